@@ -31,6 +31,7 @@
 #include "metrics/metrics.h"
 #include "healthcheck/healthcheck-stats.h"
 #include "logmsg/logmsg.h"
+#include "logmsg/logmsg-pool.h"
 #include "logsource.h"
 #include "logwriter.h"
 #include "afinter.h"
@@ -50,6 +51,8 @@
 #include "timeutils/cache.h"
 #include "multi-line/multi-line-factory.h"
 #include "filterx/filterx-globals.h"
+#include "filterx/filterx-scope.h"
+#include "pcre-match-pool.h"
 
 #include <iv.h>
 #include <iv_work.h>
@@ -241,6 +244,7 @@ app_startup(void)
   secret_storage_init();
   transport_factory_id_global_init();
   scratch_buffers_global_init();
+  pcre_match_pool_global_init();
   msg_stats_init();
   timeutils_global_init();
   multi_line_global_init();
@@ -278,8 +282,10 @@ app_shutdown(void)
   secret_storage_deinit();
   scratch_buffers_allocator_deinit();
   scratch_buffers_global_deinit();
+  pcre_match_pool_global_deinit();
   value_pairs_global_deinit();
   log_template_global_deinit();
+  log_msg_pool_thread_deinit();
   log_msg_global_deinit();
 
   afinter_global_deinit();
@@ -345,6 +351,7 @@ void
 app_thread_start(void)
 {
   scratch_buffers_allocator_init();
+  log_msg_pool_thread_init();
   dns_caching_thread_init();
   main_loop_call_thread_init();
   run_application_thread_init_hooks();
@@ -356,6 +363,9 @@ app_thread_stop(void)
   run_application_thread_deinit_hooks();
   main_loop_call_thread_deinit();
   dns_caching_thread_deinit();
+  filterx_scope_thread_deinit();
+  pcre_match_pool_thread_deinit();
+  log_msg_pool_thread_deinit();
   scratch_buffers_allocator_deinit();
   timeutils_cache_deinit();
 }
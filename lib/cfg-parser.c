@@ -149,6 +149,7 @@ static CfgLexerKeyword main_keywords[] =
   { "log_fetch_limit",    KW_LOG_FETCH_LIMIT },
   { "log_iw_size",        KW_LOG_IW_SIZE },
   { "log_msg_size",       KW_LOG_MSG_SIZE },
+  { "log_msg_pool",       KW_LOG_MSG_POOL },
   { "trim_large_messages", KW_TRIM_LARGE_MESSAGES },
   { "log_prefix",         KW_LOG_PREFIX, KWS_OBSOLETE, "program_override" },
   { "program_override",   KW_PROGRAM_OVERRIDE },
@@ -31,6 +31,7 @@
 #include "template/templates.h"
 #include "userdb.h"
 #include "logmsg/logmsg.h"
+#include "logmsg/logmsg-pool.h"
 #include "dnscache.h"
 #include "serialize.h"
 #include "plugin.h"
@@ -291,6 +292,8 @@ cfg_init(GlobalConfig *cfg)
   if (!rcptid_init(cfg->state, cfg->use_uniqid))
     return FALSE;
 
+  log_msg_pool_set_enabled(cfg->log_msg_pool);
+
   stats_reinit(&cfg->stats_options);
 
   dns_caching_update_options(&cfg->dns_cache_options);
@@ -238,6 +238,31 @@ log_src_driver_queue_method(LogPipe *s, LogMessage *msg, const LogPathOptions *p
   log_pipe_forward_msg(s, msg, path_options);
 }
 
+/* NOTE: not set up by default, as a driver overriding queue() would be
+ * bypassed, drivers opt in by setting queue_batch() themselves */
+void
+log_src_driver_queue_batch_method(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogSrcDriver *self = (LogSrcDriver *) s;
+  GlobalConfig *cfg = log_pipe_get_config(s);
+  gboolean postpone_mark = FALSE;
+
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      if (msgs[i]->flags & LF_LOCAL)
+        postpone_mark = TRUE;
+
+      log_msg_set_value(msgs[i], LM_V_SOURCE, self->super.group, self->group_len);
+    }
+
+  if (postpone_mark)
+    afinter_postpone_mark(cfg->mark_freq);
+
+  stats_counter_add(self->super.processed_group_messages, num_msgs);
+  stats_counter_add(self->received_global_messages, num_msgs);
+  log_pipe_forward_msg_batch(s, msgs, num_msgs, path_options);
+}
+
 void
 log_src_driver_init_instance(LogSrcDriver *self, GlobalConfig *cfg)
 {
@@ -332,6 +357,17 @@ log_dest_driver_queue_method(LogPipe *s, LogMessage *msg, const LogPathOptions *
   log_pipe_forward_msg(s, msg, path_options);
 }
 
+/* NOTE: not set up by default, see log_src_driver_queue_batch_method() */
+void
+log_dest_driver_queue_batch_method(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogDestDriver *self = (LogDestDriver *) s;
+
+  stats_counter_add(self->super.processed_group_messages, num_msgs);
+  stats_counter_add(self->queued_global_messages, num_msgs);
+  log_pipe_forward_msg_batch(s, msgs, num_msgs, path_options);
+}
+
 static gboolean
 log_dest_driver_pre_init_method(LogPipe *s)
 {
@@ -147,6 +147,8 @@ struct _LogSrcDriver
 gboolean log_src_driver_init_method(LogPipe *s);
 gboolean log_src_driver_deinit_method(LogPipe *s);
 void log_src_driver_queue_method(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options);
+void log_src_driver_queue_batch_method(LogPipe *s, LogMessage **msgs, gint num_msgs,
+                                       const LogPathOptions *path_options);
 void log_src_driver_init_instance(LogSrcDriver *self, GlobalConfig *cfg);
 void log_src_driver_free(LogPipe *s);
 
@@ -206,6 +208,8 @@ log_dest_driver_release_queue(LogDestDriver *self, LogQueue *q)
 gboolean log_dest_driver_init_method(LogPipe *s);
 gboolean log_dest_driver_deinit_method(LogPipe *s);
 void log_dest_driver_queue_method(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options);
+void log_dest_driver_queue_batch_method(LogPipe *s, LogMessage **msgs, gint num_msgs,
+                                        const LogPathOptions *path_options);
 
 void log_dest_driver_init_instance(LogDestDriver *self, GlobalConfig *cfg);
 void log_dest_driver_free(LogPipe *s);
@@ -54,6 +54,7 @@ static CfgLexerKeyword filter_expr_keywords[] =
   { "throttle",           KW_THROTTLE },
   { "tags",               KW_TAGS },
   { "in_list",            KW_IN_LIST },
+  { "netmask_file",       KW_NETMASK_FILE },
 #if SYSLOG_NG_ENABLE_IPV6
   { "netmask6",           KW_NETMASK6 },
 #endif
@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "filter-netmask-set.h"
+#include "filter-netmask.h"
+#include "filter-netmask6.h"
+#include "gsocket.h"
+#include "logmsg/logmsg.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/*
+ * A set of IPv4 and IPv6 networks, matching if the address of the sender
+ * is in any of them.  It is equivalent to OR-ing netmask() and netmask6()
+ * filters, but is evaluated with a single lookup in a path compressed
+ * binary trie for each address family, instead of comparing the address
+ * with every network one by one.
+ *
+ * Each node of the trie stores the first @prefix bits of its key, its
+ * children differ in the bit right after that.  As we only need to know
+ * whether there's a matching network, networks that are contained in
+ * another one are not stored at all.
+ */
+
+typedef struct _NetmaskTrieNode NetmaskTrieNode;
+struct _NetmaskTrieNode
+{
+  NetmaskTrieNode *children[2];
+  gint prefix;
+  gboolean terminal;
+  guint8 key[16];
+};
+
+typedef struct _FilterNetmaskSet
+{
+  FilterExprNode super;
+  NetmaskTrieNode *ipv4;
+  NetmaskTrieNode *ipv6;
+} FilterNetmaskSet;
+
+static inline gint
+_get_bit(const guint8 *key, gint bit)
+{
+  return (key[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+static gint
+_common_prefix_length(const guint8 *a, const guint8 *b, gint max_bits)
+{
+  gint bits = 0;
+
+  for (gint i = 0; bits < max_bits; i++)
+    {
+      guint8 diff = a[i] ^ b[i];
+
+      if (diff)
+        {
+          bits += __builtin_clz(diff) - (sizeof(unsigned int) - 1) * 8;
+          break;
+        }
+      bits += 8;
+    }
+  return MIN(bits, max_bits);
+}
+
+static NetmaskTrieNode *
+_trie_node_new(const guint8 *key, gint prefix, gboolean terminal)
+{
+  NetmaskTrieNode *node = g_new0(NetmaskTrieNode, 1);
+
+  memcpy(node->key, key, (prefix + 7) / 8);
+  if (prefix % 8)
+    node->key[prefix / 8] &= 0xFF << (8 - prefix % 8);
+  node->prefix = prefix;
+  node->terminal = terminal;
+  return node;
+}
+
+static void
+_trie_free(NetmaskTrieNode *node)
+{
+  if (!node)
+    return;
+
+  _trie_free(node->children[0]);
+  _trie_free(node->children[1]);
+  g_free(node);
+}
+
+static void
+_trie_insert(NetmaskTrieNode **slot, const guint8 *key, gint prefix)
+{
+  while (*slot)
+    {
+      NetmaskTrieNode *node = *slot;
+      gint common = _common_prefix_length(node->key, key, MIN(node->prefix, prefix));
+
+      if (common < node->prefix)
+        {
+          NetmaskTrieNode *parent;
+
+          if (common == prefix)
+            {
+              /* the new network contains the whole subtree */
+              _trie_free(node);
+              *slot = _trie_node_new(key, prefix, TRUE);
+              return;
+            }
+
+          parent = _trie_node_new(key, common, FALSE);
+          parent->children[_get_bit(node->key, common)] = node;
+          parent->children[_get_bit(key, common)] = _trie_node_new(key, prefix, TRUE);
+          *slot = parent;
+          return;
+        }
+
+      /* already contained in an existing network */
+      if (node->terminal)
+        return;
+
+      if (node->prefix == prefix)
+        {
+          _trie_free(node->children[0]);
+          _trie_free(node->children[1]);
+          node->children[0] = node->children[1] = NULL;
+          node->terminal = TRUE;
+          return;
+        }
+
+      slot = &node->children[_get_bit(key, node->prefix)];
+    }
+
+  *slot = _trie_node_new(key, prefix, TRUE);
+}
+
+static void
+_trie_insert_all(NetmaskTrieNode **slot, const NetmaskTrieNode *node)
+{
+  if (!node)
+    return;
+
+  if (node->terminal)
+    {
+      _trie_insert(slot, node->key, node->prefix);
+      return;
+    }
+
+  _trie_insert_all(slot, node->children[0]);
+  _trie_insert_all(slot, node->children[1]);
+}
+
+static gboolean
+_trie_lookup(const NetmaskTrieNode *node, const guint8 *address)
+{
+  while (node)
+    {
+      if (_common_prefix_length(node->key, address, node->prefix) < node->prefix)
+        return FALSE;
+
+      if (node->terminal)
+        return TRUE;
+
+      node = node->children[_get_bit(address, node->prefix)];
+    }
+  return FALSE;
+}
+
+static gint
+_trie_count_terminals(const NetmaskTrieNode *node)
+{
+  if (!node)
+    return 0;
+
+  if (node->terminal)
+    return 1;
+
+  return _trie_count_terminals(node->children[0]) + _trie_count_terminals(node->children[1]);
+}
+
+static gboolean
+_lookup_loopback(FilterNetmaskSet *self)
+{
+  struct in_addr loopback;
+
+  loopback.s_addr = htonl(INADDR_LOOPBACK);
+  if (_trie_lookup(self->ipv4, (const guint8 *) &loopback))
+    return TRUE;
+
+#if SYSLOG_NG_ENABLE_IPV6
+  if (_trie_lookup(self->ipv6, in6addr_loopback.s6_addr))
+    return TRUE;
+#endif
+
+  return FALSE;
+}
+
+static gboolean
+_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options)
+{
+  FilterNetmaskSet *self = (FilterNetmaskSet *) s;
+  LogMessage *msg = msgs[num_msg - 1];
+  gboolean result;
+
+  /* this follows how netmask() and netmask6() handle the different kinds of senders */
+  if (msg->saddr && g_sockaddr_inet_check(msg->saddr))
+    {
+      struct in_addr *addr = &((struct sockaddr_in *) &msg->saddr->sa)->sin_addr;
+      result = _trie_lookup(self->ipv4, (const guint8 *) addr);
+    }
+#if SYSLOG_NG_ENABLE_IPV6
+  else if (msg->saddr && g_sockaddr_inet6_check(msg->saddr))
+    {
+      struct in6_addr *addr = &((struct sockaddr_in6 *) &msg->saddr->sa)->sin6_addr;
+      result = _trie_lookup(self->ipv6, addr->s6_addr);
+    }
+#endif
+  else if (!msg->saddr || msg->saddr->sa.sa_family == AF_UNIX)
+    {
+      result = _lookup_loopback(self);
+    }
+  else
+    {
+      result = FALSE;
+    }
+
+  msg_trace("netmask set evaluation started",
+            evt_tag_int("result", result),
+            evt_tag_msg_reference(msg));
+  return result ^ s->comp;
+}
+
+static void
+_free(FilterExprNode *s)
+{
+  FilterNetmaskSet *self = (FilterNetmaskSet *) s;
+
+  _trie_free(self->ipv4);
+  _trie_free(self->ipv6);
+}
+
+static gboolean
+_parse_prefix(const gchar *str, gint max_prefix, gint *prefix)
+{
+  gchar *end;
+
+  if (!g_ascii_isdigit(*str))
+    return FALSE;
+
+  glong value = strtol(str, &end, 10);
+  if (*end || value > max_prefix)
+    return FALSE;
+
+  *prefix = value;
+  return TRUE;
+}
+
+/* only prefix lengths are accepted, IPv4 netmasks in dotted format are not */
+gboolean
+filter_netmask_set_add_cidr(FilterExprNode *s, const gchar *cidr)
+{
+  FilterNetmaskSet *self = (FilterNetmaskSet *) s;
+  const gchar *slash = strchr(cidr, '/');
+  gsize address_len = slash ? slash - cidr : strlen(cidr);
+  gboolean ipv6 = memchr(cidr, ':', address_len) != NULL;
+  gint prefix = ipv6 ? 128 : 32;
+  gchar address[INET6_ADDRSTRLEN];
+  guint8 key[16];
+
+#if !SYSLOG_NG_ENABLE_IPV6
+  if (ipv6)
+    return FALSE;
+#endif
+
+  if (address_len >= sizeof(address))
+    return FALSE;
+
+  memcpy(address, cidr, address_len);
+  address[address_len] = 0;
+
+  if (slash && !_parse_prefix(slash + 1, prefix, &prefix))
+    return FALSE;
+
+  if (inet_pton(ipv6 ? AF_INET6 : AF_INET, address, key) != 1)
+    return FALSE;
+
+  _trie_insert(ipv6 ? &self->ipv6 : &self->ipv4, key, prefix);
+  return TRUE;
+}
+
+static gboolean
+_is_mergeable(FilterExprNode *s)
+{
+  struct in_addr address;
+  gint prefix;
+
+  if (s->comp)
+    return FALSE;
+
+  if (s->eval == _eval)
+    return TRUE;
+
+  if (filter_netmask_get_network(s, &address, &prefix))
+    return TRUE;
+
+#if SYSLOG_NG_ENABLE_IPV6
+  struct in6_addr address6;
+  if (filter_netmask6_get_network(s, &address6, &prefix))
+    return TRUE;
+#endif
+
+  return FALSE;
+}
+
+static void
+_add_node(FilterNetmaskSet *self, FilterExprNode *s)
+{
+  struct in_addr address;
+  gint prefix;
+
+  if (s->eval == _eval)
+    {
+      FilterNetmaskSet *other = (FilterNetmaskSet *) s;
+
+      _trie_insert_all(&self->ipv4, other->ipv4);
+      _trie_insert_all(&self->ipv6, other->ipv6);
+      return;
+    }
+
+  if (filter_netmask_get_network(s, &address, &prefix))
+    {
+      _trie_insert(&self->ipv4, (const guint8 *) &address, prefix);
+      return;
+    }
+
+#if SYSLOG_NG_ENABLE_IPV6
+  struct in6_addr address6;
+  if (filter_netmask6_get_network(s, &address6, &prefix))
+    {
+      _trie_insert(&self->ipv6, address6.s6_addr, prefix);
+      return;
+    }
+#endif
+
+  g_assert_not_reached();
+}
+
+/*
+ * Merges two non-negated netmask(), netmask6() or netmask set nodes into a
+ * single netmask set, equivalent to "e1 or e2".  The references of the
+ * arguments are consumed in that case.  Returns NULL and leaves the
+ * arguments intact if they can't be merged.
+ */
+FilterExprNode *
+filter_netmask_set_merge(FilterExprNode *e1, FilterExprNode *e2)
+{
+  FilterExprNode *set;
+  FilterExprNode *other;
+
+  if (!_is_mergeable(e1) || !_is_mergeable(e2))
+    return NULL;
+
+  if (e1->eval == _eval)
+    {
+      set = e1;
+      other = e2;
+    }
+  else if (e2->eval == _eval)
+    {
+      set = e2;
+      other = e1;
+    }
+  else
+    {
+      set = filter_netmask_set_new();
+      _add_node((FilterNetmaskSet *) set, e1);
+      filter_expr_unref(e1);
+      other = e2;
+    }
+
+  _add_node((FilterNetmaskSet *) set, other);
+  filter_expr_unref(other);
+  return set;
+}
+
+gboolean
+filter_is_netmask_set(FilterExprNode *s)
+{
+  return s->eval == _eval;
+}
+
+/* networks contained in another one of the set are not counted */
+gint
+filter_netmask_set_get_number_of_networks(FilterExprNode *s)
+{
+  FilterNetmaskSet *self = (FilterNetmaskSet *) s;
+
+  g_assert(filter_is_netmask_set(s));
+  return _trie_count_terminals(self->ipv4) + _trie_count_terminals(self->ipv6);
+}
+
+FilterExprNode *
+filter_netmask_set_new(void)
+{
+  FilterNetmaskSet *self = g_new0(FilterNetmaskSet, 1);
+
+  filter_expr_node_init_instance(&self->super);
+  self->super.eval = _eval;
+  self->super.free_fn = _free;
+  return &self->super;
+}
+
+/*
+ * The file contains one network per line in CIDR notation, IPv4 and IPv6
+ * networks can be mixed.  Empty lines and lines starting with '#' are
+ * ignored.  The file is loaded while parsing the configuration, so it is
+ * reloaded with it.
+ */
+FilterExprNode *
+filter_netmask_file_new(const gchar *filename)
+{
+  FilterExprNode *self;
+  FILE *stream;
+  gchar line[256];
+  gint lineno = 0;
+
+  stream = fopen(filename, "r");
+  if (!stream)
+    {
+      msg_error("Error opening netmask-file() filter file",
+                evt_tag_str("file", filename),
+                evt_tag_error("errno"));
+      return NULL;
+    }
+
+  self = filter_netmask_set_new();
+  while (fgets(line, sizeof(line), stream) != NULL)
+    {
+      gchar *cidr = g_strstrip(line);
+
+      lineno++;
+      if (!cidr[0] || cidr[0] == '#')
+        continue;
+
+      if (!filter_netmask_set_add_cidr(self, cidr))
+        {
+          msg_error("Invalid network in netmask-file() filter file",
+                    evt_tag_str("file", filename),
+                    evt_tag_int("line", lineno),
+                    evt_tag_str("network", cidr));
+          filter_expr_unref(self);
+          fclose(stream);
+          return NULL;
+        }
+    }
+  fclose(stream);
+
+  return self;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef FILTER_NETMASK_SET_H_INCLUDED
+#define FILTER_NETMASK_SET_H_INCLUDED
+
+#include "filter-expr.h"
+
+FilterExprNode *filter_netmask_set_new(void);
+gboolean filter_netmask_set_add_cidr(FilterExprNode *s, const gchar *cidr);
+FilterExprNode *filter_netmask_set_merge(FilterExprNode *e1, FilterExprNode *e2);
+gboolean filter_is_netmask_set(FilterExprNode *s);
+gint filter_netmask_set_get_number_of_networks(FilterExprNode *s);
+
+FilterExprNode *filter_netmask_file_new(const gchar *filename);
+
+#endif
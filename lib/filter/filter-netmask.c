@@ -71,6 +71,24 @@ filter_netmask_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTempl
   return res ^ s->comp;
 }
 
+/* returns FALSE if @s is not a netmask() node or its netmask is not a prefix */
+gboolean
+filter_netmask_get_network(FilterExprNode *s, struct in_addr *address, gint *prefix)
+{
+  FilterNetmask *self = (FilterNetmask *) s;
+
+  if (s->eval != filter_netmask_eval)
+    return FALSE;
+
+  guint32 netmask = ntohl(self->netmask.s_addr);
+  if ((~netmask & (~netmask + 1)) != 0)
+    return FALSE;
+
+  *address = self->address;
+  *prefix = netmask ? 32 - __builtin_ctz(netmask) : 0;
+  return TRUE;
+}
+
 FilterExprNode *
 filter_netmask_new(const gchar *cidr)
 {
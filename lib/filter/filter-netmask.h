@@ -28,5 +28,6 @@
 #include "filter-expr.h"
 
 FilterExprNode *filter_netmask_new(const gchar *cidr);
+gboolean filter_netmask_get_network(FilterExprNode *s, struct in_addr *address, gint *prefix);
 
 #endif
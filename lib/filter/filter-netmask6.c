@@ -136,6 +136,20 @@ _eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions
   return result ^ s->comp;
 }
 
+/* returns FALSE if @s is not a netmask6() node or its CIDR was invalid */
+gboolean
+filter_netmask6_get_network(FilterExprNode *s, struct in6_addr *address, gint *prefix)
+{
+  FilterNetmask6 *self = (FilterNetmask6 *) s;
+
+  if (s->eval != _eval || !self->is_valid)
+    return FALSE;
+
+  *address = self->address;
+  *prefix = self->prefix;
+  return TRUE;
+}
+
 FilterExprNode *
 filter_netmask6_new(const gchar *cidr)
 {
@@ -22,6 +22,7 @@
  *
  */
 #include "filter-op.h"
+#include "filter-netmask-set.h"
 
 typedef struct _FilterOp
 {
@@ -93,9 +94,43 @@ fop_or_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg, LogTemplateEvalO
           || filter_expr_eval_with_context(self->right, msgs, num_msg, options)) ^ s->comp;
 }
 
+/*
+ * OR-ed netmask() and netmask6() filters are collapsed into a single
+ * netmask set, so that long lists of networks are matched with a single
+ * lookup.  As "a or b or c" is parsed as "(a or b) or c", we also try to
+ * merge @e2 with the right hand side of @e1.  Only adjacent operands are
+ * merged, so the evaluation order of the other operands (which might
+ * modify the message) does not change.
+ */
+static FilterExprNode *
+_merge_netmasks(FilterExprNode *e1, FilterExprNode *e2)
+{
+  FilterExprNode *merged = filter_netmask_set_merge(e1, e2);
+  if (merged)
+    return merged;
+
+  if (e1->eval == fop_or_eval && !e1->comp)
+    {
+      FilterOp *left = (FilterOp *) e1;
+
+      merged = filter_netmask_set_merge(left->right, e2);
+      if (merged)
+        {
+          left->right = merged;
+          return e1;
+        }
+    }
+
+  return NULL;
+}
+
 FilterExprNode *
 fop_or_new(FilterExprNode *e1, FilterExprNode *e2)
 {
+  FilterExprNode *merged = _merge_netmasks(e1, e2);
+  if (merged)
+    return merged;
+
   FilterOp *self = g_new0(FilterOp, 1);
 
   fop_init_instance(self);
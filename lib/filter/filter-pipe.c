@@ -53,26 +53,32 @@ log_filter_pipe_init(LogPipe *s)
   return TRUE;
 }
 
-static void
-log_filter_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+static gboolean
+_evaluate(LogFilterPipe *self, LogMessage **pmsg, const LogPathOptions *path_options)
 {
-  LogFilterPipe *self = (LogFilterPipe *) s;
   gboolean res;
 
   msg_trace(">>>>>> filter rule evaluation begin",
             evt_tag_str("rule", self->name),
-            log_pipe_location_tag(s),
-            evt_tag_msg_reference(msg));
+            log_pipe_location_tag(&self->super),
+            evt_tag_msg_reference(*pmsg));
 
-  res = filter_expr_eval_root(self->expr, &msg, path_options);
+  res = filter_expr_eval_root(self->expr, pmsg, path_options);
 
   msg_trace("<<<<<< filter rule evaluation result",
             evt_tag_str("result", res ? "matched" : "unmatched"),
             evt_tag_str("rule", self->name),
-            log_pipe_location_tag(s),
-            evt_tag_msg_reference(msg));
+            log_pipe_location_tag(&self->super),
+            evt_tag_msg_reference(*pmsg));
+  return res;
+}
+
+static void
+log_filter_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogFilterPipe *self = (LogFilterPipe *) s;
 
-  if (res)
+  if (_evaluate(self, &msg, path_options))
     {
       log_pipe_forward_msg(s, msg, path_options);
       stats_counter_inc(self->matched);
@@ -86,6 +92,29 @@ log_filter_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
     }
 }
 
+/* matching messages are compacted to the front of @msgs and forwarded as a
+ * single batch, path_options->matched is always NULL here */
+static void
+log_filter_pipe_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogFilterPipe *self = (LogFilterPipe *) s;
+  gint num_matched = 0;
+
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      LogMessage *msg = msgs[i];
+
+      if (_evaluate(self, &msg, path_options))
+        msgs[num_matched++] = msg;
+      else
+        log_msg_drop(msg, path_options, AT_PROCESSED);
+    }
+
+  stats_counter_add(self->matched, num_matched);
+  stats_counter_add(self->not_matched, num_msgs - num_matched);
+  log_pipe_forward_msg_batch(s, msgs, num_matched, path_options);
+}
+
 static LogPipe *
 log_filter_pipe_clone(LogPipe *s)
 {
@@ -125,6 +154,7 @@ log_filter_pipe_new(FilterExprNode *expr, GlobalConfig *cfg)
   self->super.flags |= PIF_CONFIG_RELATED + PIF_SYNC_FILTERX;
   self->super.init = log_filter_pipe_init;
   self->super.queue = log_filter_pipe_queue;
+  self->super.queue_batch = log_filter_pipe_queue_batch;
   self->super.free_fn = log_filter_pipe_free;
   self->super.clone = log_filter_pipe_clone;
   self->expr = expr;
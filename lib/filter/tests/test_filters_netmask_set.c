@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "test_filters_common.h"
+
+#include "filter/filter-expr.h"
+#include "filter/filter-netmask.h"
+#include "filter/filter-netmask6.h"
+#include "filter/filter-netmask-set.h"
+#include "filter/filter-op.h"
+#include "filter/filter-pri.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MSG "<15>Oct 15 16:19:01 host openvpn[2499]: PTHREAD support initialized"
+
+TestSuite(netmask_set, .init = setup, .fini = teardown);
+
+static FilterExprNode *
+_create_or_chain(void)
+{
+  FilterExprNode *f;
+
+  f = fop_or_new(filter_netmask_new("10.10.0.0/16"), filter_netmask_new("192.168.1.0/24"));
+  f = fop_or_new(f, filter_netmask_new("10.10.10.0/24"));
+  f = fop_or_new(f, filter_netmask_new("172.16.0.1"));
+#if SYSLOG_NG_ENABLE_IPV6
+  f = fop_or_new(f, filter_netmask6_new("2001:db8::/32"));
+#endif
+  return f;
+}
+
+Test(netmask_set, test_or_chain_of_netmasks_is_merged)
+{
+  FilterExprNode *f = _create_or_chain();
+
+  cr_assert(filter_is_netmask_set(f), "OR-ed netmask() filters were not merged");
+  /* 10.10.10.0/24 is contained in 10.10.0.0/16 */
+#if SYSLOG_NG_ENABLE_IPV6
+  cr_assert_eq(filter_netmask_set_get_number_of_networks(f), 4);
+#else
+  cr_assert_eq(filter_netmask_set_get_number_of_networks(f), 3);
+#endif
+  filter_expr_unref(f);
+}
+
+Test(netmask_set, test_merged_netmasks_match_any_of_the_networks)
+{
+  testcase_with_socket(MSG, "10.10.0.1", _create_or_chain(), TRUE);
+  testcase_with_socket(MSG, "10.10.10.1", _create_or_chain(), TRUE);
+  testcase_with_socket(MSG, "10.11.0.1", _create_or_chain(), FALSE);
+  testcase_with_socket(MSG, "192.168.1.254", _create_or_chain(), TRUE);
+  testcase_with_socket(MSG, "192.168.2.1", _create_or_chain(), FALSE);
+  testcase_with_socket(MSG, "172.16.0.1", _create_or_chain(), TRUE);
+  testcase_with_socket(MSG, "172.16.0.2", _create_or_chain(), FALSE);
+  testcase(MSG, _create_or_chain(), FALSE);
+#if SYSLOG_NG_ENABLE_IPV6
+  testcase_with_socket(MSG, "2001:db8::1", _create_or_chain(), TRUE);
+  testcase_with_socket(MSG, "2001:db9::1", _create_or_chain(), FALSE);
+#endif
+}
+
+Test(netmask_set, test_senders_without_address_match_loopback)
+{
+  testcase(MSG, fop_or_new(filter_netmask_new("10.0.0.0/8"), filter_netmask_new("127.0.0.0/8")), TRUE);
+#if SYSLOG_NG_ENABLE_IPV6
+  testcase(MSG, fop_or_new(filter_netmask_new("10.0.0.0/8"), filter_netmask6_new("::1/128")), TRUE);
+#endif
+}
+
+Test(netmask_set, test_operands_are_only_merged_when_evaluation_order_is_kept)
+{
+  FilterExprNode *negated = filter_netmask_new("10.10.0.0/16");
+  negated->comp = TRUE;
+
+  FilterExprNode *f = fop_or_new(negated, filter_netmask_new("10.10.0.0/24"));
+  cr_assert_not(filter_is_netmask_set(f));
+  testcase_with_socket(MSG, "10.10.0.1", f, TRUE);
+
+  f = fop_or_new(filter_netmask_new("10.10.0.0/16"), filter_facility_new(0));
+  f = fop_or_new(f, filter_netmask_new("192.168.0.0/16"));
+  cr_assert_not(filter_is_netmask_set(f));
+  testcase_with_socket(MSG, "192.168.0.1", f, TRUE);
+}
+
+static FilterExprNode *
+_create_set(const gchar *cidrs[])
+{
+  FilterExprNode *f = filter_netmask_set_new();
+
+  for (gint i = 0; cidrs[i]; i++)
+    cr_assert(filter_netmask_set_add_cidr(f, cidrs[i]), "Invalid network: %s", cidrs[i]);
+  return f;
+}
+
+Test(netmask_set, test_network_replaces_the_networks_it_contains)
+{
+  const gchar *cidrs[] = { "10.10.10.0/24", "10.10.20.0/24", "10.10.0.0/16", NULL };
+  FilterExprNode *f = _create_set(cidrs);
+
+  cr_assert_eq(filter_netmask_set_get_number_of_networks(f), 1);
+  filter_expr_unref(f);
+
+  testcase_with_socket(MSG, "10.10.10.1", _create_set(cidrs), TRUE);
+  testcase_with_socket(MSG, "10.10.20.1", _create_set(cidrs), TRUE);
+  testcase_with_socket(MSG, "10.10.30.1", _create_set(cidrs), TRUE);
+  testcase_with_socket(MSG, "10.11.0.1", _create_set(cidrs), FALSE);
+}
+
+Test(netmask_set, test_sibling_networks_are_split)
+{
+  const gchar *siblings[] = { "192.168.1.0/24", "192.168.2.0/24", NULL };
+  FilterExprNode *f = _create_set(siblings);
+
+  cr_assert_eq(filter_netmask_set_get_number_of_networks(f), 2);
+  filter_expr_unref(f);
+
+  testcase_with_socket(MSG, "192.168.0.1", _create_set(siblings), FALSE);
+  testcase_with_socket(MSG, "192.168.1.1", _create_set(siblings), TRUE);
+  testcase_with_socket(MSG, "192.168.2.1", _create_set(siblings), TRUE);
+  testcase_with_socket(MSG, "192.168.3.1", _create_set(siblings), FALSE);
+  testcase_with_socket(MSG, "192.169.1.1", _create_set(siblings), FALSE);
+
+  /* 192.168.3.0/24 splits the node of 192.168.2.0/24 */
+  const gchar *three_siblings[] = { "192.168.1.0/24", "192.168.2.0/24", "192.168.3.0/24", NULL };
+  f = _create_set(three_siblings);
+
+  cr_assert_eq(filter_netmask_set_get_number_of_networks(f), 3);
+  filter_expr_unref(f);
+
+  testcase_with_socket(MSG, "192.168.0.1", _create_set(three_siblings), FALSE);
+  testcase_with_socket(MSG, "192.168.2.1", _create_set(three_siblings), TRUE);
+  testcase_with_socket(MSG, "192.168.3.1", _create_set(three_siblings), TRUE);
+  testcase_with_socket(MSG, "192.168.4.1", _create_set(three_siblings), FALSE);
+}
+
+Test(netmask_set, test_default_route_matches_every_ipv4_address)
+{
+  const gchar *cidrs[] = { "10.10.0.0/16", "0.0.0.0/0", "192.168.1.0/24", NULL };
+  FilterExprNode *f = _create_set(cidrs);
+
+  cr_assert_eq(filter_netmask_set_get_number_of_networks(f), 1);
+  filter_expr_unref(f);
+
+  testcase_with_socket(MSG, "0.0.0.0", _create_set(cidrs), TRUE);
+  testcase_with_socket(MSG, "10.10.0.1", _create_set(cidrs), TRUE);
+  testcase_with_socket(MSG, "172.16.0.1", _create_set(cidrs), TRUE);
+  testcase_with_socket(MSG, "255.255.255.255", _create_set(cidrs), TRUE);
+  testcase(MSG, _create_set(cidrs), TRUE);
+#if SYSLOG_NG_ENABLE_IPV6
+  testcase_with_socket(MSG, "2001:db8::1", _create_set(cidrs), FALSE);
+#endif
+}
+
+static gchar *
+_create_netmask_file(const gchar *contents)
+{
+  gchar *filename;
+  gint fd = g_file_open_tmp("netmask-file-XXXXXX", &filename, NULL);
+
+  cr_assert(fd >= 0);
+  cr_assert_eq(write(fd, contents, strlen(contents)), (gssize) strlen(contents));
+  close(fd);
+  return filename;
+}
+
+Test(netmask_set, test_netmask_file)
+{
+  gchar *filename = _create_netmask_file("# allowlist\n"
+                                         "10.10.0.0/16\n"
+                                         "\n"
+                                         "  192.168.1.1  \n"
+#if SYSLOG_NG_ENABLE_IPV6
+                                         "2001:db8::/32\n"
+#endif
+                                        );
+
+  testcase_with_socket(MSG, "10.10.0.1", filter_netmask_file_new(filename), TRUE);
+  testcase_with_socket(MSG, "192.168.1.1", filter_netmask_file_new(filename), TRUE);
+  testcase_with_socket(MSG, "192.168.1.2", filter_netmask_file_new(filename), FALSE);
+#if SYSLOG_NG_ENABLE_IPV6
+  testcase_with_socket(MSG, "2001:db8::1", filter_netmask_file_new(filename), TRUE);
+  testcase_with_socket(MSG, "2001:db9::1", filter_netmask_file_new(filename), FALSE);
+#endif
+
+  /* netmask-file() is merged with netmask() as well */
+  FilterExprNode *f = fop_or_new(filter_netmask_file_new(filename), filter_netmask_new("10.20.0.0/16"));
+  cr_assert(filter_is_netmask_set(f));
+  testcase_with_socket(MSG, "10.20.0.1", f, TRUE);
+
+  g_unlink(filename);
+  g_free(filename);
+}
+
+Test(netmask_set, test_netmask_file_with_invalid_networks)
+{
+  gchar *filename = _create_netmask_file("10.10.0.0/16\n"
+                                         "10.10.0.0/33\n");
+  cr_assert_null(filter_netmask_file_new(filename));
+  g_unlink(filename);
+  g_free(filename);
+
+  filename = _create_netmask_file("not-an-address\n");
+  cr_assert_null(filter_netmask_file_new(filename));
+  g_unlink(filename);
+  g_free(filename);
+
+  cr_assert_null(filter_netmask_file_new("/nonexistent/netmask-file"));
+}
@@ -29,6 +29,7 @@
 #include "filterx/object-dict-interface.h"
 #include "filterx/expr-function.h"
 #include "compat/pcre.h"
+#include "pcre-match-pool.h"
 #include "scratch-buffers.h"
 
 #define FILTERX_FUNC_REGEXP_SUBST_USAGE "Usage: regexp_subst(string, pattern, replacement, " \
@@ -57,8 +58,7 @@ _state_init(FilterXReMatchState *state)
 static void
 _state_cleanup(FilterXReMatchState *state)
 {
-  if (state->match_data)
-    pcre2_match_data_free(state->match_data);
+  pcre_match_pool_release(state->match_data);
   filterx_object_unref(state->lhs_obj);
   memset(state, 0, sizeof(FilterXReMatchState));
 }
@@ -107,9 +107,8 @@ _compile_pattern_defaults(const gchar *pattern)
 static gboolean
 _match_inner(FilterXReMatchState *state, pcre2_code_8 *pattern, gint start_offset)
 {
-  gint rc = pcre2_match(pattern, (PCRE2_SPTR) state->lhs_str, (PCRE2_SIZE) state->lhs_str_len, (PCRE2_SIZE) start_offset,
-                        0,
-                        state->match_data, NULL);
+  gint rc = pcre_match_pool_match(PCRE_MATCH_POOL_FILTERX, pattern, state->lhs_str, state->lhs_str_len, start_offset, 0,
+                                  state->match_data);
   if (rc < 0)
     {
       switch (rc)
@@ -152,7 +151,7 @@ _match(FilterXExpr *lhs_expr, pcre2_code_8 *pattern, FilterXReMatchState *state)
       goto error;
     }
 
-  state->match_data = pcre2_match_data_create_from_pattern(pattern, NULL);
+  state->match_data = pcre_match_pool_acquire(pattern);
   return _match_inner(state, pattern, 0);
 error:
   _state_cleanup(state);
@@ -32,7 +32,8 @@ typedef struct _FilterXVariableExpr
 {
   FilterXExpr super;
   FilterXObject *variable_name;
-  NVHandle handle;
+  FilterXVariableHandle handle;
+  NVHandle nv_handle;
   gboolean declared;
 } FilterXVariableExpr;
 
@@ -41,7 +42,7 @@ _pull_variable_from_message(FilterXVariableExpr *self, FilterXEvalContext *conte
 {
   gssize value_len;
   LogMessageValueType t;
-  const gchar *value = log_msg_get_value_if_set_with_type(msg, self->handle, &value_len, &t);
+  const gchar *value = log_msg_get_value_if_set_with_type(msg, self->nv_handle, &value_len, &t);
   if (!value)
     {
       filterx_eval_push_error("No such name-value pair in the log message", &self->super, self->variable_name);
@@ -130,9 +131,12 @@ _isset(FilterXExpr *s)
   if (variable)
     return filterx_variable_is_set(variable);
 
+  if (filterx_variable_handle_is_floating(self->handle))
+    return FALSE;
+
   FilterXEvalContext *context = filterx_eval_get_context();
   LogMessage *msg = context->msgs[0];
-  return log_msg_is_value_set(msg, self->handle);
+  return log_msg_is_value_set(msg, self->nv_handle);
 }
 
 static gboolean
@@ -148,8 +152,11 @@ _unset(FilterXExpr *s)
       return TRUE;
     }
 
+  if (filterx_variable_handle_is_floating(self->handle))
+    return TRUE;
+
   LogMessage *msg = context->msgs[0];
-  if (log_msg_is_value_set(msg, self->handle))
+  if (log_msg_is_value_set(msg, self->nv_handle))
     _whiteout_variable(self, context);
 
   return TRUE;
@@ -179,6 +186,7 @@ filterx_variable_expr_new(FilterXString *name, FilterXVariableType type)
 
   self->variable_name = (FilterXObject *) name;
   self->handle = filterx_scope_map_variable_to_handle(filterx_string_get_value(self->variable_name, NULL), type);
+  self->nv_handle = filterx_variable_handle_get_nv_handle(self->handle);
 
   return &self->super;
 }
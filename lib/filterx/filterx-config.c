@@ -30,6 +30,7 @@ filterx_config_free(ModuleConfig *s)
 {
   FilterXConfig *self = (FilterXConfig *) s;
 
+  g_hash_table_unref(self->frozen_strings);
   g_ptr_array_unref(self->frozen_objects);
   module_config_free_method(s);
 }
@@ -41,6 +42,7 @@ filterx_config_new(GlobalConfig *cfg)
 
   self->super.free_fn = filterx_config_free;
   self->frozen_objects = g_ptr_array_new_with_free_func((GDestroyNotify) filterx_object_unfreeze_and_free);
+  self->frozen_strings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
   return self;
 }
 
@@ -68,8 +70,15 @@ filterx_config_freeze_object(GlobalConfig *cfg, FilterXObject *object)
 FilterXString *
 filterx_config_frozen_string(GlobalConfig *cfg, const gchar *str)
 {
-  FilterXString *frozen_str = filterx_string_typed_new(str);
+  FilterXConfig *fxc = filterx_config_get(cfg);
+
+  FilterXString *frozen_str = g_hash_table_lookup(fxc->frozen_strings, str);
+  if (frozen_str)
+    return frozen_str;
+
+  frozen_str = filterx_string_typed_new(str);
   filterx_config_freeze_object(cfg, (FilterXObject *) frozen_str);
+  g_hash_table_insert(fxc->frozen_strings, g_strdup(str), frozen_str);
 
   return frozen_str;
 }
@@ -31,6 +31,8 @@ typedef struct _FilterXConfig
 {
   ModuleConfig super;
   GPtrArray *frozen_objects;
+  /* frozen strings are interned, so equal attribute names share the same object */
+  GHashTable *frozen_strings;
 } FilterXConfig;
 
 FilterXConfig *filterx_config_get(GlobalConfig *cfg);
@@ -234,6 +234,8 @@ filterx_global_init(void)
 
   filterx_type_init(&FILTERX_TYPE_NAME(json_object));
   filterx_type_init(&FILTERX_TYPE_NAME(json_array));
+  filterx_type_init(&FILTERX_TYPE_NAME(json_double));
+  filterx_type_init(&FILTERX_TYPE_NAME(json_uint64));
   filterx_type_init(&FILTERX_TYPE_NAME(datetime));
   filterx_type_init(&FILTERX_TYPE_NAME(message_value));
 
@@ -249,6 +251,8 @@ filterx_global_deinit(void)
   filterx_null_global_deinit();
   filterx_primitive_global_deinit();
   filterx_types_deinit();
+  filterx_scope_thread_deinit();
+  filterx_scope_global_deinit();
 }
 
 FilterXObject *
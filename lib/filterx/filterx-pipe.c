@@ -46,19 +46,17 @@ log_filterx_pipe_init(LogPipe *s)
 
 
 static void
-log_filterx_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+_evaluate_and_forward(LogFilterXPipe *self, LogMessage *msg, LogPathOptions *local_path_options)
 {
-  LogFilterXPipe *self = (LogFilterXPipe *) s;
+  FilterXEvalContext *parent_context = local_path_options->filterx_context;
   FilterXEvalContext eval_context;
-  LogPathOptions local_path_options;
   gboolean res;
 
-  path_options = log_path_options_chain(&local_path_options, path_options);
-  filterx_eval_init_context(&eval_context, path_options->filterx_context);
+  filterx_eval_init_context(&eval_context, parent_context);
 
   msg_trace(">>>>>> filterx rule evaluation begin",
             evt_tag_str("rule", self->name),
-            log_pipe_location_tag(s),
+            log_pipe_location_tag(&self->super),
             evt_tag_msg_reference(msg));
 
   NVTable *payload = nv_table_ref(msg->payload);
@@ -67,26 +65,52 @@ log_filterx_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_o
   msg_trace("<<<<<< filterx rule evaluation result",
             evt_tag_str("result", res ? "matched" : "unmatched"),
             evt_tag_str("rule", self->name),
-            log_pipe_location_tag(s),
+            log_pipe_location_tag(&self->super),
             evt_tag_int("dirty", filterx_scope_is_dirty(eval_context.scope)),
             evt_tag_msg_reference(msg));
 
-  local_path_options.filterx_context = &eval_context;
+  local_path_options->filterx_context = &eval_context;
   if (res)
     {
-      log_pipe_forward_msg(s, msg, path_options);
+      log_pipe_forward_msg(&self->super, msg, local_path_options);
     }
   else
     {
-      if (path_options->matched)
-        (*path_options->matched) = FALSE;
-      log_msg_drop(msg, path_options, AT_PROCESSED);
+      if (local_path_options->matched)
+        (*local_path_options->matched) = FALSE;
+      log_msg_drop(msg, local_path_options, AT_PROCESSED);
     }
+  local_path_options->filterx_context = parent_context;
 
   filterx_eval_deinit_context(&eval_context);
   nv_table_unref(payload);
 }
 
+static void
+log_filterx_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogFilterXPipe *self = (LogFilterXPipe *) s;
+  LogPathOptions local_path_options;
+
+  log_path_options_chain(&local_path_options, path_options);
+  _evaluate_and_forward(self, msg, &local_path_options);
+}
+
+/*
+ * Every message leaves us with its own FilterXEvalContext, so the batch
+ * is forwarded one-by-one, only the path options are set up once.
+ */
+static void
+log_filterx_pipe_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogFilterXPipe *self = (LogFilterXPipe *) s;
+  LogPathOptions local_path_options;
+
+  log_path_options_chain(&local_path_options, path_options);
+  for (gint i = 0; i < num_msgs; i++)
+    _evaluate_and_forward(self, msgs[i], &local_path_options);
+}
+
 static LogPipe *
 log_filterx_pipe_clone(LogPipe *s)
 {
@@ -117,6 +141,7 @@ log_filterx_pipe_new(FilterXExpr *block, GlobalConfig *cfg)
   self->super.flags = (self->super.flags | PIF_CONFIG_RELATED);
   self->super.init = log_filterx_pipe_init;
   self->super.queue = log_filterx_pipe_queue;
+  self->super.queue_batch = log_filterx_pipe_queue_batch;
   self->super.free_fn = log_filterx_pipe_free;
   self->super.clone = log_filterx_pipe_clone;
   self->block = block;
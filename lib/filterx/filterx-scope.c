@@ -22,14 +22,102 @@
  */
 #include "filterx/filterx-scope.h"
 #include "scratch-buffers.h"
+#include "tls-support.h"
+
+#include <string.h>
 
 #define FILTERX_HANDLE_FLOATING_BIT (1UL << 31)
 #define FILTERX_SCOPE_MAX_GENERATION ((1UL << 20) - 1)
 
+#define FILTERX_VARIABLE_SLOTS_PER_CHUNK 1024
+#define FILTERX_VARIABLE_MAX_CHUNKS 4096
+
+/* number of released scopes retained for reuse by each thread */
+#define FILTERX_SCOPE_POOL_SIZE 16
+
+/*
+ * Variable handles are dense slot indexes, allocated at configuration
+ * parse time, when the variable references are compiled.  A slot maps to
+ * the NVHandle of the variable name, the same name has different slots
+ * depending on whether it is floating or tied to the message.
+ *
+ * Slots are stored in chunks that never move, so that the mapping can be
+ * read without locking while new configurations are being parsed.
+ */
+static struct
+{
+  GMutex lock;
+  /* key: NVHandle | FILTERX_HANDLE_FLOATING_BIT, value: slot + 1 */
+  GHashTable *slots_by_key;
+  NVHandle *chunks[FILTERX_VARIABLE_MAX_CHUNKS];
+  guint32 num_slots;
+} variable_slots;
+
+TLS_BLOCK_START
+{
+  FilterXScope *filterx_scope_pool[FILTERX_SCOPE_POOL_SIZE];
+  gint filterx_scope_pool_len;
+}
+TLS_BLOCK_END;
+
+#define filterx_scope_pool  __tls_deref(filterx_scope_pool)
+#define filterx_scope_pool_len  __tls_deref(filterx_scope_pool_len)
+
+static inline guint32
+_variable_handle_get_slot(FilterXVariableHandle handle)
+{
+  return handle & ~FILTERX_HANDLE_FLOATING_BIT;
+}
+
+static inline NVHandle
+_variable_slot_get_nv_handle(guint32 slot)
+{
+  return variable_slots.chunks[slot / FILTERX_VARIABLE_SLOTS_PER_CHUNK][slot % FILTERX_VARIABLE_SLOTS_PER_CHUNK];
+}
+
+static guint32
+_allocate_variable_slot(NVHandle nv_handle, gboolean floating)
+{
+  guint32 key = nv_handle | (floating ? FILTERX_HANDLE_FLOATING_BIT : 0);
+  guint32 slot;
+
+  g_mutex_lock(&variable_slots.lock);
+  if (!variable_slots.slots_by_key)
+    variable_slots.slots_by_key = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  gpointer p = g_hash_table_lookup(variable_slots.slots_by_key, GUINT_TO_POINTER(key));
+  if (p)
+    {
+      slot = GPOINTER_TO_UINT(p) - 1;
+      goto exit;
+    }
+
+  slot = variable_slots.num_slots;
+  guint32 chunk = slot / FILTERX_VARIABLE_SLOTS_PER_CHUNK;
+  g_assert(chunk < FILTERX_VARIABLE_MAX_CHUNKS);
+
+  if (!variable_slots.chunks[chunk])
+    variable_slots.chunks[chunk] = g_new0(NVHandle, FILTERX_VARIABLE_SLOTS_PER_CHUNK);
+  variable_slots.chunks[chunk][slot % FILTERX_VARIABLE_SLOTS_PER_CHUNK] = nv_handle;
+  variable_slots.num_slots++;
+  g_hash_table_insert(variable_slots.slots_by_key, GUINT_TO_POINTER(key), GUINT_TO_POINTER(slot + 1));
+
+exit:
+  g_mutex_unlock(&variable_slots.lock);
+  return slot;
+}
+
+NVHandle
+filterx_variable_handle_get_nv_handle(FilterXVariableHandle handle)
+{
+  return _variable_slot_get_nv_handle(_variable_handle_get_slot(handle));
+}
+
 struct _FilterXVariable
 {
   /* the MSB indicates that the variable is a floating one */
   FilterXVariableHandle handle;
+  NVHandle nv_handle;
   /*
    * assigned -- Indicates that the variable was assigned to a new value
    *
@@ -56,7 +144,7 @@ filterx_variable_is_floating(FilterXVariable *v)
 static NVHandle
 filterx_variable_get_nv_handle(FilterXVariable *v)
 {
-  return v->handle & ~FILTERX_HANDLE_FLOATING_BIT;
+  return v->nv_handle;
 }
 
 const gchar *
@@ -101,41 +189,44 @@ _variable_free(FilterXVariable *v)
 struct _FilterXScope
 {
   GAtomicCounter ref_cnt;
+  /* variables in the order of registration */
   GArray *variables;
+  /* indexed by slot, the index of the variable in @variables + 1, or 0 if not present */
+  guint32 *variable_index;
+  guint32 variable_index_size;
   guint32 generation:20, write_protected, dirty, syncable;
 };
 
-static gboolean
-_lookup_variable(FilterXScope *self, FilterXVariableHandle handle, FilterXVariable **v_slot)
+static inline FilterXVariable *
+_lookup_variable(FilterXScope *self, FilterXVariableHandle handle)
 {
-  gint l, h, m;
+  guint32 slot = _variable_handle_get_slot(handle);
 
-  /* open-coded binary search */
-  l = 0;
-  h = self->variables->len - 1;
-  while (l <= h)
-    {
-      m = (l + h) >> 1;
+  if (slot >= self->variable_index_size || self->variable_index[slot] == 0)
+    return NULL;
+  return &g_array_index(self->variables, FilterXVariable, self->variable_index[slot] - 1);
+}
 
-      FilterXVariable *m_elem = &g_array_index(self->variables, FilterXVariable, m);
+static FilterXVariable *
+_append_variable(FilterXScope *self, const FilterXVariable *v)
+{
+  guint32 slot = _variable_handle_get_slot(v->handle);
 
-      FilterXVariableHandle mv = m_elem->handle;
-      if (mv == handle)
-        {
-          *v_slot = m_elem;
-          return TRUE;
-        }
-      else if (mv > handle)
-        {
-          h = m - 1;
-        }
-      else
-        {
-          l = m + 1;
-        }
+  if (slot >= self->variable_index_size)
+    {
+      guint32 new_size = MAX(self->variable_index_size, 64);
+
+      while (new_size <= slot)
+        new_size *= 2;
+      self->variable_index = g_renew(guint32, self->variable_index, new_size);
+      memset(&self->variable_index[self->variable_index_size], 0,
+             (new_size - self->variable_index_size) * sizeof(self->variable_index[0]));
+      self->variable_index_size = new_size;
     }
-  *v_slot = &g_array_index(self->variables, FilterXVariable, l);
-  return FALSE;
+
+  g_array_append_val(self->variables, *v);
+  self->variable_index[slot] = self->variables->len;
+  return &g_array_index(self->variables, FilterXVariable, self->variables->len - 1);
 }
 
 void
@@ -157,18 +248,19 @@ filterx_scope_map_variable_to_handle(const gchar *name, FilterXVariableType type
     name++;
 
   NVHandle nv_handle = log_msg_get_value_handle(name);
+  guint32 slot = _allocate_variable_slot(nv_handle, type != FX_VAR_MESSAGE);
 
   if (type == FX_VAR_MESSAGE)
-    return (FilterXVariableHandle) nv_handle;
-  return (FilterXVariableHandle) nv_handle | FILTERX_HANDLE_FLOATING_BIT;
+    return (FilterXVariableHandle) slot;
+  return (FilterXVariableHandle) slot | FILTERX_HANDLE_FLOATING_BIT;
 }
 
 FilterXVariable *
 filterx_scope_lookup_variable(FilterXScope *self, FilterXVariableHandle handle)
 {
-  FilterXVariable *v;
+  FilterXVariable *v = _lookup_variable(self, handle);
 
-  if (_lookup_variable(self, handle, &v))
+  if (v)
     {
       if (filterx_variable_handle_is_floating(handle) &&
           !v->declared && v->generation != self->generation)
@@ -185,7 +277,8 @@ _register_variable(FilterXScope *self,
 {
   FilterXVariable v, *v_slot;
 
-  if (_lookup_variable(self, handle, &v_slot))
+  v_slot = _lookup_variable(self, handle);
+  if (v_slot)
     {
       /* already present */
       if (v_slot->generation != self->generation)
@@ -200,18 +293,14 @@ _register_variable(FilterXScope *self,
         }
       return v_slot;
     }
-  /* turn v_slot into an index */
-  gsize v_index = ((guint8 *) v_slot - (guint8 *) self->variables->data) / sizeof(FilterXVariable);
-  g_assert(v_index <= self->variables->len);
-  g_assert(&g_array_index(self->variables, FilterXVariable, v_index) == v_slot);
 
   v.handle = handle;
+  v.nv_handle = filterx_variable_handle_get_nv_handle(handle);
   v.assigned = FALSE;
+  v.declared = FALSE;
   v.value = filterx_object_ref(initial_value);
   v.generation = self->generation;
-  g_array_insert_val(self->variables, v_index, v);
-
-  return &g_array_index(self->variables, FilterXVariable, v_index);
+  return _append_variable(self, &v);
 }
 
 FilterXVariable *
@@ -242,9 +331,31 @@ filterx_scope_register_declared_variable(FilterXScope *self,
   return v;
 }
 
+static gint
+_compare_variables_by_nv_handle(gconstpointer a, gconstpointer b)
+{
+  const FilterXVariable *v1 = *(const FilterXVariable **) a;
+  const FilterXVariable *v2 = *(const FilterXVariable **) b;
+  gboolean floating1 = filterx_variable_handle_is_floating(v1->handle);
+  gboolean floating2 = filterx_variable_handle_is_floating(v2->handle);
+
+  if (floating1 != floating2)
+    return floating1 - floating2;
+  return (v1->nv_handle > v2->nv_handle) - (v1->nv_handle < v2->nv_handle);
+}
+
+/*
+ * Variables are stored in registration order, but they are visited in the
+ * same order as when they were kept sorted by their handle: the variables
+ * tied to the message first, then the floating ones, ordered by NVHandle
+ * in both groups.  This is the order vars() lists them in.
+ */
 gboolean
 filterx_scope_foreach_variable(FilterXScope *self, FilterXScopeForeachFunc func, gpointer user_data)
 {
+  GPtrArray *variables = g_ptr_array_sized_new(self->variables->len);
+  gboolean result = TRUE;
+
   for (gsize i = 0; i < self->variables->len; i++)
     {
       FilterXVariable *variable = &g_array_index(self->variables, FilterXVariable, i);
@@ -256,11 +367,21 @@ filterx_scope_foreach_variable(FilterXScope *self, FilterXScopeForeachFunc func,
           !variable->declared && variable->generation != self->generation)
         continue;
 
-      if (!func(variable, user_data))
-        return FALSE;
+      g_ptr_array_add(variables, variable);
+    }
+  g_ptr_array_sort(variables, _compare_variables_by_nv_handle);
+
+  for (guint i = 0; i < variables->len; i++)
+    {
+      if (!func(g_ptr_array_index(variables, i), user_data))
+        {
+          result = FALSE;
+          break;
+        }
     }
 
-  return TRUE;
+  g_ptr_array_free(variables, TRUE);
+  return result;
 }
 
 /*
@@ -317,7 +438,7 @@ filterx_scope_sync(FilterXScope *self, LogMessage *msg)
           msg_trace("Filterx sync: whiteout variable, unsetting in message",
                     evt_tag_str("variable", log_msg_get_value_name(filterx_variable_get_nv_handle(v), NULL)));
           /* we need to unset */
-          log_msg_unset_value(msg, v->handle);
+          log_msg_unset_value(msg, v->nv_handle);
           v->assigned = FALSE;
         }
       else if (v->assigned || v->value->modified_in_place)
@@ -330,7 +451,7 @@ filterx_scope_sync(FilterXScope *self, LogMessage *msg)
           g_string_truncate(buffer, 0);
           if (!filterx_object_marshal(v->value, buffer, &t))
             g_assert_not_reached();
-          log_msg_set_value_with_type(msg, v->handle, buffer->str, buffer->len, t);
+          log_msg_set_value_with_type(msg, v->nv_handle, buffer->str, buffer->len, t);
           v->value->modified_in_place = FALSE;
           v->assigned = FALSE;
         }
@@ -346,7 +467,16 @@ filterx_scope_sync(FilterXScope *self, LogMessage *msg)
 FilterXScope *
 filterx_scope_new(void)
 {
-  FilterXScope *self = g_new0(FilterXScope, 1);
+  FilterXScope *self;
+
+  if (filterx_scope_pool_len > 0)
+    {
+      self = filterx_scope_pool[--filterx_scope_pool_len];
+      g_atomic_counter_set(&self->ref_cnt, 1);
+      return self;
+    }
+
+  self = g_new0(FilterXScope, 1);
 
   g_atomic_counter_set(&self->ref_cnt, 1);
   self->variables = g_array_sized_new(FALSE, TRUE, sizeof(FilterXVariable), 16);
@@ -359,23 +489,21 @@ filterx_scope_clone(FilterXScope *other)
 {
   FilterXScope *self = filterx_scope_new();
 
-  for (gint src_index = 0, dst_index = 0; src_index < other->variables->len; src_index++)
+  for (gint src_index = 0; src_index < other->variables->len; src_index++)
     {
       FilterXVariable *v = &g_array_index(other->variables, FilterXVariable, src_index);
 
       if (v->declared || !filterx_variable_is_floating(v))
         {
-          g_array_append_val(self->variables, *v);
-          FilterXVariable *v_clone = &g_array_index(self->variables, FilterXVariable, dst_index);
+          FilterXVariable *v_clone = _append_variable(self, v);
 
           v_clone->generation = 0;
           if (v->value)
             v_clone->value = filterx_object_clone(v->value);
           else
             v_clone->value = NULL;
-          dst_index++;
           msg_trace("Filterx scope, cloning scope variable",
-                    evt_tag_str("variable", log_msg_get_value_name((v->handle & ~FILTERX_HANDLE_FLOATING_BIT), NULL)));
+                    evt_tag_str("variable", log_msg_get_value_name(v->nv_handle, NULL)));
         }
     }
 
@@ -416,12 +544,43 @@ filterx_scope_make_writable(FilterXScope **pself)
 }
 
 static void
-_free(FilterXScope *self)
+_destroy(FilterXScope *self)
 {
   g_array_free(self->variables, TRUE);
+  g_free(self->variable_index);
   g_free(self);
 }
 
+/* drop all variables, while retaining the allocated storage */
+static void
+_reset(FilterXScope *self)
+{
+  for (guint i = 0; i < self->variables->len; i++)
+    {
+      FilterXVariable *v = &g_array_index(self->variables, FilterXVariable, i);
+      self->variable_index[_variable_handle_get_slot(v->handle)] = 0;
+    }
+  if (self->variables->len > 0)
+    g_array_remove_range(self->variables, 0, self->variables->len);
+
+  self->generation = 0;
+  self->write_protected = FALSE;
+  self->dirty = FALSE;
+  self->syncable = FALSE;
+}
+
+static void
+_free(FilterXScope *self)
+{
+  if (filterx_scope_pool_len < FILTERX_SCOPE_POOL_SIZE)
+    {
+      _reset(self);
+      filterx_scope_pool[filterx_scope_pool_len++] = self;
+      return;
+    }
+  _destroy(self);
+}
+
 FilterXScope *
 filterx_scope_ref(FilterXScope *self)
 {
@@ -436,3 +595,27 @@ filterx_scope_unref(FilterXScope *self)
   if (self && (g_atomic_counter_dec_and_test(&self->ref_cnt)))
     _free(self);
 }
+
+/* release the scopes retained by the current thread */
+void
+filterx_scope_thread_deinit(void)
+{
+  while (filterx_scope_pool_len > 0)
+    _destroy(filterx_scope_pool[--filterx_scope_pool_len]);
+}
+
+void
+filterx_scope_global_deinit(void)
+{
+  g_mutex_lock(&variable_slots.lock);
+  if (variable_slots.slots_by_key)
+    g_hash_table_destroy(variable_slots.slots_by_key);
+  variable_slots.slots_by_key = NULL;
+  for (gint i = 0; i < FILTERX_VARIABLE_MAX_CHUNKS && variable_slots.chunks[i]; i++)
+    {
+      g_free(variable_slots.chunks[i]);
+      variable_slots.chunks[i] = NULL;
+    }
+  variable_slots.num_slots = 0;
+  g_mutex_unlock(&variable_slots.lock);
+}
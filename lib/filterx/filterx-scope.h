@@ -63,6 +63,7 @@ gboolean filterx_scope_is_dirty(FilterXScope *self);
 void filterx_scope_sync(FilterXScope *self, LogMessage *msg);
 
 FilterXVariableHandle filterx_scope_map_variable_to_handle(const gchar *name, FilterXVariableType type);
+NVHandle filterx_variable_handle_get_nv_handle(FilterXVariableHandle handle);
 FilterXVariable *filterx_scope_lookup_variable(FilterXScope *self, FilterXVariableHandle handle);
 FilterXVariable *filterx_scope_register_variable(FilterXScope *self,
                                                  FilterXVariableHandle handle,
@@ -80,4 +81,7 @@ FilterXScope *filterx_scope_new(void);
 FilterXScope *filterx_scope_ref(FilterXScope *self);
 void filterx_scope_unref(FilterXScope *self);
 
+void filterx_scope_thread_deinit(void);
+void filterx_scope_global_deinit(void);
+
 #endif
\ No newline at end of file
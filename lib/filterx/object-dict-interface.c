@@ -167,7 +167,6 @@ _add_elem_to_json_object(FilterXObject *key_obj, FilterXObject *value_obj, gpoin
   if (!filterx_object_map_to_json(value_obj, &value, &assoc_object))
     return FALSE;
 
-  filterx_json_associate_cached_object(object, assoc_object);
   filterx_object_unref(assoc_object);
 
   if (json_object_object_add(object, key, value) != 0)
@@ -190,7 +189,6 @@ _map_to_json(FilterXObject *s, struct json_object **object, FilterXObject **asso
       return FALSE;
     }
 
-  *assoc_object = filterx_json_new_from_object(json_object_get(*object));
   return TRUE;
 }
 
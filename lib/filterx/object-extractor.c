@@ -162,8 +162,13 @@ filterx_object_extract_json_array(FilterXObject *obj, struct json_object **value
       return FALSE;
     }
 
-  *value = filterx_json_array_get_value(obj);
-  return !!(*value);
+  if (!filterx_object_is_type(obj, &FILTERX_TYPE_NAME(json_array)))
+    return FALSE;
+
+  FilterXObject *assoc_object = NULL;
+  gboolean success = filterx_object_map_to_json(obj, value, &assoc_object);
+  filterx_object_unref(assoc_object);
+  return success;
 }
 
 gboolean
@@ -172,6 +177,11 @@ filterx_object_extract_json_object(FilterXObject *obj, struct json_object **valu
   if (filterx_object_is_type(obj, &FILTERX_TYPE_NAME(message_value)))
     return filterx_message_value_get_json(obj, value);
 
-  *value = filterx_json_object_get_value(obj);
-  return !!(*value);
+  if (!filterx_object_is_type(obj, &FILTERX_TYPE_NAME(json_object)))
+    return FALSE;
+
+  FilterXObject *assoc_object = NULL;
+  gboolean success = filterx_object_map_to_json(obj, value, &assoc_object);
+  filterx_object_unref(assoc_object);
+  return success;
 }
@@ -37,6 +37,7 @@ gboolean filterx_object_extract_double(FilterXObject *obj, gdouble *value);
 gboolean filterx_object_extract_generic_number(FilterXObject *obj, GenericNumber *value);
 gboolean filterx_object_extract_datetime(FilterXObject *obj, UnixTime *value);
 gboolean filterx_object_extract_null(FilterXObject *obj);
+/* NOTE: the json extractors return a new json-c reference, to be released using json_object_put() */
 gboolean filterx_object_extract_json_array(FilterXObject *obj, struct json_object **value);
 gboolean filterx_object_extract_json_object(FilterXObject *obj, struct json_object **value);
 
@@ -23,7 +23,6 @@
 #include "filterx/object-json-internal.h"
 #include "filterx/object-extractor.h"
 #include "filterx/object-null.h"
-#include "filterx/object-primitive.h"
 #include "filterx/object-string.h"
 #include "filterx/object-message-value.h"
 #include "filterx/filterx-weakrefs.h"
@@ -32,31 +31,99 @@
 #include "filterx/filterx-eval.h"
 
 #include "logmsg/type-hinting.h"
+#include "scanner/list-scanner/list-scanner.h"
 #include "str-repr/encode.h"
 
 #define JSON_ARRAY_MAX_SIZE 65536
 
+/* shared between clones, see _get_writable_elements() */
+typedef struct _FilterXJsonArrayElements
+{
+  GAtomicCounter ref_cnt;
+  GPtrArray *values;
+} FilterXJsonArrayElements;
+
 struct FilterXJsonArray_
 {
   FilterXList super;
   FilterXWeakRef root_container;
-  struct json_object *jso;
+  FilterXJsonArrayElements *elements;
 };
 
-static gboolean
-_truthy(FilterXObject *s)
+static FilterXJsonArrayElements *
+_elements_new(guint reserved_size)
 {
-  return TRUE;
+  FilterXJsonArrayElements *elements = g_new0(FilterXJsonArrayElements, 1);
+
+  g_atomic_counter_set(&elements->ref_cnt, 1);
+  elements->values = g_ptr_array_new_full(reserved_size, (GDestroyNotify) filterx_object_unref);
+  return elements;
+}
+
+static FilterXJsonArrayElements *
+_elements_ref(FilterXJsonArrayElements *elements)
+{
+  g_atomic_counter_inc(&elements->ref_cnt);
+  return elements;
+}
+
+static void
+_elements_unref(FilterXJsonArrayElements *elements)
+{
+  if (!g_atomic_counter_dec_and_test(&elements->ref_cnt))
+    return;
+
+  g_ptr_array_unref(elements->values);
+  g_free(elements);
 }
 
+static FilterXJsonArrayElements *
+_elements_copy(FilterXJsonArrayElements *other)
+{
+  FilterXJsonArrayElements *elements = _elements_new(other->values->len);
+
+  for (guint i = 0; i < other->values->len; i++)
+    g_ptr_array_add(elements->values, filterx_object_clone(g_ptr_array_index(other->values, i)));
+  return elements;
+}
+
+/* mutable elements that are referenced from outside of the array may be changed in place */
 static gboolean
-_marshal_to_json_literal_append(FilterXJsonArray *self, GString *repr, LogMessageValueType *t)
+_elements_in_use(FilterXJsonArrayElements *elements)
 {
-  *t = LM_VT_JSON;
+  for (guint i = 0; i < elements->values->len; i++)
+    {
+      FilterXObject *value = g_ptr_array_index(elements->values, i);
 
-  const gchar *json_repr = json_object_to_json_string_ext(self->jso, JSON_C_TO_STRING_PLAIN);
-  g_string_append(repr, json_repr);
+      if (value->type->is_mutable && g_atomic_counter_get(&value->ref_cnt) > 1)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+/* separate our elements from our clones, before changing them */
+static GPtrArray *
+_get_writable_elements(FilterXJsonArray *self)
+{
+  if (g_atomic_counter_get(&self->elements->ref_cnt) > 1)
+    {
+      FilterXJsonArrayElements *elements = _elements_copy(self->elements);
+
+      _elements_unref(self->elements);
+      self->elements = elements;
+    }
+  return self->elements->values;
+}
+
+static inline void
+_mark_modified(FilterXJsonArray *self)
+{
+  filterx_json_mark_modified(&self->super.super, &self->root_container);
+}
 
+static gboolean
+_truthy(FilterXObject *s)
+{
   return TRUE;
 }
 
@@ -64,17 +131,25 @@ static gboolean
 _marshal(FilterXObject *s, GString *repr, LogMessageValueType *t)
 {
   FilterXJsonArray *self = (FilterXJsonArray *) s;
+  GPtrArray *values = self->elements->values;
+  gsize initial_len = repr->len;
 
-  for (gint i = 0; i < json_object_array_length(self->jso); i++)
+  for (guint i = 0; i < values->len; i++)
     {
-      struct json_object *el = json_object_array_get_idx(self->jso, i);
-      if (json_object_get_type(el) != json_type_string)
-        return _marshal_to_json_literal_append(self, repr, t);
+      FilterXObject *el = g_ptr_array_index(values, i);
+      if (!filterx_object_is_type(el, &FILTERX_TYPE_NAME(string)))
+        {
+          g_string_truncate(repr, initial_len);
+          *t = LM_VT_JSON;
+          return filterx_json_append_literal(s, repr);
+        }
 
       if (i != 0)
         g_string_append_c(repr, ',');
 
-      str_repr_encode_append(repr, json_object_get_string(el), -1, NULL);
+      gsize len;
+      const gchar *str = filterx_string_get_value(el, &len);
+      str_repr_encode_append(repr, str, len, NULL);
     }
 
   *t = LM_VT_LIST;
@@ -84,33 +159,51 @@ _marshal(FilterXObject *s, GString *repr, LogMessageValueType *t)
 static gboolean
 _repr(FilterXObject *s, GString *repr)
 {
-  FilterXJsonArray *self = (FilterXJsonArray *) s;
-
-  const gchar *json_repr = json_object_to_json_string_ext(self->jso, JSON_C_TO_STRING_PLAIN);
-  g_string_append(repr, json_repr);
-
-  return TRUE;
+  return filterx_json_append_literal(s, repr);
 }
 
 static gboolean
 _map_to_json(FilterXObject *s, struct json_object **jso, FilterXObject **assoc_object)
 {
   FilterXJsonArray *self = (FilterXJsonArray *) s;
+  GPtrArray *values = self->elements->values;
+  struct json_object *array = json_object_new_array_ext(values->len);
 
-  *jso = json_object_get(self->jso);
+  for (guint i = 0; i < values->len; i++)
+    {
+      struct json_object *value = NULL;
+      FilterXObject *value_assoc_object = NULL;
+      gboolean success = filterx_object_map_to_json(g_ptr_array_index(values, i), &value, &value_assoc_object);
+      filterx_object_unref(value_assoc_object);
+
+      if (!success)
+        {
+          json_object_put(array);
+          return FALSE;
+        }
+
+      if (json_object_array_add(array, value) != 0)
+        {
+          json_object_put(value);
+          json_object_put(array);
+          return FALSE;
+        }
+    }
+
+  *jso = array;
   return TRUE;
 }
 
+static FilterXObject *_new_with_elements(FilterXJsonArrayElements *elements);
+
 static FilterXObject *
 _clone(FilterXObject *s)
 {
   FilterXJsonArray *self = (FilterXJsonArray *) s;
 
-  struct json_object *jso = filterx_json_deep_copy(self->jso);
-  if (!jso)
-    return NULL;
-
-  return filterx_json_array_new_sub(jso, NULL);
+  if (_elements_in_use(self->elements))
+    return _new_with_elements(_elements_copy(self->elements));
+  return _new_with_elements(_elements_ref(self->elements));
 }
 
 static FilterXObject *
@@ -118,15 +211,21 @@ _get_subscript(FilterXList *s, guint64 index)
 {
   FilterXJsonArray *self = (FilterXJsonArray *) s;
 
-  struct json_object *jso = json_object_array_get_idx(self->jso, index);
-  if (!jso)
-    {
-      /* NULL is returned if the stored value is null. */
-      if (json_object_array_length(self->jso) > index + 1)
-        return NULL;
-    }
+  if (index >= self->elements->values->len)
+    return NULL;
+
+  FilterXObject *value = g_ptr_array_index(self->elements->values, index);
+
+  if (!value->type->is_mutable)
+    return filterx_object_ref(value);
+
+  /* the caller will make the result readonly, that should not affect our member */
+  if (s->super.readonly)
+    return filterx_object_clone(value);
 
-  return filterx_json_convert_json_to_object_cached(&s->super, &self->root_container, jso);
+  value = g_ptr_array_index(_get_writable_elements(self), index);
+  filterx_json_hand_out_member(value, &s->super, &self->root_container);
+  return filterx_object_ref(value);
 }
 
 static guint64
@@ -134,7 +233,7 @@ _len(FilterXList *s)
 {
   FilterXJsonArray *self = (FilterXJsonArray *) s;
 
-  return json_object_array_length(self->jso);
+  return self->elements->values->len;
 }
 
 static gboolean
@@ -145,30 +244,16 @@ _append(FilterXList *s, FilterXObject **new_value)
   if (G_UNLIKELY(_len(s) >= JSON_ARRAY_MAX_SIZE))
     return FALSE;
 
-  struct json_object *jso = NULL;
-  FilterXObject *assoc_object = NULL;
-  if (!filterx_object_map_to_json(*new_value, &jso, &assoc_object))
+  FilterXObject *member = filterx_json_prepare_member(*new_value);
+  if (!member)
     return FALSE;
 
-  filterx_json_associate_cached_object(jso, assoc_object);
-
-  if (json_object_array_add(self->jso, jso) != 0)
-    {
-      filterx_object_unref(assoc_object);
-      json_object_put(jso);
-      return FALSE;
-    }
-
-  self->super.super.modified_in_place = TRUE;
-  FilterXObject *root_container = filterx_weakref_get(&self->root_container);
-  if (root_container)
-    {
-      root_container->modified_in_place = TRUE;
-      filterx_object_unref(root_container);
-    }
+  g_ptr_array_add(_get_writable_elements(self), filterx_object_ref(member));
+  filterx_json_hand_out_member(member, &s->super, &self->root_container);
+  _mark_modified(self);
 
   filterx_object_unref(*new_value);
-  *new_value = assoc_object;
+  *new_value = member;
 
   return TRUE;
 }
@@ -181,30 +266,30 @@ _set_subscript(FilterXList *s, guint64 index, FilterXObject **new_value)
   if (G_UNLIKELY(index >= JSON_ARRAY_MAX_SIZE))
     return FALSE;
 
-  struct json_object *jso = NULL;
-  FilterXObject *assoc_object = NULL;
-  if (!filterx_object_map_to_json(*new_value, &jso, &assoc_object))
+  FilterXObject *member = filterx_json_prepare_member(*new_value);
+  if (!member)
     return FALSE;
 
-  filterx_json_associate_cached_object(jso, assoc_object);
+  GPtrArray *values = _get_writable_elements(self);
+
+  /* same as json-c: the gap is filled with nulls when setting an index past the end */
+  while (values->len < index)
+    g_ptr_array_add(values, filterx_null_new());
 
-  if (json_object_array_put_idx(self->jso, index, jso) != 0)
+  if (index == values->len)
     {
-      filterx_object_unref(assoc_object);
-      json_object_put(jso);
-      return FALSE;
+      g_ptr_array_add(values, filterx_object_ref(member));
     }
-
-  self->super.super.modified_in_place = TRUE;
-  FilterXObject *root_container = filterx_weakref_get(&self->root_container);
-  if (root_container)
+  else
     {
-      root_container->modified_in_place = TRUE;
-      filterx_object_unref(root_container);
+      filterx_object_unref(g_ptr_array_index(values, index));
+      g_ptr_array_index(values, index) = filterx_object_ref(member);
     }
+  filterx_json_hand_out_member(member, &s->super, &self->root_container);
+  _mark_modified(self);
 
   filterx_object_unref(*new_value);
-  *new_value = assoc_object;
+  *new_value = member;
 
   return TRUE;
 }
@@ -217,23 +302,18 @@ _unset_index(FilterXList *s, guint64 index)
   if (G_UNLIKELY(index >= JSON_ARRAY_MAX_SIZE))
     return FALSE;
 
-  if (json_object_array_del_idx(self->jso, index, 1) != 0)
+  if (index >= _len(s))
     return FALSE;
 
-  self->super.super.modified_in_place = TRUE;
-  FilterXObject *root_container = filterx_weakref_get(&self->root_container);
-  if (root_container)
-    {
-      root_container->modified_in_place = TRUE;
-      filterx_object_unref(root_container);
-    }
+  g_ptr_array_remove_index(_get_writable_elements(self), index);
+  _mark_modified(self);
 
   return TRUE;
 }
 
-/* NOTE: consumes root ref */
-FilterXObject *
-filterx_json_array_new_sub(struct json_object *jso, FilterXObject *root)
+/* NOTE: consumes the elements reference */
+static FilterXObject *
+_new_with_elements(FilterXJsonArrayElements *elements)
 {
   FilterXJsonArray *self = g_new0(FilterXJsonArray, 1);
   filterx_list_init_instance(&self->super, &FILTERX_TYPE_NAME(json_array));
@@ -244,9 +324,7 @@ filterx_json_array_new_sub(struct json_object *jso, FilterXObject *root)
   self->super.unset_index = _unset_index;
   self->super.len = _len;
 
-  filterx_weakref_set(&self->root_container, root);
-  filterx_object_unref(root);
-  self->jso = jso;
+  self->elements = elements;
 
   return &self->super.super;
 }
@@ -256,10 +334,66 @@ _free(FilterXObject *s)
 {
   FilterXJsonArray *self = (FilterXJsonArray *) s;
 
-  json_object_put(self->jso);
+  _elements_unref(self->elements);
   filterx_weakref_clear(&self->root_container);
 }
 
+gboolean
+filterx_json_array_is_instance(FilterXObject *s)
+{
+  /* NOTE: this also covers types that are cloned from json_array */
+  return s->type->free_fn == _free;
+}
+
+void
+filterx_json_array_set_root(FilterXObject *s, FilterXObject *root)
+{
+  FilterXJsonArray *self = (FilterXJsonArray *) s;
+
+  if (self->root_container.object != root)
+    filterx_weakref_set(&self->root_container, root);
+}
+
+void
+filterx_json_array_foreach_member(FilterXObject *s, FilterXJsonMemberFunc func, gpointer user_data)
+{
+  FilterXJsonArray *self = (FilterXJsonArray *) s;
+
+  for (guint i = 0; i < self->elements->values->len; i++)
+    func(g_ptr_array_index(self->elements->values, i), user_data);
+}
+
+gboolean
+filterx_json_array_append_literal(FilterXObject *s, GString *output)
+{
+  FilterXJsonArray *self = (FilterXJsonArray *) s;
+  GPtrArray *values = self->elements->values;
+
+  g_string_append_c(output, '[');
+  for (guint i = 0; i < values->len; i++)
+    {
+      if (i != 0)
+        g_string_append_c(output, ',');
+
+      if (!filterx_json_append_literal(g_ptr_array_index(values, i), output))
+        return FALSE;
+    }
+  g_string_append_c(output, ']');
+  return TRUE;
+}
+
+FilterXObject *
+filterx_json_array_new_from_json(struct json_object *jso)
+{
+  gsize len = json_object_array_length(jso);
+  FilterXJsonArrayElements *elements = _elements_new(len);
+
+  for (gsize i = 0; i < len; i++)
+    g_ptr_array_add(elements->values, filterx_json_convert_json_to_object(json_object_array_get_idx(jso, i)));
+
+  return _new_with_elements(elements);
+}
+
 FilterXObject *
 filterx_json_array_new_from_repr(const gchar *repr, gssize repr_len)
 {
@@ -267,23 +401,31 @@ filterx_json_array_new_from_repr(const gchar *repr, gssize repr_len)
   if (!type_cast_to_json(repr, repr_len, &jso, NULL))
     return NULL;
 
-  if (!json_object_is_type(jso, json_type_array))
-    {
-      json_object_put(jso);
-      return NULL;
-    }
+  FilterXObject *result = NULL;
+  if (json_object_is_type(jso, json_type_array))
+    result = filterx_json_array_new_from_json(jso);
 
-  return filterx_json_array_new_sub(jso, NULL);
+  json_object_put(jso);
+  return result;
 }
 
 FilterXObject *
 filterx_json_array_new_from_syslog_ng_list(const gchar *repr, gssize repr_len)
 {
-  struct json_object *jso;
-  if (!type_cast_to_json_from_list(repr, repr_len, &jso, NULL))
-    return NULL;
+  FilterXJsonArrayElements *elements = _elements_new(0);
+  ListScanner scanner;
 
-  return filterx_json_array_new_sub(jso, NULL);
+  list_scanner_init(&scanner);
+  list_scanner_input_string(&scanner, repr, repr_len);
+  while (list_scanner_scan_next(&scanner))
+    {
+      g_ptr_array_add(elements->values,
+                      filterx_string_new(list_scanner_get_current_value(&scanner),
+                                         list_scanner_get_current_value_len(&scanner)));
+    }
+  list_scanner_deinit(&scanner);
+
+  return _new_with_elements(elements);
 }
 
 FilterXObject *
@@ -303,9 +445,24 @@ filterx_json_array_new_from_args(FilterXExpr *s, GPtrArray *args)
   if (filterx_object_is_type(arg, &FILTERX_TYPE_NAME(json_array)))
     return filterx_object_ref(arg);
 
+  if (filterx_object_is_type(arg, &FILTERX_TYPE_NAME(list)))
+    {
+      FilterXObject *self = filterx_json_array_new_empty();
+      if (!filterx_list_merge(self, arg))
+        {
+          filterx_object_unref(self);
+          return NULL;
+        }
+      return self;
+    }
+
   struct json_object *jso;
   if (filterx_object_extract_json_array(arg, &jso))
-    return filterx_json_array_new_sub(jso, NULL);
+    {
+      FilterXObject *self = filterx_json_array_new_from_json(jso);
+      json_object_put(jso);
+      return self;
+    }
 
   const gchar *repr;
   gsize repr_len;
@@ -320,29 +477,7 @@ filterx_json_array_new_from_args(FilterXExpr *s, GPtrArray *args)
 FilterXObject *
 filterx_json_array_new_empty(void)
 {
-  return filterx_json_array_new_sub(json_object_new_array(), NULL);
-}
-
-const gchar *
-filterx_json_array_to_json_literal(FilterXObject *s)
-{
-  FilterXJsonArray *self = (FilterXJsonArray *) s;
-
-  if (!filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_array)))
-    return NULL;
-  return json_object_to_json_string_ext(self->jso, JSON_C_TO_STRING_PLAIN);
-}
-
-/* NOTE: Consider using filterx_object_extract_json_array() to also support message_value. */
-struct json_object *
-filterx_json_array_get_value(FilterXObject *s)
-{
-  if (!filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_array)))
-    return NULL;
-
-  FilterXJsonArray *self = (FilterXJsonArray *) s;
-
-  return self->jso;
+  return _new_with_elements(_elements_new(0));
 }
 
 FILTERX_DEFINE_TYPE(json_array, FILTERX_TYPE_NAME(list),
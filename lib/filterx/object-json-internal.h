@@ -27,12 +27,35 @@
 #include "object-json.h"
 #include "filterx/filterx-weakrefs.h"
 
-FilterXObject *filterx_json_convert_json_to_object_cached(FilterXObject *self, FilterXWeakRef *root_container,
-                                                          struct json_object *jso);
+/*
+ * json_object and json_array store their members as native FilterXObject
+ * instances, json-c is only used when parsing JSON text and when
+ * converting to a json-c value is explicitly requested.
+ *
+ * Both containers share their storage between clones (copy-on-write), the
+ * storage is separated when either of the clones is about to change it, or
+ * when a mutable member is handed out, as that could be changed in place.
+ */
+
+FilterXObject *filterx_json_object_new_from_json(struct json_object *jso);
+FilterXObject *filterx_json_array_new_from_json(struct json_object *jso);
+
+gboolean filterx_json_object_is_instance(FilterXObject *s);
+gboolean filterx_json_array_is_instance(FilterXObject *s);
+void filterx_json_object_set_root(FilterXObject *s, FilterXObject *root);
+void filterx_json_array_set_root(FilterXObject *s, FilterXObject *root);
 
-struct json_object *filterx_json_deep_copy(struct json_object *jso);
+FilterXObject *filterx_json_prepare_member(FilterXObject *value);
+void filterx_json_hand_out_member(FilterXObject *member, FilterXObject *container, FilterXWeakRef *root_container);
+void filterx_json_mark_modified(FilterXObject *container, FilterXWeakRef *root_container);
+gboolean filterx_json_append_literal(FilterXObject *s, GString *output);
+void filterx_json_append_string(GString *output, const gchar *str, gsize str_len);
+gboolean filterx_json_object_append_literal(FilterXObject *s, GString *output);
+gboolean filterx_json_array_append_literal(FilterXObject *s, GString *output);
 
-FilterXObject *filterx_json_object_new_sub(struct json_object *jso, FilterXObject *root);
-FilterXObject *filterx_json_array_new_sub(struct json_object *jso, FilterXObject *root);
+/* iterates over the stored members directly, without handing them out */
+typedef void (*FilterXJsonMemberFunc)(FilterXObject *member, gpointer user_data);
+void filterx_json_object_foreach_member(FilterXObject *s, FilterXJsonMemberFunc func, gpointer user_data);
+void filterx_json_array_foreach_member(FilterXObject *s, FilterXJsonMemberFunc func, gpointer user_data);
 
 #endif
@@ -22,21 +22,288 @@
  */
 #include "filterx/object-json-internal.h"
 #include "filterx/object-extractor.h"
-#include "filterx/object-null.h"
-#include "filterx/object-primitive.h"
 #include "filterx/object-string.h"
 #include "filterx/filterx-weakrefs.h"
 #include "filterx/object-dict-interface.h"
-#include "str-utils.h"
 #include "logmsg/type-hinting.h"
 
+#include <string.h>
+
+#define JSON_OBJECT_MIN_ENTRIES 4
+
+typedef struct _FilterXJsonObjectEntry
+{
+  FilterXObject *key;
+  FilterXObject *value;
+  guint hash;
+} FilterXJsonObjectEntry;
+
+/*
+ * Members are stored in insertion order in @entries, @index is an
+ * open-addressed (linear probing) hash table on top of that, holding entry
+ * positions + 1, 0 being an empty slot.
+ *
+ * Removed entries leave a hole (key == NULL) in @entries until the next
+ * rebuild, the index slots pointing to them act as tombstones.  The table
+ * is shared between clones, see _get_writable_table().
+ */
+typedef struct _FilterXJsonObjectTable
+{
+  GAtomicCounter ref_cnt;
+  guint32 num_entries;
+  guint32 num_removed;
+  guint32 entries_size;
+  guint32 index_mask;
+  FilterXJsonObjectEntry *entries;
+  guint32 *index;
+} FilterXJsonObjectTable;
+
 struct FilterXJsonObject_
 {
   FilterXDict super;
   FilterXWeakRef root_container;
-  struct json_object *jso;
+  FilterXJsonObjectTable *table;
 };
 
+static guint
+_hash_key(const gchar *key, gsize key_len)
+{
+  guint hash = 5381;
+
+  for (gsize i = 0; i < key_len; i++)
+    hash = (hash << 5) + hash + (guchar) key[i];
+  return hash;
+}
+
+static FilterXObject *
+_key_new(FilterXObject *key_obj, const gchar *key, gsize key_len)
+{
+  /* attribute names are frozen strings, we can share those */
+  if (key_obj && filterx_object_is_type(key_obj, &FILTERX_TYPE_NAME(string)))
+    return filterx_object_ref(key_obj);
+  return filterx_string_new(key, key_len);
+}
+
+static FilterXJsonObjectTable *
+_table_new(void)
+{
+  FilterXJsonObjectTable *table = g_new0(FilterXJsonObjectTable, 1);
+
+  g_atomic_counter_set(&table->ref_cnt, 1);
+  return table;
+}
+
+static FilterXJsonObjectTable *
+_table_ref(FilterXJsonObjectTable *table)
+{
+  g_atomic_counter_inc(&table->ref_cnt);
+  return table;
+}
+
+static void
+_table_unref(FilterXJsonObjectTable *table)
+{
+  if (!g_atomic_counter_dec_and_test(&table->ref_cnt))
+    return;
+
+  for (guint32 i = 0; i < table->num_entries; i++)
+    {
+      filterx_object_unref(table->entries[i].key);
+      filterx_object_unref(table->entries[i].value);
+    }
+  g_free(table->entries);
+  g_free(table->index);
+  g_free(table);
+}
+
+static inline gboolean
+_table_is_shared(FilterXJsonObjectTable *table)
+{
+  return g_atomic_counter_get(&table->ref_cnt) > 1;
+}
+
+static inline guint32
+_table_len(FilterXJsonObjectTable *table)
+{
+  return table->num_entries - table->num_removed;
+}
+
+/* the copy keeps the layout of the original, so entry positions remain valid */
+static FilterXJsonObjectTable *
+_table_copy(FilterXJsonObjectTable *other)
+{
+  FilterXJsonObjectTable *table = _table_new();
+
+  if (!other->entries)
+    return table;
+
+  table->num_entries = other->num_entries;
+  table->num_removed = other->num_removed;
+  table->entries_size = other->entries_size;
+  table->index_mask = other->index_mask;
+  table->entries = g_new(FilterXJsonObjectEntry, table->entries_size);
+  table->index = g_new(guint32, table->index_mask + 1);
+  memcpy(table->index, other->index, (table->index_mask + 1) * sizeof(table->index[0]));
+
+  for (guint32 i = 0; i < table->num_entries; i++)
+    {
+      FilterXJsonObjectEntry *src = &other->entries[i];
+      FilterXJsonObjectEntry *dst = &table->entries[i];
+
+      dst->hash = src->hash;
+      dst->key = filterx_object_ref(src->key);
+      dst->value = src->value ? filterx_object_clone(src->value) : NULL;
+    }
+  return table;
+}
+
+/* mutable members that are referenced from outside of the table may be changed in place */
+static gboolean
+_table_has_members_in_use(FilterXJsonObjectTable *table)
+{
+  for (guint32 i = 0; i < table->num_entries; i++)
+    {
+      FilterXObject *value = table->entries[i].value;
+
+      if (value && value->type->is_mutable && g_atomic_counter_get(&value->ref_cnt) > 1)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static void
+_table_rebuild(FilterXJsonObjectTable *table, guint32 entries_size)
+{
+  guint32 num_entries = 0;
+
+  for (guint32 i = 0; i < table->num_entries; i++)
+    {
+      if (table->entries[i].key)
+        table->entries[num_entries++] = table->entries[i];
+    }
+  table->num_entries = num_entries;
+  table->num_removed = 0;
+
+  table->entries = g_renew(FilterXJsonObjectEntry, table->entries, entries_size);
+  table->entries_size = entries_size;
+
+  /* at most half of the index slots are in use */
+  g_free(table->index);
+  table->index = g_new0(guint32, entries_size * 2);
+  table->index_mask = entries_size * 2 - 1;
+
+  for (guint32 i = 0; i < num_entries; i++)
+    {
+      guint32 slot = table->entries[i].hash & table->index_mask;
+
+      while (table->index[slot])
+        slot = (slot + 1) & table->index_mask;
+      table->index[slot] = i + 1;
+    }
+}
+
+static void
+_table_reserve(FilterXJsonObjectTable *table, guint32 num_new_entries)
+{
+  if (table->num_entries + num_new_entries <= table->entries_size)
+    return;
+
+  guint32 required = _table_len(table) + num_new_entries;
+  guint32 entries_size = MAX(table->entries_size, JSON_OBJECT_MIN_ENTRIES);
+
+  while (entries_size < required + required / 2)
+    entries_size *= 2;
+  _table_rebuild(table, entries_size);
+}
+
+/*
+ * Returns the matching entry or NULL. If @insert_slot is specified, it is
+ * set to the index slot a new entry with this key should be stored at.
+ */
+static FilterXJsonObjectEntry *
+_table_lookup(FilterXJsonObjectTable *table, FilterXObject *key_obj, const gchar *key, gsize key_len, guint hash,
+              guint32 **insert_slot)
+{
+  guint32 *reusable_slot = NULL;
+
+  if (!table->index)
+    return NULL;
+
+  for (guint32 i = hash & table->index_mask; ; i = (i + 1) & table->index_mask)
+    {
+      guint32 *slot = &table->index[i];
+
+      if (*slot == 0)
+        {
+          if (insert_slot)
+            *insert_slot = reusable_slot ? : slot;
+          return NULL;
+        }
+
+      FilterXJsonObjectEntry *entry = &table->entries[*slot - 1];
+      if (!entry->key)
+        {
+          if (!reusable_slot)
+            reusable_slot = slot;
+          continue;
+        }
+
+      if (entry->hash != hash)
+        continue;
+
+      if (entry->key == key_obj)
+        return entry;
+
+      gsize entry_key_len;
+      const gchar *entry_key = filterx_string_get_value(entry->key, &entry_key_len);
+      if (entry_key_len == key_len && memcmp(entry_key, key, key_len) == 0)
+        return entry;
+    }
+}
+
+/* NOTE: consumes the key and value references, needs a prior _table_reserve() */
+static void
+_table_append(FilterXJsonObjectTable *table, guint32 *slot, FilterXObject *key, guint hash, FilterXObject *value)
+{
+  FilterXJsonObjectEntry *entry = &table->entries[table->num_entries++];
+
+  entry->key = key;
+  entry->value = value;
+  entry->hash = hash;
+  *slot = table->num_entries;
+}
+
+/* separate our table from our clones, before changing it */
+static FilterXJsonObjectTable *
+_get_writable_table(FilterXJsonObject *self)
+{
+  if (_table_is_shared(self->table))
+    {
+      FilterXJsonObjectTable *table = _table_copy(self->table);
+
+      _table_unref(self->table);
+      self->table = table;
+    }
+  return self->table;
+}
+
+static FilterXObject *
+_hand_out_member(FilterXJsonObject *self, guint32 entry_ndx)
+{
+  FilterXObject *value = self->table->entries[entry_ndx].value;
+
+  if (!value->type->is_mutable)
+    return filterx_object_ref(value);
+
+  /* the caller will make the result readonly, that should not affect our member */
+  if (self->super.super.readonly)
+    return filterx_object_clone(value);
+
+  value = _get_writable_table(self)->entries[entry_ndx].value;
+  filterx_json_hand_out_member(value, &self->super.super, &self->root_container);
+  return filterx_object_ref(value);
+}
+
 static gboolean
 _truthy(FilterXObject *s)
 {
@@ -46,46 +313,73 @@ _truthy(FilterXObject *s)
 static gboolean
 _marshal(FilterXObject *s, GString *repr, LogMessageValueType *t)
 {
-  FilterXJsonObject *self = (FilterXJsonObject *) s;
-
   *t = LM_VT_JSON;
-
-  const gchar *json_repr = json_object_to_json_string_ext(self->jso, JSON_C_TO_STRING_PLAIN);
-  g_string_append(repr, json_repr);
-
-  return TRUE;
+  return filterx_json_append_literal(s, repr);
 }
 
 static gboolean
 _repr(FilterXObject *s, GString *repr)
 {
-  FilterXJsonObject *self = (FilterXJsonObject *) s;
-
-  const gchar *json_repr = json_object_to_json_string_ext(self->jso, JSON_C_TO_STRING_PLAIN);
-  g_string_append(repr, json_repr);
-
-  return TRUE;
+  return filterx_json_append_literal(s, repr);
 }
 
 static gboolean
 _map_to_json(FilterXObject *s, struct json_object **jso, FilterXObject **assoc_object)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
+  FilterXJsonObjectTable *table = self->table;
+  struct json_object *object = json_object_new_object();
 
-  *jso = json_object_get(self->jso);
+  for (guint32 i = 0; i < table->num_entries; i++)
+    {
+      FilterXJsonObjectEntry *entry = &table->entries[i];
+      if (!entry->key)
+        continue;
+
+      struct json_object *value = NULL;
+      FilterXObject *value_assoc_object = NULL;
+      gboolean success = filterx_object_map_to_json(entry->value, &value, &value_assoc_object);
+      filterx_object_unref(value_assoc_object);
+
+      if (!success)
+        {
+          json_object_put(object);
+          return FALSE;
+        }
+
+      if (json_object_object_add(object, filterx_string_get_value(entry->key, NULL), value) != 0)
+        {
+          json_object_put(value);
+          json_object_put(object);
+          return FALSE;
+        }
+    }
+
+  *jso = object;
   return TRUE;
 }
 
+static FilterXObject *_new_with_table(FilterXJsonObjectTable *table);
+
 static FilterXObject *
 _clone(FilterXObject *s)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  struct json_object *jso = filterx_json_deep_copy(self->jso);
-  if (!jso)
+  if (_table_has_members_in_use(self->table))
+    return _new_with_table(_table_copy(self->table));
+  return _new_with_table(_table_ref(self->table));
+}
+
+static FilterXJsonObjectEntry *
+_lookup(FilterXJsonObject *self, FilterXObject *key)
+{
+  const gchar *key_str;
+  gsize len;
+  if (!filterx_object_extract_string(key, &key_str, &len))
     return NULL;
 
-  return filterx_json_object_new_sub(jso, NULL);
+  return _table_lookup(self->table, key, key_str, len, _hash_key(key_str, len), NULL);
 }
 
 static FilterXObject *
@@ -93,18 +387,19 @@ _get_subscript(FilterXDict *s, FilterXObject *key)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  const gchar *key_str;
-  gsize len;
-  if (!filterx_object_extract_string(key, &key_str, &len))
+  FilterXJsonObjectEntry *entry = _lookup(self, key);
+  if (!entry)
     return NULL;
 
-  APPEND_ZERO(key_str, key_str, len);
+  return _hand_out_member(self, entry - self->table->entries);
+}
 
-  struct json_object *jso = NULL;
-  if (!json_object_object_get_ex(self->jso, key_str, &jso))
-    return NULL;
+static gboolean
+_is_key_set(FilterXDict *s, FilterXObject *key)
+{
+  FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  return filterx_json_convert_json_to_object_cached(&s->super, &self->root_container, jso);
+  return !!_lookup(self, key);
 }
 
 static gboolean
@@ -117,32 +412,31 @@ _set_subscript(FilterXDict *s, FilterXObject *key, FilterXObject **new_value)
   if (!filterx_object_extract_string(key, &key_str, &len))
     return FALSE;
 
-  APPEND_ZERO(key_str, key_str, len);
-
-  struct json_object *jso = NULL;
-  FilterXObject *assoc_object = NULL;
-  if (!filterx_object_map_to_json(*new_value, &jso, &assoc_object))
+  FilterXObject *member = filterx_json_prepare_member(*new_value);
+  if (!member)
     return FALSE;
 
-  filterx_json_associate_cached_object(jso, assoc_object);
+  FilterXJsonObjectTable *table = _get_writable_table(self);
+  _table_reserve(table, 1);
 
-  if (json_object_object_add(self->jso, key_str, jso) != 0)
+  guint hash = _hash_key(key_str, len);
+  guint32 *slot;
+  FilterXJsonObjectEntry *entry = _table_lookup(table, key, key_str, len, hash, &slot);
+  if (entry)
     {
-      filterx_object_unref(assoc_object);
-      json_object_put(jso);
-      return FALSE;
+      filterx_object_unref(entry->value);
+      entry->value = filterx_object_ref(member);
     }
-
-  self->super.super.modified_in_place = TRUE;
-  FilterXObject *root_container = filterx_weakref_get(&self->root_container);
-  if (root_container)
+  else
     {
-      root_container->modified_in_place = TRUE;
-      filterx_object_unref(root_container);
+      _table_append(table, slot, _key_new(key, key_str, len), hash, filterx_object_ref(member));
     }
 
+  filterx_json_hand_out_member(member, &self->super.super, &self->root_container);
+  filterx_json_mark_modified(&self->super.super, &self->root_container);
+
   filterx_object_unref(*new_value);
-  *new_value = assoc_object;
+  *new_value = member;
 
   return TRUE;
 }
@@ -152,22 +446,20 @@ _unset_key(FilterXDict *s, FilterXObject *key)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  const gchar *key_str;
-  gsize len;
-  if (!filterx_object_extract_string(key, &key_str, &len))
-    return FALSE;
+  FilterXJsonObjectEntry *entry = _lookup(self, key);
+  if (!entry)
+    return TRUE;
 
-  APPEND_ZERO(key_str, key_str, len);
+  guint32 entry_ndx = entry - self->table->entries;
+  entry = &_get_writable_table(self)->entries[entry_ndx];
 
-  json_object_object_del(self->jso, key_str);
+  filterx_object_unref(entry->key);
+  filterx_object_unref(entry->value);
+  entry->key = NULL;
+  entry->value = NULL;
+  self->table->num_removed++;
 
-  self->super.super.modified_in_place = TRUE;
-  FilterXObject *root_container = filterx_weakref_get(&self->root_container);
-  if (root_container)
-    {
-      root_container->modified_in_place = TRUE;
-      filterx_object_unref(root_container);
-    }
+  filterx_json_mark_modified(&self->super.super, &self->root_container);
 
   return TRUE;
 }
@@ -177,54 +469,48 @@ _len(FilterXDict *s)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  return json_object_object_length(self->jso);
+  return _table_len(self->table);
 }
 
 static gboolean
-_iter_inner(FilterXJsonObject *self, const gchar *obj_key, struct json_object *jso,
-            FilterXDictIterFunc func, gpointer user_data)
+_iter(FilterXDict *s, FilterXDictIterFunc func, gpointer user_data)
 {
-  FilterXObject *key = filterx_string_new(obj_key, -1);
-  FilterXObject *value = filterx_json_convert_json_to_object_cached(&self->super.super, &self->root_container,
-                         jso);
+  FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  gboolean result = func(key, value, user_data);
+  /* NOTE: func() may change the table, so we always use self->table */
+  for (guint32 i = 0; i < self->table->num_entries; i++)
+    {
+      if (!self->table->entries[i].key)
+        continue;
 
-  filterx_object_unref(key);
-  filterx_object_unref(value);
-  return result;
-}
+      FilterXObject *key = filterx_object_ref(self->table->entries[i].key);
+      FilterXObject *value = _hand_out_member(self, i);
 
-static gboolean
-_iter(FilterXDict *s, FilterXDictIterFunc func, gpointer user_data)
-{
-  FilterXJsonObject *self = (FilterXJsonObject *) s;
+      gboolean result = func(key, value, user_data);
 
-  struct json_object_iter itr;
-  json_object_object_foreachC(self->jso, itr)
-  {
-    if (!_iter_inner(self, itr.key, itr.val, func, user_data))
-      return FALSE;
-  }
+      filterx_object_unref(key);
+      filterx_object_unref(value);
+      if (!result)
+        return FALSE;
+    }
   return TRUE;
 }
 
-/* NOTE: consumes root ref */
-FilterXObject *
-filterx_json_object_new_sub(struct json_object *jso, FilterXObject *root)
+/* NOTE: consumes the table reference */
+static FilterXObject *
+_new_with_table(FilterXJsonObjectTable *table)
 {
   FilterXJsonObject *self = g_new0(FilterXJsonObject, 1);
   filterx_dict_init_instance(&self->super, &FILTERX_TYPE_NAME(json_object));
 
   self->super.get_subscript = _get_subscript;
   self->super.set_subscript = _set_subscript;
+  self->super.is_key_set = _is_key_set;
   self->super.unset_key = _unset_key;
   self->super.len = _len;
   self->super.iter = _iter;
 
-  filterx_weakref_set(&self->root_container, root);
-  filterx_object_unref(root);
-  self->jso = jso;
+  self->table = table;
 
   return &self->super.super;
 }
@@ -234,46 +520,110 @@ _free(FilterXObject *s)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  json_object_put(self->jso);
+  _table_unref(self->table);
   filterx_weakref_clear(&self->root_container);
 }
 
-FilterXObject *
-filterx_json_object_new_from_repr(const gchar *repr, gssize repr_len)
+gboolean
+filterx_json_object_is_instance(FilterXObject *s)
 {
-  struct json_object *jso;
-  if (!type_cast_to_json(repr, repr_len, &jso, NULL))
-    return NULL;
+  /* NOTE: this also covers types that are cloned from json_object */
+  return s->type->free_fn == _free;
+}
+
+void
+filterx_json_object_set_root(FilterXObject *s, FilterXObject *root)
+{
+  FilterXJsonObject *self = (FilterXJsonObject *) s;
 
-  return filterx_json_object_new_sub(jso, NULL);
+  if (self->root_container.object != root)
+    filterx_weakref_set(&self->root_container, root);
 }
 
-FilterXObject *
-filterx_json_object_new_empty(void)
+void
+filterx_json_object_foreach_member(FilterXObject *s, FilterXJsonMemberFunc func, gpointer user_data)
 {
-  return filterx_json_object_new_sub(json_object_new_object(), NULL);
+  FilterXJsonObject *self = (FilterXJsonObject *) s;
+
+  for (guint32 i = 0; i < self->table->num_entries; i++)
+    {
+      if (self->table->entries[i].key)
+        func(self->table->entries[i].value, user_data);
+    }
 }
 
-const gchar *
-filterx_json_object_to_json_literal(FilterXObject *s)
+gboolean
+filterx_json_object_append_literal(FilterXObject *s, GString *output)
 {
   FilterXJsonObject *self = (FilterXJsonObject *) s;
+  FilterXJsonObjectTable *table = self->table;
+  gboolean first = TRUE;
 
-  if (!filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_object)))
-    return NULL;
-  return json_object_to_json_string_ext(self->jso, JSON_C_TO_STRING_PLAIN);
+  g_string_append_c(output, '{');
+  for (guint32 i = 0; i < table->num_entries; i++)
+    {
+      FilterXJsonObjectEntry *entry = &table->entries[i];
+      if (!entry->key)
+        continue;
+
+      if (!first)
+        g_string_append_c(output, ',');
+      first = FALSE;
+
+      gsize key_len;
+      const gchar *key = filterx_string_get_value(entry->key, &key_len);
+      filterx_json_append_string(output, key, key_len);
+      g_string_append_c(output, ':');
+
+      if (!filterx_json_append_literal(entry->value, output))
+        return FALSE;
+    }
+  g_string_append_c(output, '}');
+  return TRUE;
+}
+
+FilterXObject *
+filterx_json_object_new_from_json(struct json_object *jso)
+{
+  FilterXJsonObjectTable *table = _table_new();
+
+  _table_reserve(table, json_object_object_length(jso));
+
+  struct json_object_iter itr;
+  json_object_object_foreachC(jso, itr)
+  {
+    gsize key_len = strlen(itr.key);
+    guint hash = _hash_key(itr.key, key_len);
+    guint32 *slot;
+
+    /* keys are unique in json-c objects, we only need the slot */
+    _table_lookup(table, NULL, itr.key, key_len, hash, &slot);
+    _table_append(table, slot, filterx_string_new(itr.key, key_len), hash,
+                  filterx_json_convert_json_to_object(itr.val));
+  }
+
+  return _new_with_table(table);
 }
 
-/* NOTE: Consider using filterx_object_extract_json_object() to also support message_value. */
-struct json_object *
-filterx_json_object_get_value(FilterXObject *s)
+FilterXObject *
+filterx_json_object_new_from_repr(const gchar *repr, gssize repr_len)
 {
-  if (!filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_object)))
+  struct json_object *jso;
+  if (!type_cast_to_json(repr, repr_len, &jso, NULL))
     return NULL;
 
-  FilterXJsonObject *self = (FilterXJsonObject *) s;
+  FilterXObject *result = NULL;
+  if (json_object_is_type(jso, json_type_object))
+    result = filterx_json_object_new_from_json(jso);
 
-  return self->jso;
+  json_object_put(jso);
+  return result;
+}
+
+FilterXObject *
+filterx_json_object_new_empty(void)
+{
+  return _new_with_table(_table_new());
 }
 
 FILTERX_DEFINE_TYPE(json_object, FILTERX_TYPE_NAME(dict),
@@ -30,157 +30,371 @@
 #include "filterx/object-message-value.h"
 #include "filterx/filterx-eval.h"
 
-#include "scanner/list-scanner/list-scanner.h"
-#include "str-repr/encode.h"
+#include "logmsg/type-hinting.h"
+
+/*
+ * Numbers parsed from JSON text keep what they would lose as a plain
+ * integer/double: the original text of doubles (e.g. "1.50" or "1e3") and
+ * unsigned 64 bit integers above G_MAXINT64.  They are integers/doubles in
+ * every other respect, changing them replaces them with a plain number.
+ *
+ * The json-c value is not kept itself, as its reference counter and
+ * serialization buffer are not thread safe.
+ */
+typedef struct _FilterXJsonDouble
+{
+  FilterXPrimitive super;
+  gchar *repr;
+} FilterXJsonDouble;
 
 static gboolean
-_is_json_cacheable(struct json_object *jso)
+_json_double_map_to_json(FilterXObject *s, struct json_object **object, FilterXObject **assoc_object)
 {
-  if (json_object_get_type(jso) == json_type_double && JSON_C_MAJOR_VERSION == 0 && JSON_C_MINOR_VERSION < 14)
-    {
-      /*
-       * See: filterx_json_get_cached_object()
-       *
-       * The workaround only works starting with 0.14, before that json_object_set_double()
-       * does not drop the string user data, so we cannot check if it is our
-       * filterx object or the string, which means we cannot cache doubles.
-       */
-      return FALSE;
-    }
+  FilterXJsonDouble *self = (FilterXJsonDouble *) s;
 
+  *object = json_object_new_double_s(gn_as_double(&self->super.value), self->repr);
   return TRUE;
 }
 
-static int
-_deep_copy_filterx_object_ref(json_object *src, json_object *parent, const char *key, size_t index, json_object **dst)
+static void
+_json_double_free(FilterXObject *s)
 {
-  int result = json_c_shallow_copy_default(src, parent, key, index, dst);
-  if (*dst == NULL)
-    return result;
+  FilterXJsonDouble *self = (FilterXJsonDouble *) s;
 
-  /* we need to copy the userdata for primitive types */
+  g_free(self->repr);
+}
 
-  switch (json_object_get_type(src))
-    {
-    case json_type_null:
-    case json_type_boolean:
-    case json_type_double:
-    case json_type_int:
-    case json_type_string:
-    {
-      FilterXObject *fobj = filterx_json_get_cached_object(src);
-      if (fobj)
-        filterx_json_associate_cached_object(*dst, fobj);
-      break;
-    }
-    default:
-      break;
-    }
-  return 2;
+static FilterXObject *
+_json_double_new(struct json_object *jso)
+{
+  FilterXJsonDouble *self = g_new0(FilterXJsonDouble, 1);
+
+  filterx_object_init_instance(&self->super.super, &FILTERX_TYPE_NAME(json_double));
+  gn_set_double(&self->super.value, json_object_get_double(jso), -1);
+  self->repr = g_strdup(json_object_to_json_string_ext(jso, JSON_C_TO_STRING_PLAIN));
+  return &self->super.super;
 }
 
-struct json_object *
-filterx_json_deep_copy(struct json_object *jso)
+/* json-c supports unsigned 64 bit integers since 0.14 */
+#define JSON_C_HAS_UINT64 (JSON_C_MAJOR_VERSION > 0 || JSON_C_MINOR_VERSION >= 14)
+
+typedef struct _FilterXJsonUInt64
 {
-  struct json_object *clone = NULL;
-  if (json_object_deep_copy(jso, &clone, _deep_copy_filterx_object_ref) != 0)
-    return NULL;
+  FilterXPrimitive super;
+  guint64 value;
+} FilterXJsonUInt64;
+
+static gboolean
+_json_uint64_map_to_json(FilterXObject *s, struct json_object **object, FilterXObject **assoc_object)
+{
+  FilterXJsonUInt64 *self = (FilterXJsonUInt64 *) s;
+
+#if JSON_C_HAS_UINT64
+  *object = json_object_new_uint64(self->value);
+#else
+  *object = json_object_new_int64(gn_as_int64(&self->super.value));
+#endif
+  return TRUE;
+}
+
+/* json_object_get_int64() clamps these to G_MAXINT64, and so does our value */
+static FilterXObject *
+_json_integer_new(struct json_object *jso)
+{
+#if JSON_C_HAS_UINT64
+  guint64 value = json_object_get_uint64(jso);
+
+  if (value > G_MAXINT64)
+    {
+      FilterXJsonUInt64 *self = g_new0(FilterXJsonUInt64, 1);
+
+      filterx_object_init_instance(&self->super.super, &FILTERX_TYPE_NAME(json_uint64));
+      gn_set_int64(&self->super.value, G_MAXINT64);
+      self->value = value;
+      return &self->super.super;
+    }
+#endif
 
-  return clone;
+  return filterx_integer_new(json_object_get_int64(jso));
 }
 
+/* NOTE: does not consume the jso reference */
 FilterXObject *
-filterx_json_convert_json_to_object(FilterXObject *root_obj, FilterXWeakRef *root_container, struct json_object *jso)
+filterx_json_convert_json_to_object(struct json_object *jso)
 {
   switch (json_object_get_type(jso))
     {
     case json_type_null:
       return filterx_null_new();
     case json_type_double:
-      return filterx_double_new(json_object_get_double(jso));
+      return _json_double_new(jso);
     case json_type_boolean:
       return filterx_boolean_new(json_object_get_boolean(jso));
     case json_type_int:
-      return filterx_integer_new(json_object_get_int64(jso));
+      return _json_integer_new(jso);
     case json_type_string:
-      return filterx_string_new(json_object_get_string(jso), -1);
+      return filterx_string_new(json_object_get_string(jso), json_object_get_string_len(jso));
     case json_type_array:
-      return filterx_json_array_new_sub(json_object_get(jso),
-                                        filterx_weakref_get(root_container) ? : filterx_object_ref(root_obj));
+      return filterx_json_array_new_from_json(jso);
     case json_type_object:
-      return filterx_json_object_new_sub(json_object_get(jso),
-                                         filterx_weakref_get(root_container) ? : filterx_object_ref(root_obj));
+      return filterx_json_object_new_from_json(jso);
     default:
       g_assert_not_reached();
     }
 }
 
-FilterXObject *
-filterx_json_convert_json_to_object_cached(FilterXObject *self, FilterXWeakRef *root_container,
-                                           struct json_object *jso)
+static FilterXObject *
+_copy_container(FilterXObject *value)
 {
-  FilterXObject *filterx_obj;
+  FilterXObject *result;
+  gboolean success;
 
-  if (!jso || json_object_get_type(jso) == json_type_null)
-    return filterx_null_new();
+  if (filterx_object_is_type(value, &FILTERX_TYPE_NAME(dict)))
+    {
+      result = filterx_json_object_new_empty();
+      success = filterx_dict_merge(result, value);
+    }
+  else
+    {
+      result = filterx_json_array_new_empty();
+      success = filterx_list_merge(result, value);
+    }
 
-  /* NOTE: userdata is a weak reference */
-  filterx_obj = filterx_json_get_cached_object(jso);
-  if (filterx_obj)
-    return filterx_object_ref(filterx_obj);
+  if (!success)
+    {
+      filterx_object_unref(result);
+      return NULL;
+    }
+  return result;
+}
 
-  filterx_obj = filterx_json_convert_json_to_object(self, root_container, jso);
-  filterx_json_associate_cached_object(jso, filterx_obj);
-  return filterx_obj;
+/*
+ * Returns the object to be stored in a json_object/json_array, NULL if
+ * @value cannot be represented in JSON.
+ *
+ * Our own containers are adopted as is if nobody else is holding a
+ * reference to them (e.g.  the clone that setattr/set_subscript makes),
+ * anything else is converted to a json_object/json_array.
+ */
+FilterXObject *
+filterx_json_prepare_member(FilterXObject *value)
+{
+  FilterXObject *result = NULL;
+  FilterXObject *unmarshalled = filterx_object_unmarshal(value);
+
+  if (filterx_json_object_is_instance(unmarshalled) || filterx_json_array_is_instance(unmarshalled))
+    {
+      if (unmarshalled->readonly)
+        result = _copy_container(unmarshalled);
+      else if (g_atomic_counter_get(&unmarshalled->ref_cnt) <= 2)
+        result = filterx_object_ref(unmarshalled);
+      else
+        result = filterx_object_clone(unmarshalled);
+    }
+  else if (filterx_object_is_type(unmarshalled, &FILTERX_TYPE_NAME(dict)) ||
+           filterx_object_is_type(unmarshalled, &FILTERX_TYPE_NAME(list)))
+    {
+      result = _copy_container(unmarshalled);
+    }
+  else if (unmarshalled->type->map_to_json)
+    {
+      result = filterx_object_ref(unmarshalled);
+    }
+
+  filterx_object_unref(unmarshalled);
+  return result;
 }
 
+/* @member is about to be returned by @container, changes through it need to be propagated to the root */
 void
-filterx_json_associate_cached_object(struct json_object *jso, FilterXObject *filterx_obj)
+filterx_json_hand_out_member(FilterXObject *member, FilterXObject *container, FilterXWeakRef *root_container)
 {
-  /* null JSON value turns into NULL pointer. */
-  if (!jso)
+  if (container->readonly)
     return;
 
-  if (!_is_json_cacheable(jso))
-    return;
+  FilterXObject *root = filterx_weakref_get(root_container) ? : filterx_object_ref(container);
 
-  filterx_eval_store_weak_ref(filterx_obj);
+  if (filterx_json_object_is_instance(member))
+    filterx_json_object_set_root(member, root);
+  else if (filterx_json_array_is_instance(member))
+    filterx_json_array_set_root(member, root);
 
-  /* we are not storing a reference in userdata to avoid circular
-   * references.  That ref is retained by the filterx_scope_store_weak_ref()
-   * call above, which is automatically terminated when the scope ends */
-  json_object_set_userdata(jso, filterx_obj, NULL);
+  filterx_object_unref(root);
 }
 
-FilterXObject *
-filterx_json_get_cached_object(struct json_object *jso)
+void
+filterx_json_mark_modified(FilterXObject *container, FilterXWeakRef *root_container)
 {
-  if (!_is_json_cacheable(jso))
-    return NULL;
+  container->modified_in_place = TRUE;
 
-  if (json_object_get_type(jso) == json_type_double)
+  FilterXObject *root = filterx_weakref_get(root_container);
+  if (root)
     {
-      /*
-       * This is a workaround to ditch builtin serializer for double objects
-       * that are set when parsing from a string representation.
-       * json_object_double_new_ds() will set userdata to the string
-       * representation of the number, as extracted from the JSON source.
-       *
-       * Changing the value of the double to the same value, ditches this,
-       * but only if necessary.
-       */
-      json_object_set_double(jso, json_object_get_double(jso));
+      root->modified_in_place = TRUE;
+      filterx_object_unref(root);
     }
+}
 
-  return (FilterXObject *) json_object_get_userdata(jso);
+/*
+ * The JSON text is produced the same way json-c does with
+ * JSON_C_TO_STRING_PLAIN, so that the formatting of the output remains
+ * the same as it used to be.  Containers, strings, integers, booleans and
+ * null are written directly, other values (e.g. doubles, whose formatting
+ * depends on the json-c version) are formatted by json-c one-by-one.
+ */
+void
+filterx_json_append_string(GString *output, const gchar *str, gsize str_len)
+{
+  static const gchar hex_chars[] = "0123456789abcdef";
+  gsize start = 0;
+
+  g_string_append_c(output, '"');
+  for (gsize pos = 0; pos < str_len; pos++)
+    {
+      guchar c = (guchar) str[pos];
+      const gchar *escaped;
+
+      switch (c)
+        {
+        case '\b':
+          escaped = "\\b";
+          break;
+        case '\n':
+          escaped = "\\n";
+          break;
+        case '\r':
+          escaped = "\\r";
+          break;
+        case '\t':
+          escaped = "\\t";
+          break;
+        case '\f':
+          escaped = "\\f";
+          break;
+        case '"':
+          escaped = "\\\"";
+          break;
+        case '\\':
+          escaped = "\\\\";
+          break;
+        case '/':
+          escaped = "\\/";
+          break;
+        default:
+          if (c >= ' ')
+            continue;
+          escaped = NULL;
+          break;
+        }
+
+      g_string_append_len(output, str + start, pos - start);
+      start = pos + 1;
+      if (escaped)
+        {
+          g_string_append(output, escaped);
+        }
+      else
+        {
+          g_string_append(output, "\\u00");
+          g_string_append_c(output, hex_chars[c >> 4]);
+          g_string_append_c(output, hex_chars[c & 0xf]);
+        }
+    }
+  g_string_append_len(output, str + start, str_len - start);
+  g_string_append_c(output, '"');
+}
+
+static gboolean
+_append_literal_using_json_c(FilterXObject *s, GString *output)
+{
+  struct json_object *jso = NULL;
+  FilterXObject *assoc_object = NULL;
+
+  gboolean success = filterx_object_map_to_json(s, &jso, &assoc_object);
+  filterx_object_unref(assoc_object);
+  if (!success)
+    return FALSE;
+
+  g_string_append(output, json_object_to_json_string_ext(jso, JSON_C_TO_STRING_PLAIN));
+  json_object_put(jso);
+  return TRUE;
+}
+
+gboolean
+filterx_json_append_literal(FilterXObject *s, GString *output)
+{
+  if (filterx_json_object_is_instance(s))
+    return filterx_json_object_append_literal(s, output);
+
+  if (filterx_json_array_is_instance(s))
+    return filterx_json_array_append_literal(s, output);
+
+  if (s->type == &FILTERX_TYPE_NAME(string))
+    {
+      gsize str_len;
+      const gchar *str = filterx_string_get_value(s, &str_len);
+
+      filterx_json_append_string(output, str, str_len);
+      return TRUE;
+    }
+
+  if (s->type == &FILTERX_TYPE_NAME(integer))
+    {
+      g_string_append_printf(output, "%" G_GINT64_FORMAT, gn_as_int64(&((FilterXPrimitive *) s)->value));
+      return TRUE;
+    }
+
+  if (s->type == &FILTERX_TYPE_NAME(boolean))
+    {
+      g_string_append(output, gn_as_int64(&((FilterXPrimitive *) s)->value) ? "true" : "false");
+      return TRUE;
+    }
+
+  if (s->type == &FILTERX_TYPE_NAME(null))
+    {
+      g_string_append(output, "null");
+      return TRUE;
+    }
+
+  /* json-c writes the original text of these as is */
+  if (s->type == &FILTERX_TYPE_NAME(json_double))
+    {
+      g_string_append(output, ((FilterXJsonDouble *) s)->repr);
+      return TRUE;
+    }
+
+  return _append_literal_using_json_c(s, output);
+}
+
+static void
+_deep_freeze_member(FilterXObject *member, gpointer user_data)
+{
+  GPtrArray *frozen_objects = (GPtrArray *) user_data;
+
+  filterx_object_make_readonly(member);
+  filterx_json_deep_freeze(member, frozen_objects);
+}
+
+void
+filterx_json_deep_freeze(FilterXObject *s, GPtrArray *frozen_objects)
+{
+  if (filterx_object_freeze(s))
+    g_ptr_array_add(frozen_objects, s);
+
+  if (filterx_json_object_is_instance(s))
+    filterx_json_object_foreach_member(s, _deep_freeze_member, frozen_objects);
+  else if (filterx_json_array_is_instance(s))
+    filterx_json_array_foreach_member(s, _deep_freeze_member, frozen_objects);
 }
 
 FilterXObject *
 filterx_json_new_from_repr(const gchar *repr, gssize repr_len)
 {
-  if (repr_len == 0 || repr[0] == '{')
-    return filterx_json_object_new_from_repr(repr, repr_len);
-  return filterx_json_array_new_from_repr(repr, repr_len);
+  struct json_object *jso;
+  if (!type_cast_to_json(repr, repr_len, &jso, NULL))
+    return NULL;
+
+  return filterx_json_new_from_object(jso);
 }
 
 FilterXObject *
@@ -237,24 +451,36 @@ filterx_json_new_from_args(FilterXExpr *s, GPtrArray *args)
   return NULL;
 }
 
+/* NOTE: consumes the jso reference */
 FilterXObject *
 filterx_json_new_from_object(struct json_object *jso)
 {
-  if (json_object_get_type(jso) == json_type_object)
-    return filterx_json_object_new_sub(jso, NULL);
+  FilterXObject *result = NULL;
 
-  if (json_object_get_type(jso) == json_type_array)
-    return filterx_json_array_new_sub(jso, NULL);
+  if (json_object_get_type(jso) == json_type_object)
+    result = filterx_json_object_new_from_json(jso);
+  else if (json_object_get_type(jso) == json_type_array)
+    result = filterx_json_array_new_from_json(jso);
 
-  return NULL;
+  json_object_put(jso);
+  return result;
 }
 
-const gchar *
-filterx_json_to_json_literal(FilterXObject *s)
+gboolean
+filterx_json_to_json_literal(FilterXObject *s, GString *output)
 {
-  if (filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_object)))
-    return filterx_json_object_to_json_literal(s);
-  if (filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_array)))
-    return filterx_json_array_to_json_literal(s);
-  return NULL;
+  if (!filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_object)) &&
+      !filterx_object_is_type(s, &FILTERX_TYPE_NAME(json_array)))
+    return FALSE;
+
+  return filterx_json_append_literal(s, output);
 }
+
+FILTERX_DEFINE_TYPE(json_double, FILTERX_TYPE_NAME(double),
+                    .map_to_json = _json_double_map_to_json,
+                    .free_fn = _json_double_free,
+                   );
+
+FILTERX_DEFINE_TYPE(json_uint64, FILTERX_TYPE_NAME(integer),
+                    .map_to_json = _json_uint64_map_to_json,
+                   );
@@ -32,6 +32,8 @@ typedef struct FilterXJsonArray_ FilterXJsonArray;
 
 FILTERX_DECLARE_TYPE(json_object);
 FILTERX_DECLARE_TYPE(json_array);
+FILTERX_DECLARE_TYPE(json_double);
+FILTERX_DECLARE_TYPE(json_uint64);
 
 FilterXObject *filterx_json_new_from_repr(const gchar *repr, gssize repr_len);
 FilterXObject *filterx_json_object_new_from_repr(const gchar *repr, gssize repr_len);
@@ -44,18 +46,16 @@ FilterXObject *filterx_json_array_new_empty(void);
 FilterXObject *filterx_json_new_from_args(FilterXExpr *s, GPtrArray *args);
 FilterXObject *filterx_json_array_new_from_args(FilterXExpr *s, GPtrArray *args);
 
+/* NOTE: consumes the object reference */
 FilterXObject *filterx_json_new_from_object(struct json_object *object);
+FilterXObject *filterx_json_convert_json_to_object(struct json_object *jso);
 
-const gchar *filterx_json_to_json_literal(FilterXObject *s);
-const gchar *filterx_json_object_to_json_literal(FilterXObject *s);
-const gchar *filterx_json_array_to_json_literal(FilterXObject *s);
+gboolean filterx_json_to_json_literal(FilterXObject *s, GString *output);
 
-FilterXObject *filterx_json_convert_json_to_object(FilterXObject *root_obj, FilterXWeakRef *root_container,
-                                                   struct json_object *jso);
-void filterx_json_associate_cached_object(struct json_object *jso, FilterXObject *filterx_object);
-FilterXObject *filterx_json_get_cached_object(struct json_object *jso);
-
-struct json_object *filterx_json_object_get_value(FilterXObject *s);
-struct json_object *filterx_json_array_get_value(FilterXObject *s);
+/*
+ * Makes @s and its members readonly and freezes them, the frozen objects
+ * are added to @frozen_objects, to be freed using filterx_object_unfreeze_and_free().
+ */
+void filterx_json_deep_freeze(FilterXObject *s, GPtrArray *frozen_objects);
 
 #endif
@@ -264,8 +264,6 @@ _map_to_json(FilterXObject *s, struct json_object **object, FilterXObject **asso
           goto error;
         }
 
-      filterx_json_associate_cached_object(*object, elem_assoc_object);
-
       filterx_object_unref(elem_assoc_object);
       filterx_object_unref(value_obj);
 
@@ -276,7 +274,6 @@ _map_to_json(FilterXObject *s, struct json_object **object, FilterXObject **asso
         }
     }
 
-  *assoc_object = filterx_json_new_from_object(json_object_get(*object));
   return TRUE;
 
 error:
@@ -328,6 +328,25 @@ Test(filterx_expr, test_filterx_assign)
   filterx_object_unref(result_obj);
 }
 
+Test(filterx_expr, test_filterx_isset_and_unset_of_unread_message_variable)
+{
+  /* the variables are not evaluated first, so they are not in the scope yet */
+  FilterXExpr *value = filterx_msg_variable_expr_new(filterx_string_typed_new("$APP.VALUE"));
+  FilterXExpr *missing = filterx_msg_variable_expr_new(filterx_string_typed_new("$no-such-field"));
+
+  cr_assert(filterx_expr_is_set(value));
+  cr_assert_not(filterx_expr_is_set(missing));
+
+  cr_assert(filterx_expr_unset(missing));
+  cr_assert_not(filterx_expr_is_set(missing));
+
+  cr_assert(filterx_expr_unset(value));
+  cr_assert_not(filterx_expr_is_set(value));
+
+  filterx_expr_unref(missing);
+  filterx_expr_unref(value);
+}
+
 Test(filterx_expr, test_filterx_setattr)
 {
   FilterXObject *json = filterx_json_object_new_empty();
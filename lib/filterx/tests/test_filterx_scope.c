@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/filterx-lib.h"
+
+#include "filterx/filterx-scope.h"
+#include "filterx/object-primitive.h"
+
+#include "apphook.h"
+#include "scratch-buffers.h"
+
+#define NUM_VARIABLES 100
+
+static void
+_assert_variable_value(FilterXScope *scope, FilterXVariableHandle handle, gint64 expected)
+{
+  FilterXVariable *v = filterx_scope_lookup_variable(scope, handle);
+  cr_assert(v);
+
+  FilterXObject *value = filterx_variable_get_value(v);
+  gint64 i;
+  cr_assert(filterx_integer_unwrap(value, &i));
+  cr_assert_eq(i, expected);
+  filterx_object_unref(value);
+}
+
+static void
+_register_integer(FilterXScope *scope, FilterXVariableHandle handle, gint64 value)
+{
+  FilterXObject *o = filterx_integer_new(value);
+  filterx_scope_register_variable(scope, handle, o);
+  filterx_object_unref(o);
+}
+
+Test(filterx_scope, test_variable_handles_are_allocated_once_per_name_and_type)
+{
+  FilterXVariableHandle floating = filterx_scope_map_variable_to_handle("foo", FX_VAR_FLOATING);
+  FilterXVariableHandle msg_tied = filterx_scope_map_variable_to_handle("$foo", FX_VAR_MESSAGE);
+
+  cr_assert_eq(filterx_scope_map_variable_to_handle("foo", FX_VAR_FLOATING), floating);
+  cr_assert_eq(filterx_scope_map_variable_to_handle("$foo", FX_VAR_MESSAGE), msg_tied);
+  cr_assert_neq(floating, msg_tied);
+
+  cr_assert(filterx_variable_handle_is_floating(floating));
+  cr_assert_not(filterx_variable_handle_is_floating(msg_tied));
+
+  cr_assert_eq(filterx_variable_handle_get_nv_handle(floating), log_msg_get_value_handle("foo"));
+  cr_assert_eq(filterx_variable_handle_get_nv_handle(msg_tied), log_msg_get_value_handle("foo"));
+}
+
+Test(filterx_scope, test_variables_can_be_registered_and_looked_up)
+{
+  FilterXVariableHandle handles[NUM_VARIABLES];
+  FilterXScope *scope = filterx_scope_new();
+
+  for (gint i = 0; i < NUM_VARIABLES; i++)
+    {
+      gchar name[32];
+
+      g_snprintf(name, sizeof(name), "var%d", i);
+      handles[i] = filterx_scope_map_variable_to_handle(name, FX_VAR_FLOATING);
+    }
+
+  /* register in reverse order, so registration order is different from slot order */
+  for (gint i = NUM_VARIABLES - 1; i >= 0; i--)
+    {
+      cr_assert_null(filterx_scope_lookup_variable(scope, handles[i]));
+      _register_integer(scope, handles[i], i);
+    }
+
+  for (gint i = 0; i < NUM_VARIABLES; i++)
+    _assert_variable_value(scope, handles[i], i);
+
+  filterx_scope_unref(scope);
+}
+
+Test(filterx_scope, test_undeclared_floating_variables_do_not_survive_to_the_next_generation)
+{
+  FilterXVariableHandle floating = filterx_scope_map_variable_to_handle("floating", FX_VAR_FLOATING);
+  FilterXVariableHandle declared = filterx_scope_map_variable_to_handle("declared", FX_VAR_FLOATING);
+  FilterXVariableHandle msg_tied = filterx_scope_map_variable_to_handle("$MSG", FX_VAR_MESSAGE);
+  FilterXScope *scope = filterx_scope_new();
+
+  filterx_scope_make_writable(&scope);
+  _register_integer(scope, floating, 1);
+  FilterXObject *o = filterx_integer_new(2);
+  filterx_scope_register_declared_variable(scope, declared, o);
+  filterx_object_unref(o);
+  _register_integer(scope, msg_tied, 3);
+
+  filterx_scope_make_writable(&scope);
+  cr_assert_null(filterx_scope_lookup_variable(scope, floating));
+  _assert_variable_value(scope, declared, 2);
+  _assert_variable_value(scope, msg_tied, 3);
+
+  /* cloning drops undeclared floating variables altogether */
+  filterx_scope_write_protect(scope);
+  filterx_scope_make_writable(&scope);
+  cr_assert_null(filterx_scope_lookup_variable(scope, floating));
+  _assert_variable_value(scope, declared, 2);
+  _assert_variable_value(scope, msg_tied, 3);
+
+  filterx_scope_unref(scope);
+}
+
+Test(filterx_scope, test_released_scopes_are_reused_empty)
+{
+  FilterXVariableHandle handle = filterx_scope_map_variable_to_handle("foo", FX_VAR_FLOATING);
+  FilterXScope *scope = filterx_scope_new();
+
+  filterx_scope_make_writable(&scope);
+  _register_integer(scope, handle, 42);
+  filterx_scope_set_dirty(scope);
+  filterx_scope_write_protect(scope);
+  filterx_scope_unref(scope);
+
+  FilterXScope *reused = filterx_scope_new();
+  cr_assert_eq(reused, scope);
+  cr_assert_not(filterx_scope_is_dirty(reused));
+  cr_assert_null(filterx_scope_lookup_variable(reused, handle));
+
+  /* not write protected anymore, make_writable() must not clone it */
+  filterx_scope_make_writable(&reused);
+  cr_assert_eq(reused, scope);
+
+  _register_integer(reused, handle, 43);
+  _assert_variable_value(reused, handle, 43);
+  filterx_scope_unref(reused);
+}
+
+static gboolean
+_collect_variable_names(FilterXVariable *variable, gpointer user_data)
+{
+  GPtrArray *names = (GPtrArray *) user_data;
+
+  g_ptr_array_add(names, (gpointer) filterx_variable_get_name(variable, NULL));
+  return TRUE;
+}
+
+Test(filterx_scope, test_variables_are_visited_message_tied_first_in_nv_handle_order)
+{
+  /* the NVHandles are allocated in this order */
+  FilterXVariableHandle floating = filterx_scope_map_variable_to_handle("order_a", FX_VAR_FLOATING);
+  FilterXVariableHandle msg_tied_b = filterx_scope_map_variable_to_handle("$order_b", FX_VAR_MESSAGE);
+  FilterXVariableHandle msg_tied_c = filterx_scope_map_variable_to_handle("$order_c", FX_VAR_MESSAGE);
+  FilterXScope *scope = filterx_scope_new();
+  GPtrArray *names = g_ptr_array_new();
+
+  filterx_scope_make_writable(&scope);
+  _register_integer(scope, floating, 1);
+  _register_integer(scope, msg_tied_c, 2);
+  _register_integer(scope, msg_tied_b, 3);
+
+  cr_assert(filterx_scope_foreach_variable(scope, _collect_variable_names, names));
+  cr_assert_eq(names->len, 3);
+  cr_assert_str_eq(g_ptr_array_index(names, 0), "order_b");
+  cr_assert_str_eq(g_ptr_array_index(names, 1), "order_c");
+  cr_assert_str_eq(g_ptr_array_index(names, 2), "order_a");
+
+  g_ptr_array_free(names, TRUE);
+  filterx_scope_unref(scope);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  init_libtest_filterx();
+}
+
+static void
+teardown(void)
+{
+  scratch_buffers_explicit_gc();
+  deinit_libtest_filterx();
+  app_shutdown();
+}
+
+TestSuite(filterx_scope, .init = setup, .fini = teardown);
@@ -25,6 +25,8 @@
 
 #include "filterx/object-json.h"
 #include "filterx/object-string.h"
+#include "filterx/object-primitive.h"
+#include "filterx/object-list-interface.h"
 #include "filterx/object-message-value.h"
 #include "filterx/expr-function.h"
 #include "apphook.h"
@@ -213,15 +215,189 @@ Test(filterx_json, filterx_json_object_cloning_double)
   filterx_object_unref(obj);
 }
 
+static void
+_set_key(FilterXObject *dict, const gchar *key, FilterXObject *value)
+{
+  FilterXObject *key_obj = filterx_string_new(key, -1);
+  cr_assert(filterx_object_set_subscript(dict, key_obj, &value));
+  filterx_object_unref(key_obj);
+  filterx_object_unref(value);
+}
+
+static FilterXObject *
+_get_key(FilterXObject *dict, const gchar *key)
+{
+  FilterXObject *key_obj = filterx_string_new(key, -1);
+  FilterXObject *value = filterx_object_get_subscript(dict, key_obj);
+  filterx_object_unref(key_obj);
+  return value;
+}
+
+static void
+_unset_key(FilterXObject *dict, const gchar *key)
+{
+  FilterXObject *key_obj = filterx_string_new(key, -1);
+  cr_assert(filterx_object_unset_key(dict, key_obj));
+  filterx_object_unref(key_obj);
+}
+
+Test(filterx_json, filterx_json_object_keeps_insertion_order)
+{
+  FilterXObject *obj = filterx_json_object_new_empty();
+
+  for (gint i = 0; i < 20; i++)
+    {
+      gchar key[16];
+      g_snprintf(key, sizeof(key), "k%d", i);
+      _set_key(obj, key, filterx_integer_new(i));
+    }
+  for (gint i = 0; i < 20; i += 2)
+    {
+      gchar key[16];
+      g_snprintf(key, sizeof(key), "k%d", i);
+      _unset_key(obj, key);
+    }
+  _set_key(obj, "k0", filterx_integer_new(0));
+  _set_key(obj, "k1", filterx_integer_new(100));
+
+  assert_object_json_equals(obj, "{\"k1\":100,\"k3\":3,\"k5\":5,\"k7\":7,\"k9\":9,\"k11\":11,\"k13\":13,"
+                            "\"k15\":15,\"k17\":17,\"k19\":19,\"k0\":0}");
+
+  guint64 len;
+  cr_assert(filterx_object_len(obj, &len));
+  cr_assert_eq(len, 11);
+  filterx_object_unref(obj);
+}
+
+Test(filterx_json, filterx_json_object_clones_are_independent)
+{
+  FilterXObject *obj = filterx_json_object_new_from_repr("{\"a\": {\"b\": 1}, \"c\": [1, 2]}", -1);
+  FilterXObject *obj_clone = filterx_object_clone(obj);
+
+  FilterXObject *inner = _get_key(obj_clone, "a");
+  _set_key(inner, "b", filterx_integer_new(2));
+  filterx_object_unref(inner);
+
+  FilterXObject *list = _get_key(obj_clone, "c");
+  FilterXObject *elem = filterx_integer_new(3);
+  cr_assert(filterx_list_append(list, &elem));
+  filterx_object_unref(elem);
+  filterx_object_unref(list);
+
+  _set_key(obj, "d", filterx_string_new("foo", -1));
+
+  assert_object_json_equals(obj, "{\"a\":{\"b\":1},\"c\":[1,2],\"d\":\"foo\"}");
+  assert_object_json_equals(obj_clone, "{\"a\":{\"b\":2},\"c\":[1,2,3]}");
+  cr_assert(obj_clone->modified_in_place);
+
+  filterx_object_unref(obj_clone);
+  filterx_object_unref(obj);
+}
+
+Test(filterx_json, filterx_json_object_member_changes_are_visible_in_the_container)
+{
+  FilterXObject *obj = filterx_json_object_new_from_repr("{\"a\": {\"b\": {\"c\": 1}}}", -1);
+
+  FilterXObject *a = _get_key(obj, "a");
+  FilterXObject *b = _get_key(a, "b");
+  FilterXObject *a_clone = filterx_object_clone(a);
+
+  _set_key(b, "c", filterx_integer_new(2));
+
+  assert_object_json_equals(obj, "{\"a\":{\"b\":{\"c\":2}}}");
+  assert_object_json_equals(a_clone, "{\"b\":{\"c\":1}}");
+  cr_assert(obj->modified_in_place);
+
+  filterx_object_unref(a_clone);
+  filterx_object_unref(b);
+  filterx_object_unref(a);
+  filterx_object_unref(obj);
+}
+
+Test(filterx_json, filterx_json_array_set_subscript_past_the_end_fills_nulls)
+{
+  FilterXObject *obj = filterx_json_array_new_from_repr("[1]", -1);
+
+  FilterXObject *elem = filterx_string_new("foo", -1);
+  cr_assert(filterx_list_set_subscript(obj, 3, &elem));
+  filterx_object_unref(elem);
+
+  assert_object_json_equals(obj, "[1,null,null,\"foo\"]");
+  filterx_object_unref(obj);
+}
+
+Test(filterx_json, filterx_json_numbers_keep_their_original_text)
+{
+  const gchar *object_repr = "{\"a\":1.50,\"b\":1e3,\"c\":18446744073709551615}";
+  FilterXObject *obj = _exec_json_func(filterx_string_new(object_repr, -1));
+  GString *repr = scratch_buffers_alloc();
+  LogMessageValueType t;
+
+  assert_object_json_equals(obj, object_repr);
+  cr_assert(filterx_object_marshal(obj, repr, &t));
+  cr_assert_str_eq(repr->str, object_repr);
+  cr_assert_eq(t, LM_VT_JSON);
+
+  FilterXObject *array = _exec_json_func(filterx_string_new("[1.50,1e3,18446744073709551615]", -1));
+  assert_object_json_equals(array, "[1.50,1e3,18446744073709551615]");
+  filterx_object_unref(array);
+
+  /* they are still numbers */
+  FilterXObject *a = _get_key(obj, "a");
+  gdouble d;
+  cr_assert(filterx_object_extract_double(a, &d));
+  cr_assert_eq(d, 1.5);
+  filterx_object_unref(a);
+
+  FilterXObject *c = _get_key(obj, "c");
+  gint64 i;
+  cr_assert(filterx_object_extract_integer(c, &i));
+  cr_assert_eq(i, G_MAXINT64);
+  filterx_object_unref(c);
+
+  /* a changed number loses its original text */
+  _set_key(obj, "a", filterx_double_new(2.5));
+  assert_object_json_equals(obj, "{\"a\":2.5,\"b\":1e3,\"c\":18446744073709551615}");
+
+  filterx_object_unref(obj);
+}
+
+Test(filterx_json, filterx_json_marshal_matches_json_c_formatting)
+{
+  const gchar *object_repr = "{\"str\":\"q\\\"b\\\\s\\/n\\nt\\tc\\u0001\\u001f\xc3\xa1\","
+                             "\"list\":[1,-2,true,false,null,2.5,{}],\"obj\":{\"a\\/b\":[]},\"\":\"\"}";
+  FilterXObject *obj = _exec_json_func(filterx_string_new(object_repr, -1));
+  GString *repr = scratch_buffers_alloc();
+  LogMessageValueType t;
+
+  _set_key(obj, "new", filterx_string_new("x/\x02y", -1));
+
+  const gchar *expected = "{\"str\":\"q\\\"b\\\\s\\/n\\nt\\tc\\u0001\\u001f\xc3\xa1\","
+                          "\"list\":[1,-2,true,false,null,2.5,{}],\"obj\":{\"a\\/b\":[]},\"\":\"\","
+                          "\"new\":\"x\\/\\u0002y\"}";
+
+  /* formatted by json-c */
+  assert_object_json_equals(obj, expected);
+
+  cr_assert(filterx_object_marshal(obj, repr, &t));
+  cr_assert_str_eq(repr->str, expected);
+  cr_assert_eq(t, LM_VT_JSON);
+
+  filterx_object_unref(obj);
+}
+
 static void
 setup(void)
 {
   app_startup();
+  init_libtest_filterx();
 }
 
 static void
 teardown(void)
 {
+  scratch_buffers_explicit_gc();
+  deinit_libtest_filterx();
   app_shutdown();
 }
 
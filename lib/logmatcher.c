@@ -27,6 +27,7 @@
 #include "cfg.h"
 #include "str-utils.h"
 #include "scratch-buffers.h"
+#include "pcre-match-pool.h"
 #include "compat/string.h"
 #include "compat/pcre.h"
 
@@ -509,19 +510,18 @@ log_matcher_pcre_re_match(LogMatcher *s, LogMessage *msg, gint value_handle, con
   if (value_len == -1)
     value_len = strlen(value);
 
-  result.match_data = pcre2_match_data_create_from_pattern(self->pattern, NULL);
+  result.match_data = pcre_match_pool_acquire(self->pattern);
   result.source_value = value;
   result.source_value_len = value_len;
   result.source_handle = value_handle;
   result.source_handles_value_changed = FALSE;
 
-  rc = pcre2_match(self->pattern,
-                   (PCRE2_SPTR) result.source_value,
-                   (PCRE2_SIZE) result.source_value_len,
-                   (PCRE2_SIZE) 0,
-                   self->match_options,
-                   result.match_data,
-                   NULL);
+  rc = pcre_match_pool_match(PCRE_MATCH_POOL_LOGMATCHER, self->pattern,
+                             result.source_value,
+                             result.source_value_len,
+                             0,
+                             self->match_options,
+                             result.match_data);
   if (rc < 0)
     {
       switch (rc)
@@ -549,7 +549,7 @@ log_matcher_pcre_re_match(LogMatcher *s, LogMessage *msg, gint value_handle, con
           log_matcher_pcre_re_feed_named_substrings(self, msg, &result);
         }
     }
-  pcre2_match_data_free(result.match_data);
+  pcre_match_pool_release(result.match_data);
   return res;
 }
 
@@ -565,7 +565,7 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
   gint options;
   gboolean last_match_was_empty;
 
-  result.match_data = pcre2_match_data_create_from_pattern(self->pattern, NULL);
+  result.match_data = pcre_match_pool_acquire(self->pattern);
   PCRE2_SIZE *matches = pcre2_get_ovector_pointer(result.match_data);
 
 
@@ -620,13 +620,12 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
           options = 0;
         }
 
-      rc = pcre2_match(self->pattern,
-                       (PCRE2_SPTR) result.source_value,
-                       (PCRE2_SIZE) result.source_value_len,
-                       start_offset,
-                       (self->match_options | options),
-                       result.match_data,
-                       NULL);
+      rc = pcre_match_pool_match(PCRE_MATCH_POOL_LOGMATCHER, self->pattern,
+                                 result.source_value,
+                                 result.source_value_len,
+                                 start_offset,
+                                 (self->match_options | options),
+                                 result.match_data);
       if (rc < 0 && rc != PCRE2_ERROR_NOMATCH)
         {
           msg_error("Error while matching regexp",
@@ -674,7 +673,7 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
     }
   while (self->super.flags & LMF_GLOBAL && start_offset < result.source_value_len);
 
-  pcre2_match_data_free(result.match_data);
+  pcre_match_pool_release(result.match_data);
 
   if (new_value)
     {
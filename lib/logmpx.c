@@ -25,6 +25,9 @@
 #include "logmpx.h"
 #include "cfg-walker.h"
 
+/* number of messages handed over to a next-hop at once */
+#define LOG_MULTIPLEXER_BATCH_CHUNK 64
+
 
 void
 log_multiplexer_add_next_hop(LogMultiplexer *self, LogPipe *next_hop)
@@ -58,6 +61,10 @@ log_multiplexer_init(LogPipe *s)
         {
           self->fallback_exists = TRUE;
         }
+      if (branch_head->flags & PIF_BRANCH_FINAL)
+        {
+          self->final_exists = TRUE;
+        }
     }
   return TRUE;
 }
@@ -180,6 +187,59 @@ log_multiplexer_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
   log_pipe_forward_msg(s, msg, path_options);
 }
 
+/*
+ * Batches are only delivered as a whole if the outcome of a branch has no
+ * effect on the rest of the branches (e.g.  there are no fallback or final
+ * branches), otherwise we need the matched result of each individual
+ * message and fall back to log_multiplexer_queue().
+ *
+ * log_pipe_queue_batch() only calls us with a NULL matched pointer, so
+ * there's nothing to propagate towards our parent either.
+ */
+static void
+log_multiplexer_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogMultiplexer *self = (LogMultiplexer *) s;
+  LogMessage *hop_msgs[LOG_MULTIPLEXER_BATCH_CHUNK];
+  LogPathOptions local_path_options;
+  gint i;
+
+  if (self->fallback_exists || self->final_exists)
+    {
+      for (i = 0; i < num_msgs; i++)
+        log_multiplexer_queue(s, msgs[i], path_options);
+      return;
+    }
+
+  log_path_options_push_junction(&local_path_options, NULL, path_options);
+  if (_has_multiple_arcs(self))
+    {
+      for (i = 0; i < num_msgs; i++)
+        filterx_eval_prepare_for_fork(path_options->filterx_context, &msgs[i], path_options);
+    }
+
+  for (i = 0; i < self->next_hops->len; i++)
+    {
+      LogPipe *next_hop = g_ptr_array_index(self->next_hops, i);
+
+      for (gint chunk_start = 0; chunk_start < num_msgs; chunk_start += LOG_MULTIPLEXER_BATCH_CHUNK)
+        {
+          gint chunk_len = MIN(num_msgs - chunk_start, LOG_MULTIPLEXER_BATCH_CHUNK);
+
+          for (gint j = 0; j < chunk_len; j++)
+            {
+              LogMessage *msg = msgs[chunk_start + j];
+
+              log_msg_add_ack(msg, &local_path_options);
+              hop_msgs[j] = log_msg_ref(msg);
+            }
+          log_pipe_queue_batch(next_hop, hop_msgs, chunk_len, &local_path_options);
+        }
+    }
+
+  log_pipe_forward_msg_batch(s, msgs, num_msgs, path_options);
+}
+
 static void
 log_multiplexer_free(LogPipe *s)
 {
@@ -222,6 +282,7 @@ log_multiplexer_new(GlobalConfig *cfg)
   self->super.init = log_multiplexer_init;
   self->super.deinit = log_multiplexer_deinit;
   self->super.queue = log_multiplexer_queue;
+  self->super.queue_batch = log_multiplexer_queue_batch;
   self->super.free_fn = log_multiplexer_free;
   self->next_hops = g_ptr_array_new();
   self->super.arcs = _arcs;
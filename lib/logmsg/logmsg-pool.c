@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "logmsg/logmsg-pool.h"
+#include "tls-support.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+/*
+ * LogMessage pool
+ *
+ * A size-class based block allocator for LogMessage instances (including
+ * the preallocated LogMessageQueueNodes and the borrowed NVTable payload
+ * that follows the LogMessage structure).
+ *
+ * Design:
+ *   - blocks are grouped in power-of-two size classes, from
+ *     LOG_MSG_POOL_MIN_CLASS_SIZE up to LOG_MSG_POOL_MAX_CLASS_SIZE, larger
+ *     allocations are served by g_malloc() directly
+ *
+ *   - each thread has a small, lock-free cache of free blocks for every
+ *     size class, allocations and frees hit this cache in the common case
+ *
+ *   - messages are usually allocated by a source thread and freed by a
+ *     destination thread.  Frees always go to the cache of the freeing
+ *     thread, once that cache overflows, a fixed sized batch of blocks is
+ *     returned to a global depot (protected by a mutex), where allocating
+ *     threads can pick it up as a whole, again as a single batch.  This
+ *     way, the lock is taken once per batch and not once per message.
+ *
+ *   - both the per-thread caches and the depot are bounded, excess blocks
+ *     are released to libc.
+ *
+ *   - the pool is opt-in (see the log-msg-pool() global option), the size
+ *     class of a block is stored in the LogMessage, so blocks allocated
+ *     while the pool was enabled are released properly even after it gets
+ *     disabled by a config reload.
+ */
+
+#define LOG_MSG_POOL_MIN_CLASS_SHIFT 9
+#define LOG_MSG_POOL_NUM_CLASSES 8
+#define LOG_MSG_POOL_MIN_CLASS_SIZE (1 << LOG_MSG_POOL_MIN_CLASS_SHIFT)
+#define LOG_MSG_POOL_MAX_CLASS_SIZE (1 << (LOG_MSG_POOL_MIN_CLASS_SHIFT + LOG_MSG_POOL_NUM_CLASSES - 1))
+
+/* upper bound of the memory cached per size class, per thread */
+#define LOG_MSG_POOL_THREAD_CACHE_BYTES (256 * 1024)
+/* upper bound of the memory kept in the global depot, per size class */
+#define LOG_MSG_POOL_DEPOT_BYTES (4 * 1024 * 1024)
+/* minimum number of blocks moved between a thread cache and the depot */
+#define LOG_MSG_POOL_MIN_BATCH_SIZE 2
+
+/* thread local counters are published to stats after this many operations */
+#define LOG_MSG_POOL_STATS_FLUSH_PERIOD 256
+
+typedef struct _LogMsgPoolBlock LogMsgPoolBlock;
+struct _LogMsgPoolBlock
+{
+  LogMsgPoolBlock *next;
+  /* only valid in the first block of a batch stored in the depot */
+  LogMsgPoolBlock *next_batch;
+};
+
+typedef struct _LogMsgPoolFreeList
+{
+  LogMsgPoolBlock *head;
+  gint count;
+} LogMsgPoolFreeList;
+
+typedef struct _LogMsgPoolDepot
+{
+  GMutex lock;
+  LogMsgPoolBlock *batches;
+  gint num_batches;
+} LogMsgPoolDepot;
+
+TLS_BLOCK_START
+{
+  LogMsgPoolFreeList log_msg_pool_cache[LOG_MSG_POOL_NUM_CLASSES];
+  gssize log_msg_pool_pending_hits;
+  gssize log_msg_pool_pending_misses;
+  gssize log_msg_pool_pending_resident_bytes;
+  gint log_msg_pool_ops_since_flush;
+}
+TLS_BLOCK_END;
+
+#define log_msg_pool_cache  __tls_deref(log_msg_pool_cache)
+#define log_msg_pool_pending_hits  __tls_deref(log_msg_pool_pending_hits)
+#define log_msg_pool_pending_misses  __tls_deref(log_msg_pool_pending_misses)
+#define log_msg_pool_pending_resident_bytes  __tls_deref(log_msg_pool_pending_resident_bytes)
+#define log_msg_pool_ops_since_flush  __tls_deref(log_msg_pool_ops_since_flush)
+
+static LogMsgPoolDepot log_msg_pool_depot[LOG_MSG_POOL_NUM_CLASSES];
+static gboolean log_msg_pool_enabled;
+
+static StatsCounterItem *count_pool_hits;
+static StatsCounterItem *count_pool_misses;
+static StatsCounterItem *count_pool_resident_bytes;
+
+static inline gsize
+_class_size(gint class_index)
+{
+  return ((gsize) LOG_MSG_POOL_MIN_CLASS_SIZE) << class_index;
+}
+
+static inline gint
+_thread_cache_limit(gint class_index)
+{
+  return MAX(LOG_MSG_POOL_THREAD_CACHE_BYTES / _class_size(class_index), 2 * LOG_MSG_POOL_MIN_BATCH_SIZE);
+}
+
+static inline gint
+_batch_size(gint class_index)
+{
+  return _thread_cache_limit(class_index) / 2;
+}
+
+static inline gint
+_depot_limit(gint class_index)
+{
+  return MAX(LOG_MSG_POOL_DEPOT_BYTES / (_class_size(class_index) * _batch_size(class_index)), 1);
+}
+
+static inline gint
+_lookup_class_index(gsize size)
+{
+  if (size <= LOG_MSG_POOL_MIN_CLASS_SIZE)
+    return 0;
+  return g_bit_storage(size - 1) - LOG_MSG_POOL_MIN_CLASS_SHIFT;
+}
+
+static void
+_flush_stats(void)
+{
+  stats_counter_add(count_pool_hits, log_msg_pool_pending_hits);
+  stats_counter_add(count_pool_misses, log_msg_pool_pending_misses);
+  stats_counter_add(count_pool_resident_bytes, log_msg_pool_pending_resident_bytes);
+
+  log_msg_pool_pending_hits = 0;
+  log_msg_pool_pending_misses = 0;
+  log_msg_pool_pending_resident_bytes = 0;
+  log_msg_pool_ops_since_flush = 0;
+}
+
+static inline void
+_lazy_flush_stats(void)
+{
+  if (++log_msg_pool_ops_since_flush >= LOG_MSG_POOL_STATS_FLUSH_PERIOD)
+    _flush_stats();
+}
+
+static void
+_free_chain(LogMsgPoolBlock *block)
+{
+  while (block)
+    {
+      LogMsgPoolBlock *next = block->next;
+      g_free(block);
+      block = next;
+    }
+}
+
+/* move a batch from the thread cache to the depot, called when the cache overflows */
+static void
+_release_batch_to_depot(gint class_index)
+{
+  LogMsgPoolFreeList *cache = &log_msg_pool_cache[class_index];
+  LogMsgPoolDepot *depot = &log_msg_pool_depot[class_index];
+  gint batch_size = _batch_size(class_index);
+
+  LogMsgPoolBlock *batch = cache->head;
+  LogMsgPoolBlock *last = batch;
+  for (gint i = 1; i < batch_size; i++)
+    last = last->next;
+
+  cache->head = last->next;
+  cache->count -= batch_size;
+  last->next = NULL;
+
+  g_mutex_lock(&depot->lock);
+  if (depot->num_batches < _depot_limit(class_index))
+    {
+      batch->next_batch = depot->batches;
+      depot->batches = batch;
+      depot->num_batches++;
+      batch = NULL;
+    }
+  g_mutex_unlock(&depot->lock);
+
+  if (batch)
+    {
+      _free_chain(batch);
+      log_msg_pool_pending_resident_bytes -= batch_size * _class_size(class_index);
+    }
+}
+
+/* refill an empty thread cache with a batch from the depot */
+static gboolean
+_acquire_batch_from_depot(gint class_index)
+{
+  LogMsgPoolFreeList *cache = &log_msg_pool_cache[class_index];
+  LogMsgPoolDepot *depot = &log_msg_pool_depot[class_index];
+  LogMsgPoolBlock *batch = NULL;
+
+  g_mutex_lock(&depot->lock);
+  if (depot->batches)
+    {
+      batch = depot->batches;
+      depot->batches = batch->next_batch;
+      depot->num_batches--;
+    }
+  g_mutex_unlock(&depot->lock);
+
+  if (!batch)
+    return FALSE;
+
+  g_assert(cache->count == 0);
+  cache->head = batch;
+  cache->count = _batch_size(class_index);
+  return TRUE;
+}
+
+gpointer
+log_msg_pool_alloc(gsize size, guint8 *alloc_class)
+{
+  if (!log_msg_pool_enabled || size > LOG_MSG_POOL_MAX_CLASS_SIZE)
+    {
+      *alloc_class = LOG_MSG_POOL_CLASS_NONE;
+      return g_malloc(size);
+    }
+
+  gint class_index = _lookup_class_index(size);
+  LogMsgPoolFreeList *cache = &log_msg_pool_cache[class_index];
+
+  *alloc_class = class_index + 1;
+  _lazy_flush_stats();
+
+  if (cache->count == 0 && !_acquire_batch_from_depot(class_index))
+    {
+      log_msg_pool_pending_misses++;
+      return g_malloc(_class_size(class_index));
+    }
+
+  LogMsgPoolBlock *block = cache->head;
+  cache->head = block->next;
+  cache->count--;
+
+  log_msg_pool_pending_hits++;
+  log_msg_pool_pending_resident_bytes -= _class_size(class_index);
+  return block;
+}
+
+void
+log_msg_pool_free(gpointer block, guint8 alloc_class)
+{
+  if (alloc_class == LOG_MSG_POOL_CLASS_NONE || !log_msg_pool_enabled)
+    {
+      g_free(block);
+      return;
+    }
+
+  gint class_index = alloc_class - 1;
+  LogMsgPoolFreeList *cache = &log_msg_pool_cache[class_index];
+  LogMsgPoolBlock *free_block = (LogMsgPoolBlock *) block;
+
+  free_block->next = cache->head;
+  cache->head = free_block;
+  cache->count++;
+  log_msg_pool_pending_resident_bytes += _class_size(class_index);
+
+  if (cache->count >= _thread_cache_limit(class_index))
+    _release_batch_to_depot(class_index);
+  _lazy_flush_stats();
+}
+
+/* the usable size of a block, which might be larger than what was requested */
+gsize
+log_msg_pool_get_class_size(guint8 alloc_class)
+{
+  g_assert(alloc_class != LOG_MSG_POOL_CLASS_NONE);
+  return _class_size(alloc_class - 1);
+}
+
+void
+log_msg_pool_set_enabled(gboolean enabled)
+{
+  log_msg_pool_enabled = enabled;
+}
+
+gboolean
+log_msg_pool_is_enabled(void)
+{
+  return log_msg_pool_enabled;
+}
+
+void
+log_msg_pool_register_stats(void)
+{
+  StatsClusterKey sc_key;
+
+  stats_cluster_single_key_set(&sc_key, "events_pool_hits_total", NULL, 0);
+  stats_cluster_single_key_add_legacy_alias(&sc_key, SCS_GLOBAL, "msg_pool_hits", NULL);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_pool_hits);
+
+  stats_cluster_single_key_set(&sc_key, "events_pool_misses_total", NULL, 0);
+  stats_cluster_single_key_add_legacy_alias(&sc_key, SCS_GLOBAL, "msg_pool_misses", NULL);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_pool_misses);
+
+  stats_cluster_single_key_set(&sc_key, "events_pool_resident_bytes", NULL, 0);
+  stats_cluster_single_key_add_legacy_alias(&sc_key, SCS_GLOBAL, "msg_pool_resident_bytes", NULL);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_pool_resident_bytes);
+}
+
+void
+log_msg_pool_thread_init(void)
+{
+  memset(log_msg_pool_cache, 0, sizeof(log_msg_pool_cache));
+  log_msg_pool_pending_hits = 0;
+  log_msg_pool_pending_misses = 0;
+  log_msg_pool_pending_resident_bytes = 0;
+  log_msg_pool_ops_since_flush = 0;
+}
+
+/* hand over all complete batches to the depot, release the remainder */
+void
+log_msg_pool_thread_deinit(void)
+{
+  for (gint class_index = 0; class_index < LOG_MSG_POOL_NUM_CLASSES; class_index++)
+    {
+      LogMsgPoolFreeList *cache = &log_msg_pool_cache[class_index];
+
+      while (cache->count >= _batch_size(class_index))
+        _release_batch_to_depot(class_index);
+
+      _free_chain(cache->head);
+      log_msg_pool_pending_resident_bytes -= cache->count * _class_size(class_index);
+      cache->head = NULL;
+      cache->count = 0;
+    }
+  _flush_stats();
+}
+
+void
+log_msg_pool_global_init(void)
+{
+  for (gint class_index = 0; class_index < LOG_MSG_POOL_NUM_CLASSES; class_index++)
+    g_mutex_init(&log_msg_pool_depot[class_index].lock);
+}
+
+void
+log_msg_pool_global_deinit(void)
+{
+  log_msg_pool_enabled = FALSE;
+  for (gint class_index = 0; class_index < LOG_MSG_POOL_NUM_CLASSES; class_index++)
+    {
+      LogMsgPoolDepot *depot = &log_msg_pool_depot[class_index];
+
+      while (depot->batches)
+        {
+          LogMsgPoolBlock *batch = depot->batches;
+
+          depot->batches = batch->next_batch;
+          _free_chain(batch);
+        }
+      stats_counter_sub(count_pool_resident_bytes,
+                        depot->num_batches * _batch_size(class_index) * _class_size(class_index));
+      depot->num_batches = 0;
+      g_mutex_clear(&depot->lock);
+    }
+}
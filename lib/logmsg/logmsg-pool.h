@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGMSG_POOL_H_INCLUDED
+#define LOGMSG_POOL_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/* alloc_class value for blocks that were allocated directly by g_malloc() */
+#define LOG_MSG_POOL_CLASS_NONE 0
+
+gpointer log_msg_pool_alloc(gsize size, guint8 *alloc_class);
+void log_msg_pool_free(gpointer block, guint8 alloc_class);
+gsize log_msg_pool_get_class_size(guint8 alloc_class);
+
+void log_msg_pool_set_enabled(gboolean enabled);
+gboolean log_msg_pool_is_enabled(void);
+
+void log_msg_pool_register_stats(void);
+
+void log_msg_pool_thread_init(void);
+void log_msg_pool_thread_deinit(void);
+void log_msg_pool_global_init(void);
+void log_msg_pool_global_deinit(void);
+
+#endif
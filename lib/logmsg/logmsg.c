@@ -23,6 +23,7 @@
  */
 
 #include "logmsg/logmsg.h"
+#include "logmsg/logmsg-pool.h"
 #include "str-utils.h"
 #include "str-repr/encode.h"
 #include "messages.h"
@@ -1432,9 +1433,20 @@ log_msg_alloc(gsize payload_size)
       payload_ofs = alloc_size;
       alloc_size += payload_space;
     }
-  msg = g_malloc(alloc_size);
+
+  guint8 alloc_class;
+  msg = log_msg_pool_alloc(alloc_size, &alloc_class);
+
+  /* the pooled block is rounded up to its size class, let the payload use
+   * the slack, it would go to waste otherwise */
+  if (payload_size && alloc_class != LOG_MSG_POOL_CLASS_NONE)
+    {
+      payload_space = log_msg_pool_get_class_size(alloc_class) - payload_ofs;
+      alloc_size = payload_ofs + payload_space;
+    }
 
   memset(msg, 0, sizeof(LogMessage));
+  msg->alloc_class = alloc_class;
 
   if (payload_size)
     msg->payload = nv_table_init_borrowed(((gchar *) msg) + payload_ofs, payload_space, LM_V_MAX);
@@ -1490,12 +1502,14 @@ log_msg_clone_cow(LogMessage *msg, const LogPathOptions *path_options)
 {
   LogMessage *self = log_msg_alloc(0);
   gsize allocated_bytes = self->allocated_bytes;
+  guint8 alloc_class = self->alloc_class;
 
   stats_counter_inc(count_msg_clones);
   log_msg_write_protect(msg);
 
   memcpy(self, msg, sizeof(*msg));
   msg->allocated_bytes = allocated_bytes;
+  self->alloc_class = alloc_class;
 
   msg_trace("Message was cloned",
             evt_tag_printf("original_msg", "%p", msg),
@@ -1625,7 +1639,7 @@ log_msg_free(LogMessage *self)
 
   stats_counter_sub(count_allocated_bytes, self->allocated_bytes);
 
-  g_free(self);
+  log_msg_pool_free(self, self->alloc_class);
 }
 
 /**
@@ -2099,6 +2113,8 @@ log_msg_register_stats(void)
   stats_cluster_single_key_set(&sc_key, "events_allocated_bytes", NULL, 0);
   stats_cluster_single_key_add_legacy_alias(&sc_key, SCS_GLOBAL, "msg_allocated_bytes", NULL);
   stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_allocated_bytes);
+
+  log_msg_pool_register_stats();
   stats_unlock();
 }
 
@@ -2108,6 +2124,7 @@ log_msg_global_init(void)
   log_msg_registry_init();
   log_tags_global_init();
   log_msg_tags_init();
+  log_msg_pool_global_init();
 
   /* NOTE: we always initialize counters as they are on stats-level(0),
    * however we need to defer that as the stats subsystem may not be
@@ -2125,6 +2142,7 @@ log_msg_get_handle_name(NVHandle handle, gssize *length)
 void
 log_msg_global_deinit(void)
 {
+  log_msg_pool_global_deinit();
   log_tags_global_deinit();
   log_msg_registry_deinit();
 }
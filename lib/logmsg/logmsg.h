@@ -304,6 +304,8 @@ struct _LogMessage
   guint8 num_nodes;
   guint8 cur_node;
   guint8 write_protected;
+  /* size class of the allocation, see logmsg-pool.h */
+  guint8 alloc_class;
 
 
   /* preallocated LogQueueNodes used to insert this message into a LogQueue */
@@ -331,6 +331,7 @@ nv_table_deserialize_22(SerializeArchive *sa)
     return NULL;
 
   res->ref_cnt = 1;
+  res->index_hashed = FALSE;
   res->borrowed = FALSE;
 
   if (!_deserialize_struct_22(sa, res))
@@ -467,6 +468,7 @@ nv_table_deserialize_legacy(SerializeArchive *sa)
     return NULL;
 
   res->borrowed = FALSE;
+  res->index_hashed = FALSE;
   res->ref_cnt = 1;
 
   if (!_deserialize_blob_v22(sa, res, nv_table_get_top(res), swap_bytes))
@@ -127,6 +127,8 @@ _read_header(SerializeArchive *sa, NVTable **nvtable)
 
   res = (NVTable *) g_malloc(size);
   res->size = size;
+  /* the serialized index is always sorted */
+  res->index_hashed = FALSE;
 
   if (!serialize_read_uint32(sa, &res->used))
     goto error;
@@ -203,6 +205,33 @@ error:
  * serialize an NVTable
  **********************************************************************/
 
+static gint
+_index_entry_cmp(const void *a, const void *b)
+{
+  const NVIndexEntry *entry_a = (const NVIndexEntry *) a;
+  const NVIndexEntry *entry_b = (const NVIndexEntry *) b;
+
+  if (entry_a->handle < entry_b->handle)
+    return -1;
+  else if (entry_a->handle == entry_b->handle)
+    return 0;
+  else
+    return 1;
+}
+
+/* the hashed index is not sorted, while the serialized format (and earlier
+ * versions reading it) expects a sorted array */
+static void
+_write_hashed_index(SerializeArchive *sa, NVTable *self)
+{
+  NVIndexEntry *sorted_index = g_new(NVIndexEntry, self->index_size);
+
+  memcpy(sorted_index, nv_table_get_index(self), self->index_size * sizeof(NVIndexEntry));
+  qsort(sorted_index, self->index_size, sizeof(NVIndexEntry), _index_entry_cmp);
+  serialize_write_uint32_array(sa, (guint32 *) sorted_index, self->index_size * 2);
+  g_free(sorted_index);
+}
+
 static void
 _write_struct(SerializeArchive *sa, NVTable *self)
 {
@@ -211,7 +240,10 @@ _write_struct(SerializeArchive *sa, NVTable *self)
   serialize_write_uint16(sa, self->index_size);
   serialize_write_uint8(sa, self->num_static_entries);
   serialize_write_uint32_array(sa, self->static_entries, self->num_static_entries);
-  serialize_write_uint32_array(sa, (guint32 *) nv_table_get_index(self), self->index_size * 2);
+  if (self->index_hashed)
+    _write_hashed_index(sa, self);
+  else
+    serialize_write_uint32_array(sa, (guint32 *) nv_table_get_index(self), self->index_size * 2);
 }
 
 static void
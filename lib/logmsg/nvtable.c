@@ -292,8 +292,62 @@ _find_index_entry(NVIndexEntry *index_table, gint index_size, NVHandle handle, N
   return NULL;
 }
 
+static inline guint32
+_hash_handle(NVHandle handle, guint32 num_slots)
+{
+  /* fibonacci hashing, handles are small, mostly consecutive integers */
+  return (handle * 2654435761U) >> (33 - g_bit_storage(num_slots));
+}
+
+static inline NVIndexEntry *
+_find_hashed_index_entry(NVTable *self, NVHandle handle, NVIndexEntry **index_slot)
+{
+  NVIndexEntry *index_table = nv_table_get_index(self);
+  guint16 *hash = nv_table_get_index_hash(self);
+  guint32 num_slots = 2 * nv_table_get_index_capacity(self->index_size);
+
+  for (guint32 i = _hash_handle(handle, num_slots); hash[i]; i = (i + 1) & (num_slots - 1))
+    {
+      NVIndexEntry *index_entry = &index_table[hash[i] - 1];
+
+      if (index_entry->handle == handle)
+        {
+          *index_slot = index_entry;
+          return index_entry;
+        }
+    }
+
+  /* new entries are always appended in hashed mode */
+  *index_slot = &index_table[self->index_size];
+  return NULL;
+}
+
+static inline void
+_insert_hashed_index_entry(NVTable *self, gint index_pos)
+{
+  NVIndexEntry *index_table = nv_table_get_index(self);
+  guint16 *hash = nv_table_get_index_hash(self);
+  guint32 num_slots = 2 * nv_table_get_index_capacity(self->index_size);
+  guint32 i;
+
+  for (i = _hash_handle(index_table[index_pos].handle, num_slots); hash[i]; i = (i + 1) & (num_slots - 1))
+    ;
+  hash[i] = index_pos + 1;
+}
+
+static void
+_rebuild_index_hash(NVTable *self)
+{
+  memset(nv_table_get_index_hash(self), 0,
+         2 * nv_table_get_index_capacity(self->index_size) * sizeof(guint16));
+
+  for (gint i = 0; i < self->index_size; i++)
+    _insert_hashed_index_entry(self, i);
+}
+
 /* slow path for nv_table_get_entry(), i.e.  we need to perform the lookup
- * for handle in the sorted index_table by implementing a binary search.
+ * for handle in the sorted index_table by implementing a binary search (or
+ * a hash lookup if the table has a hashed index).
  *
  * The two output arguments `index_entry` and `index_slot` deserve further
  * explanation:
@@ -313,17 +367,72 @@ _find_index_entry(NVIndexEntry *index_table, gint index_size, NVHandle handle, N
 NVEntry *
 nv_table_get_entry_slow(NVTable *self, NVHandle handle, NVIndexEntry **index_entry, NVIndexEntry **index_slot)
 {
-  *index_entry = _find_index_entry(nv_table_get_index(self), self->index_size, handle, index_slot);
+  if (self->index_hashed)
+    *index_entry = _find_hashed_index_entry(self, handle, index_slot);
+  else
+    *index_entry = _find_index_entry(nv_table_get_index(self), self->index_size, handle, index_slot);
   if (*index_entry)
     return nv_table_get_entry_at_ofs(self, (*index_entry)->ofs);
   return NULL;
 }
 
+/* the number of bytes the hashed index occupies with index_size entries */
+static inline gsize
+_hashed_index_size(guint16 index_size)
+{
+  guint32 capacity = nv_table_get_index_capacity(index_size);
+
+  return capacity * sizeof(NVIndexEntry) + 2 * capacity * sizeof(guint16);
+}
+
+static gboolean
+_alloc_hashed_index_entry(NVTable *self, NVHandle handle, NVIndexEntry **index_entry)
+{
+  NVIndexEntry *index_table = nv_table_get_index(self);
+  gboolean needs_rebuild = !self->index_hashed ||
+                           nv_table_get_index_capacity(self->index_size) != nv_table_get_index_capacity(self->index_size + 1);
+
+  if (self->index_size == G_MAXUINT16)
+    return FALSE;
+
+  if (needs_rebuild)
+    {
+      gsize current_size = self->index_hashed
+                           ? _hashed_index_size(self->index_size)
+                           : self->index_size * sizeof(index_table[0]);
+
+      if (!nv_table_alloc_check(self, _hashed_index_size(self->index_size + 1) - current_size))
+        return FALSE;
+    }
+
+  *index_entry = &index_table[self->index_size];
+
+  /* we set ofs to zero here, which means that the NVEntry won't
+     be found even if the slot is present in index */
+  (*index_entry)->handle = handle;
+  (*index_entry)->ofs    = 0;
+  self->index_size++;
+
+  if (needs_rebuild)
+    {
+      self->index_hashed = TRUE;
+      _rebuild_index_hash(self);
+    }
+  else
+    {
+      _insert_hashed_index_entry(self, self->index_size - 1);
+    }
+  return TRUE;
+}
+
 static inline gboolean
 _alloc_index_entry(NVTable *self, NVHandle handle, NVIndexEntry **index_entry, NVIndexEntry *index_slot)
 {
   if (G_UNLIKELY(!(*index_entry) && !nv_table_is_handle_static(self, handle)))
     {
+      if (self->index_hashed || self->index_size >= NV_TABLE_INDEX_HASH_THRESHOLD)
+        return _alloc_hashed_index_entry(self, handle, index_entry);
+
       /* this is a dynamic value */
       NVIndexEntry *index_table = nv_table_get_index(self);
 
@@ -712,6 +821,7 @@ nv_table_init(NVTable *self, gsize alloc_length, gint num_static_entries)
   self->index_size = 0;
   self->num_static_entries = num_static_entries;
   self->ref_cnt = 1;
+  self->index_hashed = FALSE;
   self->borrowed = FALSE;
   memset(&self->static_entries[0], 0, self->num_static_entries * sizeof(self->static_entries[0]));
 }
@@ -770,8 +880,7 @@ nv_table_realloc(NVTable *self, NVTable **new_nv_table)
       *new_nv_table = g_malloc(new_size);
 
       /* we only copy the header first */
-      memcpy(*new_nv_table, self, sizeof(NVTable) + self->num_static_entries * sizeof(self->static_entries[0]) +
-             self->index_size * sizeof(NVIndexEntry));
+      memcpy(*new_nv_table, self, nv_table_get_ofs_table_top(self) - (gchar *) self);
       (*new_nv_table)->ref_cnt = 1;
       (*new_nv_table)->borrowed = FALSE;
       (*new_nv_table)->size = new_size;
@@ -823,8 +932,7 @@ nv_table_clone(NVTable *self, gint additional_space)
     new_size = NV_TABLE_MAX_BYTES;
 
   new = g_malloc(new_size);
-  memcpy(new, self, sizeof(NVTable) + self->num_static_entries * sizeof(self->static_entries[0]) + self->index_size *
-         sizeof(NVIndexEntry));
+  memcpy(new, self, nv_table_get_ofs_table_top(self) - (gchar *) self);
   new->size = new_size;
   new->ref_cnt = 1;
   new->borrowed = FALSE;
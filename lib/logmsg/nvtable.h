@@ -233,6 +233,23 @@ nv_entry_get_name(NVEntry *self)
  *   - a dynamically sized NVIndexEntry array (contains ID + offset)
  *   - dynamic values are sorted by the global ID to make handle->entry lookups fast
  *
+ * Hashed index:
+ *   - once the number of dynamic values reaches NV_TABLE_INDEX_HASH_THRESHOLD,
+ *     the table switches to a hashed index (index_hashed is set), to avoid
+ *     the O(n) insertion cost of the sorted array
+ *   - in this mode the NVIndexEntry array is no longer sorted, new entries
+ *     are appended to its end, and the array has a capacity of the next
+ *     power of two above index_size
+ *   - the array is followed by an open addressed hash table (linear
+ *     probing) of 2 * capacity guint16 slots, each containing the position
+ *     of the NVIndexEntry + 1, zero meaning an empty slot
+ *   - the layout of the hashed index is derived from index_size, so it
+ *     does not need any further fields in the header
+ *   - the hashed index is only an in-memory representation, the
+ *     serialized form always contains the sorted NVIndexEntry array
+ *
+ *  || struct || static value offsets || dynamic value pairs (capacity) || hash slots || <free space> || stored (name, value) ||
+ *
  * Memory allocation
  * =================
  *   - the memory used by NVTable is managed by the caller, sometimes it is
@@ -261,6 +278,8 @@ nv_entry_get_name(NVEntry *self)
  *     so 2^16 * sizeof(NVIndexEntry) is allocated at most (512k). If you
  *     however change this limit, please be careful to audit the
  *     deserialization code.
+ *   - ref_cnt is 6 bits wide, as references are only taken temporarily
+ *     while a parser/rewrite rule operates on the payload.
  *
  */
 struct _NVTable
@@ -274,7 +293,8 @@ struct _NVTable
    * versions, but index_size is a more descriptive name */
   guint16 index_size;
   guint8 num_static_entries;
-  guint8 ref_cnt:7,
+  guint8 ref_cnt:6,
+         index_hashed:1, /* the dynamic index is hashed, see "Hashed index" above */
          borrowed:1; /* specifies if the memory used by NVTable was borrowed from the container struct */
 
   /* variable data, see memory layout in the comment above */
@@ -297,6 +317,9 @@ struct _NVTable
  * static values */
 #define NV_TABLE_MIN_BYTES  128
 
+/* number of dynamic values where we switch to the hashed index */
+#define NV_TABLE_INDEX_HASH_THRESHOLD 64
+
 gboolean nv_table_add_value(NVTable *self, NVHandle handle,
                             const gchar *name, gsize name_len,
                             const gchar *value, gsize value_len,
@@ -351,9 +374,31 @@ nv_table_get_bottom(NVTable *self)
   return nv_table_get_top(self) - self->used;
 }
 
+static inline NVIndexEntry *
+nv_table_get_index(NVTable *self)
+{
+  return (NVIndexEntry *)&self->static_entries[self->num_static_entries];
+}
+
+/* the number of NVIndexEntry slots reserved in hashed mode */
+static inline guint32
+nv_table_get_index_capacity(guint16 index_size)
+{
+  return 1 << g_bit_storage(index_size);
+}
+
+static inline guint16 *
+nv_table_get_index_hash(NVTable *self)
+{
+  return (guint16 *) &nv_table_get_index(self)[nv_table_get_index_capacity(self->index_size)];
+}
+
 static inline gchar *
 nv_table_get_ofs_table_top(NVTable *self)
 {
+  if (G_UNLIKELY(self->index_hashed))
+    return (gchar *) &nv_table_get_index_hash(self)[2 * nv_table_get_index_capacity(self->index_size)];
+
   return (gchar *) &self->data[self->num_static_entries * sizeof(self->static_entries[0]) +
                                                         self->index_size * sizeof(NVIndexEntry)];
 }
@@ -441,12 +486,6 @@ nv_table_get_value(NVTable *self, NVHandle handle, gssize *length, NVType *type)
   return nv_table_resolve_indirect(self, entry, length);
 }
 
-static inline NVIndexEntry *
-nv_table_get_index(NVTable *self)
-{
-  return (NVIndexEntry *)&self->static_entries[self->num_static_entries];
-}
-
 static inline NVEntry *
 nv_table_get_entry_at_ofs(NVTable *self, guint32 ofs)
 {
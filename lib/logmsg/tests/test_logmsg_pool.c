@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include <criterion/criterion.h>
+#include "logmsg/logmsg.h"
+#include "logmsg/logmsg-pool.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+#include "apphook.h"
+
+#define NUM_MESSAGES 4096
+
+Test(logmsg_pool, test_disabled_pool_uses_malloc)
+{
+  log_msg_pool_set_enabled(FALSE);
+
+  LogMessage *msg = log_msg_new_empty();
+  cr_assert_eq(msg->alloc_class, LOG_MSG_POOL_CLASS_NONE);
+  log_msg_unref(msg);
+}
+
+Test(logmsg_pool, test_freed_message_is_reused_by_the_same_thread)
+{
+  log_msg_pool_set_enabled(TRUE);
+
+  LogMessage *msg = log_msg_new_empty();
+  cr_assert_neq(msg->alloc_class, LOG_MSG_POOL_CLASS_NONE);
+
+  gpointer block = msg;
+  log_msg_unref(msg);
+
+  msg = log_msg_new_empty();
+  cr_assert_eq((gpointer) msg, block);
+  log_msg_unref(msg);
+}
+
+Test(logmsg_pool, test_payload_is_usable_in_pooled_messages)
+{
+  log_msg_pool_set_enabled(TRUE);
+
+  LogMessage *msg = log_msg_new_empty();
+  log_msg_set_value_by_name(msg, "foo", "bar", -1);
+
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *cloned = log_msg_clone_cow(msg, &path_options);
+  cr_assert_neq(cloned->alloc_class, LOG_MSG_POOL_CLASS_NONE);
+
+  log_msg_set_value_by_name(cloned, "bar", "baz", -1);
+  cr_assert_str_eq(log_msg_get_value_by_name(cloned, "foo", NULL), "bar");
+  cr_assert_str_eq(log_msg_get_value_by_name(cloned, "bar", NULL), "baz");
+
+  log_msg_unref(cloned);
+  log_msg_unref(msg);
+}
+
+static gpointer
+_free_messages_thread(gpointer user_data)
+{
+  LogMessage **msgs = (LogMessage **) user_data;
+
+  log_msg_pool_thread_init();
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    log_msg_unref(msgs[i]);
+  log_msg_pool_thread_deinit();
+  return NULL;
+}
+
+Test(logmsg_pool, test_blocks_freed_by_another_thread_flow_back_in_batches)
+{
+  log_msg_pool_set_enabled(TRUE);
+
+  LogMessage **msgs = g_new0(LogMessage *, NUM_MESSAGES);
+  GHashTable *blocks = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    {
+      msgs[i] = log_msg_new_empty();
+      g_hash_table_add(blocks, msgs[i]);
+    }
+
+  GThread *thread = g_thread_new("free-messages", _free_messages_thread, msgs);
+  g_thread_join(thread);
+
+  /* at least some of the blocks freed by the other thread has to be reused here */
+  gint reused = 0;
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    {
+      msgs[i] = log_msg_new_empty();
+      if (g_hash_table_contains(blocks, msgs[i]))
+        reused++;
+    }
+  cr_assert_gt(reused, 0);
+
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    log_msg_unref(msgs[i]);
+
+  g_hash_table_unref(blocks);
+  g_free(msgs);
+}
+
+Test(logmsg_pool, test_resident_bytes_return_to_zero_when_the_pool_is_released)
+{
+  StatsClusterKey sc_key;
+  StatsCounterItem *resident_bytes = NULL;
+
+  stats_lock();
+  log_msg_pool_register_stats();
+  stats_cluster_single_key_set(&sc_key, "events_pool_resident_bytes", NULL, 0);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &resident_bytes);
+  stats_unlock();
+
+  log_msg_pool_set_enabled(TRUE);
+
+  LogMessage **msgs = g_new0(LogMessage *, NUM_MESSAGES);
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    msgs[i] = log_msg_new_empty();
+
+  /* the other thread returns its blocks to the depot in batches */
+  GThread *thread = g_thread_new("free-messages", _free_messages_thread, msgs);
+  g_thread_join(thread);
+  g_free(msgs);
+
+  log_msg_pool_thread_deinit();
+  cr_assert_gt(stats_counter_get(resident_bytes), 0);
+
+  log_msg_pool_global_deinit();
+  cr_assert_eq(stats_counter_get(resident_bytes), 0);
+
+  log_msg_pool_global_init();
+
+  stats_lock();
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &resident_bytes);
+  stats_unlock();
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(logmsg_pool, .init = setup, .fini = teardown);
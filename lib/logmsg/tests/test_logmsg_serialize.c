@@ -311,6 +311,44 @@ Test(logmsg_serialize, existing_and_given_ts_processed)
   g_string_free(stream, TRUE);
 }
 
+Test(logmsg_serialize, serialize_message_with_hashed_index)
+{
+  GString *stream = g_string_new("");
+  SerializeArchive *sa = serialize_string_archive_new(stream);
+  LogMessage *msg = log_msg_new_empty();
+  gchar value_name[64];
+
+  for (gint i = 0; i < 256; i++)
+    {
+      g_snprintf(value_name, sizeof(value_name), "hashed.field%d", i);
+      log_msg_set_value_by_name(msg, value_name, value_name, -1);
+    }
+  cr_assert(msg->payload->index_hashed);
+  log_msg_serialize(msg, sa, 0);
+  log_msg_unref(msg);
+
+  _reset_log_msg_registry();
+  msg = log_msg_new_empty();
+  cr_assert(log_msg_deserialize(msg, sa), ERROR_MSG);
+
+  /* the serialized index is sorted, lookups work right after deserialization */
+  NVIndexEntry *index_table = nv_table_get_index(msg->payload);
+  for (gint i = 1; i < msg->payload->index_size; i++)
+    cr_assert_lt(index_table[i - 1].handle, index_table[i].handle);
+
+  log_msg_set_value_by_name(msg, "hashed.after_deserialization", "value", -1);
+  for (gint i = 0; i < 256; i++)
+    {
+      g_snprintf(value_name, sizeof(value_name), "hashed.field%d", i);
+      assert_log_message_value(msg, log_msg_get_value_handle(value_name), value_name);
+    }
+  assert_log_message_value(msg, log_msg_get_value_handle("hashed.after_deserialization"), "value");
+
+  log_msg_unref(msg);
+  serialize_archive_free(sa);
+  g_string_free(stream, TRUE);
+}
+
 #include "messages/syslog-ng-pe-6.0-msg.h"
 #include "messages/syslog-ng-3.17.1-msg.h"
 #include "messages/syslog-ng-3.18.1-msg.h"
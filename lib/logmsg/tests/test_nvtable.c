@@ -1166,3 +1166,80 @@ Test(nvtable, test_nvtable_compact_skips_unset_values)
 
   nv_table_unref(tab2);
 }
+
+static NVTable *
+_add_many_dynamic_values(NVTable *tab, gint num_values)
+{
+  gchar name[16];
+
+  /* insert in descending handle order, so that the sorted index would need
+   * to move all entries for each insert */
+  for (gint i = num_values - 1; i >= 0; i--)
+    {
+      NVHandle handle = DYN_HANDLE + i;
+
+      g_snprintf(name, sizeof(name), "VAL%d", handle);
+      while (!nv_table_add_value(tab, handle, name, strlen(name), name, strlen(name), 0, NULL))
+        cr_assert(nv_table_realloc(tab, &tab));
+    }
+  return tab;
+}
+
+static void
+_assert_many_dynamic_values(NVTable *tab, gint num_values)
+{
+  gchar name[16];
+
+  for (gint i = 0; i < num_values; i++)
+    {
+      NVHandle handle = DYN_HANDLE + i;
+
+      g_snprintf(name, sizeof(name), "VAL%d", handle);
+      assert_nvtable(tab, handle, name, strlen(name));
+    }
+  cr_assert_not(nv_table_is_value_set(tab, DYN_HANDLE + num_values));
+}
+
+Test(nvtable, test_nvtable_switches_to_hashed_index_above_threshold)
+{
+  NVTable *tab = nv_table_new(STATIC_VALUES, STATIC_VALUES, 1024);
+
+  tab = _add_many_dynamic_values(tab, NV_TABLE_INDEX_HASH_THRESHOLD);
+  cr_assert_not(tab->index_hashed);
+  _assert_many_dynamic_values(tab, NV_TABLE_INDEX_HASH_THRESHOLD);
+
+  tab = _add_many_dynamic_values(tab, 1000);
+  cr_assert(tab->index_hashed);
+  cr_assert_eq(tab->index_size, 1000);
+  _assert_many_dynamic_values(tab, 1000);
+
+  nv_table_unref(tab);
+}
+
+Test(nvtable, test_nvtable_hashed_index_survives_clone_realloc_and_compact)
+{
+  NVTable *tab = _add_many_dynamic_values(nv_table_new(STATIC_VALUES, STATIC_VALUES, 1024), 300);
+
+  NVTable *tab_clone = nv_table_clone(tab, 64);
+  cr_assert(tab_clone->index_hashed);
+  _assert_many_dynamic_values(tab_clone, 300);
+  nv_table_unref(tab_clone);
+
+  NVTable *tab_ref = nv_table_ref(tab);
+  cr_assert(nv_table_realloc(tab_ref, &tab_ref));
+  _assert_many_dynamic_values(tab_ref, 300);
+  _assert_many_dynamic_values(tab, 300);
+  nv_table_unref(tab_ref);
+
+  cr_assert(nv_table_unset_value(tab, DYN_HANDLE + 5));
+  cr_assert_null(nv_table_get_value(tab, DYN_HANDLE + 5, NULL, NULL));
+
+  NVTable *tab_compacted = nv_table_compact(tab);
+  cr_assert(tab_compacted->index_hashed);
+  cr_assert_eq(tab_compacted->index_size, 299);
+  cr_assert_null(nv_table_get_value(tab_compacted, DYN_HANDLE + 5, NULL, NULL));
+  assert_nvtable(tab_compacted, DYN_HANDLE + 6, "VAL23", 5);
+
+  nv_table_unref(tab_compacted);
+  nv_table_unref(tab);
+}
@@ -301,6 +301,10 @@ struct _LogPipe
 
   void (*queue)(LogPipe *self, LogMessage *msg, const LogPathOptions *path_options);
 
+  /* optional: process a batch of messages that share the same
+   * path_options, see log_pipe_queue_batch() */
+  void (*queue_batch)(LogPipe *self, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options);
+
   GlobalConfig *cfg;
   LogExprNode *expr_node;
   LogPipe *pipe_next;
@@ -431,6 +435,9 @@ log_pipe_post_config_init(LogPipe *s)
 static inline void
 log_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options);
 
+static inline void
+log_pipe_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options);
+
 static inline void
 log_pipe_forward_msg(LogPipe *self, LogMessage *msg, const LogPathOptions *path_options)
 {
@@ -445,40 +452,65 @@ log_pipe_forward_msg(LogPipe *self, LogMessage *msg, const LogPathOptions *path_
 }
 
 static inline void
-log_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+log_pipe_forward_msg_batch(LogPipe *self, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
 {
-  LogPathOptions local_path_options;
-  g_assert((s->flags & PIF_INITIALIZED) != 0);
+  if (num_msgs == 0)
+    return;
 
-  if (G_UNLIKELY(pipe_single_step_hook))
+  if (self->pipe_next)
     {
-      if (!pipe_single_step_hook(s, msg, path_options))
-        {
-          log_msg_drop(msg, path_options, AT_PROCESSED);
-          return;
-        }
+      log_pipe_queue_batch(self->pipe_next, msgs, num_msgs, path_options);
     }
+  else
+    {
+      for (gint i = 0; i < num_msgs; i++)
+        log_msg_drop(msgs[i], path_options, AT_PROCESSED);
+    }
+}
 
-  if ((s->flags & PIF_SYNC_FILTERX))
-    filterx_eval_sync_message(path_options->filterx_context, &msg, path_options);
-
+/* apply the path_options changes requested by the flags of @s */
+static inline const LogPathOptions *
+log_pipe_apply_path_options_flags(LogPipe *s, LogPathOptions *local_path_options, const LogPathOptions *path_options)
+{
   if (G_UNLIKELY(s->flags & (PIF_HARD_FLOW_CONTROL | PIF_JUNCTION_END | PIF_CONDITIONAL_MIDPOINT)))
     {
-      path_options = log_path_options_chain(&local_path_options, path_options);
+      path_options = log_path_options_chain(local_path_options, path_options);
       if (s->flags & PIF_HARD_FLOW_CONTROL)
         {
-          local_path_options.flow_control_requested = 1;
+          local_path_options->flow_control_requested = 1;
           msg_trace("Requesting flow control", log_pipe_location_tag(s));
         }
       if (s->flags & PIF_JUNCTION_END)
         {
-          log_path_options_pop_junction(&local_path_options);
+          log_path_options_pop_junction(local_path_options);
         }
       if (s->flags & PIF_CONDITIONAL_MIDPOINT)
         {
-          log_path_options_pop_conditional(&local_path_options);
+          log_path_options_pop_conditional(local_path_options);
         }
     }
+  return path_options;
+}
+
+static inline void
+log_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogPathOptions local_path_options;
+  g_assert((s->flags & PIF_INITIALIZED) != 0);
+
+  if (G_UNLIKELY(pipe_single_step_hook))
+    {
+      if (!pipe_single_step_hook(s, msg, path_options))
+        {
+          log_msg_drop(msg, path_options, AT_PROCESSED);
+          return;
+        }
+    }
+
+  if ((s->flags & PIF_SYNC_FILTERX))
+    filterx_eval_sync_message(path_options->filterx_context, &msg, path_options);
+
+  path_options = log_pipe_apply_path_options_flags(s, &local_path_options, path_options);
 
   if (s->queue)
     {
@@ -491,6 +523,48 @@ log_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
 
 }
 
+/*
+ * Queue a batch of messages, each carrying its own reference, sharing the
+ * same path_options.  The result is equivalent to calling log_pipe_queue()
+ * for each message in order, the array itself remains owned by the caller
+ * (but its elements may be overwritten by the callee).
+ *
+ * Sharing path_options is only possible as long as there is no per-message
+ * state in them: once a filterx evaluation context is attached or the
+ * caller is interested in the "matched" result of individual messages, we
+ * fall back to queueing messages one-by-one.  The same happens if @s does
+ * not implement queue_batch().
+ */
+static inline void
+log_pipe_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogPathOptions local_path_options;
+  g_assert((s->flags & PIF_INITIALIZED) != 0);
+
+  if (G_UNLIKELY(pipe_single_step_hook) || path_options->filterx_context)
+    {
+      for (gint i = 0; i < num_msgs; i++)
+        log_pipe_queue(s, msgs[i], path_options);
+      return;
+    }
+
+  path_options = log_pipe_apply_path_options_flags(s, &local_path_options, path_options);
+
+  if (s->queue_batch && !path_options->matched)
+    {
+      s->queue_batch(s, msgs, num_msgs, path_options);
+    }
+  else if (s->queue)
+    {
+      for (gint i = 0; i < num_msgs; i++)
+        s->queue(s, msgs[i], path_options);
+    }
+  else
+    {
+      log_pipe_forward_msg_batch(s, msgs, num_msgs, path_options);
+    }
+}
+
 static inline LogPipe *
 log_pipe_clone(LogPipe *self)
 {
@@ -45,27 +45,38 @@ QueueType log_queue_fifo_type = "FIFO";
  *
  *   - has a per-thread, unlocked input queue where threads can put their items
  *
- *   - has a locked wait-queue where items go once the per-thread input
+ *   - has a lock-free wait-queue where items go once the per-thread input
  *     would be overflown or if the input thread goes to sleep (e.g.  one
- *     lock acquisition per a longer period)
+ *     atomic operation per a longer period)
  *
  *   - has an unlocked output queue where items from the wait queue go, once
  *     it becomes depleted.
  *
  * This means that items flow in this sequence from one list to the next:
  *
- *    input queue (per-thread) -> wait queue (locked) -> output queue (single-threaded)
+ *    input queue (per-thread) -> wait queue (lock-free) -> output queue (single-threaded)
  *
  * Fastpath is:
  *   - input threads putting elements on their per-thread queue (lockless)
  *   - output threads removing elements from the output queue (lockless)
  *
  * Slowpath:
- *   - input queue is overflown (or the input thread goes to sleep), wait
- *     queue mutex is grabbed, all elements are put to the wait queue.
+ *   - input queue is overflown (or the input thread goes to sleep), all
+ *     elements are appended to the wait queue as a single chain, using an
+ *     atomic exchange of its tail pointer.
  *
- *   - output queue is depleted, wait queue mutex is grabbed, all elements
- *     on the wait queue is put to the output queue
+ *   - output queue is depleted, all elements reachable on the wait queue
+ *     are moved to the output queue, without any atomic read-modify-write
+ *     operations on the consumer side.
+ *
+ * The wait queue is an intrusive multi-producer/single-consumer queue
+ * (Dmitry Vyukov's design), which reuses the "next" pointer of
+ * LogMessageQueueNode->list as its link, so the chain prepared on the
+ * per-thread input queue can be handed over in O(1).  The "prev" pointers
+ * are only restored once the nodes reach the output queue.
+ *
+ * LogQueue->lock is only taken to deliver a parallel push notification,
+ * e.g. when the consumer registered one after finding the queue empty.
  *
  * Threading assumptions:
  *   - the head of the queue is only manipulated from the output thread
@@ -89,13 +100,28 @@ typedef struct _OverflowQueue
   gint non_flow_controlled_len;
 } OverflowQueue;
 
+typedef struct _WaitQueue
+{
+  /* producer side, only changed by atomic operations */
+  struct iv_list_head *tail;
+  gint len;
+  gint non_flow_controlled_len;
+
+  /* keep the consumer side away from the cache line the producers write */
+  gchar padding[64];
+
+  /* consumer side */
+  struct iv_list_head *head;
+  struct iv_list_head stub;
+} WaitQueue;
+
 typedef struct _LogQueueFifo
 {
   LogQueue super;
 
   /* scalable qoverflow implementation */
+  WaitQueue wait_queue;
   OverflowQueue output_queue;
-  OverflowQueue wait_queue;
   OverflowQueue backlog_queue; /* entries that were sent but not acked yet */
 
   gint log_fifo_size;
@@ -113,8 +139,103 @@ typedef struct _LogQueueFifo
   InputQueue input_queues[0];
 } LogQueueFifo;
 
-/* NOTE: this is inherently racy. If the LogQueue->lock is taken, then the
- * race is limited to the changes in output_queue queue changes.
+static void
+_wait_queue_init(WaitQueue *self)
+{
+  self->stub.next = NULL;
+  self->head = &self->stub;
+  self->tail = &self->stub;
+}
+
+static inline struct iv_list_head *
+_wait_queue_exchange_tail(WaitQueue *self, struct iv_list_head *new_tail)
+{
+  struct iv_list_head *old_tail;
+
+  do
+    old_tail = g_atomic_pointer_get(&self->tail);
+  while (!g_atomic_pointer_compare_and_exchange(&self->tail, old_tail, new_tail));
+
+  return old_tail;
+}
+
+/* Can be called from any thread, @first..@last must be already linked
+ * through their "next" pointers.
+ */
+static void
+_wait_queue_push_chain(WaitQueue *self, struct iv_list_head *first, struct iv_list_head *last)
+{
+  last->next = NULL;
+
+  struct iv_list_head *prev = _wait_queue_exchange_tail(self, last);
+
+  /* between the exchange above and this store the chain is not reachable
+   * from the head, the consumer handles this as if the queue was empty */
+  g_atomic_pointer_set(&prev->next, first);
+}
+
+/*
+ * Can only run from the output thread.
+ *
+ * Returns NULL if the queue is empty or if the next element is still being
+ * linked by a producer.
+ */
+static struct iv_list_head *
+_wait_queue_pop(WaitQueue *self)
+{
+  struct iv_list_head *head = self->head;
+  struct iv_list_head *next = g_atomic_pointer_get(&head->next);
+
+  if (head == &self->stub)
+    {
+      if (!next)
+        return NULL;
+
+      self->head = next;
+      head = next;
+      next = g_atomic_pointer_get(&head->next);
+    }
+
+  if (next)
+    {
+      self->head = next;
+      return head;
+    }
+
+  if (head != g_atomic_pointer_get(&self->tail))
+    return NULL;
+
+  /* head is the last element, put the stub behind it so it can be detached */
+  _wait_queue_push_chain(self, &self->stub, &self->stub);
+
+  next = g_atomic_pointer_get(&head->next);
+  if (next)
+    {
+      self->head = next;
+      return head;
+    }
+
+  return NULL;
+}
+
+/* parallel_push_notify is registered by log_queue_check_items() before it
+ * checks the length of the queue, so either we see the callback here or
+ * the consumer sees the items we have just added.
+ */
+static inline void
+_push_notify(LogQueueFifo *self)
+{
+  if (!g_atomic_pointer_get(&self->super.parallel_push_notify))
+    return;
+
+  g_mutex_lock(&self->super.lock);
+  log_queue_push_notify(&self->super);
+  g_mutex_unlock(&self->super.lock);
+}
+
+/* NOTE: this is inherently racy. The wait_queue lengths are changed
+ * atomically, so the race is limited to the changes in output_queue queue
+ * changes.
  *
  * In the output thread, this means that this can get race-free. In the
  * input thread, the output_queue can change because of a
@@ -139,13 +260,13 @@ log_queue_fifo_get_length(LogQueue *s)
 {
   LogQueueFifo *self = (LogQueueFifo *) s;
 
-  return self->wait_queue.len + self->output_queue.len;
+  return g_atomic_int_get(&self->wait_queue.len) + self->output_queue.len;
 }
 
 static gint64
 log_queue_fifo_get_non_flow_controlled_length(LogQueueFifo *self)
 {
-  return self->wait_queue.non_flow_controlled_len + self->output_queue.non_flow_controlled_len;
+  return g_atomic_int_get(&self->wait_queue.non_flow_controlled_len) + self->output_queue.non_flow_controlled_len;
 }
 
 gboolean
@@ -153,7 +274,7 @@ log_queue_fifo_is_empty_racy(LogQueue *s)
 {
   LogQueueFifo *self = (LogQueueFifo *) s;
   gboolean has_message_in_queue = FALSE;
-  g_mutex_lock(&self->super.lock);
+
   if (log_queue_fifo_get_length(s) > 0)
     {
       has_message_in_queue = TRUE;
@@ -166,7 +287,6 @@ log_queue_fifo_is_empty_racy(LogQueue *s)
           has_message_in_queue |= self->input_queues[i].finish_cb_registered;
         }
     }
-  g_mutex_unlock(&self->super.lock);
   return !has_message_in_queue;
 }
 
@@ -261,34 +381,43 @@ log_queue_fifo_calculate_num_of_messages_to_drop(LogQueueFifo *self, InputQueue
   return TRUE;
 }
 
-/* move items from the per-thread input queue to the lock-protected "wait" queue */
+/* move items from the per-thread input queue to the lock-free "wait" queue */
 static void
-log_queue_fifo_move_input_unlocked(LogQueueFifo *self, gint thread_index)
+log_queue_fifo_move_input_queue(LogQueueFifo *self, InputQueue *input_queue)
 {
   gint num_of_messages_to_drop;
-  gboolean drop_messages = log_queue_fifo_calculate_num_of_messages_to_drop(self, &self->input_queues[thread_index],
+  gboolean drop_messages = log_queue_fifo_calculate_num_of_messages_to_drop(self, input_queue,
                            &num_of_messages_to_drop);
 
   if (drop_messages)
     {
       /* slow path, the input thread's queue would overflow the queue, let's drop some messages */
-      log_queue_fifo_drop_messages_from_input_queue(self, &self->input_queues[thread_index], num_of_messages_to_drop);
+      log_queue_fifo_drop_messages_from_input_queue(self, input_queue, num_of_messages_to_drop);
     }
 
-  log_queue_queued_messages_add(&self->super, self->input_queues[thread_index].len);
-  iv_list_update_msg_size(self, &self->input_queues[thread_index].items);
+  if (iv_list_empty(&input_queue->items))
+    return;
+
+  log_queue_queued_messages_add(&self->super, input_queue->len);
+  iv_list_update_msg_size(self, &input_queue->items);
+
+  /* the lengths are increased before the items become reachable, so the
+   * consumer never sees more items than what is accounted for */
+  g_atomic_int_add(&self->wait_queue.len, input_queue->len);
+  g_atomic_int_add(&self->wait_queue.non_flow_controlled_len, input_queue->non_flow_controlled_len);
 
-  iv_list_splice_tail_init(&self->input_queues[thread_index].items, &self->wait_queue.items);
-  self->wait_queue.len += self->input_queues[thread_index].len;
-  self->wait_queue.non_flow_controlled_len += self->input_queues[thread_index].non_flow_controlled_len;
-  self->input_queues[thread_index].len = 0;
-  self->input_queues[thread_index].non_flow_controlled_len = 0;
+  struct iv_list_head *first = input_queue->items.next;
+  struct iv_list_head *last = input_queue->items.prev;
+  INIT_IV_LIST_HEAD(&input_queue->items);
+  _wait_queue_push_chain(&self->wait_queue, first, last);
+
+  input_queue->len = 0;
+  input_queue->non_flow_controlled_len = 0;
 }
 
-/* move items from the per-thread input queue to the lock-protected
- * "wait" queue, but grabbing locks first. This is registered as a
- * callback to be called when the input worker thread finishes its
- * job.
+/* move items from the per-thread input queue to the lock-free "wait"
+ * queue. This is registered as a callback to be called when the input
+ * worker thread finishes its job.
  */
 static gpointer
 log_queue_fifo_move_input(gpointer user_data)
@@ -299,24 +428,56 @@ log_queue_fifo_move_input(gpointer user_data)
   thread_index = main_loop_worker_get_thread_index();
   g_assert(thread_index >= 0);
 
-  g_mutex_lock(&self->super.lock);
-  log_queue_fifo_move_input_unlocked(self, thread_index);
-  log_queue_push_notify(&self->super);
-  g_mutex_unlock(&self->super.lock);
+  log_queue_fifo_move_input_queue(self, &self->input_queues[thread_index]);
+  _push_notify(self);
   self->input_queues[thread_index].finish_cb_registered = FALSE;
   log_queue_unref(&self->super);
   return NULL;
 }
 
-/* lock must be held */
+/* Reserves room for a single message on the wait queue, in a way that
+ * concurrent callers can't go past log_fifo_size together. The output
+ * queue is changed by the output thread in the meanwhile, which is the
+ * same race that the input queues have in
+ * log_queue_fifo_calculate_num_of_messages_to_drop().
+ */
 static inline gboolean
-_message_has_to_be_dropped(LogQueueFifo *self, const LogPathOptions *path_options)
+_reserve_wait_queue_slot(LogQueueFifo *self, const LogPathOptions *path_options)
 {
+  gint *limited_len = NULL;
+  gint output_queue_len = 0;
+
   if (G_UNLIKELY(self->use_legacy_fifo_size))
-    return log_queue_fifo_get_length(&self->super) >= self->log_fifo_size;
+    {
+      limited_len = &self->wait_queue.len;
+      output_queue_len = self->output_queue.len;
+    }
+  else if (!path_options->flow_control_requested)
+    {
+      limited_len = &self->wait_queue.non_flow_controlled_len;
+      output_queue_len = self->output_queue.non_flow_controlled_len;
+    }
+
+  if (limited_len)
+    {
+      gint len;
 
-  return !path_options->flow_control_requested
-         && log_queue_fifo_get_non_flow_controlled_length(self) >= self->log_fifo_size;
+      do
+        {
+          len = g_atomic_int_get(limited_len);
+          if (output_queue_len + len >= self->log_fifo_size)
+            return FALSE;
+        }
+      while (!g_atomic_int_compare_and_exchange(limited_len, len, len + 1));
+    }
+
+  if (limited_len != &self->wait_queue.len)
+    g_atomic_int_inc(&self->wait_queue.len);
+
+  if (!path_options->flow_control_requested && limited_len != &self->wait_queue.non_flow_controlled_len)
+    g_atomic_int_inc(&self->wait_queue.non_flow_controlled_len);
+
+  return TRUE;
 }
 
 static inline void
@@ -397,14 +558,11 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
       return;
     }
 
-  /* slow path, put the pending item and the whole input queue to the wait_queue */
-
-  g_mutex_lock(&self->super.lock);
+  /* slow path, put the pending item directly to the wait_queue */
 
-  if (_message_has_to_be_dropped(self, path_options))
+  if (!_reserve_wait_queue_slot(self, path_options))
     {
       log_queue_dropped_messages_inc(&self->super);
-      g_mutex_unlock(&self->super.lock);
 
       _drop_message(msg, path_options);
 
@@ -418,17 +576,11 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
   log_msg_write_protect(msg);
   node = log_msg_alloc_queue_node(msg, path_options);
 
-  iv_list_add_tail(&node->list, &self->wait_queue.items);
-  self->wait_queue.len++;
-
-  if (!path_options->flow_control_requested)
-    self->wait_queue.non_flow_controlled_len++;
-
-  log_queue_push_notify(&self->super);
   log_queue_queued_messages_inc(&self->super);
-
   log_queue_memory_usage_add(&self->super, log_msg_get_size(msg));
-  g_mutex_unlock(&self->super.lock);
+
+  _wait_queue_push_chain(&self->wait_queue, &node->list, &node->list);
+  _push_notify(self);
 
   log_msg_unref(msg);
 }
@@ -440,13 +592,27 @@ static inline void
 _move_items_from_wait_queue_to_output_queue(LogQueueFifo *self)
 {
   /* slow path, output queue is empty, get some elements from the wait queue */
-  g_mutex_lock(&self->super.lock);
-  iv_list_splice_tail_init(&self->wait_queue.items, &self->output_queue.items);
-  self->output_queue.len = self->wait_queue.len;
-  self->output_queue.non_flow_controlled_len = self->wait_queue.non_flow_controlled_len;
-  self->wait_queue.len = 0;
-  self->wait_queue.non_flow_controlled_len = 0;
-  g_mutex_unlock(&self->super.lock);
+  struct iv_list_head *ilh;
+  gint len = 0;
+  gint non_flow_controlled_len = 0;
+
+  while ((ilh = _wait_queue_pop(&self->wait_queue)))
+    {
+      LogMessageQueueNode *node = iv_list_entry(ilh, LogMessageQueueNode, list);
+
+      iv_list_add_tail(&node->list, &self->output_queue.items);
+      len++;
+
+      if (!node->flow_control_requested)
+        non_flow_controlled_len++;
+    }
+
+  /* increase the output queue first, so that the items are never missing
+   * from log_queue_fifo_get_length() */
+  self->output_queue.len += len;
+  self->output_queue.non_flow_controlled_len += non_flow_controlled_len;
+  g_atomic_int_add(&self->wait_queue.len, -len);
+  g_atomic_int_add(&self->wait_queue.non_flow_controlled_len, -non_flow_controlled_len);
 }
 
 /*
@@ -686,7 +852,7 @@ log_queue_fifo_free(LogQueue *s)
       log_queue_fifo_free_queue(&self->input_queues[i].items);
     }
 
-  log_queue_fifo_free_queue(&self->wait_queue.items);
+  _move_items_from_wait_queue_to_output_queue(self);
   log_queue_fifo_free_queue(&self->output_queue.items);
   log_queue_fifo_free_queue(&self->backlog_queue.items);
 
@@ -732,7 +898,7 @@ log_queue_fifo_new(gint log_fifo_size, const gchar *persist_name, gint stats_lev
       self->input_queues[i].cb.func = log_queue_fifo_move_input;
       self->input_queues[i].cb.user_data = self;
     }
-  INIT_IV_LIST_HEAD(&self->wait_queue.items);
+  _wait_queue_init(&self->wait_queue);
   INIT_IV_LIST_HEAD(&self->output_queue.items);
   INIT_IV_LIST_HEAD(&self->backlog_queue.items);
 
@@ -160,23 +160,29 @@ log_queue_check_items(LogQueue *self, gint *timeout, LogQueuePushNotifyFunc para
   if (self->parallel_push_data && self->parallel_push_data_destroy)
     self->parallel_push_data_destroy(self->parallel_push_data);
 
+  /* the callback is registered before the length is checked: queues that
+   * push without holding self->lock check parallel_push_notify after
+   * adding their items, so either they see the callback or we see the
+   * items */
+  self->parallel_push_data = user_data;
+  self->parallel_push_data_destroy = user_data_destroy;
+  g_atomic_pointer_set(&self->parallel_push_notify, parallel_push_notify);
+
   num_elements = log_queue_get_length(self);
   if (num_elements == 0)
     {
-      self->parallel_push_notify = parallel_push_notify;
-      self->parallel_push_data = user_data;
-      self->parallel_push_data_destroy = user_data_destroy;
       g_mutex_unlock(&self->lock);
       return FALSE;
     }
 
+  self->parallel_push_notify = NULL;
+  self->parallel_push_data = NULL;
+  self->parallel_push_data_destroy = NULL;
+
   /* consume the user_data reference as we won't use the callback */
   if (user_data && user_data_destroy)
     user_data_destroy(user_data);
 
-  self->parallel_push_notify = NULL;
-  self->parallel_push_data = NULL;
-
   g_mutex_unlock(&self->lock);
 
   /* recalculate buckets, throttle is only running in the output thread, no need to lock it. */
@@ -440,6 +440,38 @@ log_reader_process_handshake(LogReader *self)
   return 0;
 }
 
+/* the messages of a fetch round are posted together, in chunks of this size */
+#define LOG_READER_BATCH_SIZE 64
+
+typedef struct _LogReaderBatch
+{
+  LogMessage *msgs[LOG_READER_BATCH_SIZE];
+  gint len;
+} LogReaderBatch;
+
+/*
+ * A single message is posted with the producer side refcache, as before.
+ * The refcache can only follow one message per thread, so batches go
+ * without it.
+ */
+static void
+log_reader_post_batch(LogReader *self, LogReaderBatch *batch)
+{
+  if (batch->len == 1)
+    {
+      LogMessage *m = batch->msgs[0];
+
+      log_msg_refcache_start_producer(m);
+      log_source_post_batch(&self->super, batch->msgs, 1);
+      log_msg_refcache_stop();
+    }
+  else if (batch->len > 1)
+    {
+      log_source_post_batch(&self->super, batch->msgs, batch->len);
+    }
+  batch->len = 0;
+}
+
 static void
 _log_reader_insert_msg_length_stats(LogReader *self, gsize len)
 {
@@ -448,7 +480,8 @@ _log_reader_insert_msg_length_stats(LogReader *self, gsize len)
 }
 
 static gboolean
-log_reader_handle_line(LogReader *self, const guchar *line, gint length, LogTransportAuxData *aux)
+log_reader_handle_line(LogReader *self, const guchar *line, gint length, LogTransportAuxData *aux,
+                       LogReaderBatch *batch)
 {
   LogMessage *m;
 
@@ -476,12 +509,16 @@ log_reader_handle_line(LogReader *self, const guchar *line, gint length, LogTran
         }
       m->proto = aux->proto;
     }
-  log_msg_refcache_start_producer(m);
 
   log_transport_aux_data_foreach(aux, _add_aux_nvpair, m);
 
-  log_source_post(&self->super, m);
-  log_msg_refcache_stop();
+  /* the bookmark belongs to this message, it has to be tracked before the
+   * next fetch, but posting it can wait until the end of the fetch round */
+  log_source_track_msg(&self->super, m);
+  batch->msgs[batch->len++] = m;
+  if (batch->len == LOG_READER_BATCH_SIZE)
+    log_reader_post_batch(self, batch);
+
   return log_source_free_to_send(&self->super);
 }
 
@@ -490,8 +527,10 @@ static gint
 log_reader_fetch_log(LogReader *self)
 {
   gint msg_count = 0;
+  gint notify_code = 0;
   gboolean may_read = TRUE;
   LogTransportAuxData aux_storage, *aux = &aux_storage;
+  LogReaderBatch batch = { .len = 0 };
 
   if ((self->options->flags & LR_IGNORE_AUX_DATA))
     aux = NULL;
@@ -527,11 +566,11 @@ log_reader_fetch_log(LogReader *self)
       switch (status)
         {
         case LPS_EOF:
-          log_transport_aux_data_destroy(aux);
-          return NC_CLOSE;
+          notify_code = NC_CLOSE;
+          break;
         case LPS_ERROR:
-          log_transport_aux_data_destroy(aux);
-          return NC_READ_ERROR;
+          notify_code = NC_READ_ERROR;
+          break;
         case LPS_SUCCESS:
           break;
         case LPS_AGAIN:
@@ -541,7 +580,7 @@ log_reader_fetch_log(LogReader *self)
           break;
         }
 
-      if (!msg)
+      if (notify_code || !msg)
         {
           /* no more messages for now */
           break;
@@ -550,15 +589,19 @@ log_reader_fetch_log(LogReader *self)
         {
           msg_count++;
 
-          if (!log_reader_handle_line(self, msg, msg_len, aux))
+          if (!log_reader_handle_line(self, msg, msg_len, aux, &batch))
             {
               /* window is full, don't generate further messages */
               break;
             }
         }
     }
+  log_reader_post_batch(self, &batch);
   log_transport_aux_data_destroy(aux);
 
+  if (notify_code)
+    return notify_code;
+
   if (msg_count == self->options->fetch_limit)
     self->immediate_check = TRUE;
   return 0;
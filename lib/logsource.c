@@ -480,7 +480,8 @@ _register_counters(LogSource *self)
 
   gint level = log_pipe_is_internal(&self->super) ? STATS_LEVEL3 : self->options->stats_level;
 
-  stats_register_counter(level, self->metrics.recvd_messages_key, SC_TYPE_SINGLE_VALUE, &self->metrics.recvd_messages);
+  stats_register_sharded_counter(level, self->metrics.recvd_messages_key, SC_TYPE_SINGLE_VALUE,
+                                 &self->metrics.recvd_messages);
 
   StatsClusterKey sc_key;
   gchar stats_instance[1024];
@@ -554,8 +555,13 @@ log_source_deinit(LogPipe *s)
   return TRUE;
 }
 
+/*
+ * Takes the pending bookmark of the ack tracker and one slot of the
+ * flow-control window for @msg.  It has to be called as soon as the message
+ * is constructed, as the next bookmark request reuses the pending one.
+ */
 void
-log_source_post(LogSource *self, LogMessage *msg)
+log_source_track_msg(LogSource *self, LogMessage *msg)
 {
   LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
   gint old_window_size;
@@ -587,6 +593,16 @@ log_source_post(LogSource *self, LogMessage *msg)
    */
 
   g_assert(old_window_size > 0);
+}
+
+void
+log_source_post(LogSource *self, LogMessage *msg)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  log_source_track_msg(self, msg);
+
+  path_options.ack_needed = TRUE;
 
   ScratchBuffersMarker mark;
   scratch_buffers_mark(&mark);
@@ -594,6 +610,23 @@ log_source_post(LogSource *self, LogMessage *msg)
   scratch_buffers_reclaim_marked(mark);
 }
 
+/*
+ * Posts messages that were already passed to log_source_track_msg(), in
+ * one log_pipe_queue_batch() call.
+ */
+void
+log_source_post_batch(LogSource *self, LogMessage **msgs, gint num_msgs)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  path_options.ack_needed = TRUE;
+
+  ScratchBuffersMarker mark;
+  scratch_buffers_mark(&mark);
+  log_pipe_queue_batch(&self->super, msgs, num_msgs, &path_options);
+  scratch_buffers_reclaim_marked(mark);
+}
+
 static void
 log_source_override_host(LogSource *self, LogMessage *msg)
 {
@@ -630,17 +663,10 @@ _get_pid_string(void)
 }
 
 static void
-log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+_setup_msg(LogSource *self, LogMessage *msg)
 {
-  LogSource *self = (LogSource *) s;
   gint i;
 
-  msg_set_context(msg);
-
-  msg_diagnostics(">>>>>> Source side message processing begin",
-                  log_pipe_location_tag(s),
-                  evt_tag_msg_reference(msg));
-
   /* $HOST setup */
   log_source_mangle_hostname(self, msg);
 
@@ -665,14 +691,11 @@ log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options
     log_source_override_program(self, msg);
 
   msg_stats_update_counters(self->stats_id, msg);
+}
 
-  /* message setup finished, send it out */
-
-  stats_counter_inc(self->metrics.recvd_messages);
-  stats_counter_set_time(self->metrics.last_message_seen, msg->timestamps[LM_TS_RECVD].ut_sec);
-  stats_byte_counter_add(&self->metrics.recvd_bytes, msg->recvd_rawmsg_size);
-  log_pipe_forward_msg(s, msg, path_options);
-
+static void
+_wait_for_window(LogSource *self)
+{
   if (accurate_nanosleep && self->threaded && self->window_full_sleep_nsec > 0 && !log_source_free_to_send(self))
     {
       struct timespec ts;
@@ -682,6 +705,29 @@ log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options
       ts.tv_nsec = self->window_full_sleep_nsec;
       nanosleep(&ts, NULL);
     }
+}
+
+static void
+log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogSource *self = (LogSource *) s;
+
+  msg_set_context(msg);
+
+  msg_diagnostics(">>>>>> Source side message processing begin",
+                  log_pipe_location_tag(s),
+                  evt_tag_msg_reference(msg));
+
+  _setup_msg(self, msg);
+
+  /* message setup finished, send it out */
+
+  stats_counter_inc(self->metrics.recvd_messages);
+  stats_counter_set_time(self->metrics.last_message_seen, msg->timestamps[LM_TS_RECVD].ut_sec);
+  stats_byte_counter_add(&self->metrics.recvd_bytes, msg->recvd_rawmsg_size);
+  log_pipe_forward_msg(s, msg, path_options);
+
+  _wait_for_window(self);
   msg_diagnostics("<<<<<< Source side message processing finish",
                   log_pipe_location_tag(s),
                   evt_tag_msg_reference(msg));
@@ -689,6 +735,48 @@ log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options
   msg_set_context(NULL);
 }
 
+/*
+ * Internal messages need msg_set_context() for the whole duration of their
+ * processing to suppress recursion, so they are queued one-by-one.
+ */
+static void
+log_source_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogSource *self = (LogSource *) s;
+  gsize recvd_bytes = 0;
+  gint i;
+
+  for (i = 0; i < num_msgs; i++)
+    {
+      if (msgs[i]->flags & LF_INTERNAL)
+        {
+          for (i = 0; i < num_msgs; i++)
+            log_source_queue(s, msgs[i], path_options);
+          return;
+        }
+    }
+
+  for (i = 0; i < num_msgs; i++)
+    {
+      msg_diagnostics(">>>>>> Source side message processing begin",
+                      log_pipe_location_tag(s),
+                      evt_tag_msg_reference(msgs[i]));
+
+      _setup_msg(self, msgs[i]);
+      recvd_bytes += msgs[i]->recvd_rawmsg_size;
+    }
+
+  stats_counter_add(self->metrics.recvd_messages, num_msgs);
+  stats_counter_set_time(self->metrics.last_message_seen, msgs[num_msgs - 1]->timestamps[LM_TS_RECVD].ut_sec);
+  stats_byte_counter_add(&self->metrics.recvd_bytes, recvd_bytes);
+  log_pipe_forward_msg_batch(s, msgs, num_msgs, path_options);
+
+  _wait_for_window(self);
+  msg_diagnostics("<<<<<< Source side batch processing finish",
+                  log_pipe_location_tag(s),
+                  evt_tag_int("messages", num_msgs));
+}
+
 static void
 _initialize_window(LogSource *self, gint init_window_size)
 {
@@ -781,6 +869,7 @@ log_source_init_instance(LogSource *self, GlobalConfig *cfg)
 {
   log_pipe_init_instance(&self->super, cfg);
   self->super.queue = log_source_queue;
+  self->super.queue_batch = log_source_queue_batch;
   self->super.free_fn = log_source_free;
   self->super.init = log_source_init;
   self->super.deinit = log_source_deinit;
@@ -132,6 +132,8 @@ gboolean log_source_init(LogPipe *s);
 gboolean log_source_deinit(LogPipe *s);
 
 void log_source_post(LogSource *self, LogMessage *msg);
+void log_source_track_msg(LogSource *self, LogMessage *msg);
+void log_source_post_batch(LogSource *self, LogMessage **msgs, gint num_msgs);
 
 void log_source_set_options(LogSource *self, LogSourceOptions *options, const gchar *stats_id,
                             StatsClusterKeyBuilder *kb, gboolean threaded, LogExprNode *expr_node);
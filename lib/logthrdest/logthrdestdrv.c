@@ -125,6 +125,65 @@ log_threaded_dest_worker_rewind_messages(LogThreadedDestWorker *self, gint batch
   self->batch_size -= batch_size;
 }
 
+/*
+ * In-flight batches
+ *
+ * Workers that can keep multiple batches in flight (e.g. asynchronous
+ * requests) detach the current batch in their flush() method using
+ * log_threaded_dest_worker_set_batch_in_flight() and return
+ * LTR_EXPLICIT_ACK_MGMT.  The messages stay in the backlog and are counted
+ * in in_flight_size, while the next batch is collected from zero.
+ *
+ * Batches have to be completed in the order they were detached, as the
+ * backlog can only be acknowledged from its head.  A failed batch cannot be
+ * rewound on its own either (rewinding happens from the tail), so in that
+ * case the worker should abort everything that is in flight, reclaim the
+ * in-flight messages into the current batch using
+ * log_threaded_dest_worker_reclaim_in_flight_messages() and return the
+ * failure from flush(), which then applies to all of them.
+ *
+ * An expedited flush is not a failure: the worker reclaims the in-flight
+ * messages the same way, rewinds them itself and returns
+ * LTR_EXPLICIT_ACK_MGMT, so that no retry is counted.
+ */
+gint
+log_threaded_dest_worker_set_batch_in_flight(LogThreadedDestWorker *self)
+{
+  gint batch_size = self->batch_size;
+
+  self->in_flight_size += batch_size;
+  self->batch_size = 0;
+  return batch_size;
+}
+
+void
+log_threaded_dest_worker_ack_in_flight_messages(LogThreadedDestWorker *self, gint batch_size)
+{
+  g_assert(batch_size <= self->in_flight_size);
+
+  log_queue_ack_backlog(self->queue, batch_size);
+  stats_counter_add(self->owner->metrics.written_messages, batch_size);
+  self->retries_on_error_counter = 0;
+  self->in_flight_size -= batch_size;
+}
+
+void
+log_threaded_dest_worker_drop_in_flight_messages(LogThreadedDestWorker *self, gint batch_size)
+{
+  g_assert(batch_size <= self->in_flight_size);
+
+  log_queue_ack_backlog(self->queue, batch_size);
+  stats_counter_add(self->owner->metrics.dropped_messages, batch_size);
+  self->in_flight_size -= batch_size;
+}
+
+void
+log_threaded_dest_worker_reclaim_in_flight_messages(LogThreadedDestWorker *self)
+{
+  self->batch_size += self->in_flight_size;
+  self->in_flight_size = 0;
+}
+
 static gchar *
 _format_queue_persist_name(LogThreadedDestWorker *self)
 {
@@ -625,6 +684,19 @@ _perform_work(gpointer data)
         _perform_flush(self);
       _schedule_restart_on_next_flush(self);
     }
+  else if (self->in_flight_size > 0)
+    {
+      /* nothing to send, but some batches are still in flight.  flush()
+       * waits for them to make progress and processes their results, we
+       * come back here until all of them are completed. */
+      msg_trace("Queue empty, waiting for in-flight batches",
+                evt_tag_str("driver", self->owner->super.super.id),
+                evt_tag_int("worker_index", self->worker_index),
+                evt_tag_int("in_flight_size", self->in_flight_size));
+
+      _perform_flush(self);
+      _schedule_restart(self);
+    }
   else if (timeout_msec != 0)
     {
       /* We probably have some items in the queue, but timeout_msec is set,
@@ -734,6 +806,14 @@ _perform_final_flush(LogThreadedDestWorker *self)
 
   result = log_threaded_dest_worker_flush(self, mode);
   _process_result(self, result);
+
+  /* at shutdown, wait for the batches still in flight, in expedite mode
+   * flush() is expected to reclaim them */
+  while (mode == LTF_FLUSH_NORMAL && self->in_flight_size > 0 && !self->suspended)
+    {
+      result = log_threaded_dest_worker_flush(self, mode);
+      _process_result(self, result);
+    }
   log_queue_rewind_backlog_all(self->queue);
 }
 
@@ -1283,10 +1363,12 @@ _register_driver_stats(LogThreadedDestDriver *self, StatsClusterKeyBuilder *driv
 
   stats_lock();
   {
-    stats_register_counter(level, self->metrics.output_events_sc_key, SC_TYPE_DROPPED, &self->metrics.dropped_messages);
-    stats_register_counter(level, self->metrics.output_events_sc_key, SC_TYPE_WRITTEN, &self->metrics.written_messages);
-    stats_register_counter(level, self->metrics.processed_sc_key, SC_TYPE_SINGLE_VALUE,
-                           &self->metrics.processed_messages);
+    stats_register_sharded_counter(level, self->metrics.output_events_sc_key, SC_TYPE_DROPPED,
+                                   &self->metrics.dropped_messages);
+    stats_register_sharded_counter(level, self->metrics.output_events_sc_key, SC_TYPE_WRITTEN,
+                                   &self->metrics.written_messages);
+    stats_register_sharded_counter(level, self->metrics.processed_sc_key, SC_TYPE_SINGLE_VALUE,
+                                   &self->metrics.processed_messages);
     stats_register_counter(level, self->metrics.output_event_retries_sc_key, SC_TYPE_SINGLE_VALUE,
                            &self->metrics.output_event_retries);
   }
@@ -90,6 +90,9 @@ struct _LogThreadedDestWorker
   gint worker_index;
   gboolean connected;
   gint batch_size;
+  /* messages of batches handed over to the destination that are still
+   * waiting for their results, see log_threaded_dest_worker_set_batch_in_flight() */
+  gint in_flight_size;
   gint rewound_batch_size;
   gint retries_on_error_counter;
   guint retries_counter;
@@ -292,6 +295,10 @@ log_threaded_dest_driver_flush(LogThreadedDestDriver *self)
 void log_threaded_dest_worker_ack_messages(LogThreadedDestWorker *self, gint batch_size);
 void log_threaded_dest_worker_drop_messages(LogThreadedDestWorker *self, gint batch_size);
 void log_threaded_dest_worker_rewind_messages(LogThreadedDestWorker *self, gint batch_size);
+gint log_threaded_dest_worker_set_batch_in_flight(LogThreadedDestWorker *self);
+void log_threaded_dest_worker_ack_in_flight_messages(LogThreadedDestWorker *self, gint batch_size);
+void log_threaded_dest_worker_drop_in_flight_messages(LogThreadedDestWorker *self, gint batch_size);
+void log_threaded_dest_worker_reclaim_in_flight_messages(LogThreadedDestWorker *self);
 void log_threaded_dest_worker_wakeup_when_suspended(LogThreadedDestWorker *self);
 gboolean log_threaded_dest_worker_init_method(LogThreadedDestWorker *self);
 void log_threaded_dest_worker_deinit_method(LogThreadedDestWorker *self);
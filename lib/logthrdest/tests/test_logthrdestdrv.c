@@ -30,6 +30,9 @@
 #include "mainloop-worker.h"
 #include "apphook.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 typedef struct TestThreadedDestDriver
 {
   LogThreadedDestDriver super;
@@ -39,6 +42,21 @@ typedef struct TestThreadedDestDriver
   gint failure_counter;
   gint prev_flush_size;
   gint flush_size;
+
+  /* simulated asynchronous requests, see the in-flight testcases */
+  struct
+  {
+    gint window;
+    gint messages;
+    gint batches[16];
+    gint len;
+    gint max_len;
+    gint pids[64];
+    gint pids_len;
+    gint next_acked_pid;
+    gint sent_batches;
+    gint fail_at_batch;
+  } in_flight;
 } TestThreadedDestDriver;
 
 static const gchar *
@@ -806,6 +824,157 @@ Test(logthrdestdrv, test_explicit_ack_accept)
   cr_assert(dd->super.shared_seq_num == 11, "%d", dd->super.shared_seq_num);
 }
 
+/*
+ * In-flight batches: flush() detaches the batch as if it was sent
+ * asynchronously and completes the oldest one once the window is full.
+ * Batches are completed without a new one being sent only after every
+ * message has been inserted, so the window fills up regardless of how fast
+ * the messages arrive.
+ */
+
+static void
+_complete_oldest_in_flight_batch(TestThreadedDestDriver *self)
+{
+  gint batch_size = self->in_flight.batches[0];
+
+  for (gint i = 0; i < batch_size; i++)
+    {
+      cr_expect(self->in_flight.pids[i] == self->in_flight.next_acked_pid,
+                "in-flight batches have to be acked in order, pid=%d, expected=%d",
+                self->in_flight.pids[i], self->in_flight.next_acked_pid);
+      self->in_flight.next_acked_pid++;
+    }
+  memmove(self->in_flight.pids, self->in_flight.pids + batch_size,
+          (self->in_flight.pids_len - batch_size) * sizeof(self->in_flight.pids[0]));
+  self->in_flight.pids_len -= batch_size;
+
+  memmove(self->in_flight.batches, self->in_flight.batches + 1,
+          (self->in_flight.len - 1) * sizeof(self->in_flight.batches[0]));
+  self->in_flight.len--;
+
+  log_threaded_dest_worker_ack_in_flight_messages(&self->super.worker.instance, batch_size);
+}
+
+static LogThreadedResult
+_fail_all_in_flight_batches(TestThreadedDestDriver *self)
+{
+  /* the messages are rewound and inserted again */
+  self->in_flight.len = 0;
+  self->in_flight.pids_len = 0;
+  log_threaded_dest_worker_reclaim_in_flight_messages(&self->super.worker.instance);
+  return LTR_ERROR;
+}
+
+static LogThreadedResult
+_flush_in_flight(LogThreadedDestDriver *s)
+{
+  TestThreadedDestDriver *self = (TestThreadedDestDriver *) s;
+  LogThreadedDestWorker *worker = &s->worker.instance;
+
+  self->flush_counter++;
+  if (worker->batch_size == 0 && self->in_flight.len == 0)
+    return LTR_SUCCESS;
+
+  if (worker->batch_size == 0)
+    {
+      if (self->in_flight.next_acked_pid + self->in_flight.pids_len == self->in_flight.messages)
+        _complete_oldest_in_flight_batch(self);
+      return LTR_EXPLICIT_ACK_MGMT;
+    }
+
+  if (++self->in_flight.sent_batches == self->in_flight.fail_at_batch)
+    return _fail_all_in_flight_batches(self);
+
+  if (self->in_flight.len == self->in_flight.window)
+    _complete_oldest_in_flight_batch(self);
+
+  self->flush_size += worker->batch_size;
+  self->in_flight.batches[self->in_flight.len++] = log_threaded_dest_worker_set_batch_in_flight(worker);
+  self->in_flight.max_len = MAX(self->in_flight.max_len, self->in_flight.len);
+  cr_assert(worker->in_flight_size == self->in_flight.pids_len,
+            "in_flight_size has to cover every message sent, in_flight_size=%d, expected=%d",
+            worker->in_flight_size, self->in_flight.pids_len);
+  return LTR_EXPLICIT_ACK_MGMT;
+}
+
+static LogThreadedResult
+_insert_in_flight(LogThreadedDestDriver *s, LogMessage *msg)
+{
+  TestThreadedDestDriver *self = (TestThreadedDestDriver *) s;
+
+  self->insert_counter++;
+  cr_assert(self->in_flight.pids_len < (gint) G_N_ELEMENTS(self->in_flight.pids));
+  self->in_flight.pids[self->in_flight.pids_len++] = atoi(log_msg_get_value(msg, LM_V_PID, NULL));
+
+  if (self->super.worker.instance.batch_size < s->batch_lines)
+    return LTR_QUEUED;
+  return _flush_in_flight(s);
+}
+
+static void
+_setup_in_flight(TestThreadedDestDriver *self, gint window, gint messages)
+{
+  self->super.worker.insert = _insert_in_flight;
+  self->super.worker.flush = _flush_in_flight;
+  self->super.batch_lines = 2;
+  self->in_flight.window = window;
+  self->in_flight.messages = messages;
+}
+
+Test(logthrdestdrv, test_in_flight_batches_are_limited_by_the_window_and_acked_in_order)
+{
+  _setup_in_flight(dd, 3, 20);
+
+  _generate_messages_and_wait_for_processing(dd, 20, dd->super.metrics.written_messages);
+  cr_assert(dd->insert_counter == 20, "%d", dd->insert_counter);
+  cr_assert(dd->flush_size == 20, "%d", dd->flush_size);
+  cr_assert(dd->in_flight.max_len == 3, "the window was not filled, max in-flight batches=%d", dd->in_flight.max_len);
+  cr_assert(dd->in_flight.next_acked_pid == 20, "%d", dd->in_flight.next_acked_pid);
+
+  cr_assert(dd->super.worker.instance.in_flight_size == 0);
+  cr_assert(stats_counter_get(dd->super.metrics.processed_messages) == 20);
+  cr_assert(stats_counter_get(dd->super.metrics.written_messages) == 20);
+  cr_assert(stats_counter_get(dd->super.metrics.dropped_messages) == 0);
+  cr_assert(stats_counter_get(dd->super.worker.instance.queue->metrics.shared.queued_messages) == 0);
+  cr_assert(stats_counter_get(dd->super.worker.instance.queue->metrics.shared.memory_usage) == 0);
+}
+
+Test(logthrdestdrv, test_in_flight_window_of_one_keeps_a_single_batch_in_flight)
+{
+  _setup_in_flight(dd, 1, 10);
+
+  _generate_messages_and_wait_for_processing(dd, 10, dd->super.metrics.written_messages);
+  cr_assert(dd->insert_counter == 10, "%d", dd->insert_counter);
+  cr_assert(dd->flush_size == 10, "%d", dd->flush_size);
+  cr_assert(dd->in_flight.max_len == 1, "%d", dd->in_flight.max_len);
+  cr_assert(dd->in_flight.next_acked_pid == 10, "%d", dd->in_flight.next_acked_pid);
+
+  cr_assert(stats_counter_get(dd->super.metrics.written_messages) == 10);
+  cr_assert(stats_counter_get(dd->super.metrics.dropped_messages) == 0);
+  cr_assert(stats_counter_get(dd->super.worker.instance.queue->metrics.shared.memory_usage) == 0);
+}
+
+Test(logthrdestdrv, test_failed_in_flight_batches_are_reclaimed_and_sent_again)
+{
+  _setup_in_flight(dd, 3, 20);
+  dd->super.worker.instance.time_reopen = 0;
+  dd->super.retries_on_error_max = 5;
+  /* the window is full by then, 3 batches in flight and 1 to be sent */
+  dd->in_flight.fail_at_batch = 4;
+
+  start_grabbing_messages();
+  _generate_messages_and_wait_for_processing(dd, 20, dd->super.metrics.written_messages);
+  cr_assert(dd->insert_counter > 20, "nothing was sent again, insert_counter=%d", dd->insert_counter);
+  cr_assert(dd->in_flight.next_acked_pid == 20, "%d", dd->in_flight.next_acked_pid);
+
+  cr_assert(dd->super.worker.instance.in_flight_size == 0);
+  cr_assert(stats_counter_get(dd->super.metrics.processed_messages) == 20);
+  cr_assert(stats_counter_get(dd->super.metrics.written_messages) == 20);
+  cr_assert(stats_counter_get(dd->super.metrics.dropped_messages) == 0);
+  cr_assert(stats_counter_get(dd->super.worker.instance.queue->metrics.shared.memory_usage) == 0);
+  assert_grabbed_log_contains("Error occurred while");
+}
+
 MainLoopOptions main_loop_options = {0};
 
 static void
@@ -888,6 +888,52 @@ log_writer_queue(LogPipe *s, LogMessage *lm, const LogPathOptions *path_options)
   log_queue_push_tail(self->queue, lm, path_options);
 }
 
+/* NOTE: runs in the reader thread, same as log_writer_queue(), except that
+ * the flow-control decision, the MARK timer and the stats update are done
+ * only once for the entire batch */
+static void
+log_writer_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogWriter *self = (LogWriter *) s;
+  gint mark_mode = self->options->mark_mode;
+  gboolean break_ack = !path_options->flow_control_requested &&
+                       ((self->proto == NULL || self->suspended) || !(self->flags & LW_SOFT_FLOW_CONTROL));
+  gboolean postpone_mark = FALSE;
+  gint num_queued = 0;
+
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      LogMessage *lm = msgs[i];
+      LogPathOptions local_path_options;
+      const LogPathOptions *msg_path_options = path_options;
+
+      if (break_ack)
+        msg_path_options = log_msg_break_ack(lm, path_options, &local_path_options);
+
+      if (log_writer_is_msg_suppressed(self, lm))
+        {
+          log_msg_drop(lm, msg_path_options, AT_PROCESSED);
+          continue;
+        }
+
+      if (mark_mode != MM_INTERNAL && (lm->flags & LF_INTERNAL) && (lm->flags & LF_MARK))
+        {
+          log_msg_drop(lm, msg_path_options, AT_PROCESSED);
+          continue;
+        }
+
+      if (mark_mode == MM_DST_IDLE || (mark_mode == MM_HOST_IDLE && !(lm->flags & LF_LOCAL)))
+        postpone_mark = TRUE;
+
+      log_queue_push_tail(self->queue, lm, msg_path_options);
+      num_queued++;
+    }
+
+  if (postpone_mark)
+    log_writer_postpone_mark_timer(self);
+  stats_counter_add(self->metrics.processed_messages, num_queued);
+}
+
 static void
 log_writer_append_value(GString *result, LogMessage *lm, NVHandle handle, gboolean use_nil, gboolean append_space)
 {
@@ -1513,8 +1559,10 @@ _register_counters(LogWriter *self)
   if (self->options->suppress > 0)
     stats_register_counter(level, self->metrics.output_events_key, SC_TYPE_SUPPRESSED,
                            &self->metrics.suppressed_messages);
-  stats_register_counter(level, self->metrics.output_events_key, SC_TYPE_DROPPED, &self->metrics.dropped_messages);
-  stats_register_counter(level, self->metrics.output_events_key, SC_TYPE_WRITTEN, &self->metrics.written_messages);
+  stats_register_sharded_counter(level, self->metrics.output_events_key, SC_TYPE_DROPPED,
+                                 &self->metrics.dropped_messages);
+  stats_register_sharded_counter(level, self->metrics.output_events_key, SC_TYPE_WRITTEN,
+                                 &self->metrics.written_messages);
 
 
   gchar stats_instance[1024];
@@ -1524,7 +1572,7 @@ _register_counters(LogWriter *self)
   StatsClusterKey sc_legacy_processed;
   stats_cluster_single_key_legacy_set_with_name(&sc_legacy_processed, self->options->stats_source | SCS_DESTINATION,
                                                 self->stats_id, stats_instance, "processed");
-  stats_register_counter(level, &sc_legacy_processed, SC_TYPE_SINGLE_VALUE, &self->metrics.processed_messages);
+  stats_register_sharded_counter(level, &sc_legacy_processed, SC_TYPE_SINGLE_VALUE, &self->metrics.processed_messages);
 
   StatsClusterKey sc_key_truncated_count;
   stats_cluster_single_key_legacy_set_with_name(&sc_key_truncated_count, self->options->stats_source | SCS_DESTINATION,
@@ -1919,6 +1967,7 @@ log_writer_new(guint32 flags, GlobalConfig *cfg)
   self->super.init = log_writer_init;
   self->super.deinit = log_writer_deinit;
   self->super.queue = log_writer_queue;
+  self->super.queue_batch = log_writer_queue_batch;
   self->super.free_fn = log_writer_free;
   self->flags = flags;
   self->line_buffer = g_string_sized_new(128);
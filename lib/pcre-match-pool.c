@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "pcre-match-pool.h"
+#include "apphook.h"
+#include "tls-support.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+/*
+ * Per-thread cache of the pcre2 objects needed to run a match, so that
+ * matching does not need to allocate.
+ *
+ * Match data is cached by the size of its ovector (the number of capture
+ * groups + 1), which keeps pcre2_get_ovector_count() the same as with
+ * pcre2_match_data_create_from_pattern(), and is independent of the
+ * lifetime of the patterns themselves.  Each size is cached once per
+ * thread, nested users of the same size get a newly allocated one.
+ *
+ * Every thread also has a match context with a JIT stack that can grow
+ * beyond the default 32k machine stack the JIT code uses otherwise.
+ */
+
+#define PCRE_MATCH_POOL_MAX_PAIRS 32
+#define PCRE_JIT_STACK_START_SIZE (32 * 1024)
+#define PCRE_JIT_STACK_MAX_SIZE (512 * 1024)
+
+TLS_BLOCK_START
+{
+  pcre2_match_data *pcre_match_data_pool[PCRE_MATCH_POOL_MAX_PAIRS + 1];
+  pcre2_match_context *pcre_match_context;
+  pcre2_jit_stack *pcre_jit_stack;
+}
+TLS_BLOCK_END;
+
+#define pcre_match_data_pool  __tls_deref(pcre_match_data_pool)
+#define pcre_match_context  __tls_deref(pcre_match_context)
+#define pcre_jit_stack  __tls_deref(pcre_jit_stack)
+
+static const gchar *pcre_match_pool_user_names[PCRE_MATCH_POOL_NUM_USERS] =
+{
+  [PCRE_MATCH_POOL_FILTERX] = "filterx",
+  [PCRE_MATCH_POOL_LOGMATCHER] = "logmatcher",
+};
+
+static StatsCounterItem *stats_regexp_evaluations[PCRE_MATCH_POOL_NUM_USERS];
+static StatsCounterItem *stats_regexp_jit_misses[PCRE_MATCH_POOL_NUM_USERS];
+
+pcre2_match_data *
+pcre_match_pool_acquire(const pcre2_code *pattern)
+{
+  guint32 capture_count = 0;
+
+  pcre2_pattern_info(pattern, PCRE2_INFO_CAPTURECOUNT, &capture_count);
+
+  guint32 num_pairs = capture_count + 1;
+  if (num_pairs <= PCRE_MATCH_POOL_MAX_PAIRS && pcre_match_data_pool[num_pairs])
+    {
+      pcre2_match_data *match_data = pcre_match_data_pool[num_pairs];
+
+      pcre_match_data_pool[num_pairs] = NULL;
+      return match_data;
+    }
+  return pcre2_match_data_create(num_pairs, NULL);
+}
+
+void
+pcre_match_pool_release(pcre2_match_data *match_data)
+{
+  if (!match_data)
+    return;
+
+  guint32 num_pairs = pcre2_get_ovector_count(match_data);
+  if (num_pairs <= PCRE_MATCH_POOL_MAX_PAIRS && !pcre_match_data_pool[num_pairs])
+    {
+      pcre_match_data_pool[num_pairs] = match_data;
+      return;
+    }
+  pcre2_match_data_free(match_data);
+}
+
+static pcre2_match_context *
+_get_match_context(void)
+{
+  if (G_LIKELY(pcre_match_context))
+    return pcre_match_context;
+
+  pcre_match_context = pcre2_match_context_create(NULL);
+
+  /* NULL if JIT is not supported by the pcre2 library, the context is still usable */
+  pcre_jit_stack = pcre2_jit_stack_create(PCRE_JIT_STACK_START_SIZE, PCRE_JIT_STACK_MAX_SIZE, NULL);
+  if (pcre_jit_stack)
+    pcre2_jit_stack_assign(pcre_match_context, NULL, pcre_jit_stack);
+  return pcre_match_context;
+}
+
+static inline gboolean
+_is_jit_compiled(const pcre2_code *pattern)
+{
+  gsize jit_size = 0;
+
+  pcre2_pattern_info(pattern, PCRE2_INFO_JITSIZE, &jit_size);
+  return jit_size > 0;
+}
+
+/*
+ * Same as pcre2_match(), using the per-thread match context.  A match
+ * that runs out of JIT stack is retried with the interpreter.
+ */
+gint
+pcre_match_pool_match(PcreMatchPoolUser user, const pcre2_code *pattern,
+                      const gchar *subject, gsize subject_len, gsize start_offset,
+                      guint32 options, pcre2_match_data *match_data)
+{
+  pcre2_match_context *match_context = _get_match_context();
+
+  stats_counter_inc(stats_regexp_evaluations[user]);
+  if (!_is_jit_compiled(pattern))
+    stats_counter_inc(stats_regexp_jit_misses[user]);
+
+  gint rc = pcre2_match(pattern, (PCRE2_SPTR) subject, (PCRE2_SIZE) subject_len, (PCRE2_SIZE) start_offset,
+                        options, match_data, match_context);
+  if (rc == PCRE2_ERROR_JIT_STACKLIMIT)
+    {
+      stats_counter_inc(stats_regexp_jit_misses[user]);
+      rc = pcre2_match(pattern, (PCRE2_SPTR) subject, (PCRE2_SIZE) subject_len, (PCRE2_SIZE) start_offset,
+                       options | PCRE2_NO_JIT, match_data, match_context);
+    }
+  return rc;
+}
+
+void
+pcre_match_pool_thread_deinit(void)
+{
+  for (gint i = 0; i <= PCRE_MATCH_POOL_MAX_PAIRS; i++)
+    {
+      if (pcre_match_data_pool[i])
+        pcre2_match_data_free(pcre_match_data_pool[i]);
+      pcre_match_data_pool[i] = NULL;
+    }
+
+  if (pcre_match_context)
+    pcre2_match_context_free(pcre_match_context);
+  pcre_match_context = NULL;
+
+  if (pcre_jit_stack)
+    pcre2_jit_stack_free(pcre_jit_stack);
+  pcre_jit_stack = NULL;
+}
+
+static void
+_set_stats_key(StatsClusterKey *sc_key, const gchar *name, StatsClusterLabel *label, PcreMatchPoolUser user)
+{
+  *label = stats_cluster_label("subsystem", pcre_match_pool_user_names[user]);
+  stats_cluster_single_key_set(sc_key, name, label, 1);
+}
+
+void
+pcre_match_pool_register_stats(void)
+{
+  StatsClusterKey sc_key;
+  StatsClusterLabel label;
+
+  stats_lock();
+  for (gint user = 0; user < PCRE_MATCH_POOL_NUM_USERS; user++)
+    {
+      _set_stats_key(&sc_key, "regexp_evaluations_total", &label, user);
+      stats_register_sharded_counter(STATS_LEVEL1, &sc_key, SC_TYPE_SINGLE_VALUE, &stats_regexp_evaluations[user]);
+      _set_stats_key(&sc_key, "regexp_jit_misses_total", &label, user);
+      stats_register_sharded_counter(STATS_LEVEL1, &sc_key, SC_TYPE_SINGLE_VALUE, &stats_regexp_jit_misses[user]);
+    }
+  stats_unlock();
+}
+
+void
+pcre_match_pool_unregister_stats(void)
+{
+  StatsClusterKey sc_key;
+  StatsClusterLabel label;
+
+  stats_lock();
+  for (gint user = 0; user < PCRE_MATCH_POOL_NUM_USERS; user++)
+    {
+      _set_stats_key(&sc_key, "regexp_evaluations_total", &label, user);
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &stats_regexp_evaluations[user]);
+      _set_stats_key(&sc_key, "regexp_jit_misses_total", &label, user);
+      stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &stats_regexp_jit_misses[user]);
+    }
+  stats_unlock();
+}
+
+void
+pcre_match_pool_global_init(void)
+{
+  register_application_hook(AH_RUNNING, (ApplicationHookFunc) pcre_match_pool_register_stats, NULL, AHM_RUN_ONCE);
+}
+
+void
+pcre_match_pool_global_deinit(void)
+{
+  pcre_match_pool_unregister_stats();
+  pcre_match_pool_thread_deinit();
+}
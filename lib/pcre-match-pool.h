@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef PCRE_MATCH_POOL_H_INCLUDED
+#define PCRE_MATCH_POOL_H_INCLUDED 1
+
+#include "syslog-ng.h"
+#include "compat/pcre.h"
+
+/* the users of pcre_match_pool_match(), each of them has its own set of counters */
+typedef enum
+{
+  PCRE_MATCH_POOL_FILTERX,
+  PCRE_MATCH_POOL_LOGMATCHER,
+  PCRE_MATCH_POOL_NUM_USERS,
+} PcreMatchPoolUser;
+
+pcre2_match_data *pcre_match_pool_acquire(const pcre2_code *pattern);
+void pcre_match_pool_release(pcre2_match_data *match_data);
+
+gint pcre_match_pool_match(PcreMatchPoolUser user, const pcre2_code *pattern,
+                           const gchar *subject, gsize subject_len, gsize start_offset,
+                           guint32 options, pcre2_match_data *match_data);
+
+void pcre_match_pool_thread_deinit(void);
+
+void pcre_match_pool_register_stats(void);
+void pcre_match_pool_unregister_stats(void);
+
+void pcre_match_pool_global_init(void);
+void pcre_match_pool_global_deinit(void);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-counter.h"
+#include "mainloop-worker.h"
+
+#include <stdlib.h>
+
+G_STATIC_ASSERT(sizeof(StatsCounterShard) == STATS_COUNTER_SHARD_SIZE);
+
+/* must be called with stats_lock() held, as the counter may be shared by
+ * multiple registrations */
+void
+stats_counter_enable_sharding(StatsCounterItem *counter)
+{
+  gpointer shards;
+
+  if (!counter || counter->external || counter->shards)
+    return;
+
+  gint num_shards = main_loop_worker_get_max_number_of_threads();
+  if (num_shards <= 0)
+    return;
+
+  if (posix_memalign(&shards, STATS_COUNTER_SHARD_SIZE, num_shards * sizeof(StatsCounterShard)) != 0)
+    return;
+  memset(shards, 0, num_shards * sizeof(StatsCounterShard));
+
+  counter->num_shards = num_shards;
+  g_atomic_pointer_set(&counter->shards, shards);
+}
+
+void
+stats_counter_sharded_add(StatsCounterItem *counter, gssize add)
+{
+  gint thread_index = main_loop_worker_get_thread_index();
+
+  if (thread_index < 0 || thread_index >= counter->num_shards)
+    {
+      atomic_gssize_add(&counter->value, add);
+      return;
+    }
+
+  /* the slot is only written by the current thread, no need for a locked
+   * read-modify-write, readers only need to see a consistent value */
+  atomic_gssize *slot = &counter->shards[thread_index].value;
+  atomic_gssize_racy_set(slot, atomic_gssize_racy_get(slot) + add);
+}
+
+gssize
+stats_counter_sum_shards(StatsCounterItem *counter)
+{
+  StatsCounterShard *shards = g_atomic_pointer_get(&counter->shards);
+  gssize sum = 0;
+
+  if (!shards)
+    return 0;
+
+  for (gint i = 0; i < counter->num_shards; i++)
+    sum += atomic_gssize_get(&shards[i].value);
+  return sum;
+}
+
+void
+stats_counter_free_shards(StatsCounterItem *counter)
+{
+  free(counter->shards);
+  counter->shards = NULL;
+  counter->num_shards = 0;
+}
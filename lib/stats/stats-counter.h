@@ -29,6 +29,28 @@
 
 #define STATS_COUNTER_MAX_VALUE G_MAXSIZE
 
+#define STATS_COUNTER_SHARD_SIZE 64
+
+/*
+ * Sharded counters
+ *
+ * Counters that are changed by all worker threads (e.g. processed or
+ * written messages) may be sharded by stats_counter_enable_sharding(): in
+ * this case each worker thread changes its own, cache line sized slot,
+ * indexed by main_loop_worker_get_thread_index(), without atomic
+ * read-modify-write operations.  Threads without a worker index fall back
+ * to changing "value" atomically.
+ *
+ * The value of the counter is the sum of "value" and all slots, which is
+ * what stats_counter_get() returns, so readers (stats-query,
+ * stats-prometheus, stats-csv) need no changes.
+ */
+typedef struct _StatsCounterShard
+{
+  atomic_gssize value;
+  gchar padding[STATS_COUNTER_SHARD_SIZE - sizeof(atomic_gssize)];
+} StatsCounterShard;
+
 typedef struct _StatsCounterItem
 {
   union
@@ -36,11 +58,24 @@ typedef struct _StatsCounterItem
     atomic_gssize value;
     atomic_gssize *value_ref;
   };
+  StatsCounterShard *shards;
+  gint num_shards;
   gchar *name;
   gint type;
   gboolean external;
 } StatsCounterItem;
 
+void stats_counter_enable_sharding(StatsCounterItem *counter);
+void stats_counter_sharded_add(StatsCounterItem *counter, gssize add);
+gssize stats_counter_sum_shards(StatsCounterItem *counter);
+void stats_counter_free_shards(StatsCounterItem *counter);
+
+static inline gboolean
+stats_counter_is_sharded(StatsCounterItem *counter)
+{
+  return g_atomic_pointer_get(&counter->shards) != NULL;
+}
+
 
 static gboolean
 stats_counter_read_only(StatsCounterItem *counter)
@@ -54,7 +89,10 @@ stats_counter_add(StatsCounterItem *counter, gssize add)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_add(&counter->value, add);
+      if (stats_counter_is_sharded(counter))
+        stats_counter_sharded_add(counter, add);
+      else
+        atomic_gssize_add(&counter->value, add);
     }
 }
 
@@ -64,7 +102,10 @@ stats_counter_sub(StatsCounterItem *counter, gssize sub)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_sub(&counter->value, sub);
+      if (stats_counter_is_sharded(counter))
+        stats_counter_sharded_add(counter, -sub);
+      else
+        atomic_gssize_sub(&counter->value, sub);
     }
 }
 
@@ -74,7 +115,10 @@ stats_counter_inc(StatsCounterItem *counter)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_inc(&counter->value);
+      if (stats_counter_is_sharded(counter))
+        stats_counter_sharded_add(counter, 1);
+      else
+        atomic_gssize_inc(&counter->value);
     }
 }
 
@@ -84,7 +128,10 @@ stats_counter_dec(StatsCounterItem *counter)
   if (counter)
     {
       g_assert(!stats_counter_read_only(counter));
-      atomic_gssize_dec(&counter->value);
+      if (stats_counter_is_sharded(counter))
+        stats_counter_sharded_add(counter, -1);
+      else
+        atomic_gssize_dec(&counter->value);
     }
 }
 
@@ -93,6 +140,10 @@ stats_counter_set(StatsCounterItem *counter, gsize value)
 {
   if (counter && !stats_counter_read_only(counter))
     {
+      /* the slots are only written by their own threads, compensate for
+       * them in the shared value instead */
+      if (stats_counter_is_sharded(counter))
+        value -= stats_counter_sum_shards(counter);
       atomic_gssize_set(&counter->value, value);
     }
 }
@@ -105,7 +156,11 @@ stats_counter_get(StatsCounterItem *counter)
   if (counter)
     {
       if (!counter->external)
-        result = atomic_gssize_get_unsigned(&counter->value);
+        {
+          result = atomic_gssize_get_unsigned(&counter->value);
+          if (stats_counter_is_sharded(counter))
+            result += stats_counter_sum_shards(counter);
+        }
       else
         result = atomic_gssize_get_unsigned(counter->value_ref);
     }
@@ -131,6 +186,7 @@ static inline void
 stats_counter_clear(StatsCounterItem *counter)
 {
   g_free(counter->name);
+  stats_counter_free_shards(counter);
   memset(counter, 0, sizeof(*counter));
 }
 
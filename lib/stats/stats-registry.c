@@ -228,6 +228,24 @@ stats_register_counter(gint stats_level, const StatsClusterKey *sc_key, gint typ
   return _register_counter(stats_level, sc_key, type, FALSE, counter);
 }
 
+/*
+ * stats_register_sharded_counter:
+ *
+ * Same as stats_register_counter(), but the counter is sharded to per-thread
+ * slots, see stats-counter.h.  Use it for counters that are changed by
+ * multiple worker threads in the hot path.
+ */
+StatsCluster *
+stats_register_sharded_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
+                               StatsCounterItem **counter)
+{
+  StatsCluster *sc = _register_counter(stats_level, sc_key, type, FALSE, counter);
+
+  if (*counter)
+    stats_counter_enable_sharding(*counter);
+  return sc;
+}
+
 StatsCluster *
 stats_register_external_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
                                 atomic_gssize *external_counter)
@@ -238,6 +256,8 @@ stats_register_external_counter(gint stats_level, const StatsClusterKey *sc_key,
 StatsCluster *
 stats_register_alias_counter(gint level, const StatsClusterKey *sc_key, gint type, StatsCounterItem *aliased_counter)
 {
+  /* the alias would only see the shared part of the value */
+  g_assert(!stats_counter_is_sharded(aliased_counter));
   return stats_register_external_counter(level, sc_key, type, &aliased_counter->value);
 }
 
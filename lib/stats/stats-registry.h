@@ -34,6 +34,8 @@ void stats_lock(void);
 void stats_unlock(void);
 gboolean stats_check_level(gint level);
 StatsCluster *stats_register_counter(gint level, const StatsClusterKey *sc_key, gint type, StatsCounterItem **counter);
+StatsCluster *stats_register_sharded_counter(gint level, const StatsClusterKey *sc_key, gint type,
+                                             StatsCounterItem **counter);
 
 StatsCluster *stats_register_external_counter(gint level, const StatsClusterKey *sc_key, gint type,
                                               atomic_gssize *external_counter);
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+
+#include "apphook.h"
+#include "mainloop-worker.h"
+#include "stats/stats-cluster.h"
+#include "stats/stats-cluster-logpipe.h"
+#include "stats/stats-counter.h"
+#include "stats/stats-registry.h"
+
+#include <iv.h>
+
+#define NUM_WORKERS 4
+#define INCREMENTS_PER_WORKER 100000
+
+static gpointer
+_increment_from_worker(gpointer user_data)
+{
+  StatsCounterItem *counter = (StatsCounterItem *) user_data;
+
+  iv_init();
+  main_loop_worker_thread_start(MLW_ASYNC_WORKER);
+
+  for (gint i = 0; i < INCREMENTS_PER_WORKER; i++)
+    stats_counter_inc(counter);
+  stats_counter_add(counter, 2);
+  stats_counter_sub(counter, 1);
+
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+static StatsCounterItem *
+_register_sharded_counter(StatsClusterKey *sc_key)
+{
+  StatsCounterItem *counter = NULL;
+
+  stats_lock();
+  stats_cluster_logpipe_key_legacy_set(sc_key, SCS_GLOBAL, "test_sharded_ctr", NULL);
+  stats_register_sharded_counter(0, sc_key, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+
+  return counter;
+}
+
+static void
+_unregister_sharded_counter(StatsClusterKey *sc_key, StatsCounterItem *counter)
+{
+  stats_lock();
+  stats_unregister_counter(sc_key, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+}
+
+static void
+_run_workers(StatsCounterItem *counter)
+{
+  GThread *threads[NUM_WORKERS];
+
+  for (gint i = 0; i < NUM_WORKERS; i++)
+    threads[i] = g_thread_new(NULL, _increment_from_worker, counter);
+  for (gint i = 0; i < NUM_WORKERS; i++)
+    g_thread_join(threads[i]);
+}
+
+Test(stats_sharded_counter, slots_are_summed_on_read)
+{
+  StatsClusterKey sc_key;
+  StatsCounterItem *counter = _register_sharded_counter(&sc_key);
+
+  cr_assert(stats_counter_is_sharded(counter));
+  cr_assert_eq(counter->num_shards, NUM_WORKERS);
+
+  /* not a worker thread, changes the shared value */
+  stats_counter_inc(counter);
+
+  _run_workers(counter);
+  cr_assert_eq(stats_counter_get(counter), NUM_WORKERS * (INCREMENTS_PER_WORKER + 1) + 1);
+
+  _unregister_sharded_counter(&sc_key, counter);
+}
+
+Test(stats_sharded_counter, set_compensates_for_slots)
+{
+  StatsClusterKey sc_key;
+  StatsCounterItem *counter = _register_sharded_counter(&sc_key);
+
+  _run_workers(counter);
+  cr_assert_neq(stats_counter_get(counter), 0);
+
+  stats_counter_set(counter, 0);
+  cr_assert_eq(stats_counter_get(counter), 0);
+
+  _run_workers(counter);
+  cr_assert_eq(stats_counter_get(counter), NUM_WORKERS * (INCREMENTS_PER_WORKER + 1));
+
+  _unregister_sharded_counter(&sc_key, counter);
+}
+
+Test(stats_sharded_counter, registering_again_keeps_the_slots)
+{
+  StatsClusterKey sc_key;
+  StatsCounterItem *counter = _register_sharded_counter(&sc_key);
+  StatsCounterShard *shards = counter->shards;
+
+  _run_workers(counter);
+
+  StatsCounterItem *same_counter = _register_sharded_counter(&sc_key);
+  cr_assert_eq(same_counter, counter);
+  cr_assert_eq(same_counter->shards, shards);
+  cr_assert_eq(stats_counter_get(same_counter), NUM_WORKERS * (INCREMENTS_PER_WORKER + 1));
+
+  _unregister_sharded_counter(&sc_key, same_counter);
+  _unregister_sharded_counter(&sc_key, counter);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  main_loop_worker_allocate_thread_space(NUM_WORKERS);
+  main_loop_worker_finalize_thread_space();
+}
+
+TestSuite(stats_sharded_counter, .init = setup, .fini = app_shutdown);
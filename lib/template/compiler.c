@@ -444,6 +444,82 @@ error:
   return result;
 }
 
+static guint8
+_select_opcode(const LogTemplateElem *e)
+{
+  switch (e->type)
+    {
+    case LTE_MACRO:
+      return e->macro == M_NONE ? LTI_LITERAL : LTI_MACRO;
+    case LTE_VALUE:
+      if (e->msg_ref == 0 && !e->default_value)
+        return LTI_TEXT_AND_VALUE;
+      return LTI_VALUE;
+    case LTE_FUNC:
+      return LTI_FUNC;
+    default:
+      g_assert_not_reached();
+    }
+}
+
+static void
+_emit_insn(LogTemplateInsn *insn, const LogTemplateElem *e, gchar *text)
+{
+  insn->opcode = _select_opcode(e);
+  insn->msg_ref = e->msg_ref;
+  insn->text = text;
+  insn->text_len = e->text_len;
+  insn->default_value = e->default_value;
+
+  switch (e->type)
+    {
+    case LTE_MACRO:
+      insn->macro = e->macro;
+      break;
+    case LTE_VALUE:
+      insn->value_handle = e->value_handle;
+      break;
+    case LTE_FUNC:
+      insn->func.ops = e->func.ops;
+      insn->func.state = e->func.state;
+      break;
+    default:
+      g_assert_not_reached();
+    }
+}
+
+/* flatten the list of elements into a contiguous array of instructions
+ * followed by the literal text of all elements */
+LogTemplateProgram *
+log_template_compiler_emit_program(GList *compiled_template)
+{
+  gint num_insns = 0;
+  gsize text_len = 0;
+
+  for (GList *l = compiled_template; l; l = l->next)
+    {
+      LogTemplateElem *e = (LogTemplateElem *) l->data;
+
+      text_len += e->text_len;
+      num_insns++;
+    }
+
+  LogTemplateProgram *program = g_malloc0(sizeof(LogTemplateProgram) + num_insns * sizeof(LogTemplateInsn) + text_len);
+  gchar *text_pool = (gchar *) &program->insns[num_insns];
+
+  program->num_insns = num_insns;
+  LogTemplateInsn *insn = program->insns;
+  for (GList *l = compiled_template; l; l = l->next, insn++)
+    {
+      LogTemplateElem *e = (LogTemplateElem *) l->data;
+
+      memcpy(text_pool, e->text, e->text_len);
+      _emit_insn(insn, e, text_pool);
+      text_pool += e->text_len;
+    }
+  return program;
+}
+
 void
 log_template_compiler_init(LogTemplateCompiler *self, LogTemplate *template)
 {
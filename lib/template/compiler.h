@@ -38,6 +38,7 @@ typedef struct
 } LogTemplateCompiler;
 
 gboolean log_template_compiler_compile(LogTemplateCompiler *self, GList **compiled_template, GError **error);
+LogTemplateProgram *log_template_compiler_emit_program(GList *compiled_template);
 void log_template_compiler_init(LogTemplateCompiler *self, LogTemplate *template);
 void log_template_compiler_clear(LogTemplateCompiler *self);
 
@@ -55,22 +55,22 @@ _should_render(const gchar *value, LogMessageValueType value_type, LogMessageVal
   return !!value[0];
 }
 
-static void
-log_template_append_elem_value(LogTemplate *self, LogTemplateElem *e, LogTemplateEvalOptions *options,
-                               LogMessage *msg, LogMessageValueType *type, GString *result)
+static inline void
+log_template_append_insn_value(LogTemplate *self, const LogTemplateInsn *insn, LogMessage *msg,
+                               LogMessageValueType *type, GString *result)
 {
   const gchar *value = NULL;
   gssize value_len = -1;
   LogMessageValueType value_type = LM_VT_NONE;
 
-  value = log_msg_get_value_with_type(msg, e->value_handle, &value_len, &value_type);
+  value = log_msg_get_value_with_type(msg, insn->value_handle, &value_len, &value_type);
   if (value && _should_render(value, value_type, self->type_hint))
     {
       g_string_append_len(result, value, value_len);
     }
-  else if (e->default_value)
+  else if (insn->default_value)
     {
-      g_string_append_len(result, e->default_value, -1);
+      g_string_append_len(result, insn->default_value, -1);
       value_type = LM_VT_STRING;
     }
   else if (value_type == LM_VT_BYTES || value_type == LM_VT_PROTOBUF)
@@ -81,30 +81,27 @@ log_template_append_elem_value(LogTemplate *self, LogTemplateElem *e, LogTemplat
 }
 
 static void
-log_template_append_elem_macro(LogTemplate *self, LogTemplateElem *e, LogTemplateEvalOptions *options,
+log_template_append_insn_macro(LogTemplate *self, const LogTemplateInsn *insn, LogTemplateEvalOptions *options,
                                LogMessage *msg, LogMessageValueType *type, GString *result)
 {
   gint len = result->len;
   LogMessageValueType value_type = LM_VT_NONE;
 
-  if (e->macro)
-    {
-      log_macro_expand(e->macro, options, msg, result, &value_type);
-      if (len == result->len && e->default_value)
-        g_string_append(result, e->default_value);
-      *type = _propagate_type(*type, value_type);
-    }
+  log_macro_expand(insn->macro, options, msg, result, &value_type);
+  if (len == result->len && insn->default_value)
+    g_string_append(result, insn->default_value);
+  *type = _propagate_type(*type, value_type);
 }
 
 static void
-log_template_append_elem_func(LogTemplate *self, LogTemplateElem *e, LogTemplateEvalOptions *options,
+log_template_append_insn_func(LogTemplate *self, const LogTemplateInsn *insn, LogTemplateEvalOptions *options,
                               LogMessage **messages, gint num_messages, gint msg_ndx,
                               LogMessageValueType *type, GString *result)
 {
   LogTemplateInvokeArgs args =
   {
-    e->msg_ref ? &messages[msg_ndx] : messages,
-    e->msg_ref ? 1 : num_messages,
+    insn->msg_ref ? &messages[msg_ndx] : messages,
+    insn->msg_ref ? 1 : num_messages,
     options,
   };
   LogMessageValueType value_type = LM_VT_NONE;
@@ -115,9 +112,9 @@ log_template_append_elem_func(LogTemplate *self, LogTemplateElem *e, LogTemplate
    * we pass the whole set so the arguments can individually
    * specify which message they want to resolve from
    */
-  if (e->func.ops->eval)
-    e->func.ops->eval(e->func.ops, e->func.state, &args);
-  e->func.ops->call(e->func.ops, e->func.state, &args, result, &value_type);
+  if (insn->func.ops->eval)
+    insn->func.ops->eval(insn->func.ops, insn->func.state, &args);
+  insn->func.ops->call(insn->func.ops, insn->func.state, &args, result, &value_type);
 
   *type = _propagate_type(*type, value_type);
 }
@@ -127,10 +124,9 @@ log_template_append_format_value_and_type_with_context(LogTemplate *self, LogMes
                                                        LogTemplateEvalOptions *options,
                                                        GString *result, LogMessageValueType *type)
 {
-  LogTemplateElem *e;
   LogMessageValueType t = LM_VT_NONE;
-  gboolean first_elem = TRUE;
   GString *target_buffer = result;
+  const LogTemplateInsn *insn, *first_insn, *end_insn;
 
   if (!options->opts)
     {
@@ -146,11 +142,18 @@ log_template_append_format_value_and_type_with_context(LogTemplate *self, LogMes
   if (escape)
     target_buffer = scratch_buffers_alloc();
 
-  for (GList *p = self->compiled_template; p; p = g_list_next(p), first_elem = FALSE)
+  first_insn = end_insn = NULL;
+  if (self->program)
+    {
+      first_insn = self->program->insns;
+      end_insn = first_insn + self->program->num_insns;
+    }
+
+  for (insn = first_insn; insn < end_insn; insn++)
     {
       gint msg_ndx;
 
-      if (!first_elem)
+      if (insn != first_insn)
         {
           /* this is the 2nd elem in the compiled template, we are
            * concatenating multiple elements, convert the value to string */
@@ -158,13 +161,28 @@ log_template_append_format_value_and_type_with_context(LogTemplate *self, LogMes
           t = LM_VT_STRING;
         }
 
-      e = (LogTemplateElem *) p->data;
-      if (e->text)
+      g_string_append_len(result, insn->text, insn->text_len);
+      /* concatenating literal text */
+      if (insn->text_len)
+        t = LM_VT_STRING;
+
+      switch (insn->opcode)
         {
-          g_string_append_len(result, e->text, e->text_len);
-          /* concatenating literal text */
-          if (e->text_len)
+        case LTI_LITERAL:
+          /* the empty expansion is still escaped, which makes it a string */
+          if (escape)
             t = LM_VT_STRING;
+          continue;
+        case LTI_TEXT_AND_VALUE:
+          /* fastpath: no msg_ref, no default value */
+          if (!escape)
+            {
+              log_template_append_insn_value(self, insn, messages[num_messages - 1], &t, result);
+              continue;
+            }
+          break;
+        default:
+          break;
         }
 
       /* NOTE: msg_ref is 1 larger than the index specified by the user in
@@ -173,31 +191,32 @@ log_template_append_format_value_and_type_with_context(LogTemplate *self, LogMes
        *
        * msg_ref == 0 means that the user didn't specify msg_ref
        * msg_ref >= 1 means that the user supplied the given msg_ref, 1 is equal to @0 */
-      if (e->msg_ref > num_messages)
+      if (insn->msg_ref > num_messages)
         {
           /* msg_ref out of range, we expand to empty string without evaluating the element */
           t = LM_VT_STRING;
           continue;
         }
-      msg_ndx = num_messages - e->msg_ref;
+      msg_ndx = num_messages - insn->msg_ref;
 
       /* value and macro can't understand a context, assume that no msg_ref means @0 */
-      if (e->msg_ref == 0)
+      if (insn->msg_ref == 0)
         msg_ndx--;
 
       if (escape)
         g_string_truncate(target_buffer, 0);
 
-      switch (e->type)
+      switch (insn->opcode)
         {
-        case LTE_VALUE:
-          log_template_append_elem_value(self, e, options, messages[msg_ndx], &t, target_buffer);
+        case LTI_TEXT_AND_VALUE:
+        case LTI_VALUE:
+          log_template_append_insn_value(self, insn, messages[msg_ndx], &t, target_buffer);
           break;
-        case LTE_MACRO:
-          log_template_append_elem_macro(self, e, options, messages[msg_ndx], &t, target_buffer);
+        case LTI_MACRO:
+          log_template_append_insn_macro(self, insn, options, messages[msg_ndx], &t, target_buffer);
           break;
-        case LTE_FUNC:
-          log_template_append_elem_func(self, e, options, messages, num_messages, msg_ndx, &t, target_buffer);
+        case LTI_FUNC:
+          log_template_append_insn_func(self, insn, options, messages, num_messages, msg_ndx, &t, target_buffer);
           break;
         default:
           g_assert_not_reached();
@@ -215,7 +234,7 @@ log_template_append_format_value_and_type_with_context(LogTemplate *self, LogMes
     }
   if (type)
     {
-      if (first_elem && t == LM_VT_NONE)
+      if (first_insn == end_insn && t == LM_VT_NONE)
         {
           /* empty template string, use LM_VT_STRING before applying the type-cast */
           t = LM_VT_STRING;
@@ -70,5 +70,49 @@ log_template_elem_is_literal_string(const LogTemplateElem *self)
 
 void log_template_elem_free_list(GList *el);
 
+/* opcodes of the flattened representation */
+enum
+{
+  /* literal text only */
+  LTI_LITERAL,
+  /* literal text followed by a name-value pair of the last message,
+   * without default value: the most common element in templates */
+  LTI_TEXT_AND_VALUE,
+  /* these are the generic counterparts of LTE_VALUE/LTE_MACRO/LTE_FUNC */
+  LTI_VALUE,
+  LTI_MACRO,
+  LTI_FUNC,
+};
+
+typedef struct _LogTemplateInsn
+{
+  guint8 opcode;
+  guint16 msg_ref;
+  guint32 text_len;
+  /* points into the literal pool of the program */
+  const gchar *text;
+  /* owned by the LogTemplateElem the instruction was emitted from */
+  const gchar *default_value;
+  union
+  {
+    guint macro;
+    NVHandle value_handle;
+    struct
+    {
+      LogTemplateFunction *ops;
+      gpointer state;
+    } func;
+  };
+} LogTemplateInsn;
+
+/* The instructions are followed by the literal text of all instructions,
+ * concatenated in the same order, all in a single allocation.  Function
+ * state is not copied, so the program must not outlive compiled_template. */
+struct _LogTemplateProgram
+{
+  gint num_insns;
+  LogTemplateInsn insns[0];
+};
+
 
 #endif
@@ -51,6 +51,9 @@ struct _LogTemplate
   gchar *name;
   gchar *template_str;
   GList *compiled_template;
+  /* compiled_template flattened into a single allocation, this is what
+   * gets evaluated */
+  LogTemplateProgram *program;
   GlobalConfig *cfg;
   guint top_level:1, escape:1, def_inline:1, trivial:1, literal:1;
 
@@ -377,6 +377,47 @@ Test(template_compile, test_unknown_function)
                            type = LTE_MACRO, msg_ref = 0);
 }
 
+static void
+assert_insn(const LogTemplateInsn *insn, guint8 opcode, const gchar *text)
+{
+  cr_assert_eq(insn->opcode, opcode, "Bad instruction opcode, expected=%d, actual=%d", opcode, insn->opcode);
+  cr_assert_eq(insn->text_len, strlen(text), "Bad instruction text length");
+  cr_assert_eq(memcmp(insn->text, text, insn->text_len), 0, "Bad instruction text");
+}
+
+Test(template_compile, test_program_is_flattened_into_a_contiguous_array)
+{
+  assert_template_compile("foo${APP.VALUE} bar${MESSAGE}${APP.VALUE:-default}${APP.VALUE}@1$(hello) baz");
+
+  const LogTemplateProgram *program = template->program;
+  cr_assert_eq(program->num_insns, 6);
+
+  assert_insn(&program->insns[0], LTI_TEXT_AND_VALUE, "foo");
+  cr_assert_eq(program->insns[0].value_handle, log_msg_get_value_handle("APP.VALUE"));
+  assert_insn(&program->insns[1], LTI_MACRO, " bar");
+  cr_assert_eq(program->insns[1].macro, M_MESSAGE);
+  assert_insn(&program->insns[2], LTI_VALUE, "");
+  cr_assert_str_eq(program->insns[2].default_value, "default");
+  assert_insn(&program->insns[3], LTI_VALUE, "");
+  cr_assert_eq(program->insns[3].msg_ref, 2);
+  assert_insn(&program->insns[4], LTI_FUNC, "");
+  cr_assert_eq(program->insns[4].func.ops, get_template_function_ops("hello"));
+  assert_insn(&program->insns[5], LTI_LITERAL, " baz");
+
+  /* literal text is stored back-to-back, right after the instructions */
+  cr_assert_eq(program->insns[0].text, (const gchar *) &program->insns[program->num_insns]);
+  cr_assert_eq(program->insns[1].text, program->insns[0].text + 3);
+  cr_assert_eq(program->insns[5].text, program->insns[1].text + 4);
+}
+
+Test(template_compile, test_literal_string_is_flattened)
+{
+  log_template_compile_literal_string(template, "literal");
+
+  cr_assert_eq(template->program->num_insns, 1);
+  assert_insn(&template->program->insns[0], LTI_LITERAL, "literal");
+}
+
 static void
 setup(void)
 {
@@ -54,6 +54,8 @@ Test(template_speed, test_template_speed)
   perftest_template("$(+ $FACILITY_NUM $FACILITY_NUM)\n");
   perftest_template("$DATE $FACILITY.$PRIORITY $HOST $MSGHDR$MSG $SEQNO\n");
   perftest_template("${APP.VALUE} ${APP.VALUE2}\n");
+  perftest_template("a=${APP.VALUE} b=${APP.VALUE2} c=${APP.VALUE3} d=${APP.VALUE4} e=${APP.VALUE5}\n");
+  perftest_template("${APP.VALUE}@0 ${APP.VALUE2:-default} ${APP.VALUE3}\n");
   perftest_template("$DATE ${HOST:--} ${PROGRAM:--} ${PID:--} ${MSGID:--} ${SDATA:--} $MSG\n");
 
   app_shutdown();
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include <criterion/criterion.h>
+#include "libtest/cr_template.h"
+
+#include "logpipe.h"
+#include "logmpx.h"
+#include "filter/filter-pipe.h"
+#include "filterx/filterx-pipe.h"
+#include "filterx/expr-literal.h"
+#include "filterx/object-primitive.h"
+#include "logsource.h"
+#include "apphook.h"
+
+#define NUM_MESSAGES 100
+
+typedef struct TestPipe
+{
+  LogPipe super;
+  GQueue *messages;
+  gint queue_calls;
+  gint queue_batch_calls;
+} TestPipe;
+
+static void
+test_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  TestPipe *self = (TestPipe *) s;
+
+  self->queue_calls++;
+  g_queue_push_tail(self->messages, msg);
+  log_msg_ack(msg, path_options, AT_PROCESSED);
+}
+
+static void
+test_pipe_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  TestPipe *self = (TestPipe *) s;
+
+  self->queue_batch_calls++;
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      g_queue_push_tail(self->messages, msgs[i]);
+      log_msg_ack(msgs[i], path_options, AT_PROCESSED);
+    }
+}
+
+static void
+test_pipe_free(LogPipe *s)
+{
+  TestPipe *self = (TestPipe *) s;
+
+  g_queue_free_full(self->messages, (GDestroyNotify) log_msg_unref);
+  log_pipe_free_method(s);
+}
+
+static TestPipe *
+test_pipe_new(gboolean batching)
+{
+  TestPipe *self = g_new0(TestPipe, 1);
+
+  log_pipe_init_instance(&self->super, configuration);
+  self->super.queue = test_pipe_queue;
+  if (batching)
+    self->super.queue_batch = test_pipe_queue_batch;
+  self->super.free_fn = test_pipe_free;
+  self->messages = g_queue_new();
+  cr_assert(log_pipe_init(&self->super));
+  return self;
+}
+
+static void
+test_pipe_free_instance(TestPipe *self)
+{
+  log_pipe_deinit(&self->super);
+  log_pipe_unref(&self->super);
+}
+
+static gint acked_messages;
+
+static void
+_count_acks(LogMessage *msg, AckType ack_type)
+{
+  acked_messages++;
+}
+
+static void
+_create_messages(LogMessage **msgs, gint num_msgs)
+{
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      gchar seq[2] = { 'a' + i % 26, 0 };
+
+      msgs[i] = create_sample_message();
+      msgs[i]->ack_func = _count_acks;
+      log_msg_set_value_by_name(msgs[i], "SEQ", seq, -1);
+    }
+}
+
+static void
+_assert_messages_in_order(TestPipe *pipe, LogMessage **msgs, gint num_msgs)
+{
+  cr_assert_eq(g_queue_get_length(pipe->messages), num_msgs);
+  for (gint i = 0; i < num_msgs; i++)
+    cr_assert_eq(g_queue_peek_nth(pipe->messages, i), msgs[i], "message #%d was delivered out of order", i);
+}
+
+static void
+_queue_batch(LogPipe *pipe, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  LogMessage *batch[NUM_MESSAGES];
+
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      log_msg_add_ack(msgs[i], path_options);
+      batch[i] = log_msg_ref(msgs[i]);
+    }
+  log_pipe_queue_batch(pipe, batch, num_msgs, path_options);
+}
+
+static void
+_unref_messages(LogMessage **msgs, gint num_msgs)
+{
+  for (gint i = 0; i < num_msgs; i++)
+    log_msg_unref(msgs[i]);
+}
+
+Test(logpipe_batch, test_pipe_without_queue_batch_receives_messages_one_by_one)
+{
+  TestPipe *pipe = test_pipe_new(FALSE);
+  LogMessage *msgs[NUM_MESSAGES];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  _create_messages(msgs, NUM_MESSAGES);
+  _queue_batch(&pipe->super, msgs, NUM_MESSAGES, &path_options);
+
+  cr_assert_eq(pipe->queue_calls, NUM_MESSAGES);
+  _assert_messages_in_order(pipe, msgs, NUM_MESSAGES);
+  cr_assert_eq(acked_messages, NUM_MESSAGES);
+
+  _unref_messages(msgs, NUM_MESSAGES);
+  test_pipe_free_instance(pipe);
+}
+
+Test(logpipe_batch, test_pipe_with_queue_batch_receives_the_batch_at_once)
+{
+  TestPipe *pipe = test_pipe_new(TRUE);
+  LogMessage *msgs[NUM_MESSAGES];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  _create_messages(msgs, NUM_MESSAGES);
+  _queue_batch(&pipe->super, msgs, NUM_MESSAGES, &path_options);
+
+  cr_assert_eq(pipe->queue_calls, 0);
+  cr_assert_eq(pipe->queue_batch_calls, 1);
+  _assert_messages_in_order(pipe, msgs, NUM_MESSAGES);
+  cr_assert_eq(acked_messages, NUM_MESSAGES);
+
+  _unref_messages(msgs, NUM_MESSAGES);
+  test_pipe_free_instance(pipe);
+}
+
+Test(logpipe_batch, test_batch_falls_back_to_queue_if_matched_is_requested)
+{
+  TestPipe *pipe = test_pipe_new(TRUE);
+  LogMessage *msgs[NUM_MESSAGES];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gboolean matched = TRUE;
+
+  path_options.matched = &matched;
+  _create_messages(msgs, NUM_MESSAGES);
+  _queue_batch(&pipe->super, msgs, NUM_MESSAGES, &path_options);
+
+  cr_assert_eq(pipe->queue_calls, NUM_MESSAGES);
+  cr_assert_eq(pipe->queue_batch_calls, 0);
+  _assert_messages_in_order(pipe, msgs, NUM_MESSAGES);
+
+  _unref_messages(msgs, NUM_MESSAGES);
+  test_pipe_free_instance(pipe);
+}
+
+static LogMultiplexer *
+_construct_multiplexer(TestPipe *first, TestPipe *second)
+{
+  LogMultiplexer *mpx = log_multiplexer_new(configuration);
+
+  log_multiplexer_add_next_hop(mpx, &first->super);
+  log_multiplexer_add_next_hop(mpx, &second->super);
+  cr_assert(log_pipe_init(&mpx->super));
+  return mpx;
+}
+
+static void
+_free_multiplexer(LogMultiplexer *mpx)
+{
+  log_pipe_deinit(&mpx->super);
+  log_pipe_unref(&mpx->super);
+}
+
+Test(logpipe_batch, test_multiplexer_forwards_the_batch_to_every_next_hop)
+{
+  TestPipe *first = test_pipe_new(TRUE);
+  TestPipe *second = test_pipe_new(FALSE);
+  LogMultiplexer *mpx = _construct_multiplexer(first, second);
+  LogMessage *msgs[NUM_MESSAGES];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  _create_messages(msgs, NUM_MESSAGES);
+  _queue_batch(&mpx->super, msgs, NUM_MESSAGES, &path_options);
+
+  cr_assert_gt(first->queue_batch_calls, 0);
+  cr_assert_lt(first->queue_batch_calls, NUM_MESSAGES);
+  cr_assert_eq(second->queue_calls, NUM_MESSAGES);
+  _assert_messages_in_order(first, msgs, NUM_MESSAGES);
+  _assert_messages_in_order(second, msgs, NUM_MESSAGES);
+  cr_assert_eq(acked_messages, NUM_MESSAGES, "messages should be acked once all branches acked them");
+
+  _unref_messages(msgs, NUM_MESSAGES);
+  _free_multiplexer(mpx);
+  test_pipe_free_instance(first);
+  test_pipe_free_instance(second);
+}
+
+Test(logpipe_batch, test_multiplexer_with_final_branch_delivers_messages_one_by_one)
+{
+  TestPipe *first = test_pipe_new(TRUE);
+  TestPipe *second = test_pipe_new(TRUE);
+  first->super.flags |= PIF_BRANCH_FINAL;
+  LogMultiplexer *mpx = _construct_multiplexer(first, second);
+  LogMessage *msgs[NUM_MESSAGES];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  _create_messages(msgs, NUM_MESSAGES);
+  _queue_batch(&mpx->super, msgs, NUM_MESSAGES, &path_options);
+
+  /* first is final and matches everything, so second receives nothing */
+  cr_assert_eq(first->queue_calls, NUM_MESSAGES);
+  cr_assert_eq(first->queue_batch_calls, 0);
+  _assert_messages_in_order(first, msgs, NUM_MESSAGES);
+  cr_assert_eq(g_queue_get_length(second->messages), 0);
+
+  _unref_messages(msgs, NUM_MESSAGES);
+  _free_multiplexer(mpx);
+  test_pipe_free_instance(first);
+  test_pipe_free_instance(second);
+}
+
+static gboolean
+_filter_odd_messages_eval(FilterExprNode *self, LogMessage **msgs, gint num_msg, LogTemplateEvalOptions *options)
+{
+  const gchar *seq = log_msg_get_value_by_name(msgs[num_msg - 1], "SEQ", NULL);
+
+  return ((seq[0] - 'a') % 2 == 0) ^ self->comp;
+}
+
+static FilterExprNode *
+_filter_odd_messages_new(void)
+{
+  FilterExprNode *self = g_new0(FilterExprNode, 1);
+
+  filter_expr_node_init_instance(self);
+  self->eval = _filter_odd_messages_eval;
+  return self;
+}
+
+Test(logpipe_batch, test_filter_pipe_forwards_matching_messages_as_a_batch)
+{
+  TestPipe *pipe = test_pipe_new(TRUE);
+  LogPipe *filter = log_filter_pipe_new(_filter_odd_messages_new(), configuration);
+  LogMessage *msgs[26];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  log_pipe_append(filter, &pipe->super);
+  cr_assert(log_pipe_init(filter));
+
+  _create_messages(msgs, G_N_ELEMENTS(msgs));
+  _queue_batch(filter, msgs, G_N_ELEMENTS(msgs), &path_options);
+
+  cr_assert_eq(pipe->queue_batch_calls, 1);
+  cr_assert_eq(g_queue_get_length(pipe->messages), G_N_ELEMENTS(msgs) / 2);
+  for (gint i = 0; i < G_N_ELEMENTS(msgs) / 2; i++)
+    cr_assert_eq(g_queue_peek_nth(pipe->messages, i), msgs[i * 2]);
+  cr_assert_eq(acked_messages, G_N_ELEMENTS(msgs));
+
+  _unref_messages(msgs, G_N_ELEMENTS(msgs));
+  log_pipe_deinit(filter);
+  log_pipe_unref(filter);
+  test_pipe_free_instance(pipe);
+}
+
+Test(logpipe_batch, test_filterx_pipe_forwards_messages_with_their_own_eval_context)
+{
+  TestPipe *pipe = test_pipe_new(TRUE);
+  LogPipe *filterx = log_filterx_pipe_new(filterx_literal_new(filterx_boolean_new(TRUE)), configuration);
+  LogMessage *msgs[NUM_MESSAGES];
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  log_pipe_append(filterx, &pipe->super);
+  cr_assert(log_pipe_init(filterx));
+
+  _create_messages(msgs, NUM_MESSAGES);
+  _queue_batch(filterx, msgs, NUM_MESSAGES, &path_options);
+
+  cr_assert_eq(pipe->queue_calls, NUM_MESSAGES);
+  cr_assert_eq(pipe->queue_batch_calls, 0);
+  _assert_messages_in_order(pipe, msgs, NUM_MESSAGES);
+  cr_assert_eq(acked_messages, NUM_MESSAGES);
+
+  _unref_messages(msgs, NUM_MESSAGES);
+  log_pipe_deinit(filterx);
+  log_pipe_unref(filterx);
+  test_pipe_free_instance(pipe);
+}
+
+Test(logpipe_batch, test_source_posts_tracked_messages_as_a_batch)
+{
+  LogSourceOptions source_options;
+  LogSource *source = g_new0(LogSource, 1);
+  TestPipe *pipe = test_pipe_new(TRUE);
+  LogMessage *msgs[NUM_MESSAGES];
+
+  log_source_options_defaults(&source_options);
+  source_options.init_window_size = NUM_MESSAGES;
+  log_source_init_instance(source, configuration);
+  log_source_options_init(&source_options, configuration, "test_source_group");
+  log_source_set_options(source, &source_options, "test_stats_id", NULL, FALSE, NULL);
+  log_pipe_append(&source->super, &pipe->super);
+  cr_assert(log_pipe_init(&source->super));
+
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    {
+      msgs[i] = create_sample_message();
+      log_source_track_msg(source, msgs[i]);
+    }
+  cr_assert_not(log_source_free_to_send(source), "tracked messages should take their slots of the window");
+
+  log_source_post_batch(source, msgs, NUM_MESSAGES);
+
+  cr_assert_eq(pipe->queue_calls, 0);
+  cr_assert_eq(pipe->queue_batch_calls, 1);
+  _assert_messages_in_order(pipe, msgs, NUM_MESSAGES);
+  cr_assert_eq(window_size_counter_get(&source->window_size, NULL), NUM_MESSAGES,
+               "acking the messages should return the window");
+
+  log_pipe_deinit(&source->super);
+  log_pipe_unref(&source->super);
+  log_source_options_destroy(&source_options);
+  test_pipe_free_instance(pipe);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+  cr_assert(cfg_init(configuration));
+  acked_messages = 0;
+}
+
+static void
+teardown(void)
+{
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(logpipe_batch, .init = setup, .fini = teardown);
@@ -262,6 +262,112 @@ Test(logqueue, test_with_threads)
   fprintf(stderr, "Feed speed: %.2lf\n", (double) TEST_RUNS * MESSAGES_SUM * 1000000 / sum_time);
 }
 
+#define WAIT_QUEUE_PRODUCERS 4
+
+static gpointer
+_threaded_feed_wait_queue(gpointer args)
+{
+  LogQueue *q = args;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  /* acks would be delivered from multiple threads for dropped messages */
+  path_options.ack_needed = FALSE;
+
+  /* no main_loop_worker_thread_start(): there is no per-thread input
+   * queue, every message goes directly to the wait queue */
+  for (gint i = 0; i < MESSAGES_PER_FEEDER; i++)
+    log_queue_push_tail(q, log_msg_new_empty(), &path_options);
+
+  return NULL;
+}
+
+static gpointer
+_threaded_consume_with_rewinds(gpointer args)
+{
+  LogQueue *q = args;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint msg_count = 0;
+  gint slept = 0;
+
+  while (msg_count < WAIT_QUEUE_PRODUCERS * MESSAGES_PER_FEEDER)
+    {
+      LogMessage *msg = log_queue_pop_head(q, &path_options);
+      if (!msg)
+        {
+          struct timespec ns = { 0, 1000000 };
+
+          nanosleep(&ns, NULL);
+          if (++slept > 10000)
+            return GUINT_TO_POINTER(1);
+          continue;
+        }
+      log_msg_unref(msg);
+
+      /* every now and then put the message back, it must not be lost or duplicated */
+      if ((msg_count & 0x3F) == 0)
+        {
+          log_queue_rewind_backlog(q, 1);
+          msg = log_queue_pop_head(q, &path_options);
+          if (!msg)
+            return GUINT_TO_POINTER(2);
+          log_msg_unref(msg);
+        }
+
+      log_queue_ack_backlog(q, 1);
+      msg_count++;
+    }
+  return NULL;
+}
+
+Test(logqueue, log_queue_fifo_wait_queue_with_concurrent_producers)
+{
+  GThread *producers[WAIT_QUEUE_PRODUCERS];
+
+  StatsClusterKeyBuilder *driver_sck_builder = stats_cluster_key_builder_new();
+  StatsClusterKeyBuilder *queue_sck_builder = stats_cluster_key_builder_new();
+  LogQueue *q = log_queue_fifo_new(WAIT_QUEUE_PRODUCERS * MESSAGES_PER_FEEDER, NULL, STATS_LEVEL0, driver_sck_builder, queue_sck_builder);
+  stats_cluster_key_builder_free(driver_sck_builder);
+  stats_cluster_key_builder_free(queue_sck_builder);
+
+  GThread *consumer = g_thread_new(NULL, _threaded_consume_with_rewinds, q);
+  for (gint i = 0; i < WAIT_QUEUE_PRODUCERS; i++)
+    producers[i] = g_thread_new(NULL, _threaded_feed_wait_queue, q);
+
+  for (gint i = 0; i < WAIT_QUEUE_PRODUCERS; i++)
+    g_thread_join(producers[i]);
+  cr_assert_null(g_thread_join(consumer), "consumer lost messages on the wait queue");
+
+  cr_assert_eq(stats_counter_get(q->metrics.shared.dropped_messages), 0);
+  cr_assert_eq(log_queue_get_length(q), 0);
+
+  log_queue_unref(q);
+}
+
+Test(logqueue, log_queue_fifo_wait_queue_respects_fifo_size)
+{
+  const gint fifo_size = 100;
+  GThread *producers[WAIT_QUEUE_PRODUCERS];
+  StatsClusterKeyBuilder *driver_sck_builder = stats_cluster_key_builder_new();
+  StatsClusterKeyBuilder *queue_sck_builder = stats_cluster_key_builder_new();
+  LogQueue *q = log_queue_fifo_new(fifo_size, NULL, STATS_LEVEL0, driver_sck_builder, queue_sck_builder);
+  stats_cluster_key_builder_free(driver_sck_builder);
+  stats_cluster_key_builder_free(queue_sck_builder);
+
+  for (gint i = 0; i < WAIT_QUEUE_PRODUCERS; i++)
+    producers[i] = g_thread_new(NULL, _threaded_feed_wait_queue, q);
+  for (gint i = 0; i < WAIT_QUEUE_PRODUCERS; i++)
+    g_thread_join(producers[i]);
+
+  cr_assert_eq(log_queue_get_length(q), fifo_size);
+  cr_assert_eq(stats_counter_get(q->metrics.shared.dropped_messages),
+               WAIT_QUEUE_PRODUCERS * MESSAGES_PER_FEEDER - fifo_size);
+
+  send_some_messages(q, fifo_size, TRUE);
+  cr_assert_eq(log_queue_get_length(q), 0);
+
+  log_queue_unref(q);
+}
+
 Test(logqueue, log_queue_fifo_rewind_all_and_memory_usage)
 {
   StatsClusterKeyBuilder *driver_sck_builder = stats_cluster_key_builder_new();
@@ -40,6 +40,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+/*
+ * modules/syslogformat/tests builds this file once more for each scanner
+ * implementation of the syslog parser, with MSGPARSE_SCAN_IMPL set to it.
+ */
+#ifdef MSGPARSE_SCAN_IMPL
+#include "syslog-format-scan.h"
+#endif
+
 struct sdata_pair
 {
   const gchar *name;
@@ -132,6 +140,10 @@ setup(void)
   setenv("TZ", "MET-1METDST", TRUE);
   tzset();
   init_parse_options_and_load_syslogformat(&parse_options);
+#ifdef MSGPARSE_SCAN_IMPL
+  if (!syslog_format_scan_select_impl(MSGPARSE_SCAN_IMPL))
+    cr_skip_test("scanner implementation is not supported on this CPU");
+#endif
   /* Fri Feb  8 09:37:49 CET 2019 */
   fake_time(1549615069);
 }
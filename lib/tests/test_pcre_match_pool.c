@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include <criterion/criterion.h>
+
+#include "pcre-match-pool.h"
+#include "apphook.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+#include <string.h>
+
+static StatsOptions stats_options;
+
+typedef struct _PcreMatchPoolCounters
+{
+  StatsClusterKey evaluations_key;
+  StatsClusterKey jit_misses_key;
+  StatsClusterLabel label;
+  StatsCounterItem *evaluations;
+  StatsCounterItem *jit_misses;
+} PcreMatchPoolCounters;
+
+static void
+_lookup_counters(PcreMatchPoolCounters *counters, const gchar *subsystem)
+{
+  counters->label = stats_cluster_label("subsystem", subsystem);
+
+  stats_lock();
+  stats_cluster_single_key_set(&counters->evaluations_key, "regexp_evaluations_total", &counters->label, 1);
+  stats_register_counter(1, &counters->evaluations_key, SC_TYPE_SINGLE_VALUE, &counters->evaluations);
+  stats_cluster_single_key_set(&counters->jit_misses_key, "regexp_jit_misses_total", &counters->label, 1);
+  stats_register_counter(1, &counters->jit_misses_key, SC_TYPE_SINGLE_VALUE, &counters->jit_misses);
+  stats_unlock();
+
+  cr_assert_not_null(counters->evaluations);
+  cr_assert_not_null(counters->jit_misses);
+}
+
+static void
+_release_counters(PcreMatchPoolCounters *counters)
+{
+  stats_lock();
+  stats_unregister_counter(&counters->evaluations_key, SC_TYPE_SINGLE_VALUE, &counters->evaluations);
+  stats_unregister_counter(&counters->jit_misses_key, SC_TYPE_SINGLE_VALUE, &counters->jit_misses);
+  stats_unlock();
+}
+
+static void
+_assert_counters(PcreMatchPoolCounters *counters, gsize evaluations, gsize jit_misses)
+{
+  cr_assert_eq(stats_counter_get(counters->evaluations), evaluations,
+               "regexp_evaluations_total mismatch; value=%" G_GSIZE_FORMAT ", expected=%" G_GSIZE_FORMAT,
+               stats_counter_get(counters->evaluations), evaluations);
+  cr_assert_eq(stats_counter_get(counters->jit_misses), jit_misses,
+               "regexp_jit_misses_total mismatch; value=%" G_GSIZE_FORMAT ", expected=%" G_GSIZE_FORMAT,
+               stats_counter_get(counters->jit_misses), jit_misses);
+}
+
+static pcre2_code *
+_compile(const gchar *pattern)
+{
+  gint rc;
+  PCRE2_SIZE error_offset;
+
+  pcre2_code *compiled = pcre2_compile((PCRE2_SPTR) pattern, PCRE2_ZERO_TERMINATED, 0, &rc, &error_offset, NULL);
+  cr_assert_not_null(compiled);
+  return compiled;
+}
+
+Test(pcre_match_pool, test_match_data_is_sized_for_the_pattern)
+{
+  pcre2_code *pattern = _compile("(a)(b)(c)");
+
+  pcre2_match_data *match_data = pcre_match_pool_acquire(pattern);
+  cr_assert_eq(pcre2_get_ovector_count(match_data), 4);
+  pcre_match_pool_release(match_data);
+
+  pcre2_code_free(pattern);
+}
+
+Test(pcre_match_pool, test_released_match_data_is_reused)
+{
+  pcre2_code *pattern = _compile("(foo)");
+  pcre2_code *other_pattern = _compile("(bar)");
+
+  pcre2_match_data *match_data = pcre_match_pool_acquire(pattern);
+  pcre2_match_data *nested_match_data = pcre_match_pool_acquire(other_pattern);
+  cr_assert_neq(match_data, nested_match_data);
+
+  pcre_match_pool_release(nested_match_data);
+  pcre_match_pool_release(match_data);
+
+  /* the same capture count can share match data, regardless of the pattern */
+  cr_assert_eq(pcre_match_pool_acquire(other_pattern), nested_match_data);
+  pcre_match_pool_release(nested_match_data);
+
+  pcre2_code_free(other_pattern);
+  pcre2_code_free(pattern);
+}
+
+Test(pcre_match_pool, test_match_with_pooled_match_data)
+{
+  pcre2_code *pattern = _compile("(\\w+)=(\\w+)");
+  const gchar *subject = "foo bar=baz";
+  PcreMatchPoolCounters filterx_counters = { 0 };
+  PcreMatchPoolCounters logmatcher_counters = { 0 };
+  gsize expected_jit_misses = 0;
+
+  _lookup_counters(&filterx_counters, "filterx");
+  _lookup_counters(&logmatcher_counters, "logmatcher");
+
+  for (gint jit = 0; jit < 2; jit++)
+    {
+      /* every evaluation is a miss if JIT is not supported by the pcre2 library */
+      if (!jit || pcre2_jit_compile(pattern, PCRE2_JIT_COMPLETE) != 0)
+        expected_jit_misses++;
+
+      pcre2_match_data *match_data = pcre_match_pool_acquire(pattern);
+      gint rc = pcre_match_pool_match(PCRE_MATCH_POOL_FILTERX, pattern, subject, strlen(subject), 0, 0, match_data);
+      cr_assert_eq(rc, 3);
+      _assert_counters(&filterx_counters, jit + 1, expected_jit_misses);
+      /* the counters of the other subsystem are not touched */
+      cr_assert_eq(stats_counter_get(logmatcher_counters.evaluations), jit);
+
+      PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(match_data);
+      cr_assert_eq(ovector[2], 4);
+      cr_assert_eq(ovector[3], 7);
+      cr_assert_eq(ovector[4], 8);
+      cr_assert_eq(ovector[5], 11);
+
+      rc = pcre_match_pool_match(PCRE_MATCH_POOL_LOGMATCHER, pattern, subject, 3, 0, 0, match_data);
+      cr_assert_eq(rc, PCRE2_ERROR_NOMATCH);
+      _assert_counters(&filterx_counters, jit + 1, expected_jit_misses);
+      _assert_counters(&logmatcher_counters, jit + 1, expected_jit_misses);
+      pcre_match_pool_release(match_data);
+    }
+
+  _release_counters(&logmatcher_counters);
+  _release_counters(&filterx_counters);
+  pcre2_code_free(pattern);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  stats_options_defaults(&stats_options);
+  stats_options.level = 1;
+  stats_reinit(&stats_options);
+  pcre_match_pool_register_stats();
+}
+
+static void
+teardown(void)
+{
+  pcre_match_pool_unregister_stats();
+  app_shutdown();
+}
+
+TestSuite(pcre_match_pool, .init = setup, .fini = teardown);
@@ -100,6 +100,13 @@ static void
 _add_context_data_to_message(gpointer pmsg, const ContextualDataRecord *record)
 {
   LogMessage *msg = (LogMessage *) pmsg;
+
+  if (!record->value)
+    {
+      log_msg_set_value_with_type(msg, record->value_handle, record->literal_value, -1, LM_VT_STRING);
+      return;
+    }
+
   GString *result = scratch_buffers_alloc();
   LogMessageValueType type;
 
@@ -190,34 +197,39 @@ _complete_relative_path_with_config_path(const gchar *filename)
                      filename, NULL);
 }
 
+static gchar *
+_resolve_data_file_path(const gchar *filename)
+{
+  if (_is_relative_path(filename))
+    return _complete_relative_path_with_config_path(filename);
+
+  return g_strdup(filename);
+}
+
 static FILE *
 _open_data_file(const gchar *filename)
 {
-  FILE *f = NULL;
-
-  if (_is_relative_path(filename))
-    {
-      gchar *absolute_path =
-        _complete_relative_path_with_config_path(filename);
-      f = fopen(absolute_path, "r");
-      g_free(absolute_path);
-    }
-  else
-    {
-      f = fopen(filename, "r");
-    }
+  gchar *path = _resolve_data_file_path(filename);
+  FILE *f = fopen(path, "r");
 
+  g_free(path);
   return f;
 }
 
+static gboolean
+_is_precompiled_database(AddContextualData *self)
+{
+  return g_strcmp0(get_filename_extension(self->filename), "ctxdb") == 0;
+}
+
 static ContextualDataRecordScanner *
 _get_scanner(AddContextualData *self)
 {
   const gchar *type = get_filename_extension(self->filename);
 
-  if (g_strcmp0(type, "csv") != 0)
+  if (g_strcmp0(type, "csv") != 0 && g_strcmp0(type, "ctxdb") != 0)
     {
-      msg_error("add-contextual-data(): unknown file extension, only files with a .csv extension are supported",
+      msg_error("add-contextual-data(): unknown file extension, only files with a .csv or .ctxdb extension are supported",
                 evt_tag_str("filename", self->filename));
       return NULL;
     }
@@ -225,6 +237,24 @@ _get_scanner(AddContextualData *self)
   return contextual_data_record_scanner_new(log_pipe_get_config(&self->super.super), self->prefix);
 }
 
+static gboolean
+_load_precompiled_context_info_db(AddContextualData *self, ContextualDataRecordScanner *scanner)
+{
+  gchar *path = _resolve_data_file_path(self->filename);
+  GError *error = NULL;
+  gboolean result = context_info_db_import_mapped(self->context_info_db, path, scanner, &error);
+
+  if (!result)
+    {
+      msg_error("add-contextual-data(): Error loading precompiled database",
+                evt_tag_str("filename", self->filename),
+                evt_tag_str("error", error->message));
+      g_clear_error(&error);
+    }
+  g_free(path);
+  return result;
+}
+
 static gboolean
 _load_context_info_db(AddContextualData *self)
 {
@@ -235,6 +265,9 @@ _load_context_info_db(AddContextualData *self)
   if (!(scanner = _get_scanner(self)))
     goto error;
 
+  if (_is_precompiled_database(self))
+    return _load_precompiled_context_info_db(self, scanner);
+
   f = _open_data_file(self->filename);
   if (!f)
     {
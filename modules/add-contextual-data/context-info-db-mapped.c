@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "context-info-db-mapped.h"
+
+#include <string.h>
+
+GQuark
+context_info_db_mapped_error_quark(void)
+{
+  return g_quark_from_static_string("context-info-db-mapped-error-quark");
+}
+
+static gint
+_compare_selectors(const gchar *a, const gchar *b, gboolean ignore_case)
+{
+  return ignore_case ? g_ascii_strcasecmp(a, b) : strcmp(a, b);
+}
+
+/*
+ * Reader
+ *
+ * The file is mapped read-only and is never copied, selectors are looked
+ * up using a binary search on the sorted selector array and every string
+ * is returned as a pointer into the mapping.  The file is validated once
+ * when opened, so lookups don't need to check offsets.
+ */
+
+struct _ContextInfoDBMapped
+{
+  GMappedFile *file;
+  const ContextInfoDBMappedHeader *header;
+  const ContextInfoDBMappedSelector *selectors;
+  const guint32 *selector_order;
+  const guint32 *names;
+  const ContextInfoDBMappedRecord *records;
+  const ContextInfoDBMappedTemplate *templates;
+  const gchar *strings;
+  gboolean ignore_case;
+};
+
+static gboolean
+_is_section_valid(gsize file_length, guint32 offset, guint32 num_elements, gsize element_size)
+{
+  if (offset % sizeof(guint32) != 0)
+    return FALSE;
+  if (offset > file_length)
+    return FALSE;
+  return num_elements <= (file_length - offset) / element_size;
+}
+
+static gboolean
+_is_string_valid(ContextInfoDBMapped *self, guint32 offset)
+{
+  return offset < self->header->strings_length;
+}
+
+static gboolean
+_validate_header(ContextInfoDBMapped *self, gsize file_length)
+{
+  const ContextInfoDBMappedHeader *header = self->header;
+
+  if (file_length < sizeof(*header) ||
+      memcmp(header->magic, CONTEXT_INFO_DB_MAPPED_MAGIC, sizeof(header->magic)) != 0)
+    return FALSE;
+
+  if (header->byte_order_mark != CONTEXT_INFO_DB_MAPPED_BYTE_ORDER_MARK ||
+      header->version != CONTEXT_INFO_DB_MAPPED_VERSION)
+    return FALSE;
+
+  if (!_is_section_valid(file_length, header->selectors_offset, header->num_selectors,
+                         sizeof(ContextInfoDBMappedSelector)) ||
+      !_is_section_valid(file_length, header->selector_order_offset, header->num_selectors, sizeof(guint32)) ||
+      !_is_section_valid(file_length, header->names_offset, header->num_names, sizeof(guint32)) ||
+      !_is_section_valid(file_length, header->records_offset, header->num_records,
+                         sizeof(ContextInfoDBMappedRecord)) ||
+      !_is_section_valid(file_length, header->templates_offset, header->num_templates,
+                         sizeof(ContextInfoDBMappedTemplate)))
+    return FALSE;
+
+  /* the string pool is not aligned, the last string needs to be terminated */
+  if (header->strings_offset > file_length || header->strings_length > file_length - header->strings_offset)
+    return FALSE;
+  if (header->strings_length > 0 && self->strings[header->strings_length - 1] != '\0')
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+_validate_contents(ContextInfoDBMapped *self)
+{
+  const ContextInfoDBMappedHeader *header = self->header;
+
+  for (guint32 i = 0; i < header->num_selectors; i++)
+    {
+      const ContextInfoDBMappedSelector *selector = &self->selectors[i];
+
+      if (!_is_string_valid(self, selector->selector) ||
+          selector->first_record > header->num_records ||
+          selector->num_records > header->num_records - selector->first_record)
+        return FALSE;
+
+      if (i > 0 && _compare_selectors(self->strings + self->selectors[i - 1].selector,
+                                      self->strings + selector->selector, self->ignore_case) >= 0)
+        return FALSE;
+
+      if (self->selector_order[i] >= header->num_selectors)
+        return FALSE;
+    }
+
+  for (guint32 i = 0; i < header->num_names; i++)
+    {
+      if (!_is_string_valid(self, self->names[i]))
+        return FALSE;
+    }
+
+  for (guint32 i = 0; i < header->num_records; i++)
+    {
+      const ContextInfoDBMappedRecord *record = &self->records[i];
+
+      if (record->name >= header->num_names || !_is_string_valid(self, record->value))
+        return FALSE;
+
+      if (record->template != CONTEXT_INFO_DB_MAPPED_LITERAL &&
+          (record->template >= header->num_templates || self->templates[record->template].record != i))
+        return FALSE;
+    }
+
+  for (guint32 i = 0; i < header->num_templates; i++)
+    {
+      const ContextInfoDBMappedTemplate *template = &self->templates[i];
+
+      if (template->selector >= header->num_selectors || template->record >= header->num_records ||
+          self->records[template->record].template != i)
+        return FALSE;
+
+      const ContextInfoDBMappedSelector *selector = &self->selectors[template->selector];
+      if (template->record < selector->first_record ||
+          template->record - selector->first_record >= selector->num_records)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+ContextInfoDBMapped *
+context_info_db_mapped_open(const gchar *filename, GError **error)
+{
+  GMappedFile *file = g_mapped_file_new(filename, FALSE, error);
+
+  if (!file)
+    return NULL;
+
+  ContextInfoDBMapped *self = g_new0(ContextInfoDBMapped, 1);
+  const gchar *contents = g_mapped_file_get_contents(file);
+  gsize file_length = g_mapped_file_get_length(file);
+
+  self->file = file;
+  self->header = (const ContextInfoDBMappedHeader *) contents;
+
+  if (!contents || file_length < sizeof(ContextInfoDBMappedHeader))
+    goto invalid;
+
+  self->selectors = (const ContextInfoDBMappedSelector *) (contents + self->header->selectors_offset);
+  self->selector_order = (const guint32 *) (contents + self->header->selector_order_offset);
+  self->names = (const guint32 *) (contents + self->header->names_offset);
+  self->records = (const ContextInfoDBMappedRecord *) (contents + self->header->records_offset);
+  self->templates = (const ContextInfoDBMappedTemplate *) (contents + self->header->templates_offset);
+  self->strings = contents + self->header->strings_offset;
+  self->ignore_case = !!(self->header->flags & CONTEXT_INFO_DB_MAPPED_IGNORE_CASE);
+
+  if (!_validate_header(self, file_length) || !_validate_contents(self))
+    goto invalid;
+
+  return self;
+
+invalid:
+  g_set_error(error, CONTEXT_INFO_DB_MAPPED_ERROR, CONTEXT_INFO_DB_MAPPED_ERROR_FORMAT,
+              "%s is not a valid precompiled contextual data file, or it was created by an incompatible version "
+              "or on a platform with a different byte order", filename);
+  context_info_db_mapped_close(self);
+  return NULL;
+}
+
+void
+context_info_db_mapped_close(ContextInfoDBMapped *self)
+{
+  g_mapped_file_unref(self->file);
+  g_free(self);
+}
+
+gboolean
+context_info_db_mapped_is_ignore_case(ContextInfoDBMapped *self)
+{
+  return self->ignore_case;
+}
+
+guint32
+context_info_db_mapped_number_of_selectors(ContextInfoDBMapped *self)
+{
+  return self->header->num_selectors;
+}
+
+guint32
+context_info_db_mapped_number_of_records(ContextInfoDBMapped *self)
+{
+  return self->header->num_records;
+}
+
+guint32
+context_info_db_mapped_number_of_names(ContextInfoDBMapped *self)
+{
+  return self->header->num_names;
+}
+
+guint32
+context_info_db_mapped_number_of_templates(ContextInfoDBMapped *self)
+{
+  return self->header->num_templates;
+}
+
+gint64
+context_info_db_mapped_lookup(ContextInfoDBMapped *self, const gchar *selector)
+{
+  guint32 lo = 0;
+  guint32 hi = self->header->num_selectors;
+
+  while (lo < hi)
+    {
+      guint32 mid = lo + (hi - lo) / 2;
+      gint cmp = _compare_selectors(selector, self->strings + self->selectors[mid].selector, self->ignore_case);
+
+      if (cmp == 0)
+        return mid;
+      if (cmp < 0)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+  return -1;
+}
+
+const gchar *
+context_info_db_mapped_get_selector(ContextInfoDBMapped *self, guint32 selector_ndx)
+{
+  g_assert(selector_ndx < self->header->num_selectors);
+  return self->strings + self->selectors[selector_ndx].selector;
+}
+
+guint32
+context_info_db_mapped_get_ordered_selector(ContextInfoDBMapped *self, guint32 order_ndx)
+{
+  g_assert(order_ndx < self->header->num_selectors);
+  return self->selector_order[order_ndx];
+}
+
+guint32
+context_info_db_mapped_number_of_selector_records(ContextInfoDBMapped *self, guint32 selector_ndx)
+{
+  g_assert(selector_ndx < self->header->num_selectors);
+  return self->selectors[selector_ndx].num_records;
+}
+
+void
+context_info_db_mapped_get_record(ContextInfoDBMapped *self, guint32 selector_ndx, guint32 record_ndx,
+                                  guint32 *name_ndx, const gchar **value, guint32 *template_ndx)
+{
+  const ContextInfoDBMappedSelector *selector = &self->selectors[selector_ndx];
+
+  g_assert(selector_ndx < self->header->num_selectors && record_ndx < selector->num_records);
+
+  const ContextInfoDBMappedRecord *record = &self->records[selector->first_record + record_ndx];
+  *name_ndx = record->name;
+  *value = self->strings + record->value;
+  *template_ndx = record->template;
+}
+
+const gchar *
+context_info_db_mapped_get_name(ContextInfoDBMapped *self, guint32 name_ndx)
+{
+  g_assert(name_ndx < self->header->num_names);
+  return self->strings + self->names[name_ndx];
+}
+
+void
+context_info_db_mapped_get_template(ContextInfoDBMapped *self, guint32 template_ndx,
+                                    const gchar **selector, const gchar **name, const gchar **value)
+{
+  g_assert(template_ndx < self->header->num_templates);
+
+  const ContextInfoDBMappedTemplate *template = &self->templates[template_ndx];
+  const ContextInfoDBMappedRecord *record = &self->records[template->record];
+
+  *selector = self->strings + self->selectors[template->selector].selector;
+  *name = self->strings + self->names[record->name];
+  *value = self->strings + record->value;
+}
+
+/*
+ * Writer
+ */
+
+typedef struct _WriterSelector
+{
+  guint32 selector;
+  guint32 sorted_ndx;
+  GArray *records;
+} WriterSelector;
+
+struct _ContextInfoDBMappedWriter
+{
+  gboolean ignore_case;
+  GString *strings;
+  GHashTable *string_offsets;
+  GHashTable *selectors_by_key;
+  /* in the order of their first appearance */
+  GPtrArray *selectors;
+  GArray *names;
+  GHashTable *name_indexes;
+  guint32 num_records;
+  guint32 num_templates;
+};
+
+static void
+_writer_selector_free(WriterSelector *selector)
+{
+  g_array_free(selector->records, TRUE);
+  g_free(selector);
+}
+
+static guint32
+_writer_intern_string(ContextInfoDBMappedWriter *self, const gchar *str)
+{
+  gpointer offset;
+
+  if (g_hash_table_lookup_extended(self->string_offsets, str, NULL, &offset))
+    return GPOINTER_TO_UINT(offset);
+
+  guint32 new_offset = self->strings->len;
+  g_string_append_len(self->strings, str, strlen(str) + 1);
+  g_hash_table_insert(self->string_offsets, g_strdup(str), GUINT_TO_POINTER(new_offset));
+  return new_offset;
+}
+
+static guint32
+_writer_intern_name(ContextInfoDBMappedWriter *self, const gchar *name)
+{
+  gpointer ndx;
+
+  if (g_hash_table_lookup_extended(self->name_indexes, name, NULL, &ndx))
+    return GPOINTER_TO_UINT(ndx);
+
+  guint32 offset = _writer_intern_string(self, name);
+  guint32 new_ndx = self->names->len;
+
+  g_array_append_val(self->names, offset);
+  g_hash_table_insert(self->name_indexes, g_strdup(name), GUINT_TO_POINTER(new_ndx));
+  return new_ndx;
+}
+
+/* Whether the value is a literal string regardless of the @version and
+ * typing settings of the configuration loading the file: no $ references,
+ * no type-cast and no backslash, which used to be an escape character. */
+static gboolean
+_is_literal_value(const gchar *value)
+{
+  return strpbrk(value, "$(\\") == NULL;
+}
+
+static WriterSelector *
+_writer_lookup_selector(ContextInfoDBMappedWriter *self, const gchar *selector_str)
+{
+  gchar *key = self->ignore_case ? g_ascii_strdown(selector_str, -1) : g_strdup(selector_str);
+  WriterSelector *selector = g_hash_table_lookup(self->selectors_by_key, key);
+
+  if (selector)
+    {
+      g_free(key);
+      return selector;
+    }
+
+  selector = g_new0(WriterSelector, 1);
+  selector->selector = _writer_intern_string(self, selector_str);
+  selector->records = g_array_new(FALSE, FALSE, sizeof(ContextInfoDBMappedRecord));
+  g_hash_table_insert(self->selectors_by_key, key, selector);
+  g_ptr_array_add(self->selectors, selector);
+  return selector;
+}
+
+void
+context_info_db_mapped_writer_add(ContextInfoDBMappedWriter *self,
+                                  const gchar *selector_str, const gchar *name, const gchar *value)
+{
+  WriterSelector *selector = _writer_lookup_selector(self, selector_str);
+  gboolean is_template = !_is_literal_value(value);
+  ContextInfoDBMappedRecord record =
+  {
+    .name = _writer_intern_name(self, name),
+    .value = _writer_intern_string(self, value),
+    /* the index is assigned when the records are sorted by selector */
+    .template = is_template ? 0 : CONTEXT_INFO_DB_MAPPED_LITERAL,
+  };
+
+  g_array_append_val(selector->records, record);
+  self->num_records++;
+  if (is_template)
+    self->num_templates++;
+}
+
+static gint
+_writer_compare_selectors(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  ContextInfoDBMappedWriter *self = (ContextInfoDBMappedWriter *) user_data;
+  const WriterSelector *s1 = *(const WriterSelector **) a;
+  const WriterSelector *s2 = *(const WriterSelector **) b;
+
+  return _compare_selectors(self->strings->str + s1->selector, self->strings->str + s2->selector,
+                            self->ignore_case);
+}
+
+static void
+_append_uint32(GString *buffer, guint32 value)
+{
+  g_string_append_len(buffer, (const gchar *) &value, sizeof(value));
+}
+
+gboolean
+context_info_db_mapped_writer_write(ContextInfoDBMappedWriter *self, const gchar *filename, GError **error)
+{
+  guint64 num_selectors = self->selectors->len;
+  guint64 selectors_offset = sizeof(ContextInfoDBMappedHeader);
+  guint64 selector_order_offset = selectors_offset + num_selectors * sizeof(ContextInfoDBMappedSelector);
+  guint64 names_offset = selector_order_offset + num_selectors * sizeof(guint32);
+  guint64 records_offset = names_offset + (guint64) self->names->len * sizeof(guint32);
+  guint64 templates_offset = records_offset + (guint64) self->num_records * sizeof(ContextInfoDBMappedRecord);
+  guint64 strings_offset = templates_offset + (guint64) self->num_templates * sizeof(ContextInfoDBMappedTemplate);
+
+  if (strings_offset + self->strings->len > G_MAXUINT32)
+    {
+      g_set_error(error, CONTEXT_INFO_DB_MAPPED_ERROR, CONTEXT_INFO_DB_MAPPED_ERROR_TOO_LARGE,
+                  "the database is too large to be stored in a precompiled contextual data file");
+      return FALSE;
+    }
+
+  GPtrArray *sorted = g_ptr_array_sized_new(num_selectors);
+  for (guint32 i = 0; i < num_selectors; i++)
+    g_ptr_array_add(sorted, g_ptr_array_index(self->selectors, i));
+  g_ptr_array_sort_with_data(sorted, _writer_compare_selectors, self);
+
+  ContextInfoDBMappedHeader header =
+  {
+    .byte_order_mark = CONTEXT_INFO_DB_MAPPED_BYTE_ORDER_MARK,
+    .version = CONTEXT_INFO_DB_MAPPED_VERSION,
+    .flags = self->ignore_case ? CONTEXT_INFO_DB_MAPPED_IGNORE_CASE : 0,
+    .num_selectors = num_selectors,
+    .num_records = self->num_records,
+    .num_names = self->names->len,
+    .num_templates = self->num_templates,
+    .selectors_offset = selectors_offset,
+    .selector_order_offset = selector_order_offset,
+    .names_offset = names_offset,
+    .records_offset = records_offset,
+    .templates_offset = templates_offset,
+    .strings_offset = strings_offset,
+    .strings_length = self->strings->len,
+  };
+  memcpy(header.magic, CONTEXT_INFO_DB_MAPPED_MAGIC, sizeof(header.magic));
+
+  GString *buffer = g_string_sized_new(strings_offset + self->strings->len);
+  g_string_append_len(buffer, (const gchar *) &header, sizeof(header));
+
+  guint32 first_record = 0;
+  for (guint32 i = 0; i < num_selectors; i++)
+    {
+      WriterSelector *selector = g_ptr_array_index(sorted, i);
+
+      selector->sorted_ndx = i;
+      _append_uint32(buffer, selector->selector);
+      _append_uint32(buffer, first_record);
+      _append_uint32(buffer, selector->records->len);
+      first_record += selector->records->len;
+    }
+
+  for (guint32 i = 0; i < num_selectors; i++)
+    _append_uint32(buffer, ((WriterSelector *) g_ptr_array_index(self->selectors, i))->sorted_ndx);
+
+  g_string_append_len(buffer, self->names->data, self->names->len * sizeof(guint32));
+
+  GArray *templates = g_array_sized_new(FALSE, FALSE, sizeof(ContextInfoDBMappedTemplate), self->num_templates);
+  guint32 record_ndx = 0;
+  for (guint32 i = 0; i < num_selectors; i++)
+    {
+      WriterSelector *selector = g_ptr_array_index(sorted, i);
+
+      for (guint32 j = 0; j < selector->records->len; j++, record_ndx++)
+        {
+          ContextInfoDBMappedRecord *record = &g_array_index(selector->records, ContextInfoDBMappedRecord, j);
+          guint32 template_ndx = CONTEXT_INFO_DB_MAPPED_LITERAL;
+
+          if (record->template != CONTEXT_INFO_DB_MAPPED_LITERAL)
+            {
+              ContextInfoDBMappedTemplate template = { .selector = i, .record = record_ndx };
+
+              template_ndx = templates->len;
+              g_array_append_val(templates, template);
+            }
+
+          _append_uint32(buffer, record->name);
+          _append_uint32(buffer, record->value);
+          _append_uint32(buffer, template_ndx);
+        }
+    }
+
+  g_assert(templates->len == self->num_templates);
+  g_string_append_len(buffer, templates->data, templates->len * sizeof(ContextInfoDBMappedTemplate));
+  g_array_free(templates, TRUE);
+
+  g_assert(buffer->len == strings_offset);
+  g_string_append_len(buffer, self->strings->str, self->strings->len);
+
+  /* replaces the file atomically, so a running syslog-ng that still has the
+   * previous version mapped is not affected */
+  gboolean result = g_file_set_contents(filename, buffer->str, buffer->len, error);
+
+  g_string_free(buffer, TRUE);
+  g_ptr_array_free(sorted, TRUE);
+  return result;
+}
+
+ContextInfoDBMappedWriter *
+context_info_db_mapped_writer_new(gboolean ignore_case)
+{
+  ContextInfoDBMappedWriter *self = g_new0(ContextInfoDBMappedWriter, 1);
+
+  self->ignore_case = ignore_case;
+  self->strings = g_string_new(NULL);
+  self->string_offsets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  self->selectors_by_key = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  self->selectors = g_ptr_array_new_with_free_func((GDestroyNotify) _writer_selector_free);
+  self->names = g_array_new(FALSE, FALSE, sizeof(guint32));
+  self->name_indexes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  return self;
+}
+
+void
+context_info_db_mapped_writer_free(ContextInfoDBMappedWriter *self)
+{
+  g_ptr_array_free(self->selectors, TRUE);
+  g_hash_table_unref(self->name_indexes);
+  g_array_free(self->names, TRUE);
+  g_hash_table_unref(self->selectors_by_key);
+  g_hash_table_unref(self->string_offsets);
+  g_string_free(self->strings, TRUE);
+  g_free(self);
+}
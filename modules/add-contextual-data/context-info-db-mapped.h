@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef CONTEXT_INFO_DB_MAPPED_H_INCLUDED
+#define CONTEXT_INFO_DB_MAPPED_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * Precompiled add-contextual-data database (.ctxdb), produced by
+ * ctxdbtool from a CSV file and mapped read-only by syslog-ng.
+ *
+ * The file consists of a header, an array of selectors sorted by the
+ * comparison function matching ignore-case(), the selector indexes in the
+ * order of their first appearance in the source file, the distinct names,
+ * the records grouped by selector (in file order within a group), the
+ * records whose value is a template and a pool of NUL terminated strings.
+ * All integers are 32 bit in host byte order, every string is referenced
+ * by its offset in the pool.
+ *
+ * Values that can't be anything but a literal string are flagged when the
+ * file is written, these are used straight from the mapping.  Only the
+ * records in the template array need to be compiled when loading the file.
+ */
+
+#define CONTEXT_INFO_DB_MAPPED_MAGIC "SNGCTXDB"
+#define CONTEXT_INFO_DB_MAPPED_VERSION 1
+#define CONTEXT_INFO_DB_MAPPED_BYTE_ORDER_MARK 0x01020304
+
+#define CONTEXT_INFO_DB_MAPPED_IGNORE_CASE 0x0001
+
+/* the template index of records with a literal value */
+#define CONTEXT_INFO_DB_MAPPED_LITERAL G_MAXUINT32
+
+#define CONTEXT_INFO_DB_MAPPED_ERROR context_info_db_mapped_error_quark()
+
+enum ContextInfoDBMappedError
+{
+  CONTEXT_INFO_DB_MAPPED_ERROR_FORMAT,
+  CONTEXT_INFO_DB_MAPPED_ERROR_TOO_LARGE,
+};
+
+GQuark context_info_db_mapped_error_quark(void);
+
+typedef struct _ContextInfoDBMappedHeader
+{
+  gchar magic[8];
+  guint32 byte_order_mark;
+  guint32 version;
+  guint32 flags;
+  guint32 num_selectors;
+  guint32 num_records;
+  guint32 num_names;
+  guint32 num_templates;
+  guint32 selectors_offset;
+  guint32 selector_order_offset;
+  guint32 names_offset;
+  guint32 records_offset;
+  guint32 templates_offset;
+  guint32 strings_offset;
+  guint32 strings_length;
+} ContextInfoDBMappedHeader;
+
+typedef struct _ContextInfoDBMappedSelector
+{
+  guint32 selector;
+  guint32 first_record;
+  guint32 num_records;
+} ContextInfoDBMappedSelector;
+
+typedef struct _ContextInfoDBMappedRecord
+{
+  /* index in the name array */
+  guint32 name;
+  guint32 value;
+  /* index in the template array, or CONTEXT_INFO_DB_MAPPED_LITERAL */
+  guint32 template;
+} ContextInfoDBMappedRecord;
+
+typedef struct _ContextInfoDBMappedTemplate
+{
+  guint32 selector;
+  /* index in the record array */
+  guint32 record;
+} ContextInfoDBMappedTemplate;
+
+typedef struct _ContextInfoDBMapped ContextInfoDBMapped;
+
+ContextInfoDBMapped *context_info_db_mapped_open(const gchar *filename, GError **error);
+void context_info_db_mapped_close(ContextInfoDBMapped *self);
+
+gboolean context_info_db_mapped_is_ignore_case(ContextInfoDBMapped *self);
+guint32 context_info_db_mapped_number_of_selectors(ContextInfoDBMapped *self);
+guint32 context_info_db_mapped_number_of_records(ContextInfoDBMapped *self);
+guint32 context_info_db_mapped_number_of_names(ContextInfoDBMapped *self);
+guint32 context_info_db_mapped_number_of_templates(ContextInfoDBMapped *self);
+
+/* returns the index of the selector or -1 if it is not present */
+gint64 context_info_db_mapped_lookup(ContextInfoDBMapped *self, const gchar *selector);
+const gchar *context_info_db_mapped_get_selector(ContextInfoDBMapped *self, guint32 selector_ndx);
+guint32 context_info_db_mapped_get_ordered_selector(ContextInfoDBMapped *self, guint32 order_ndx);
+guint32 context_info_db_mapped_number_of_selector_records(ContextInfoDBMapped *self, guint32 selector_ndx);
+void context_info_db_mapped_get_record(ContextInfoDBMapped *self, guint32 selector_ndx, guint32 record_ndx,
+                                       guint32 *name_ndx, const gchar **value, guint32 *template_ndx);
+const gchar *context_info_db_mapped_get_name(ContextInfoDBMapped *self, guint32 name_ndx);
+void context_info_db_mapped_get_template(ContextInfoDBMapped *self, guint32 template_ndx,
+                                         const gchar **selector, const gchar **name, const gchar **value);
+
+typedef struct _ContextInfoDBMappedWriter ContextInfoDBMappedWriter;
+
+ContextInfoDBMappedWriter *context_info_db_mapped_writer_new(gboolean ignore_case);
+void context_info_db_mapped_writer_add(ContextInfoDBMappedWriter *self,
+                                       const gchar *selector, const gchar *name, const gchar *value);
+gboolean context_info_db_mapped_writer_write(ContextInfoDBMappedWriter *self, const gchar *filename,
+                                             GError **error);
+void context_info_db_mapped_writer_free(ContextInfoDBMappedWriter *self);
+
+#endif
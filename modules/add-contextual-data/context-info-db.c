@@ -21,6 +21,7 @@
  */
 
 #include "context-info-db.h"
+#include "context-info-db-mapped.h"
 #include "atomic.h"
 #include "messages.h"
 #include "scratch-buffers.h"
@@ -39,6 +40,13 @@ struct _ContextInfoDB
   gboolean is_ordering_enabled;
   GList *ordered_selectors;
   gboolean ignore_case;
+
+  /* precompiled database: selectors and literal values are used from the
+   * mapped file, names and template values are resolved when the database
+   * is loaded */
+  ContextInfoDBMapped *mapped;
+  NVHandle *mapped_name_handles;
+  LogTemplate **mapped_templates;
 };
 
 typedef struct _element_range
@@ -183,6 +191,14 @@ _free_array(GArray *array)
   g_array_free(array, TRUE);
 }
 
+static void
+_free_mapped_templates(LogTemplate **templates, guint32 num_templates)
+{
+  for (guint32 i = 0; i < num_templates; i++)
+    log_template_unref(templates[i]);
+  g_free(templates);
+}
+
 static void
 _free(ContextInfoDB *self)
 {
@@ -198,6 +214,12 @@ _free(ContextInfoDB *self)
     {
       g_list_free(self->ordered_selectors);
     }
+  if (self->mapped)
+    {
+      _free_mapped_templates(self->mapped_templates, context_info_db_mapped_number_of_templates(self->mapped));
+      g_free(self->mapped_name_handles);
+      context_info_db_mapped_close(self->mapped);
+    }
 }
 
 
@@ -208,9 +230,27 @@ _get_range_of_records(ContextInfoDB *self, const gchar *selector)
   return (element_range *) g_hash_table_lookup(self->index, selector);
 }
 
+static void
+_get_mapped_record(ContextInfoDB *self, guint32 selector_ndx, guint32 record_ndx, ContextualDataRecord *record)
+{
+  guint32 name_ndx, template_ndx;
+  const gchar *value;
+
+  context_info_db_mapped_get_record(self->mapped, selector_ndx, record_ndx, &name_ndx, &value, &template_ndx);
+
+  contextual_data_record_init(record);
+  record->selector = (gchar *) context_info_db_mapped_get_selector(self->mapped, selector_ndx);
+  record->value_handle = self->mapped_name_handles[name_ndx];
+  if (template_ndx == CONTEXT_INFO_DB_MAPPED_LITERAL)
+    record->literal_value = value;
+  else
+    record->value = self->mapped_templates[template_ndx];
+}
+
 void
 context_info_db_purge(ContextInfoDB *self)
 {
+  g_assert(!self->mapped);
   g_hash_table_remove_all(self->index);
   if (self->data->len > 0)
     self->data = g_array_remove_range(self->data, 0, self->data->len);
@@ -221,6 +261,7 @@ void
 context_info_db_insert(ContextInfoDB *self,
                        const ContextualDataRecord *record)
 {
+  g_assert(!self->mapped);
   log_template_forget_template_string(record->value);
 
   g_array_append_val(self->data, *record);
@@ -235,6 +276,9 @@ context_info_db_contains(ContextInfoDB *self, const gchar *selector)
   if (!selector)
     return FALSE;
 
+  if (self->mapped)
+    return context_info_db_mapped_lookup(self->mapped, selector) >= 0;
+
   _ensure_indexed_db(self);
   return (_get_range_of_records(self, selector) != NULL);
 }
@@ -243,6 +287,12 @@ gsize
 context_info_db_number_of_records(ContextInfoDB *self,
                                   const gchar *selector)
 {
+  if (self->mapped)
+    {
+      gint64 selector_ndx = context_info_db_mapped_lookup(self->mapped, selector);
+      return selector_ndx >= 0 ? context_info_db_mapped_number_of_selector_records(self->mapped, selector_ndx) : 0;
+    }
+
   _ensure_indexed_db(self);
 
   gsize n = 0;
@@ -258,6 +308,24 @@ void
 context_info_db_foreach_record(ContextInfoDB *self, const gchar *selector,
                                ADD_CONTEXT_INFO_CB callback, gpointer arg)
 {
+  if (self->mapped)
+    {
+      gint64 selector_ndx = context_info_db_mapped_lookup(self->mapped, selector);
+
+      if (selector_ndx < 0)
+        return;
+
+      guint32 num_records = context_info_db_mapped_number_of_selector_records(self->mapped, selector_ndx);
+      for (guint32 i = 0; i < num_records; ++i)
+        {
+          ContextualDataRecord record;
+
+          _get_mapped_record(self, selector_ndx, i, &record);
+          callback(arg, &record);
+        }
+      return;
+    }
+
   _ensure_indexed_db(self);
 
   element_range *record_range = _get_range_of_records(self, selector);
@@ -277,18 +345,31 @@ context_info_db_foreach_record(ContextInfoDB *self, const gchar *selector,
 gboolean
 context_info_db_is_indexed(const ContextInfoDB *self)
 {
+  if (self->mapped)
+    return TRUE;
   return self->is_data_indexed;
 }
 
 gboolean
 context_info_db_is_loaded(const ContextInfoDB *self)
 {
+  if (self->mapped)
+    return context_info_db_mapped_number_of_records(self->mapped) > 0;
   return (self->data != NULL && self->data->len > 0);
 }
 
 GList *
 context_info_db_get_selectors(ContextInfoDB *self)
 {
+  if (self->mapped)
+    {
+      GList *selectors = NULL;
+
+      for (guint32 i = context_info_db_mapped_number_of_selectors(self->mapped); i > 0; i--)
+        selectors = g_list_prepend(selectors, (gpointer) context_info_db_mapped_get_selector(self->mapped, i - 1));
+      return selectors;
+    }
+
   _ensure_indexed_db(self);
   return g_hash_table_get_keys(self->index);
 }
@@ -354,6 +435,102 @@ context_info_db_import(ContextInfoDB *self, FILE *fp, const gchar *filename,
   return TRUE;
 }
 
+static NVHandle *
+_resolve_mapped_names(ContextInfoDBMapped *mapped, ContextualDataRecordScanner *scanner)
+{
+  guint32 num_names = context_info_db_mapped_number_of_names(mapped);
+  NVHandle *handles = g_new(NVHandle, num_names);
+
+  for (guint32 i = 0; i < num_names; i++)
+    handles[i] = contextual_data_record_scanner_get_name_handle(scanner, context_info_db_mapped_get_name(mapped, i));
+  return handles;
+}
+
+/* Compiling templates may load plugins, so it is done here, at init time,
+ * rather than on the first lookup on a worker thread.  Literal values are
+ * not compiled at all. */
+static LogTemplate **
+_compile_mapped_templates(ContextInfoDBMapped *mapped, ContextualDataRecordScanner *scanner, GError **error)
+{
+  guint32 num_templates = context_info_db_mapped_number_of_templates(mapped);
+  LogTemplate **templates = g_new0(LogTemplate *, num_templates);
+
+  for (guint32 i = 0; i < num_templates; i++)
+    {
+      const gchar *selector, *name, *value;
+      ScratchBuffersMarker marker;
+
+      context_info_db_mapped_get_template(mapped, i, &selector, &name, &value);
+
+      scratch_buffers_mark(&marker);
+      ContextualDataRecord *record = contextual_data_record_scanner_build(scanner, selector, name, value);
+      scratch_buffers_reclaim_marked(marker);
+      if (!record)
+        {
+          g_set_error(error, CONTEXT_INFO_DB_MAPPED_ERROR, CONTEXT_INFO_DB_MAPPED_ERROR_FORMAT,
+                      "invalid record in precompiled database, selector: %s, name: %s, value: %s",
+                      selector, name, value);
+          _free_mapped_templates(templates, num_templates);
+          return NULL;
+        }
+
+      log_template_forget_template_string(record->value);
+      templates[i] = record->value;
+      record->value = NULL;
+      contextual_data_record_clean(record);
+    }
+  return templates;
+}
+
+gboolean
+context_info_db_import_mapped(ContextInfoDB *self, const gchar *filename,
+                              ContextualDataRecordScanner *scanner, GError **error)
+{
+  g_assert(!self->mapped && !context_info_db_is_loaded(self));
+
+  ContextInfoDBMapped *mapped = context_info_db_mapped_open(filename, error);
+  if (!mapped)
+    {
+      contextual_data_record_scanner_free(scanner);
+      return FALSE;
+    }
+
+  if (context_info_db_mapped_is_ignore_case(mapped) != self->ignore_case)
+    {
+      g_set_error(error, CONTEXT_INFO_DB_MAPPED_ERROR, CONTEXT_INFO_DB_MAPPED_ERROR_FORMAT,
+                  "%s was compiled with a different ignore-case() setting, "
+                  "use ctxdbtool --ignore-case to match the configuration", filename);
+      context_info_db_mapped_close(mapped);
+      contextual_data_record_scanner_free(scanner);
+      return FALSE;
+    }
+
+  LogTemplate **templates = _compile_mapped_templates(mapped, scanner, error);
+  if (!templates)
+    {
+      context_info_db_mapped_close(mapped);
+      contextual_data_record_scanner_free(scanner);
+      return FALSE;
+    }
+
+  self->mapped = mapped;
+  self->mapped_templates = templates;
+  self->mapped_name_handles = _resolve_mapped_names(mapped, scanner);
+  contextual_data_record_scanner_free(scanner);
+
+  if (self->is_ordering_enabled)
+    {
+      for (guint32 i = context_info_db_mapped_number_of_selectors(mapped); i > 0; i--)
+        {
+          guint32 selector_ndx = context_info_db_mapped_get_ordered_selector(mapped, i - 1);
+          self->ordered_selectors = g_list_prepend(self->ordered_selectors,
+                                                   (gpointer) context_info_db_mapped_get_selector(mapped, selector_ndx));
+        }
+    }
+
+  return TRUE;
+}
+
 ContextInfoDB *
 context_info_db_new(gboolean ignore_case)
 {
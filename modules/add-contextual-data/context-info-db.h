@@ -60,6 +60,11 @@ GList *context_info_db_get_selectors(ContextInfoDB *self);
 gboolean context_info_db_import(ContextInfoDB *self, FILE *fp, const gchar *filename,
                                 ContextualDataRecordScanner *scanner);
 
+/* maps a precompiled (.ctxdb) database read-only and compiles its template
+ * values using @scanner, which it takes ownership of */
+gboolean context_info_db_import_mapped(ContextInfoDB *self, const gchar *filename,
+                                       ContextualDataRecordScanner *scanner, GError **error);
+
 
 ContextInfoDB *context_info_db_new(gboolean ignore_case);
 ContextInfoDB *context_info_db_ref(ContextInfoDB *self);
@@ -66,35 +66,38 @@ _is_whole_record_parsed(ContextualDataRecordScanner *self)
 }
 
 static gboolean
-_fetch_selector(ContextualDataRecordScanner *self, ContextualDataRecord *record)
+_fetch_column(ContextualDataRecordScanner *self, gchar **column)
 {
   if (!_fetch_next(self))
     return FALSE;
-  record->selector = g_strdup(csv_scanner_get_current_value(&self->scanner));
+  *column = g_strdup(csv_scanner_get_current_value(&self->scanner));
   return TRUE;
 }
 
-static gboolean
-_fetch_name(ContextualDataRecordScanner *self, ContextualDataRecord *record)
+static void
+_set_selector(ContextualDataRecordScanner *self, ContextualDataRecord *record, const gchar *selector)
 {
-  if (!_fetch_next(self))
-    return FALSE;
+  record->selector = g_strdup(selector);
+}
 
-  gchar *name = g_strdup_printf("%s%s", self->name_prefix ? : "", csv_scanner_get_current_value(&self->scanner));
-  record->value_handle = log_msg_get_value_handle(name);
-  g_free(name);
+NVHandle
+contextual_data_record_scanner_get_name_handle(ContextualDataRecordScanner *self, const gchar *name)
+{
+  gchar *prefixed_name = g_strdup_printf("%s%s", self->name_prefix ? : "", name);
+  NVHandle handle = log_msg_get_value_handle(prefixed_name);
+  g_free(prefixed_name);
+  return handle;
+}
 
-  return TRUE;
+static void
+_set_name(ContextualDataRecordScanner *self, ContextualDataRecord *record, const gchar *name)
+{
+  record->value_handle = contextual_data_record_scanner_get_name_handle(self, name);
 }
 
 static gboolean
-_fetch_value(ContextualDataRecordScanner *self, ContextualDataRecord *record)
+_compile_value(ContextualDataRecordScanner *self, ContextualDataRecord *record, const gchar *value_template)
 {
-  if (!_fetch_next(self))
-    return FALSE;
-
-  const gchar *value_template = csv_scanner_get_current_value(&self->scanner);
-
   record->value = log_template_new(self->cfg, NULL);
 
 
@@ -176,20 +179,22 @@ _fetch_value(ContextualDataRecordScanner *self, ContextualDataRecord *record)
   return TRUE;
 }
 
-static gboolean
-_get_next_record(ContextualDataRecordScanner *self, const gchar *input, ContextualDataRecord *record)
+gboolean
+contextual_data_record_scanner_scan_columns(ContextualDataRecordScanner *self, const gchar *input,
+                                            gchar **selector, gchar **name, gchar **value)
 {
   gboolean result = FALSE;
 
+  *selector = *name = *value = NULL;
   csv_scanner_init(&self->scanner, &self->options, input);
 
-  if (!_fetch_selector(self, record))
+  if (!_fetch_column(self, selector))
     goto error;
 
-  if (!_fetch_name(self, record))
+  if (!_fetch_column(self, name))
     goto error;
 
-  if (!_fetch_value(self, record))
+  if (!_fetch_column(self, value))
     goto error;
 
   if (!_is_whole_record_parsed(self))
@@ -199,6 +204,31 @@ _get_next_record(ContextualDataRecordScanner *self, const gchar *input, Contextu
 
 error:
   csv_scanner_deinit(&self->scanner);
+  if (!result)
+    {
+      g_free(*selector);
+      g_free(*name);
+      g_free(*value);
+      *selector = *name = *value = NULL;
+    }
+  return result;
+}
+
+static gboolean
+_get_next_record(ContextualDataRecordScanner *self, const gchar *input, ContextualDataRecord *record)
+{
+  gchar *selector, *name, *value;
+
+  if (!contextual_data_record_scanner_scan_columns(self, input, &selector, &name, &value))
+    return FALSE;
+
+  _set_selector(self, record, selector);
+  _set_name(self, record, name);
+  gboolean result = _compile_value(self, record, value);
+
+  g_free(selector);
+  g_free(name);
+  g_free(value);
   return result;
 }
 
@@ -220,6 +250,22 @@ contextual_data_record_scanner_get_next(ContextualDataRecordScanner *self,
   return &self->last_record;
 }
 
+ContextualDataRecord *
+contextual_data_record_scanner_build(ContextualDataRecordScanner *self,
+                                     const gchar *selector, const gchar *name, const gchar *value)
+{
+  contextual_data_record_init(&self->last_record);
+  _set_selector(self, &self->last_record, selector);
+  _set_name(self, &self->last_record, name);
+  if (!_compile_value(self, &self->last_record, value))
+    {
+      contextual_data_record_clean(&self->last_record);
+      return NULL;
+    }
+
+  return &self->last_record;
+}
+
 void
 contextual_data_record_scanner_free(ContextualDataRecordScanner *self)
 {
@@ -33,6 +33,21 @@ ContextualDataRecord *contextual_data_record_scanner_get_next(ContextualDataReco
     const gchar *filename,
     gint lineno);
 
+/* split a CSV line into its columns without compiling anything, the
+ * returned strings are owned by the caller */
+gboolean contextual_data_record_scanner_scan_columns(ContextualDataRecordScanner *self, const gchar *input,
+                                                     gchar **selector, gchar **name, gchar **value);
+
+/* construct a record from columns that were already split, e.g. loaded
+ * from a precompiled database */
+ContextualDataRecord *contextual_data_record_scanner_build(ContextualDataRecordScanner *self,
+                                                           const gchar *selector,
+                                                           const gchar *name,
+                                                           const gchar *value);
+
+/* the handle of a name column, including the prefix */
+NVHandle contextual_data_record_scanner_get_name_handle(ContextualDataRecordScanner *self, const gchar *name);
+
 ContextualDataRecordScanner *contextual_data_record_scanner_new(GlobalConfig *cfg, const gchar *name_prefix);
 void contextual_data_record_scanner_free(ContextualDataRecordScanner *self);
 
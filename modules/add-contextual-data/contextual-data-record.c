@@ -28,6 +28,7 @@ contextual_data_record_init(ContextualDataRecord *record)
   record->selector = NULL;
   record->value_handle = 0;
   record->value = NULL;
+  record->literal_value = NULL;
 }
 
 void
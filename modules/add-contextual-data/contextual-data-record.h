@@ -32,6 +32,9 @@ typedef struct _ContextualDataRecord
   gchar *selector;
   NVHandle value_handle;
   LogTemplate *value;
+  /* used instead of value for the literal values of precompiled
+   * databases, points into the mapped file */
+  const gchar *literal_value;
 } ContextualDataRecord;
 
 void contextual_data_record_init(ContextualDataRecord *record);
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+/*
+ * ctxdbtool converts an add-contextual-data() CSV file to the precompiled
+ * .ctxdb format, which syslog-ng maps into memory instead of parsing it at
+ * startup and at every reload.
+ */
+
+#include "syslog-ng.h"
+#include "context-info-db-mapped.h"
+#include "contextual-data-record-scanner.h"
+#include "messages.h"
+#include "scratch-buffers.h"
+#include "stats/stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+static gchar *output_filename;
+static gboolean ignore_case;
+static gboolean display_version;
+
+static GOptionEntry ctxdbtool_options[] =
+{
+  {
+    "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_filename,
+    "Name of the precompiled database to write, defaults to the input with a .ctxdb extension", "<file>"
+  },
+  {
+    "ignore-case", 'i', 0, G_OPTION_ARG_NONE, &ignore_case,
+    "Compile the database for add-contextual-data(ignore-case(yes))", NULL
+  },
+  {
+    "version", 'V', 0, G_OPTION_ARG_NONE, &display_version,
+    "Display version number (" SYSLOG_NG_VERSION ")", NULL
+  },
+  { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL }
+};
+
+static void
+_truncate_eol(gchar *line, gsize line_len)
+{
+  if (line_len >= 2 && line[line_len - 2] == '\r' && line[line_len - 1] == '\n')
+    line[line_len - 2] = '\0';
+  else if (line_len >= 1 && line[line_len - 1] == '\n')
+    line[line_len - 1] = '\0';
+}
+
+static gboolean
+_read_csv(ContextInfoDBMappedWriter *writer, const gchar *filename)
+{
+  ContextualDataRecordScanner *scanner = contextual_data_record_scanner_new(NULL, NULL);
+  FILE *fp = fopen(filename, "r");
+  gchar *line_buf = NULL;
+  gsize line_buf_len = 0;
+  gssize n;
+  gint lineno = 0;
+  gboolean result = FALSE;
+
+  if (!fp)
+    {
+      fprintf(stderr, "Error opening input file; filename='%s', error='%s'\n", filename, g_strerror(errno));
+      goto exit;
+    }
+
+  while ((n = getline(&line_buf, &line_buf_len, fp)) != -1)
+    {
+      gchar *selector, *name, *value;
+      ScratchBuffersMarker marker;
+      gboolean success;
+
+      lineno++;
+      _truncate_eol(line_buf, n);
+      if (line_buf[0] == '\0')
+        continue;
+
+      scratch_buffers_mark(&marker);
+      success = contextual_data_record_scanner_scan_columns(scanner, line_buf, &selector, &name, &value);
+      scratch_buffers_reclaim_marked(marker);
+      if (!success)
+        {
+          fprintf(stderr, "Error parsing input file; location='%s:%d', input='%s'\n", filename, lineno, line_buf);
+          goto exit;
+        }
+
+      context_info_db_mapped_writer_add(writer, selector, name, value);
+      g_free(selector);
+      g_free(name);
+      g_free(value);
+    }
+  result = TRUE;
+
+exit:
+  g_free(line_buf);
+  if (fp)
+    fclose(fp);
+  contextual_data_record_scanner_free(scanner);
+  return result;
+}
+
+static gchar *
+_default_output_filename(const gchar *input_filename)
+{
+  const gchar *ext = strrchr(input_filename, '.');
+  gsize base_len = ext && !strchr(ext, '/') ? ext - input_filename : strlen(input_filename);
+
+  return g_strdup_printf("%.*s.ctxdb", (gint) base_len, input_filename);
+}
+
+static gint
+_compile(const gchar *input_filename)
+{
+  ContextInfoDBMappedWriter *writer = context_info_db_mapped_writer_new(ignore_case);
+  gchar *output = output_filename ? g_strdup(output_filename) : _default_output_filename(input_filename);
+  GError *error = NULL;
+  gint ret = 1;
+
+  if (!_read_csv(writer, input_filename))
+    goto exit;
+
+  if (!context_info_db_mapped_writer_write(writer, output, &error))
+    {
+      fprintf(stderr, "Error writing precompiled database; filename='%s', error='%s'\n", output, error->message);
+      g_clear_error(&error);
+      goto exit;
+    }
+  ret = 0;
+
+exit:
+  g_free(output);
+  context_info_db_mapped_writer_free(writer);
+  return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  gint ret;
+
+  ctx = g_option_context_new("<csv-file>");
+  g_option_context_set_summary(ctx, "Compile an add-contextual-data() CSV file to a precompiled .ctxdb database");
+  g_option_context_add_main_entries(ctx, ctxdbtool_options, NULL);
+
+  if (!g_option_context_parse(ctx, &argc, &argv, &error))
+    {
+      fprintf(stderr, "Error parsing command line arguments: %s\n", error ? error->message : "Invalid arguments");
+      g_clear_error(&error);
+      g_option_context_free(ctx);
+      return 1;
+    }
+
+  if (display_version)
+    {
+      printf(SYSLOG_NG_VERSION "\n");
+      g_option_context_free(ctx);
+      return 0;
+    }
+
+  if (argc != 2)
+    {
+      gchar *help = g_option_context_get_help(ctx, TRUE, NULL);
+      fprintf(stderr, "%s", help);
+      g_free(help);
+      g_option_context_free(ctx);
+      return 1;
+    }
+  g_option_context_free(ctx);
+
+  msg_init(TRUE);
+  stats_init();
+  scratch_buffers_global_init();
+  scratch_buffers_allocator_init();
+  ret = _compile(argv[1]);
+  scratch_buffers_allocator_deinit();
+  scratch_buffers_global_deinit();
+  stats_destroy();
+  msg_deinit();
+
+  g_free(output_filename);
+  return ret;
+}
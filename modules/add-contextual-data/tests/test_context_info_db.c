@@ -25,11 +25,13 @@
 #include "libtest/cr_template.h"
 
 #include "context-info-db.h"
+#include "context-info-db-mapped.h"
 #include "apphook.h"
 #include "scratch-buffers.h"
 #include "cfg.h"
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
@@ -180,9 +182,16 @@ _foreach_get_nvpairs(gpointer arg, const ContextualDataRecord *record)
 
   pair.name = log_msg_get_value_name(record->value_handle, NULL);
 
-  LogMessage *msg = create_sample_message();
-  log_template_format(record->value, msg, &DEFAULT_TEMPLATE_EVAL_OPTIONS, result);
-  log_msg_unref(msg);
+  if (record->value)
+    {
+      LogMessage *msg = create_sample_message();
+      log_template_format(record->value, msg, &DEFAULT_TEMPLATE_EVAL_OPTIONS, result);
+      log_msg_unref(msg);
+    }
+  else
+    {
+      g_string_assign(result, record->literal_value);
+    }
 
   pair.value = result->str;
   store->pairs[store->ctr++] = pair;
@@ -539,6 +548,244 @@ Test(add_contextual_data, test_selected_nvpairs_when_ignore_case_on)
   contextual_data_record_scanner_free(scanner);
 }
 
+static gchar *
+_compile_mapped_db(const gchar *csv_records[][3], gsize num_records, gboolean ignore_case)
+{
+  ContextInfoDBMappedWriter *writer = context_info_db_mapped_writer_new(ignore_case);
+  gchar *filename = NULL;
+  GError *error = NULL;
+
+  gint fd = g_file_open_tmp("test_context_info_db_XXXXXX.ctxdb", &filename, &error);
+  cr_assert(fd >= 0, "Failed to create temporary file: %s", error ? error->message : "");
+  close(fd);
+
+  for (gsize i = 0; i < num_records; i++)
+    context_info_db_mapped_writer_add(writer, csv_records[i][0], csv_records[i][1], csv_records[i][2]);
+
+  cr_assert(context_info_db_mapped_writer_write(writer, filename, &error),
+            "Failed to write precompiled database: %s", error ? error->message : "");
+  context_info_db_mapped_writer_free(writer);
+  return filename;
+}
+
+static void
+_remove_mapped_db(gchar *filename)
+{
+  unlink(filename);
+  g_free(filename);
+}
+
+Test(add_contextual_data, test_import_mapped)
+{
+  const gchar *csv_records[][3] =
+  {
+    {"selector3", "name3", "value3"},
+    {"selector1", "name1", "value1"},
+    {"selector2", "name2", "value2"},
+    {"selector1", "name1.1", "value1.1"},
+    {"selector3", "name3.1", "$(echo $HOST_FROM)"},
+  };
+  gchar *filename = _compile_mapped_db(csv_records, ARRAY_SIZE(csv_records), FALSE);
+  ContextInfoDB *db = context_info_db_new(FALSE);
+  GError *error = NULL;
+
+  context_info_db_enable_ordering(db);
+  cr_assert(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, NULL),
+                                          &error),
+            "Failed to import precompiled database: %s", error ? error->message : "");
+  cr_assert(context_info_db_is_loaded(db));
+  cr_assert(context_info_db_is_indexed(db));
+
+  cr_assert(context_info_db_contains(db, "selector1"));
+  cr_assert(context_info_db_contains(db, "selector3"));
+  cr_assert_not(context_info_db_contains(db, "selector4"));
+  cr_assert_not(context_info_db_contains(db, "SELECTOR1"));
+  cr_assert_eq(context_info_db_number_of_records(db, "selector1"), 2);
+  cr_assert_eq(context_info_db_number_of_records(db, "selector4"), 0);
+
+  TestNVPair expected_nvpairs_selector1[] =
+  {
+    {.name = "name1", .value = "value1"},
+    {.name = "name1.1", .value = "value1.1"},
+  };
+  TestNVPair expected_nvpairs_selector3[] =
+  {
+    {.name = "name3", .value = "value3"},
+    {.name = "name3.1", .value = "kismacska"},
+  };
+
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "selector1", expected_nvpairs_selector1,
+      ARRAY_SIZE(expected_nvpairs_selector1));
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "selector3", expected_nvpairs_selector3,
+      ARRAY_SIZE(expected_nvpairs_selector3));
+
+  GList *ordered_selectors = context_info_db_ordered_selectors(db);
+  cr_assert_eq(g_list_length(ordered_selectors), 3);
+  cr_assert_str_eq(g_list_nth_data(ordered_selectors, 0), "selector3");
+  cr_assert_str_eq(g_list_nth_data(ordered_selectors, 1), "selector1");
+  cr_assert_str_eq(g_list_nth_data(ordered_selectors, 2), "selector2");
+
+  GList *selectors = context_info_db_get_selectors(db);
+  cr_assert_eq(g_list_length(selectors), 3);
+  g_list_free(selectors);
+
+  context_info_db_unref(db);
+  _remove_mapped_db(filename);
+}
+
+static void
+_collect_records(gpointer arg, const ContextualDataRecord *record)
+{
+  GArray *records = (GArray *) arg;
+
+  g_array_append_val(records, *record);
+}
+
+Test(add_contextual_data, test_import_mapped_compiles_only_template_values)
+{
+  const gchar *csv_records[][3] =
+  {
+    {"selector1", "name1", "literal value"},
+    {"selector1", "name2", "$HOST_FROM"},
+    {"selector1", "name3", "string(cast)"},
+    {"selector1", "name4", "back\\slash"},
+    {"selector1", "name1", "another literal"},
+  };
+  gchar *filename = _compile_mapped_db(csv_records, ARRAY_SIZE(csv_records), FALSE);
+  ContextInfoDB *db = context_info_db_new(FALSE);
+  GArray *records = g_array_new(FALSE, FALSE, sizeof(ContextualDataRecord));
+
+  cr_assert(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, NULL),
+                                          NULL));
+
+  context_info_db_foreach_record(db, "selector1", _collect_records, records);
+  cr_assert_eq(records->len, 5);
+
+  ContextualDataRecord *literal = &g_array_index(records, ContextualDataRecord, 0);
+  cr_assert_null(literal->value);
+  cr_assert_str_eq(literal->literal_value, "literal value");
+  cr_assert_str_eq(log_msg_get_value_name(literal->value_handle, NULL), "name1");
+
+  for (gint i = 1; i <= 3; i++)
+    cr_assert_not_null(g_array_index(records, ContextualDataRecord, i).value, "record #%d is not compiled", i);
+
+  /* names are resolved once, the same name has the same handle */
+  ContextualDataRecord *same_name = &g_array_index(records, ContextualDataRecord, 4);
+  cr_assert_null(same_name->value);
+  cr_assert_str_eq(same_name->literal_value, "another literal");
+  cr_assert_eq(same_name->value_handle, literal->value_handle);
+
+  g_array_free(records, TRUE);
+  context_info_db_unref(db);
+  _remove_mapped_db(filename);
+}
+
+Test(add_contextual_data, test_import_mapped_with_ignore_case)
+{
+  const gchar *csv_records[][3] =
+  {
+    {"selector", "name1", "value1"},
+    {"another", "name4", "value4"},
+    {"SeLeCtOr", "name2", "value2"},
+    {"sElEcToR", "name3", "value3"},
+  };
+  gchar *filename = _compile_mapped_db(csv_records, ARRAY_SIZE(csv_records), TRUE);
+  ContextInfoDB *db = context_info_db_new(TRUE);
+
+  cr_assert(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, NULL),
+                                          NULL));
+
+  TestNVPair expected_nvpairs[] =
+  {
+    {.name = "name1", .value = "value1"},
+    {.name = "name2", .value = "value2"},
+    {.name = "name3", .value = "value3"},
+  };
+
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "SELECTOR", expected_nvpairs,
+      ARRAY_SIZE(expected_nvpairs));
+  cr_assert(context_info_db_contains(db, "ANOTHER"));
+  cr_assert_eq(context_info_db_number_of_records(db, "Selector"), 3);
+  context_info_db_unref(db);
+
+  GError *error = NULL;
+  db = context_info_db_new(FALSE);
+  cr_assert_not(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, NULL),
+                                              &error),
+                "Precompiled database should be rejected if ignore-case() does not match");
+  cr_assert_not_null(error);
+  g_clear_error(&error);
+  context_info_db_unref(db);
+
+  _remove_mapped_db(filename);
+}
+
+Test(add_contextual_data, test_import_mapped_with_prefix)
+{
+  const gchar *csv_records[][3] =
+  {
+    {"selector1", "name1", "value1"},
+  };
+  gchar *filename = _compile_mapped_db(csv_records, ARRAY_SIZE(csv_records), FALSE);
+  ContextInfoDB *db = context_info_db_new(FALSE);
+
+  cr_assert(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, "aaa."),
+                                          NULL));
+
+  TestNVPair expected_nvpairs[] =
+  {
+    {.name = "aaa.name1", .value = "value1"},
+  };
+
+  _assert_context_info_db_contains_name_value_pairs_by_selector(db, "selector1", expected_nvpairs,
+      ARRAY_SIZE(expected_nvpairs));
+  context_info_db_unref(db);
+  _remove_mapped_db(filename);
+}
+
+Test(add_contextual_data, test_import_mapped_rejects_invalid_files)
+{
+  gchar *filename = NULL;
+  GError *error = NULL;
+  gint fd = g_file_open_tmp("test_context_info_db_XXXXXX.ctxdb", &filename, NULL);
+  close(fd);
+
+  cr_assert(g_file_set_contents(filename, "selector1,name1,value1\n", -1, NULL));
+
+  ContextInfoDB *db = context_info_db_new(FALSE);
+  cr_assert_not(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, NULL),
+                                              &error));
+  cr_assert_not_null(error);
+  cr_assert_not(context_info_db_is_loaded(db));
+  g_clear_error(&error);
+  context_info_db_unref(db);
+
+  _remove_mapped_db(filename);
+}
+
+Test(add_contextual_data, test_import_mapped_fails_on_invalid_record)
+{
+  const gchar *csv_records[][3] =
+  {
+    {"selector1", "name1", "value1"},
+    {"selector2", "name2", "$(unknown-template-function)"},
+  };
+  gchar *filename = _compile_mapped_db(csv_records, ARRAY_SIZE(csv_records), FALSE);
+  ContextInfoDB *db = context_info_db_new(FALSE);
+  GError *error = NULL;
+
+  cr_assert_not(context_info_db_import_mapped(db, filename, contextual_data_record_scanner_new(configuration, NULL),
+                                              &error),
+                "Precompiled database with an invalid record should be rejected");
+  cr_assert_not_null(error);
+  cr_assert_not(context_info_db_is_loaded(db));
+  cr_assert_not(context_info_db_contains(db, "selector1"));
+  g_clear_error(&error);
+  context_info_db_unref(db);
+
+  _remove_mapped_db(filename);
+}
+
 static void
 setup(void)
 {
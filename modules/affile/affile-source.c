@@ -91,6 +91,16 @@ affile_sd_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
   log_src_driver_queue_method(s, msg, path_options);
 }
 
+static void
+affile_sd_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  AFFileSourceDriver *self = (AFFileSourceDriver *) s;
+
+  for (gint i = 0; i < num_msgs; i++)
+    log_msg_set_value(msgs[i], LM_V_TRANSPORT, self->transport_name, self->transport_name_len);
+  log_src_driver_queue_batch_method(s, msgs, num_msgs, path_options);
+}
+
 static gboolean
 affile_sd_init(LogPipe *s)
 {
@@ -150,6 +160,7 @@ affile_sd_new_instance(gchar *filename, GlobalConfig *cfg)
   log_src_driver_init_instance(&self->super, cfg);
   self->super.super.super.init = affile_sd_init;
   self->super.super.super.queue = affile_sd_queue;
+  self->super.super.super.queue_batch = affile_sd_queue_batch;
   self->super.super.super.deinit = affile_sd_deinit;
   self->super.super.super.free_fn = affile_sd_free;
   self->super.super.super.generate_persist_name = affile_sd_format_persist_name;
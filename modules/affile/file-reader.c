@@ -297,6 +297,16 @@ file_reader_queue_method(LogPipe *s, LogMessage *msg, const LogPathOptions *path
   log_pipe_forward_msg(s, msg, path_options);
 }
 
+void
+file_reader_queue_batch_method(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  FileReader *self = (FileReader *)s;
+
+  for (gint i = 0; i < num_msgs; i++)
+    log_msg_set_value(msgs[i], LM_V_FILE_NAME, self->filename->str, self->filename->len);
+  log_pipe_forward_msg_batch(s, msgs, num_msgs, path_options);
+}
+
 gboolean
 file_reader_init_method(LogPipe *s)
 {
@@ -356,6 +366,7 @@ file_reader_init_instance (FileReader *self, const gchar *filename,
   log_pipe_init_instance (&self->super, cfg);
   self->super.init = file_reader_init_method;
   self->super.queue = file_reader_queue_method;
+  self->super.queue_batch = file_reader_queue_batch_method;
   self->super.deinit = file_reader_deinit_method;
   self->super.notify = file_reader_notify_method;
   self->super.free_fn = file_reader_free_method;
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "file-reader.h"
+#include "driver.h"
+#include "logpipe.h"
+#include "cfg.h"
+#include "apphook.h"
+
+#define TEST_FILE_NAME "/var/log/test-file-reader.log"
+#define NUM_MESSAGES 8
+
+typedef struct _TestSourceDriver
+{
+  LogSrcDriver super;
+  gint queue_calls;
+  gint queue_batch_calls;
+  gint received_messages;
+} TestSourceDriver;
+
+static void
+_assert_file_name(LogMessage *msg)
+{
+  cr_assert_str_eq(log_msg_get_value(msg, LM_V_FILE_NAME, NULL), TEST_FILE_NAME);
+}
+
+static void
+test_source_driver_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  TestSourceDriver *self = (TestSourceDriver *) s;
+
+  self->queue_calls++;
+  self->received_messages++;
+  _assert_file_name(msg);
+  log_msg_ack(msg, path_options, AT_PROCESSED);
+  log_msg_unref(msg);
+}
+
+static void
+test_source_driver_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  TestSourceDriver *self = (TestSourceDriver *) s;
+
+  self->queue_batch_calls++;
+  for (gint i = 0; i < num_msgs; i++)
+    {
+      self->received_messages++;
+      _assert_file_name(msgs[i]);
+      log_msg_ack(msgs[i], path_options, AT_PROCESSED);
+      log_msg_unref(msgs[i]);
+    }
+}
+
+static TestSourceDriver *
+test_source_driver_new(GlobalConfig *cfg)
+{
+  TestSourceDriver *self = g_new0(TestSourceDriver, 1);
+
+  log_src_driver_init_instance(&self->super, cfg);
+  self->super.super.super.queue = test_source_driver_queue;
+  self->super.super.super.queue_batch = test_source_driver_queue_batch;
+  self->super.super.super.flags |= PIF_INITIALIZED;
+  return self;
+}
+
+Test(file_reader, batch_from_the_file_reader_arrives_at_the_driver_as_one_batch)
+{
+  TestSourceDriver *driver = test_source_driver_new(configuration);
+  FileReader *reader = file_reader_new(TEST_FILE_NAME, NULL, NULL, &driver->super, configuration);
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msgs[NUM_MESSAGES];
+
+  log_pipe_append(&reader->super, &driver->super.super.super);
+  /* the file itself is never opened, we only exercise the queue path */
+  reader->super.flags |= PIF_INITIALIZED;
+
+  for (gint i = 0; i < NUM_MESSAGES; i++)
+    msgs[i] = log_msg_new_empty();
+
+  log_pipe_queue_batch(&reader->super, msgs, NUM_MESSAGES, &path_options);
+
+  cr_assert_eq(driver->queue_batch_calls, 1);
+  cr_assert_eq(driver->queue_calls, 0);
+  cr_assert_eq(driver->received_messages, NUM_MESSAGES);
+
+  log_pipe_unref(&reader->super);
+  log_pipe_unref(&driver->super.super.super);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+}
+
+static void
+teardown(void)
+{
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(file_reader, .init = setup, .fini = teardown);
@@ -677,6 +677,23 @@ afinet_dd_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
   log_dest_driver_queue_method(s, msg, path_options);
 }
 
+static void
+afinet_dd_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+#if SYSLOG_NG_ENABLE_SPOOF_SOURCE
+  AFInetDestDriver *self = (AFInetDestDriver *) s;
+
+  /* spoofed messages bypass the LogWriter, they are decided one-by-one */
+  if (_is_spoof_source_enabled(self))
+    {
+      for (gint i = 0; i < num_msgs; i++)
+        afinet_dd_queue(s, msgs[i], path_options);
+      return;
+    }
+#endif
+  log_dest_driver_queue_batch_method(s, msgs, num_msgs, path_options);
+}
+
 void
 afinet_dd_free(LogPipe *s)
 {
@@ -706,6 +723,7 @@ afinet_dd_new_instance(TransportMapper *transport_mapper, gchar *hostname, Globa
   self->super.super.super.super.init = afinet_dd_init;
   self->super.super.super.super.deinit = afinet_dd_deinit;
   self->super.super.super.super.queue = afinet_dd_queue;
+  self->super.super.super.super.queue_batch = afinet_dd_queue_batch;
   self->super.super.super.super.free_fn = afinet_dd_free;
   self->super.construct_writer = afinet_dd_construct_writer;
   self->super.setup_addresses = afinet_dd_setup_addresses;
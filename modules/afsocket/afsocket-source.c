@@ -1364,6 +1364,22 @@ afsocket_sd_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_option
   log_src_driver_queue_method(s, msg, path_options);
 }
 
+static void
+afsocket_sd_queue_batch(LogPipe *s, LogMessage **msgs, gint num_msgs, const LogPathOptions *path_options)
+{
+  AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
+  const gchar *transport_name;
+  gsize len;
+
+  transport_name = transport_mapper_get_transport_name(self->transport_mapper, &len);
+  if (transport_name)
+    {
+      for (gint i = 0; i < num_msgs; i++)
+        log_msg_set_value(msgs[i], LM_V_TRANSPORT, transport_name, len);
+    }
+  log_src_driver_queue_batch_method(s, msgs, num_msgs, path_options);
+}
+
 static void
 afsocket_sd_notify(LogPipe *s, gint notify_code, gpointer user_data)
 {
@@ -1402,6 +1418,7 @@ afsocket_sd_init_instance(AFSocketSourceDriver *self,
   log_src_driver_init_instance(&self->super, cfg);
 
   self->super.super.super.queue = afsocket_sd_queue;
+  self->super.super.super.queue_batch = afsocket_sd_queue_batch;
   self->super.super.super.init = afsocket_sd_init_method;
   self->super.super.super.deinit = afsocket_sd_deinit_method;
   self->super.super.super.free_fn = afsocket_sd_free_method;
@@ -44,6 +44,8 @@ static const char *s_oracle = "oracle";
 static const char *s_freetds = "freetds";
 static dbi_inst dbi_instance;
 static const gint DEFAULT_SQL_TX_SIZE = 100;
+/* SQL Server refuses more than 1000 rows in a single VALUES clause */
+static const gint MAX_MULTI_ROW_INSERT_ROWS = 1000;
 
 #define MAX_FAILED_ATTEMPTS 3
 
@@ -760,6 +762,8 @@ afsql_dd_connect(LogThreadedDestDriver *s)
   return TRUE;
 }
 
+static void afsql_dd_reset_pending_insert(AFSqlDestDriver *self);
+
 static void
 afsql_dd_disconnect(LogThreadedDestDriver *s)
 {
@@ -767,6 +771,7 @@ afsql_dd_disconnect(LogThreadedDestDriver *s)
 
   dbi_conn_close(self->dbi_ctx);
   self->dbi_ctx = NULL;
+  afsql_dd_reset_pending_insert(self);
 }
 
 static GString *
@@ -895,14 +900,14 @@ afsql_dd_append_value_to_be_inserted(AFSqlDestDriver *self,
   return TRUE;
 }
 
-static GString *
-afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+/* appends "INSERT INTO table (columns) VALUES " */
+static void
+afsql_dd_append_insert_prefix(AFSqlDestDriver *self, GString *table, GString *insert_command)
 {
-  GString *insert_command = g_string_sized_new(256);
-  GString *value = g_string_sized_new(512);
   gint i, j;
 
-  g_string_printf(insert_command, "INSERT INTO %s%s%s (", self->quote_as_string, table->str, self->quote_as_string);
+  g_string_append_printf(insert_command, "INSERT INTO %s%s%s (", self->quote_as_string, table->str,
+                         self->quote_as_string);
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -919,7 +924,17 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ") VALUES (");
+  g_string_append(insert_command, ") VALUES ");
+}
+
+/* appends "(values)" of a single row, returns FALSE if the message is to be dropped */
+static gboolean
+afsql_dd_append_insert_row(AFSqlDestDriver *self, LogMessage *msg, GString *insert_command)
+{
+  GString *value = g_string_sized_new(512);
+  gint i, j;
+
+  g_string_append_c(insert_command, '(');
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -943,15 +958,29 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ")");
+  g_string_append_c(insert_command, ')');
   g_string_free(value, TRUE);
 
-  return insert_command;
+  return TRUE;
 
 drop:
   g_string_free(value, TRUE);
-  g_string_free(insert_command, TRUE);
-  return NULL;
+  return FALSE;
+}
+
+static GString *
+afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *insert_command = g_string_sized_new(256);
+
+  afsql_dd_append_insert_prefix(self, table, insert_command);
+  if (!afsql_dd_append_insert_row(self, msg, insert_command))
+    {
+      g_string_free(insert_command, TRUE);
+      return NULL;
+    }
+
+  return insert_command;
 }
 
 static inline gboolean
@@ -966,6 +995,12 @@ afsql_dd_should_begin_new_transaction(const AFSqlDestDriver *self)
   return afsql_dd_is_transaction_handling_enabled(self) && self->super.worker.instance.batch_size == 1;
 }
 
+static inline gboolean
+afsql_dd_is_multi_row_insert_enabled(const AFSqlDestDriver *self)
+{
+  return !!(self->super.flags & AFSQL_DDF_MULTI_ROW_INSERTS);
+}
+
 static gint
 _batch_lines(const AFSqlDestDriver *self)
 {
@@ -1007,20 +1042,146 @@ afsql_dd_handle_insert_row_error_depending_on_connection_availability(AFSqlDestD
   return LTR_ERROR;
 }
 
+static void
+afsql_dd_report_format_error(AFSqlDestDriver *self)
+{
+  if (self->template_options.on_error & ON_ERROR_SILENT)
+    return;
+
+  msg_error("Failed to format message for SQL, dropping message",
+            evt_tag_str("type", self->type),
+            evt_tag_str("host", self->host),
+            evt_tag_str("port", self->port),
+            evt_tag_str("username", self->user),
+            evt_tag_str("database", self->database),
+            evt_tag_str("error", "error converting name-value pair to the requested type"));
+}
+
+/*
+ * Multi-row inserts
+ *
+ * With flags(multi-row-inserts), rows are collected into a single
+ * "INSERT INTO table (columns) VALUES (...), (...)" statement, which is
+ * executed when the batch is flushed, when the target table changes or
+ * when the statement reaches MAX_MULTI_ROW_INSERT_ROWS rows.  A failing
+ * statement rewinds the whole batch.
+ *
+ * flags(explicit-commits) is required: statements executed in the middle
+ * of a batch would otherwise be committed without their messages being
+ * acknowledged, and a later failure would insert them once more.
+ *
+ * Rows that fail to format are left out of the statement.  They are only
+ * dropped once the rest of the batch is flushed successfully: until then
+ * the batch might be rewound as a whole, and dropping them right away
+ * would acknowledge some other message of the backlog in their place.
+ */
+static void
+afsql_dd_reset_pending_insert(AFSqlDestDriver *self)
+{
+  g_string_truncate(self->pending_insert.table, 0);
+  g_string_truncate(self->pending_insert.command, 0);
+  self->pending_insert.rows = 0;
+}
+
+static LogThreadedResult
+afsql_dd_run_pending_insert(AFSqlDestDriver *self)
+{
+  if (self->pending_insert.rows == 0)
+    return LTR_SUCCESS;
+
+  gboolean success = afsql_dd_run_query(self, self->pending_insert.command->str, FALSE, NULL);
+  afsql_dd_reset_pending_insert(self);
+  if (!success)
+    return afsql_dd_handle_insert_row_error_depending_on_connection_availability(self);
+
+  return LTR_SUCCESS;
+}
+
+static gboolean
+afsql_dd_pending_insert_needs_to_run_before(AFSqlDestDriver *self, GString *table)
+{
+  if (self->pending_insert.rows == 0)
+    return FALSE;
+
+  return self->pending_insert.rows >= MAX_MULTI_ROW_INSERT_ROWS ||
+         !g_string_equal(self->pending_insert.table, table);
+}
+
+static void
+afsql_dd_drop_pending_format_errors(AFSqlDestDriver *self)
+{
+  if (self->pending_insert.dropped_rows == 0)
+    return;
+
+  log_threaded_dest_worker_drop_messages(&self->super.worker.instance, self->pending_insert.dropped_rows);
+  self->pending_insert.dropped_rows = 0;
+}
+
+static LogThreadedResult
+afsql_dd_add_row_to_pending_insert(AFSqlDestDriver *self, GString *table, LogMessage *msg)
+{
+  GString *insert_command = self->pending_insert.command;
+
+  /* a new batch, the previous one was either flushed or rewound */
+  if (self->super.worker.instance.batch_size == 1)
+    {
+      afsql_dd_reset_pending_insert(self);
+      self->pending_insert.dropped_rows = 0;
+    }
+
+  if (afsql_dd_pending_insert_needs_to_run_before(self, table))
+    {
+      LogThreadedResult result = afsql_dd_run_pending_insert(self);
+      if (result != LTR_SUCCESS)
+        return result;
+    }
+
+  gsize rollback_len = insert_command->len;
+  if (self->pending_insert.rows == 0)
+    {
+      g_string_assign(self->pending_insert.table, table->str);
+      afsql_dd_append_insert_prefix(self, table, insert_command);
+    }
+  else
+    {
+      g_string_append(insert_command, ", ");
+    }
+
+  if (!afsql_dd_append_insert_row(self, msg, insert_command))
+    {
+      g_string_truncate(insert_command, rollback_len);
+      afsql_dd_report_format_error(self);
+      self->pending_insert.dropped_rows++;
+      return LTR_QUEUED;
+    }
+
+  self->pending_insert.rows++;
+  return LTR_QUEUED;
+}
+
 static LogThreadedResult
 afsql_dd_flush(LogThreadedDestDriver *s)
 {
   AFSqlDestDriver *self = (AFSqlDestDriver *) s;
 
-  if (!afsql_dd_is_transaction_handling_enabled(self))
-    return LTR_SUCCESS;
+  if (afsql_dd_is_multi_row_insert_enabled(self))
+    {
+      LogThreadedResult result = afsql_dd_run_pending_insert(self);
+      if (result != LTR_SUCCESS)
+        {
+          afsql_dd_rollback_transaction(self);
+          return result;
+        }
+    }
 
-  if (!afsql_dd_commit_transaction(self))
+  if (afsql_dd_is_transaction_handling_enabled(self) && !afsql_dd_commit_transaction(self))
     {
       /* Assuming that in case of error, the queue is rewound by afsql_dd_commit_transaction() */
       afsql_dd_rollback_transaction(self);
       return LTR_ERROR;
     }
+
+  afsql_dd_drop_pending_format_errors(self);
   return LTR_SUCCESS;
 }
 
@@ -1028,7 +1189,6 @@ static LogThreadedResult
 afsql_dd_run_insert_query(AFSqlDestDriver *self, GString *table, LogMessage *msg)
 {
   GString *insert_command;
-  gboolean drop_silently = self->template_options.on_error & ON_ERROR_SILENT;
 
   insert_command = afsql_dd_build_insert_command(self, msg, table);
   if (insert_command)
@@ -1044,16 +1204,7 @@ afsql_dd_run_insert_query(AFSqlDestDriver *self, GString *table, LogMessage *msg
     }
   else
     {
-      if (!drop_silently)
-        {
-          msg_error("Failed to format message for SQL, dropping message",
-                    evt_tag_str("type", self->type),
-                    evt_tag_str("host", self->host),
-                    evt_tag_str("port", self->port),
-                    evt_tag_str("username", self->user),
-                    evt_tag_str("database", self->database),
-                    evt_tag_str("error", "error converting name-value pair to the requested type"));
-        }
+      afsql_dd_report_format_error(self);
       return LTR_DROP;
     }
 }
@@ -1080,7 +1231,10 @@ afsql_dd_insert(LogThreadedDestDriver *s, LogMessage *msg)
   if (afsql_dd_should_begin_new_transaction(self) && !afsql_dd_begin_transaction(self))
     goto error;
 
-  retval = afsql_dd_run_insert_query(self, table, msg);
+  if (afsql_dd_is_multi_row_insert_enabled(self))
+    retval = afsql_dd_add_row_to_pending_insert(self, table, msg);
+  else
+    retval = afsql_dd_run_insert_query(self, table, msg);
 
 error:
   if (table != NULL)
@@ -1261,6 +1415,20 @@ afsql_dd_init(LogPipe *s)
                   evt_tag_str("type", self->type));
     }
 
+  if (afsql_dd_is_multi_row_insert_enabled(self) && strcmp(self->type, s_oracle) == 0)
+    {
+      msg_warning("WARNING: flags(multi-row-inserts) was ignored as Oracle does not support multi-row INSERT statements",
+                  evt_tag_str("type", self->type));
+      self->super.flags &= ~AFSQL_DDF_MULTI_ROW_INSERTS;
+    }
+
+  if (afsql_dd_is_multi_row_insert_enabled(self) && !afsql_dd_is_transaction_handling_enabled(self))
+    {
+      msg_error("flags(multi-row-inserts) requires flags(explicit-commits)",
+                evt_tag_str("type", self->type));
+      return FALSE;
+    }
+
   if (!_init_fields_from_columns_and_values(self))
     return FALSE;
 
@@ -1298,6 +1466,8 @@ afsql_dd_free(LogPipe *s)
   g_free(self->database);
   g_free(self->encoding);
   g_free(self->create_statement_append);
+  g_string_free(self->pending_insert.table, TRUE);
+  g_string_free(self->pending_insert.command, TRUE);
   if (self->null_value)
     g_free(self->null_value);
   string_list_free(self->columns);
@@ -1345,6 +1515,8 @@ afsql_dd_new(GlobalConfig *cfg)
   self->quote_as_string = g_strdup("");;
 
   self->session_statements = NULL;
+  self->pending_insert.table = g_string_sized_new(32);
+  self->pending_insert.command = g_string_sized_new(4096);
 
   self->syslogng_conform_tables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
   self->dbd_options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
@@ -1361,6 +1533,7 @@ CfgFlagHandler afsql_dd_flag_handlers[] =
 {
   { "explicit-commits",   CFH_SET, offsetof(LogThreadedDestDriver, flags), AFSQL_DDF_EXPLICIT_COMMITS },
   { "dont-create-tables", CFH_SET, offsetof(LogThreadedDestDriver, flags), AFSQL_DDF_DONT_CREATE_TABLES },
+  { "multi-row-inserts",  CFH_SET, offsetof(LogThreadedDestDriver, flags), AFSQL_DDF_MULTI_ROW_INSERTS },
   { NULL },
 };
 
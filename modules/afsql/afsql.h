@@ -41,6 +41,7 @@ enum
 {
   AFSQL_DDF_EXPLICIT_COMMITS = 0x1000,
   AFSQL_DDF_DONT_CREATE_TABLES = 0x2000,
+  AFSQL_DDF_MULTI_ROW_INSERTS = 0x4000,
 };
 
 typedef struct _AFSqlField
@@ -96,6 +97,16 @@ typedef struct _AFSqlDestDriver
   GHashTable *syslogng_conform_tables;
   guint32 failed_message_counter;
   gboolean transaction_active;
+
+  /* multi-row INSERT being collected, used exclusively by the db thread */
+  struct
+  {
+    GString *table;
+    GString *command;
+    gint rows;
+    /* rows of the current batch that failed to format, dropped when the batch is flushed */
+    gint dropped_rows;
+  } pending_insert;
 } AFSqlDestDriver;
 
 
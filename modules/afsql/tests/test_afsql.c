@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/cr_template.h"
+
+#include "afsql.h"
+#include "logthrdest/logthrdestdrv.h"
+#include "mainloop.h"
+#include "mainloop-worker.h"
+#include "string-list.h"
+#include "on-error.h"
+#include "apphook.h"
+
+#include <glib/gstdio.h>
+
+/*
+ * These tests use the sqlite3 DBD driver of libdbi, they are skipped if
+ * it is not installed.
+ */
+
+#define MAX_SPIN_ITERATIONS 10000
+
+static MainLoop *main_loop;
+static MainLoopOptions main_loop_options = {0};
+static gchar *db_dir;
+static gchar *db_file;
+static AFSqlDestDriver *dd;
+
+static gboolean
+_sqlite3_driver_available(void)
+{
+  dbi_inst instance;
+  gboolean available;
+
+  if (dbi_initialize_r(NULL, &instance) < 0)
+    return FALSE;
+
+  available = dbi_driver_open_r("sqlite3", instance) != NULL;
+  dbi_shutdown_r(instance);
+  return available;
+}
+
+static void
+_sleep_msec(long msec)
+{
+  struct timespec sleep_time = { msec / 1000, (msec % 1000) * 1000000 };
+  nanosleep(&sleep_time, NULL);
+}
+
+static void
+_spin_for_counter_value(StatsCounterItem *counter, gssize expected_value)
+{
+  gssize value = stats_counter_get(counter);
+
+  for (gint c = 0; value != expected_value && c < MAX_SPIN_ITERATIONS; c++)
+    {
+      _sleep_msec(1);
+      value = stats_counter_get(counter);
+    }
+  cr_assert_eq(value, expected_value,
+               "counter did not reach the expected value, expected_value=%" G_GSSIZE_FORMAT
+               ", value=%" G_GSSIZE_FORMAT, expected_value, value);
+}
+
+static LogTemplate *
+_compile_template(const gchar *template, const gchar *type_hint)
+{
+  LogTemplate *t = log_template_new(main_loop_get_current_config(main_loop), NULL);
+
+  cr_assert(log_template_compile(t, template, NULL));
+  if (type_hint)
+    cr_assert(log_template_set_type_hint(t, type_hint, NULL));
+  return t;
+}
+
+static LogDriver *
+_new_driver(const gchar *table, gint batch_lines)
+{
+  GlobalConfig *cfg = main_loop_get_current_config(main_loop);
+  LogDriver *d = afsql_dd_new(cfg);
+
+  afsql_dd_set_type(d, "sqlite3");
+  afsql_dd_set_database(d, db_file);
+  afsql_dd_set_table(d, _compile_template(table, NULL));
+  afsql_dd_set_columns(d, string_vargs_to_list("pid int", "program", NULL));
+  afsql_dd_set_values(d, g_list_append(g_list_append(NULL, _compile_template("$PID", "int")),
+                                       _compile_template("$PROGRAM", NULL)));
+  cr_assert(afsql_dd_process_flag(d, "multi-row-inserts"));
+  log_threaded_dest_driver_set_batch_lines(d, batch_lines);
+
+  AFSqlDestDriver *self = (AFSqlDestDriver *) d;
+  self->template_options.on_error = ON_ERROR_DROP_MESSAGE | ON_ERROR_SILENT;
+  self->super.batch_timeout = 0;
+  return d;
+}
+
+static void
+_create_driver(const gchar *table, gint batch_lines)
+{
+  LogDriver *d = _new_driver(table, batch_lines);
+
+  cr_assert(afsql_dd_process_flag(d, "explicit-commits"));
+  dd = (AFSqlDestDriver *) d;
+
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+  cr_assert(log_pipe_post_config_init(&dd->super.super.super.super));
+}
+
+static void
+_destroy_driver(void)
+{
+  main_loop_sync_worker_startup_and_teardown();
+  log_pipe_deinit(&dd->super.super.super.super);
+  log_pipe_unref(&dd->super.super.super.super);
+  dd = NULL;
+}
+
+static void
+_send_message(const gchar *pid, const gchar *program)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+  LogMessage *msg = create_sample_message();
+
+  log_msg_set_value(msg, LM_V_PID, pid, -1);
+  log_msg_set_value(msg, LM_V_PROGRAM, program, -1);
+  log_pipe_queue(&dd->super.super.super.super, msg, &path_options);
+}
+
+static void
+_send_messages(gint n, const gchar *program)
+{
+  gchar pid[16];
+
+  for (gint i = 0; i < n; i++)
+    {
+      g_snprintf(pid, sizeof(pid), "%d", i);
+      _send_message(pid, program);
+    }
+}
+
+static gint
+_count_rows(const gchar *table)
+{
+  dbi_inst instance;
+  gint rows;
+
+  cr_assert(dbi_initialize_r(NULL, &instance) > 0);
+
+  dbi_conn conn = dbi_conn_new_r("sqlite3", instance);
+  dbi_conn_set_option(conn, "sqlite3_dbdir", "/");
+  dbi_conn_set_option(conn, "dbname", db_file);
+  cr_assert(dbi_conn_connect(conn) >= 0);
+
+  dbi_result result = dbi_conn_queryf(conn, "SELECT pid FROM %s", table);
+  cr_assert_not_null(result, "table %s does not exist", table);
+  rows = dbi_result_get_numrows(result);
+
+  dbi_result_free(result);
+  dbi_conn_close(conn);
+  dbi_shutdown_r(instance);
+  return rows;
+}
+
+Test(afsql, test_multi_row_inserts_write_every_message_of_the_batch)
+{
+  if (!_sqlite3_driver_available())
+    cr_skip_test("sqlite3 DBD driver is not available");
+
+  _create_driver("messages", 10);
+  _send_messages(25, "prog");
+  _spin_for_counter_value(dd->super.metrics.written_messages, 25);
+  cr_assert_eq(stats_counter_get(dd->super.metrics.dropped_messages), 0);
+  _destroy_driver();
+
+  cr_assert_eq(_count_rows("messages"), 25);
+}
+
+Test(afsql, test_partial_batch_is_inserted_when_flushed)
+{
+  if (!_sqlite3_driver_available())
+    cr_skip_test("sqlite3 DBD driver is not available");
+
+  /* the queue gets empty long before batch-lines() is reached */
+  _create_driver("messages", 100);
+  _send_messages(7, "prog");
+  _spin_for_counter_value(dd->super.metrics.written_messages, 7);
+  _destroy_driver();
+
+  cr_assert_eq(_count_rows("messages"), 7);
+}
+
+Test(afsql, test_table_change_within_a_batch_starts_a_new_statement)
+{
+  if (!_sqlite3_driver_available())
+    cr_skip_test("sqlite3 DBD driver is not available");
+
+  _create_driver("table_${PROGRAM}", 100);
+  _send_messages(3, "foo");
+  _send_messages(2, "bar");
+  _send_messages(4, "foo");
+  _spin_for_counter_value(dd->super.metrics.written_messages, 9);
+  _destroy_driver();
+
+  cr_assert_eq(_count_rows("table_foo"), 7);
+  cr_assert_eq(_count_rows("table_bar"), 2);
+}
+
+Test(afsql, test_rows_failing_to_format_are_dropped_and_the_rest_is_written)
+{
+  if (!_sqlite3_driver_available())
+    cr_skip_test("sqlite3 DBD driver is not available");
+
+  _create_driver("messages", 10);
+  _send_message("1", "prog");
+  _send_message("not-a-number", "prog");
+  _send_message("3", "prog");
+  _send_message("also-not-a-number", "prog");
+  _send_message("5", "prog");
+  _spin_for_counter_value(dd->super.metrics.written_messages, 3);
+  _spin_for_counter_value(dd->super.metrics.dropped_messages, 2);
+  cr_assert_eq(stats_counter_get(dd->super.worker.instance.queue->metrics.shared.memory_usage), 0);
+  _destroy_driver();
+
+  cr_assert_eq(_count_rows("messages"), 3);
+}
+
+Test(afsql, test_multi_row_inserts_require_explicit_commits)
+{
+  LogDriver *d = _new_driver("messages", 10);
+
+  cr_assert_not(log_pipe_init(&d->super));
+  log_pipe_unref(&d->super);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+  cfg_set_current_version(main_loop_get_current_config(main_loop));
+  main_loop_worker_allocate_thread_space(2);
+  main_loop_worker_finalize_thread_space();
+
+  db_dir = g_dir_make_tmp("test_afsql_XXXXXX", NULL);
+  cr_assert_not_null(db_dir);
+  db_file = g_build_filename(db_dir, "test.db", NULL);
+}
+
+static void
+teardown(void)
+{
+  g_unlink(db_file);
+  g_rmdir(db_dir);
+  g_free(db_file);
+  g_free(db_dir);
+
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(afsql, .init = setup, .fini = teardown);
@@ -26,43 +26,59 @@
 #include "timeutils/cache.h"
 #include "timeutils/misc.h"
 
+static inline CorrelationStateShard *
+_get_shard(CorrelationState *self, const CorrelationKey *key)
+{
+  guint hash = correlation_key_hash(key);
+
+  /* the scope is stored in the top bits of the hash, fold the rest down */
+  hash ^= hash >> 16;
+  return &self->shards[hash % CORRELATION_STATE_NUM_SHARDS];
+}
+
+/* NOTE: a transaction only locks the shard that owns @key, and all
+ * contexts accessed within the same transaction must belong to that key. */
 void
-correlation_state_tx_begin(CorrelationState *self)
+correlation_state_tx_begin(CorrelationState *self, const CorrelationKey *key)
 {
-  g_mutex_lock(&self->lock);
+  g_mutex_lock(&_get_shard(self, key)->lock);
 }
 
 void
-correlation_state_tx_end(CorrelationState *self)
+correlation_state_tx_end(CorrelationState *self, const CorrelationKey *key)
 {
-  g_mutex_unlock(&self->lock);
+  g_mutex_unlock(&_get_shard(self, key)->lock);
 }
 
 CorrelationContext *
 correlation_state_tx_lookup_context(CorrelationState *self, const CorrelationKey *key)
 {
-  return g_hash_table_lookup(self->state, key);
+  return g_hash_table_lookup(_get_shard(self, key)->state, key);
 }
 
 void
 correlation_state_tx_store_context(CorrelationState *self, CorrelationContext *context, gint timeout)
 {
+  CorrelationStateShard *shard = _get_shard(self, &context->key);
+
   g_assert(context->timer == NULL);
 
-  g_hash_table_insert(self->state, &context->key, context);
-  context->timer = timer_wheel_add_timer(self->timer_wheel, timeout, self->expire_callback,
+  g_hash_table_insert(shard->state, &context->key, context);
+  context->timer = timer_wheel_add_timer(shard->timer_wheel, timeout, self->expire_callback,
                                          correlation_context_ref(context), (GDestroyNotify) correlation_context_unref);
 }
 
 void
 correlation_state_tx_remove_context(CorrelationState *self, CorrelationContext *context)
 {
+  CorrelationStateShard *shard = _get_shard(self, &context->key);
+
   /* NOTE: in expire callbacks our timer is already deleted and thus it is
    * set to NULL in which case we don't need to remove it again.  */
 
   if (context->timer)
-    timer_wheel_del_timer(self->timer_wheel, context->timer);
-  g_hash_table_remove(self->state, &context->key);
+    timer_wheel_del_timer(shard->timer_wheel, context->timer);
+  g_hash_table_remove(shard->state, &context->key);
 }
 
 void
@@ -70,26 +86,51 @@ correlation_state_tx_update_context(CorrelationState *self, CorrelationContext *
 {
   g_assert(context->timer != NULL);
 
-  timer_wheel_mod_timer(self->timer_wheel, context->timer, timeout);
+  timer_wheel_mod_timer(_get_shard(self, &context->key)->timer_wheel, context->timer, timeout);
+}
+
+/* NOTE: requires time_lock to be held.  The new time is published before
+ * the shards are advanced, so that the fast path in
+ * correlation_state_set_time() does not queue up on time_lock while the
+ * shards are expiring their contexts. */
+static void
+_advance_shards_to(CorrelationState *self, guint64 new_time, gpointer caller_context)
+{
+  if (new_time <= (guint64) atomic_gssize_get(&self->now))
+    return;
+
+  atomic_gssize_set(&self->now, (gssize) new_time);
+  for (gint i = 0; i < CORRELATION_STATE_NUM_SHARDS; i++)
+    {
+      CorrelationStateShard *shard = &self->shards[i];
+
+      g_mutex_lock(&shard->lock);
+      timer_wheel_set_time(shard->timer_wheel, new_time, caller_context);
+      g_mutex_unlock(&shard->lock);
+    }
 }
 
 void
 correlation_state_expire_all(CorrelationState *self, gpointer caller_context)
 {
-  g_mutex_lock(&self->lock);
-  timer_wheel_expire_all(self->timer_wheel, caller_context);
-  g_mutex_unlock(&self->lock);
+  g_mutex_lock(&self->time_lock);
+  for (gint i = 0; i < CORRELATION_STATE_NUM_SHARDS; i++)
+    {
+      CorrelationStateShard *shard = &self->shards[i];
+
+      g_mutex_lock(&shard->lock);
+      timer_wheel_expire_all(shard->timer_wheel, caller_context);
+      g_mutex_unlock(&shard->lock);
+    }
+  g_mutex_unlock(&self->time_lock);
 }
 
 void
 correlation_state_advance_time(CorrelationState *self, gint timeout, gpointer caller_context)
 {
-  guint64  new_time;
-
-  g_mutex_lock(&self->lock);
-  new_time = timer_wheel_get_time(self->timer_wheel) + timeout;
-  timer_wheel_set_time(self->timer_wheel, new_time, caller_context);
-  g_mutex_unlock(&self->lock);
+  g_mutex_lock(&self->time_lock);
+  _advance_shards_to(self, correlation_state_get_time(self) + timeout, caller_context);
+  g_mutex_unlock(&self->time_lock);
 }
 
 void
@@ -108,15 +149,20 @@ correlation_state_set_time(CorrelationState *self, guint64 sec, gpointer caller_
   if (sec < now.tv_sec)
     now.tv_sec = sec;
 
-  g_mutex_lock(&self->lock);
-  timer_wheel_set_time(self->timer_wheel, now.tv_sec, caller_context);
-  g_mutex_unlock(&self->lock);
+  /* time does not move backwards, most messages won't move it forward
+   * either, so avoid the lock in that case */
+  if ((guint64) now.tv_sec <= correlation_state_get_time(self))
+    return;
+
+  g_mutex_lock(&self->time_lock);
+  _advance_shards_to(self, now.tv_sec, caller_context);
+  g_mutex_unlock(&self->time_lock);
 }
 
 guint64
 correlation_state_get_time(CorrelationState *self)
 {
-  return timer_wheel_get_time(self->timer_wheel);
+  return (guint64) atomic_gssize_get(&self->now);
 }
 
 gboolean
@@ -126,7 +172,7 @@ correlation_state_timer_tick(CorrelationState *self, gpointer caller_context)
   glong diff;
   gboolean updated = FALSE;
 
-  g_mutex_lock(&self->lock);
+  g_mutex_lock(&self->time_lock);
   get_cached_realtime(&now);
   diff = timespec_diff_usec(&now, &self->last_tick);
 
@@ -134,7 +180,7 @@ correlation_state_timer_tick(CorrelationState *self, gpointer caller_context)
     {
       glong diff_sec = (glong)(diff / 1e6);
 
-      timer_wheel_set_time(self->timer_wheel, timer_wheel_get_time(self->timer_wheel) + diff_sec, caller_context);
+      _advance_shards_to(self, correlation_state_get_time(self) + diff_sec, caller_context);
       /* update last_tick, take the fraction of the seconds not calculated into this update into account */
 
       self->last_tick = now;
@@ -149,20 +195,57 @@ correlation_state_timer_tick(CorrelationState *self, gpointer caller_context)
        */
       self->last_tick = now;
     }
-  g_mutex_unlock(&self->lock);
+  g_mutex_unlock(&self->time_lock);
   return updated;
 }
 
+static void
+_free_assoc_data(CorrelationState *self)
+{
+  if (self->assoc_data && self->assoc_data_free)
+    self->assoc_data_free(self->assoc_data);
+  self->assoc_data = NULL;
+}
+
+/* The associated data is shared by the timer wheels of all shards, expire
+ * callbacks can retrieve it using timer_wheel_get_associated_data(). */
+void
+correlation_state_set_associated_data(CorrelationState *self, gpointer assoc_data, GDestroyNotify assoc_data_free)
+{
+  for (gint i = 0; i < CORRELATION_STATE_NUM_SHARDS; i++)
+    timer_wheel_set_associated_data(self->shards[i].timer_wheel, assoc_data, NULL);
+
+  _free_assoc_data(self);
+  self->assoc_data = assoc_data;
+  self->assoc_data_free = assoc_data_free;
+}
+
+static void
+_shard_init(CorrelationStateShard *shard)
+{
+  g_mutex_init(&shard->lock);
+  shard->state = g_hash_table_new_full(correlation_key_hash, correlation_key_equal, NULL,
+                                       (GDestroyNotify) correlation_context_unref);
+  shard->timer_wheel = timer_wheel_new();
+}
+
+static void
+_shard_deinit(CorrelationStateShard *shard)
+{
+  if (shard->state)
+    g_hash_table_destroy(shard->state);
+  timer_wheel_free(shard->timer_wheel);
+  g_mutex_clear(&shard->lock);
+}
 
 CorrelationState *
 correlation_state_new(TWCallbackFunc expire_callback)
 {
   CorrelationState *self = g_new0(CorrelationState, 1);
 
-  g_mutex_init(&self->lock);
-  self->state = g_hash_table_new_full(correlation_key_hash, correlation_key_equal, NULL,
-                                      (GDestroyNotify) correlation_context_unref);
-  self->timer_wheel = timer_wheel_new();
+  for (gint i = 0; i < CORRELATION_STATE_NUM_SHARDS; i++)
+    _shard_init(&self->shards[i]);
+  g_mutex_init(&self->time_lock);
   get_cached_realtime(&self->last_tick);
   g_atomic_counter_set(&self->ref_cnt, 1);
   self->expire_callback = expire_callback;
@@ -172,10 +255,10 @@ correlation_state_new(TWCallbackFunc expire_callback)
 void
 _free(CorrelationState *self)
 {
-  if (self->state)
-    g_hash_table_destroy(self->state);
-  timer_wheel_free(self->timer_wheel);
-  g_mutex_clear(&self->lock);
+  for (gint i = 0; i < CORRELATION_STATE_NUM_SHARDS; i++)
+    _shard_deinit(&self->shards[i]);
+  _free_assoc_data(self);
+  g_mutex_clear(&self->time_lock);
   g_free(self);
 }
 
@@ -28,19 +28,35 @@
 #include "correlation-context.h"
 #include "timerwheel.h"
 #include "timeutils/unixtime.h"
+#include "atomic-gssize.h"
 
-typedef struct _CorrelationState
+/* number of independently locked partitions of the correlation state,
+ * contexts are assigned to a shard based on the hash of their key */
+#define CORRELATION_STATE_NUM_SHARDS 16
+
+typedef struct _CorrelationStateShard
 {
-  GAtomicCounter ref_cnt;
   GMutex lock;
   GHashTable *state;
   TimerWheel *timer_wheel;
+} CorrelationStateShard;
+
+typedef struct _CorrelationState
+{
+  GAtomicCounter ref_cnt;
+  CorrelationStateShard shards[CORRELATION_STATE_NUM_SHARDS];
   TWCallbackFunc expire_callback;
+  gpointer assoc_data;
+  GDestroyNotify assoc_data_free;
+
+  /* protects moving the time forward, always acquired before shard locks */
+  GMutex time_lock;
+  atomic_gssize now;
   struct timespec last_tick;
 } CorrelationState;
 
-void correlation_state_tx_begin(CorrelationState *self);
-void correlation_state_tx_end(CorrelationState *self);
+void correlation_state_tx_begin(CorrelationState *self, const CorrelationKey *key);
+void correlation_state_tx_end(CorrelationState *self, const CorrelationKey *key);
 CorrelationContext *correlation_state_tx_lookup_context(CorrelationState *self, const CorrelationKey *key);
 void correlation_state_tx_store_context(CorrelationState *self, CorrelationContext *context, gint timeout);
 void correlation_state_tx_remove_context(CorrelationState *self, CorrelationContext *context);
@@ -51,6 +67,7 @@ guint64 correlation_state_get_time(CorrelationState *self);
 gboolean correlation_state_timer_tick(CorrelationState *self, gpointer caller_context);
 void correlation_state_expire_all(CorrelationState *self, gpointer caller_context);
 void correlation_state_advance_time(CorrelationState *self, gint timeout, gpointer caller_context);
+void correlation_state_set_associated_data(CorrelationState *self, gpointer assoc_data, GDestroyNotify assoc_data_free);
 
 void correlation_state_init_instance(CorrelationState *self);
 void correlation_state_deinit_instance(CorrelationState *self);
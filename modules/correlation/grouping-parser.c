@@ -124,8 +124,8 @@ _load_correlation_state(GroupingParser *self, GlobalConfig *cfg)
       self->correlation = persisted_correlation;
     }
 
-  timer_wheel_set_associated_data(self->correlation->timer_wheel, log_pipe_ref((LogPipe *)self),
-                                  (GDestroyNotify)log_pipe_unref);
+  correlation_state_set_associated_data(self->correlation, log_pipe_ref((LogPipe *)self),
+                                        (GDestroyNotify)log_pipe_unref);
 }
 
 static void
@@ -180,6 +180,9 @@ _expire_entry(TimerWheel *wheel, guint64 now, gpointer user_data, gpointer calle
 }
 
 
+/* NOTE: this starts a transaction on the correlation state shard that
+ * holds the context, the caller is expected to finish it by calling
+ * correlation_state_tx_end() with the key of the returned context. */
 CorrelationContext *
 grouping_parser_lookup_or_create_context(GroupingParser *self, LogMessage *msg)
 {
@@ -190,6 +193,7 @@ grouping_parser_lookup_or_create_context(GroupingParser *self, LogMessage *msg)
   log_template_format(self->key_template, msg, &DEFAULT_TEMPLATE_EVAL_OPTIONS, buffer);
 
   correlation_key_init(&key, self->scope, msg, buffer->str);
+  correlation_state_tx_begin(self->correlation, &key);
   context = correlation_state_tx_lookup_context(self->correlation, &key);
   if (!context)
     {
@@ -221,7 +225,7 @@ _aggregate_and_emit(GroupingParser *self, CorrelationContext *context, StatefulP
 {
   LogMessage *genmsg = grouping_parser_aggregate_context(self, context);
   correlation_state_tx_update_context(self->correlation, context, self->timeout);
-  correlation_state_tx_end(self->correlation);
+  correlation_state_tx_end(self->correlation, &context->key);
   if (genmsg)
     {
       stateful_parser_emitted_messages_add(emitted_messages, genmsg);
@@ -232,8 +236,6 @@ _aggregate_and_emit(GroupingParser *self, CorrelationContext *context, StatefulP
 void
 grouping_parser_perform_grouping(GroupingParser *self, LogMessage *msg, StatefulParserEmittedMessages *emitted_messages)
 {
-  correlation_state_tx_begin(self->correlation);
-
   CorrelationContext *context = grouping_parser_lookup_or_create_context(self, msg);
 
   GroupingParserUpdateContextResult r = grouping_parser_update_context(self, context, msg);
@@ -246,7 +248,7 @@ grouping_parser_perform_grouping(GroupingParser *self, LogMessage *msg, Stateful
                 evt_tag_int("expiration", correlation_state_get_time(self->correlation) + self->timeout),
                 log_pipe_location_tag(&self->super.super.super));
       correlation_state_tx_update_context(self->correlation, context, self->timeout);
-      correlation_state_tx_end(self->correlation);
+      correlation_state_tx_end(self->correlation, &context->key);
     }
   else if (r == GP_CONTEXT_COMPLETE)
     {
@@ -57,6 +57,7 @@ typedef struct _PDBProcessParams
   gpointer emitted_messages[EXPECTED_NUMBER_OF_MESSAGES_EMITTED];
   GPtrArray *emitted_messages_overflow;
   gint num_emitted_messages;
+  GPtrArray *created_contexts;
 } PDBProcessParams;
 
 struct _PatternDB
@@ -65,6 +66,7 @@ struct _PatternDB
   PDBRuleSet *ruleset;
   CorrelationState *correlation;
   LogTemplate *program_template;
+  GMutex rate_limits_lock;
   GHashTable *rate_limits;
   PatternDBEmitFunc emit;
   gpointer emit_data;
@@ -132,6 +134,29 @@ _flush_emitted_messages(PatternDB *self, PDBProcessParams *process_params)
     }
 }
 
+/* Contexts created by create-context actions may belong to a different
+ * shard of the correlation state than the one locked while the actions
+ * are executed.  They are collected in process_params and stored here,
+ * with no locks held, so that we never hold two shard locks at the same
+ * time.  */
+static void
+_store_created_contexts(PatternDB *self, PDBProcessParams *process_params)
+{
+  if (!process_params->created_contexts)
+    return;
+
+  for (gint i = 0; i < process_params->created_contexts->len; i++)
+    {
+      PDBContext *context = g_ptr_array_index(process_params->created_contexts, i);
+
+      correlation_state_tx_begin(self->correlation, &context->super.key);
+      correlation_state_tx_store_context(self->correlation, &context->super, context->rule->context.timeout);
+      correlation_state_tx_end(self->correlation, &context->super.key);
+    }
+  g_ptr_array_free(process_params->created_contexts, TRUE);
+  process_params->created_contexts = NULL;
+}
+
 /*
  * Timing
  * ======
@@ -188,6 +213,7 @@ _is_action_within_rate_limit(PatternDB *db, PDBProcessParams *process_params)
   g_string_printf(buffer, "%s:%d", rule->rule_id, action->id);
   correlation_key_init(&key, rule->context.scope, msg, buffer->str);
 
+  g_mutex_lock(&db->rate_limits_lock);
   rl = g_hash_table_lookup(db->rate_limits, &key);
   if (!rl)
     {
@@ -221,12 +247,14 @@ _is_action_within_rate_limit(PatternDB *db, PDBProcessParams *process_params)
           rl->last_check = now;
         }
     }
+  gboolean within_rate_limit = FALSE;
   if (rl->buckets)
     {
       rl->buckets--;
-      return TRUE;
+      within_rate_limit = TRUE;
     }
-  return FALSE;
+  g_mutex_unlock(&db->rate_limits_lock);
+  return within_rate_limit;
 }
 
 static gboolean
@@ -319,12 +347,16 @@ _execute_action_create_context(PatternDB *db, PDBProcessParams *process_params)
 
   correlation_key_init(&key, syn_context->scope, context_msg, buffer->str);
   new_context = pdb_context_new(&key);
-  correlation_state_tx_store_context(db->correlation, &new_context->super, rule->context.timeout);
   g_string_free(buffer, FALSE);
 
   g_ptr_array_add(new_context->super.messages, context_msg);
 
   new_context->rule = pdb_rule_ref(rule);
+
+  /* stored by _store_created_contexts() once the correlation state is unlocked */
+  if (!process_params->created_contexts)
+    process_params->created_contexts = g_ptr_array_new();
+  g_ptr_array_add(process_params->created_contexts, new_context);
 }
 
 static void
@@ -376,8 +408,8 @@ _execute_rule_actions(PatternDB *db, PDBProcessParams *process_params, PDBAction
  * PatternDB
  *********************************************************/
 
-/* NOTE: this function requires PatternDB reader/writer lock to be
- * write-locked.
+/* NOTE: this function requires the correlation state shard of the
+ * context to be locked.
  *
  * Currently, it is, as timer_wheel_set_time() is only called with that
  * precondition, and timer-wheel callbacks are only called from within
@@ -426,6 +458,7 @@ pattern_db_timer_tick(PatternDB *self)
       msg_debug("Advancing patterndb current time because of timer tick",
                 evt_tag_long("utc", correlation_state_get_time(self->correlation)));
     }
+  _store_created_contexts(self, &process_params);
   _flush_emitted_messages(self, &process_params);
 }
 
@@ -445,6 +478,7 @@ pattern_db_advance_time(PatternDB *self, gint timeout)
   PDBProcessParams process_params= {0};
 
   correlation_state_advance_time(self->correlation, timeout, &process_params);
+  _store_created_contexts(self, &process_params);
   _flush_emitted_messages(self, &process_params);
 }
 
@@ -517,7 +551,6 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
   LogMessage *msg = process_params->msg;
   GString *buffer = g_string_sized_new(32);
 
-  correlation_state_tx_begin(self->correlation);
   if (rule->context.id_template)
     {
       CorrelationKey key;
@@ -526,6 +559,7 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
       log_msg_set_value(msg, context_id_handle, buffer->str, -1);
 
       correlation_key_init(&key, rule->context.scope, msg, buffer->str);
+      correlation_state_tx_begin(self->correlation, &key);
       context = (PDBContext *) correlation_state_tx_lookup_context(self->correlation, &key);
       if (!context)
         {
@@ -570,10 +604,12 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
   _execute_rule_actions(self, process_params, RAT_MATCH);
 
   pdb_rule_unref(rule);
-  correlation_state_tx_end(self->correlation);
 
   if (context)
-    log_msg_write_protect(msg);
+    {
+      correlation_state_tx_end(self->correlation, &context->super.key);
+      log_msg_write_protect(msg);
+    }
 
   g_string_free(buffer, TRUE);
 }
@@ -584,6 +620,7 @@ _pattern_db_advance_time_and_flush_expired(PatternDB *self, LogMessage *msg)
   PDBProcessParams process_params = {0};
 
   _advance_time_based_on_message(self, &process_params, &msg->timestamps[LM_TS_STAMP]);
+  _store_created_contexts(self, &process_params);
   _flush_emitted_messages(self, &process_params);
 }
 
@@ -609,6 +646,7 @@ _pattern_db_process(PatternDB *self, PDBLookupParams *lookup, GArray *dbg_list)
   if (process_params->rule)
     _pattern_db_process_matching_rule(self, process_params);
 
+  _store_created_contexts(self, process_params);
   _flush_emitted_messages(self, process_params);
 
   return process_params->rule != NULL;
@@ -648,6 +686,7 @@ pattern_db_expire_state(PatternDB *self)
   PDBProcessParams process_params = {0};
 
   correlation_state_expire_all(self->correlation, &process_params);
+  _store_created_contexts(self, &process_params);
   _flush_emitted_messages(self, &process_params);
 
 }
@@ -658,7 +697,7 @@ _init_state(PatternDB *self)
   self->rate_limits = g_hash_table_new_full(correlation_key_hash, correlation_key_equal, NULL,
                                             (GDestroyNotify) pdb_rate_limit_free);
   self->correlation = correlation_state_new(pattern_db_expire_entry);
-  timer_wheel_set_associated_data(self->correlation->timer_wheel, self, NULL);
+  correlation_state_set_associated_data(self->correlation, self, NULL);
 }
 
 static void
@@ -687,6 +726,7 @@ pattern_db_new(const gchar *prefix)
   self->prefix = g_strdup(prefix);
   self->ruleset = pdb_rule_set_new(self->prefix);
   g_mutex_init(&self->ruleset_lock);
+  g_mutex_init(&self->rate_limits_lock);
   _init_state(self);
   return self;
 }
@@ -699,6 +739,7 @@ pattern_db_free(PatternDB *self)
   if (self->ruleset)
     pdb_rule_set_free(self->ruleset);
   _destroy_state(self);
+  g_mutex_clear(&self->rate_limits_lock);
   g_mutex_clear(&self->ruleset_lock);
   g_free(self);
 }
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include <criterion/criterion.h>
+
+#include "correlation.h"
+#include "apphook.h"
+
+#define NUM_CONTEXTS 256
+
+static gint num_expired;
+
+static void
+_expire_context(TimerWheel *wheel, guint64 now, gpointer user_data, gpointer caller_context)
+{
+  CorrelationContext *context = user_data;
+  CorrelationState *state = timer_wheel_get_associated_data(wheel);
+
+  cr_assert_eq(caller_context, &num_expired);
+  context->timer = NULL;
+  correlation_state_tx_remove_context(state, context);
+  num_expired++;
+}
+
+static CorrelationState *
+_create_state(void)
+{
+  CorrelationState *state = correlation_state_new(_expire_context);
+
+  correlation_state_set_associated_data(state, state, NULL);
+  num_expired = 0;
+  return state;
+}
+
+static void
+_init_key(CorrelationKey *key, gint ndx)
+{
+  correlation_key_init(key, RCS_GLOBAL, NULL, g_strdup_printf("session%d", ndx));
+}
+
+static void
+_store_contexts(CorrelationState *state, gint timeout)
+{
+  for (gint i = 0; i < NUM_CONTEXTS; i++)
+    {
+      CorrelationKey key;
+
+      _init_key(&key, i);
+      correlation_state_tx_begin(state, &key);
+      correlation_state_tx_store_context(state, correlation_context_new(&key), timeout);
+      correlation_state_tx_end(state, &key);
+    }
+}
+
+static gint
+_count_contexts(CorrelationState *state)
+{
+  gint found = 0;
+
+  for (gint i = 0; i < NUM_CONTEXTS; i++)
+    {
+      CorrelationKey key;
+
+      _init_key(&key, i);
+      correlation_state_tx_begin(state, &key);
+      if (correlation_state_tx_lookup_context(state, &key))
+        found++;
+      correlation_state_tx_end(state, &key);
+      g_free(key.session_id);
+    }
+  return found;
+}
+
+Test(correlation_state, test_contexts_are_found_regardless_of_their_shard)
+{
+  CorrelationState *state = _create_state();
+
+  _store_contexts(state, 10);
+  cr_assert_eq(_count_contexts(state), NUM_CONTEXTS);
+
+  correlation_state_unref(state);
+}
+
+Test(correlation_state, test_contexts_of_all_shards_expire_as_time_advances)
+{
+  CorrelationState *state = _create_state();
+
+  _store_contexts(state, 10);
+
+  correlation_state_advance_time(state, 5, &num_expired);
+  cr_assert_eq(correlation_state_get_time(state), 5);
+  cr_assert_eq(num_expired, 0);
+  cr_assert_eq(_count_contexts(state), NUM_CONTEXTS);
+
+  correlation_state_advance_time(state, 6, &num_expired);
+  cr_assert_eq(correlation_state_get_time(state), 11);
+  cr_assert_eq(num_expired, NUM_CONTEXTS);
+  cr_assert_eq(_count_contexts(state), 0);
+
+  correlation_state_unref(state);
+}
+
+Test(correlation_state, test_updated_contexts_expire_later)
+{
+  CorrelationState *state = _create_state();
+
+  _store_contexts(state, 10);
+  correlation_state_advance_time(state, 5, &num_expired);
+
+  CorrelationKey key;
+  _init_key(&key, 0);
+  correlation_state_tx_begin(state, &key);
+  CorrelationContext *context = correlation_state_tx_lookup_context(state, &key);
+  correlation_state_tx_update_context(state, context, 10);
+  correlation_state_tx_end(state, &key);
+  g_free(key.session_id);
+
+  correlation_state_advance_time(state, 6, &num_expired);
+  cr_assert_eq(num_expired, NUM_CONTEXTS - 1);
+  cr_assert_eq(_count_contexts(state), 1);
+
+  correlation_state_advance_time(state, 5, &num_expired);
+  cr_assert_eq(num_expired, NUM_CONTEXTS);
+
+  correlation_state_unref(state);
+}
+
+Test(correlation_state, test_expire_all_expires_every_shard_without_moving_time)
+{
+  CorrelationState *state = _create_state();
+
+  correlation_state_advance_time(state, 100, &num_expired);
+  _store_contexts(state, 10);
+
+  correlation_state_expire_all(state, &num_expired);
+  cr_assert_eq(num_expired, NUM_CONTEXTS);
+  cr_assert_eq(_count_contexts(state), 0);
+  cr_assert_eq(correlation_state_get_time(state), 100);
+
+  correlation_state_unref(state);
+}
+
+Test(correlation_state, test_time_does_not_move_backwards)
+{
+  CorrelationState *state = _create_state();
+
+  correlation_state_set_time(state, 1000, &num_expired);
+  cr_assert_eq(correlation_state_get_time(state), 1000);
+
+  correlation_state_set_time(state, 500, &num_expired);
+  cr_assert_eq(correlation_state_get_time(state), 1000);
+
+  correlation_state_unref(state);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(correlation_state, .init = setup, .fini = teardown);
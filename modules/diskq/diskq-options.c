@@ -82,6 +82,18 @@ disk_queue_options_set_prealloc(DiskQueueOptions *self, gboolean prealloc)
   self->prealloc = prealloc;
 }
 
+void
+disk_queue_options_set_write_batch_size(DiskQueueOptions *self, gint write_batch_size)
+{
+  self->write_batch_size = write_batch_size;
+}
+
+void
+disk_queue_options_set_read_ahead_bytes(DiskQueueOptions *self, gint read_ahead_bytes)
+{
+  self->read_ahead_bytes = read_ahead_bytes;
+}
+
 void
 disk_queue_options_check_plugin_settings(DiskQueueOptions *self)
 {
@@ -134,6 +146,8 @@ disk_queue_options_set_default_options(DiskQueueOptions *self)
   self->dir = g_strdup(get_installation_path_for(SYSLOG_NG_PATH_LOCALSTATEDIR));
   self->truncate_size_ratio = -1;
   self->prealloc = -1;
+  self->write_batch_size = 0;
+  self->read_ahead_bytes = 0;
 }
 
 void
@@ -41,6 +41,8 @@ typedef struct _DiskQueueOptions
   gchar *dir;
   gdouble truncate_size_ratio;
   gboolean prealloc;
+  gint write_batch_size;
+  gint read_ahead_bytes;
 } DiskQueueOptions;
 
 void disk_queue_options_front_cache_size_set(DiskQueueOptions *self, gint front_cache_size);
@@ -53,6 +55,8 @@ void disk_queue_options_check_plugin_settings(DiskQueueOptions *self);
 void disk_queue_options_set_dir(DiskQueueOptions *self, const gchar *dir);
 void disk_queue_options_set_truncate_size_ratio(DiskQueueOptions *self, gdouble truncate_size_ratio);
 void disk_queue_options_set_prealloc(DiskQueueOptions *self, gboolean prealloc);
+void disk_queue_options_set_write_batch_size(DiskQueueOptions *self, gint write_batch_size);
+void disk_queue_options_set_read_ahead_bytes(DiskQueueOptions *self, gint read_ahead_bytes);
 void disk_queue_options_set_default_options(DiskQueueOptions *self);
 void disk_queue_options_destroy(DiskQueueOptions *self);
 
@@ -424,6 +424,118 @@ _push_tail_disk(LogQueueDiskNonReliable *self, LogMessage *msg, const LogPathOpt
   return result;
 }
 
+static void
+_drop_message_queue_full(LogQueueDiskNonReliable *self, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueue *s = &self->super.super;
+
+  msg_debug("Destination queue full, dropping message",
+            evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
+            evt_tag_long("queue_len", log_queue_get_length(s)),
+            evt_tag_int("flow_control_window_size", self->flow_control_window_size),
+            evt_tag_long("capacity_bytes", qdisk_get_maximum_size(self->super.qdisk)),
+            evt_tag_str("persist_name", s->persist_name));
+  log_queue_disk_drop_message(&self->super, msg, path_options);
+}
+
+/* Writes the messages starting at index first to disk in one go, stops at
+ * the first one that can't be serialized or doesn't fit.  A message that
+ * can't be serialized is dropped, the same way _push_tail() drops it.
+ * Returns the number of messages consumed from the batch.
+ */
+static gint
+_push_tail_disk_batch(LogQueueDiskNonReliable *self, LogQueueDiskInputBatch *batch, gint first)
+{
+  gboolean serialization_failed = FALSE;
+  gint last = first;
+  for (; last < batch->len; last++)
+    {
+      GString *serialized_msg = batch->serialized_msgs[last];
+
+      if (serialized_msg->len == 0 && !log_queue_disk_serialize_msg(&self->super, batch->msgs[last], serialized_msg))
+        {
+          g_string_truncate(serialized_msg, 0);
+          serialization_failed = TRUE;
+          break;
+        }
+    }
+
+  gint pushed = qdisk_push_tail_batch(self->super.qdisk, &batch->serialized_msgs[first], last - first, NULL);
+  for (gint i = first; i < first + pushed; i++)
+    {
+      log_msg_ack(batch->msgs[i], &batch->path_options[i], AT_PROCESSED);
+      log_msg_unref(batch->msgs[i]);
+      log_queue_queued_messages_inc(&self->super.super);
+    }
+
+  log_queue_disk_update_disk_related_counters(&self->super);
+
+  if (serialization_failed && first + pushed == last)
+    {
+      msg_error("Failed to serialize message for non-reliable disk-buffer, dropping message",
+                evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
+                evt_tag_str("persist_name", self->super.super.persist_name));
+      log_queue_disk_drop_message(&self->super, batch->msgs[last], &batch->path_options[last]);
+      return pushed + 1;
+    }
+
+  return pushed;
+}
+
+/* Same as _push_tail() for a whole batch of messages: the segment of each
+ * message is chosen the same way, but consecutive messages going to disk are
+ * written together.
+ */
+static void
+_write_input_batch(LogQueueDisk *s, LogQueueDiskInputBatch *batch)
+{
+  LogQueueDiskNonReliable *self = (LogQueueDiskNonReliable *) s;
+
+  g_mutex_lock(&s->super.lock);
+
+  gint i = 0;
+  while (i < batch->len)
+    {
+      LogMessage *msg = batch->msgs[i];
+      LogPathOptions *path_options = &batch->path_options[i];
+
+      if (_can_push_to_front_cache(self))
+        {
+          _push_tail_front_cache(self, msg, path_options);
+          log_queue_queued_messages_inc(&s->super);
+          i++;
+          continue;
+        }
+
+      if (self->flow_control_window->length == 0)
+        {
+          gint consumed = _push_tail_disk_batch(self, batch, i);
+          if (consumed > 0)
+            {
+              i += consumed;
+              continue;
+            }
+        }
+
+      if (HAS_SPACE_IN_QUEUE(self->flow_control_window))
+        {
+          _push_tail_flow_control_window(self, msg, path_options);
+          log_queue_queued_messages_inc(&s->super);
+        }
+      else
+        {
+          _drop_message_queue_full(self, msg, path_options);
+        }
+      i++;
+    }
+
+  /* this releases the queue's lock for a short time, which may violate the
+   * consistency of the disk-buffer, so it must be the last call under lock in this function
+   */
+  log_queue_push_notify(&s->super);
+  g_mutex_unlock(&s->super.lock);
+}
+
 static void
 _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
 {
@@ -432,7 +544,12 @@ _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
   ScratchBuffersMarker marker;
   GString *serialized_msg = NULL;
 
-  if (_is_msg_serialization_needed_hint(self))
+  gboolean msg_serialization_needed = _is_msg_serialization_needed_hint(self);
+
+  if (log_queue_disk_push_tail_to_input_batch(&self->super, msg, path_options, msg_serialization_needed))
+    return;
+
+  if (msg_serialization_needed)
     {
       serialized_msg = scratch_buffers_alloc_and_mark(&marker);
       if (!log_queue_disk_serialize_msg(&self->super, msg, serialized_msg))
@@ -463,13 +580,7 @@ _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
           goto queued;
         }
 
-      msg_debug("Destination queue full, dropping message",
-                evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
-                evt_tag_long("queue_len", log_queue_get_length(s)),
-                evt_tag_int("flow_control_window_size", self->flow_control_window_size),
-                evt_tag_long("capacity_bytes", qdisk_get_maximum_size(self->super.qdisk)),
-                evt_tag_str("persist_name", s->persist_name));
-      log_queue_disk_drop_message(&self->super, msg, path_options);
+      _drop_message_queue_full(self, msg, path_options);
       goto exit;
     }
 
@@ -580,6 +691,7 @@ _set_logqueue_disk_virtual_functions(LogQueueDisk *s)
   s->start = _start;
   s->stop = _stop;
   s->stop_corrupted = _stop_corrupted;
+  s->write_input_batch = _write_input_batch;
 }
 
 static inline void
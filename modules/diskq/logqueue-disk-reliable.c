@@ -327,52 +327,34 @@ _is_space_available_in_front_cache(LogQueueDiskReliable *self)
 }
 
 static void
-_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+_drop_message_queue_full(LogQueueDiskReliable *self, LogMessage *msg, const LogPathOptions *path_options)
 {
-  LogQueueDiskReliable *self = (LogQueueDiskReliable *)s;
-
-  ScratchBuffersMarker marker;
-  GString *serialized_msg = scratch_buffers_alloc_and_mark(&marker);
-  if (!log_queue_disk_serialize_msg(&self->super, msg, serialized_msg))
+  LogQueue *s = &self->super.super;
+  EVTTAG *suggestion = NULL;
+  if (path_options->flow_control_requested)
     {
-      msg_error("Failed to serialize message for reliable disk-buffer, dropping message",
-                evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
-                evt_tag_str("persist_name", s->persist_name));
-      log_queue_disk_drop_message(&self->super, msg, path_options);
-      scratch_buffers_reclaim_marked(marker);
-      return;
+      suggestion = evt_tag_str("suggestion", "consider increasing flow-control-window-bytes() or decreasing "
+                               "log-iw-size() values on the source side to avoid message loss");
     }
 
-  g_mutex_lock(&s->lock);
+  /* we were not able to store the msg, warn */
+  msg_error("Destination reliable queue full, dropping message",
+            evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
+            evt_tag_long("queue_len", log_queue_get_length(s)),
+            evt_tag_int("flow_control_window_bytes", qdisk_get_flow_control_window_bytes(self->super.qdisk)),
+            evt_tag_long("capacity_bytes", qdisk_get_maximum_size(self->super.qdisk)),
+            evt_tag_str("persist_name", s->persist_name),
+            suggestion);
 
-  gint64 message_position = qdisk_get_next_tail_position(self->super.qdisk);
-  if (!qdisk_push_tail(self->super.qdisk, serialized_msg))
-    {
-      EVTTAG *suggestion = NULL;
-      if (path_options->flow_control_requested)
-        {
-          suggestion = evt_tag_str("suggestion", "consider increasing flow-control-window-bytes() or decreasing "
-                                   "log-iw-size() values on the source side to avoid message loss");
-        }
-
-      /* we were not able to store the msg, warn */
-      msg_error("Destination reliable queue full, dropping message",
-                evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
-                evt_tag_long("queue_len", log_queue_get_length(s)),
-                evt_tag_int("flow_control_window_bytes", qdisk_get_flow_control_window_bytes(self->super.qdisk)),
-                evt_tag_long("capacity_bytes", qdisk_get_maximum_size(self->super.qdisk)),
-                evt_tag_str("persist_name", s->persist_name),
-                suggestion);
-
-      log_queue_disk_drop_message(&self->super, msg, path_options);
-      scratch_buffers_reclaim_marked(marker);
-      g_mutex_unlock(&s->lock);
-      return;
-    }
-
-  log_queue_disk_update_disk_related_counters(&self->super);
+  log_queue_disk_drop_message(&self->super, msg, path_options);
+}
 
-  scratch_buffers_reclaim_marked(marker);
+/* called under the queue's lock, once the message was written to the disk-buffer */
+static void
+_push_tail_written_message(LogQueueDiskReliable *self, LogMessage *msg, const LogPathOptions *path_options,
+                           gint64 message_position)
+{
+  LogQueue *s = &self->super.super;
 
   if (_is_reserved_buffer_size_reached(self))
     {
@@ -404,6 +386,81 @@ _push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
 
 exit:
   log_queue_queued_messages_inc(s);
+}
+
+/* Writes the whole batch with as few write calls as possible.  Messages are
+ * acked (or kept in the flow-control window) only after their record was
+ * written, the same way as in _push_tail().  As the flow-control window
+ * decision is made after the whole batch was written, the window might kick
+ * in a few messages earlier than with per-message writes.
+ */
+static void
+_write_input_batch(LogQueueDisk *s, LogQueueDiskInputBatch *batch)
+{
+  LogQueueDiskReliable *self = (LogQueueDiskReliable *) s;
+
+  g_mutex_lock(&s->super.lock);
+
+  gint i = 0;
+  while (i < batch->len)
+    {
+      gint pushed = qdisk_push_tail_batch(s->qdisk, &batch->serialized_msgs[i], batch->len - i, &batch->positions[i]);
+
+      for (gint end = i + pushed; i < end; i++)
+        _push_tail_written_message(self, batch->msgs[i], &batch->path_options[i], batch->positions[i]);
+
+      if (i < batch->len)
+        {
+          _drop_message_queue_full(self, batch->msgs[i], &batch->path_options[i]);
+          i++;
+        }
+    }
+
+  log_queue_disk_update_disk_related_counters(s);
+
+  /* this releases the queue's lock for a short time, which may violate the
+   * consistency of the disk-buffer, so it must be the last call under lock in this function
+   */
+  log_queue_push_notify(&s->super);
+  g_mutex_unlock(&s->super.lock);
+}
+
+static void
+_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueDiskReliable *self = (LogQueueDiskReliable *)s;
+
+  if (log_queue_disk_push_tail_to_input_batch(&self->super, msg, path_options, TRUE))
+    return;
+
+  ScratchBuffersMarker marker;
+  GString *serialized_msg = scratch_buffers_alloc_and_mark(&marker);
+  if (!log_queue_disk_serialize_msg(&self->super, msg, serialized_msg))
+    {
+      msg_error("Failed to serialize message for reliable disk-buffer, dropping message",
+                evt_tag_str("filename", qdisk_get_filename(self->super.qdisk)),
+                evt_tag_str("persist_name", s->persist_name));
+      log_queue_disk_drop_message(&self->super, msg, path_options);
+      scratch_buffers_reclaim_marked(marker);
+      return;
+    }
+
+  g_mutex_lock(&s->lock);
+
+  gint64 message_position = qdisk_get_next_tail_position(self->super.qdisk);
+  if (!qdisk_push_tail(self->super.qdisk, serialized_msg))
+    {
+      _drop_message_queue_full(self, msg, path_options);
+      scratch_buffers_reclaim_marked(marker);
+      g_mutex_unlock(&s->lock);
+      return;
+    }
+
+  log_queue_disk_update_disk_related_counters(&self->super);
+
+  scratch_buffers_reclaim_marked(marker);
+
+  _push_tail_written_message(self, msg, path_options, message_position);
 
   /* this releases the queue's lock for a short time, which may violate the
    * consistency of the disk-buffer, so it must be the last call under lock in this function
@@ -480,6 +537,7 @@ _set_logqueue_disk_virtual_functions(LogQueueDisk *s)
 {
   s->start = _start;
   s->stop = _stop;
+  s->write_input_batch = _write_input_batch;
 }
 
 static inline void
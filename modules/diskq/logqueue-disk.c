@@ -121,10 +121,34 @@ _unregister_counters(LogQueueDisk *self)
   stats_unlock();
 }
 
+static void
+_free_input_batches(LogQueueDisk *self)
+{
+  for (gint i = 0; i < self->num_input_batches; i++)
+    {
+      LogQueueDiskInputBatch *batch = &self->input_batches[i];
+
+      g_assert(!batch->cb_registered && batch->len == 0);
+      if (!batch->msgs)
+        continue;
+
+      for (gint j = 0; j < self->write_batch_size; j++)
+        g_string_free(batch->serialized_msgs[j], TRUE);
+      g_free(batch->serialized_msgs);
+      g_free(batch->msgs);
+      g_free(batch->path_options);
+      g_free(batch->positions);
+    }
+  g_free(self->input_batches);
+  self->input_batches = NULL;
+  self->num_input_batches = 0;
+}
+
 void
 log_queue_disk_free_method(LogQueueDisk *self)
 {
   g_assert(!qdisk_started(self->qdisk));
+  _free_input_batches(self);
   qdisk_free(self->qdisk);
 
   _unregister_counters(self);
@@ -139,6 +163,124 @@ log_queue_disk_update_disk_related_counters(LogQueueDisk *self)
   stats_counter_set(self->metrics.disk_allocated, B_TO_KiB(qdisk_get_file_size(self->qdisk)));
 }
 
+static void
+_flush_input_batch(LogQueueDiskInputBatch *batch)
+{
+  if (batch->len == 0)
+    return;
+
+  batch->queue->write_input_batch(batch->queue, batch);
+  batch->len = 0;
+}
+
+/* called when the worker thread that filled the batch finishes its job */
+static gpointer
+_input_batch_finished(gpointer user_data)
+{
+  LogQueueDiskInputBatch *batch = (LogQueueDiskInputBatch *) user_data;
+  LogQueueDisk *self = batch->queue;
+
+  _flush_input_batch(batch);
+  batch->cb_registered = FALSE;
+  log_queue_unref(&self->super);
+  return NULL;
+}
+
+static void
+_init_input_batches(LogQueueDisk *self, gint write_batch_size)
+{
+  if (write_batch_size <= 1)
+    return;
+
+  self->write_batch_size = write_batch_size;
+  self->num_input_batches = main_loop_worker_get_max_number_of_threads();
+  self->input_batches = g_new0(LogQueueDiskInputBatch, self->num_input_batches);
+
+  for (gint i = 0; i < self->num_input_batches; i++)
+    {
+      LogQueueDiskInputBatch *batch = &self->input_batches[i];
+
+      batch->queue = self;
+      worker_batch_callback_init(&batch->cb);
+      batch->cb.func = _input_batch_finished;
+      batch->cb.user_data = batch;
+    }
+}
+
+static void
+_input_batch_alloc_slots(LogQueueDiskInputBatch *batch, gint size)
+{
+  batch->serialized_msgs = g_new(GString *, size);
+  for (gint i = 0; i < size; i++)
+    batch->serialized_msgs[i] = g_string_sized_new(256);
+  batch->msgs = g_new(LogMessage *, size);
+  batch->path_options = g_new(LogPathOptions, size);
+  batch->positions = g_new(gint64, size);
+}
+
+static LogQueueDiskInputBatch *
+_get_input_batch(LogQueueDisk *self)
+{
+  gint thread_index = main_loop_worker_get_thread_index();
+
+  /* no batching outside of worker threads, or for threads started after
+   * the queue was created (due to a config change) */
+  if (thread_index < 0 || thread_index >= self->num_input_batches)
+    return NULL;
+
+  LogQueueDiskInputBatch *batch = &self->input_batches[thread_index];
+  if (!batch->msgs)
+    _input_batch_alloc_slots(batch, self->write_batch_size);
+
+  return batch;
+}
+
+/* Adds the message to the input batch of the current thread, returns FALSE
+ * if batching is not possible, in which case the caller has to push the
+ * message right away.
+ *
+ * NOTE: it consumes the reference passed by the caller.
+ */
+gboolean
+log_queue_disk_push_tail_to_input_batch(LogQueueDisk *self, LogMessage *msg, const LogPathOptions *path_options,
+                                        gboolean serialize)
+{
+  LogQueueDiskInputBatch *batch = _get_input_batch(self);
+  if (!batch)
+    return FALSE;
+
+  GString *serialized_msg = batch->serialized_msgs[batch->len];
+  g_string_truncate(serialized_msg, 0);
+  if (serialize && !log_queue_disk_serialize_msg(self, msg, serialized_msg))
+    {
+      log_queue_disk_drop_message(self, msg, path_options);
+      return TRUE;
+    }
+
+  LogPathOptions *batch_path_options = &batch->path_options[batch->len];
+  *batch_path_options = (LogPathOptions) LOG_PATH_OPTIONS_INIT;
+  batch_path_options->ack_needed = path_options->ack_needed;
+  batch_path_options->flow_control_requested = path_options->flow_control_requested;
+  batch->msgs[batch->len] = msg;
+  batch->len++;
+
+  if (batch->len == self->write_batch_size)
+    {
+      _flush_input_batch(batch);
+      return TRUE;
+    }
+
+  if (!batch->cb_registered)
+    {
+      /* keep the queue alive while the callback is registered */
+      main_loop_worker_register_batch_callback(&batch->cb);
+      batch->cb_registered = TRUE;
+      log_queue_ref(&self->super);
+    }
+
+  return TRUE;
+}
+
 static gboolean
 _pop_disk(LogQueueDisk *self, LogMessage **msg)
 {
@@ -405,6 +547,7 @@ log_queue_disk_init_instance(LogQueueDisk *self, DiskQueueOptions *options, cons
   self->super.type = log_queue_disk_type;
 
   self->compaction = options->compaction;
+  _init_input_batches(self, options->write_batch_size);
 
   self->qdisk = qdisk_new(options, qdisk_file_id, filename);
   _register_counters(self, stats_level, queue_sck_builder);
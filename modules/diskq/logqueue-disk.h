@@ -28,9 +28,29 @@
 #include "logqueue.h"
 #include "qdisk.h"
 #include "logmsg/logmsg-serialize.h"
+#include "mainloop-worker.h"
 
 typedef struct _LogQueueDisk LogQueueDisk;
 
+/* Per-thread collection of messages pushed by a worker, written to the
+ * disk-buffer together once the worker finishes its batch (or the batch
+ * reaches write-batch-size()).  Messages are only acknowledged once they
+ * were written, so the delivery guarantees are the same as with per-message
+ * writes, only the granularity changes.
+ */
+typedef struct _LogQueueDiskInputBatch
+{
+  WorkerBatchCallback cb;
+  LogQueueDisk *queue;
+  gboolean cb_registered;
+  gint len;
+  /* an empty string means that the message was not serialized yet */
+  GString **serialized_msgs;
+  LogMessage **msgs;
+  LogPathOptions *path_options;
+  gint64 *positions;
+} LogQueueDiskInputBatch;
+
 struct _LogQueueDisk
 {
   LogQueue super;
@@ -53,9 +73,15 @@ struct _LogQueueDisk
   } metrics;
 
   gboolean compaction;
+
+  gint write_batch_size;
+  gint num_input_batches;
+  LogQueueDiskInputBatch *input_batches;
+
   gboolean (*start)(LogQueueDisk *s);
   gboolean (*stop)(LogQueueDisk *s, gboolean *persistent);
   gboolean (*stop_corrupted)(LogQueueDisk *s);
+  void (*write_input_batch)(LogQueueDisk *s, LogQueueDiskInputBatch *batch);
 };
 
 extern QueueType log_queue_disk_type;
@@ -76,5 +102,7 @@ LogMessage *log_queue_disk_peek_message(LogQueueDisk *self);
 void log_queue_disk_drop_message(LogQueueDisk *self, LogMessage *msg, const LogPathOptions *path_options);
 gboolean log_queue_disk_serialize_msg(LogQueueDisk *self, LogMessage *msg, GString *serialized);
 gboolean log_queue_disk_deserialize_msg(LogQueueDisk *self, GString *serialized, LogMessage **msg);
+gboolean log_queue_disk_push_tail_to_input_batch(LogQueueDisk *self, LogMessage *msg,
+                                                 const LogPathOptions *path_options, gboolean serialize);
 
 #endif
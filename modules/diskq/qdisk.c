@@ -40,6 +40,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/file.h>
+#include <sys/uio.h>
 
 /* MADV_RANDOM not defined on legacy Linux systems. Could be removed in the
  * future, when support for Glibc 2.1.X drops.*/
@@ -49,6 +50,12 @@
 
 #define MAX_RECORD_LENGTH 100 * 1024 * 1024
 
+/* upper limit of records coalesced into a single pwritev() call, kept well
+ * below IOV_MAX */
+#define QDISK_MAX_WRITE_BATCH_SIZE 256
+
+#define QDISK_READ_AHEAD_ALIGNMENT 4096
+
 #define PATH_QDISK              PATH_LOCALSTATEDIR
 
 #define QDISK_HDR_VERSION_CURRENT 3
@@ -102,6 +109,14 @@ struct _QDisk
   gint64 cached_file_size;
   QDiskFileHeader *hdr;
   DiskQueueOptions *options;
+
+  /* window of the file prefetched by the read path, see _pread_cached() */
+  struct
+  {
+    gchar *buffer;
+    gint64 offset;
+    gsize len;
+  } read_ahead;
 };
 
 #define QDISK_ERROR qdisk_error_quark()
@@ -138,6 +153,90 @@ pwrite_strict(gint fd, const void *buf, size_t count, off_t offset)
   return result;
 }
 
+static gboolean
+pwritev_strict(gint fd, const struct iovec *iov, gint iov_count, size_t count, off_t offset)
+{
+  ssize_t written = pwritev(fd, iov, iov_count, offset);
+  gboolean result = TRUE;
+  if (written != count)
+    {
+      if (written != -1)
+        {
+          msg_error("Short write while writing disk buffer",
+                    evt_tag_int("bytes_to_write", count),
+                    evt_tag_int("bytes_written", written));
+          errno = ENOSPC;
+        }
+      result = FALSE;
+    }
+  return result;
+}
+
+static inline void
+_invalidate_read_ahead(QDisk *self)
+{
+  self->read_ahead.offset = 0;
+  self->read_ahead.len = 0;
+}
+
+static inline gboolean
+_is_range_in_read_ahead(QDisk *self, gint64 position, gsize count)
+{
+  return position >= self->read_ahead.offset
+         && position + (gint64) count <= self->read_ahead.offset + (gint64) self->read_ahead.len;
+}
+
+static inline void
+_invalidate_read_ahead_if_overlaps(QDisk *self, gint64 position, gsize count)
+{
+  if (position < self->read_ahead.offset + (gint64) self->read_ahead.len
+      && position + (gint64) count > self->read_ahead.offset)
+    _invalidate_read_ahead(self);
+}
+
+static void
+_fill_read_ahead(QDisk *self, gint64 position)
+{
+  gsize size = self->options->read_ahead_bytes;
+
+  if (!self->read_ahead.buffer)
+    self->read_ahead.buffer = g_malloc(size);
+
+  gint64 offset = position - (position % QDISK_READ_AHEAD_ALIGNMENT);
+  gssize bytes_read = pread(self->fd, self->read_ahead.buffer, size, offset);
+
+  if (bytes_read < 0)
+    {
+      _invalidate_read_ahead(self);
+      return;
+    }
+
+  self->read_ahead.offset = offset;
+  self->read_ahead.len = bytes_read;
+}
+
+/* pread() replacement of the read path: when read-ahead is enabled, a
+ * large, aligned window of the file is read at once and subsequent records
+ * are served from memory.  The window is invalidated whenever the
+ * underlying file region is written or truncated, so it never returns stale
+ * data.  Requests not fitting in the window fall back to a plain pread().
+ */
+static gssize
+_pread_cached(QDisk *self, gchar *buf, gsize count, gint64 position)
+{
+  if (self->options->read_ahead_bytes <= 0 || count > (gsize) self->options->read_ahead_bytes / 2)
+    return pread(self->fd, buf, count, position);
+
+  if (!_is_range_in_read_ahead(self, position, count))
+    _fill_read_ahead(self, position);
+
+  if (!_is_range_in_read_ahead(self, position, count))
+    return pread(self->fd, buf, count, position);
+
+  memcpy(buf, self->read_ahead.buffer + (position - self->read_ahead.offset), count);
+  return count;
+}
+
 
 static inline gboolean
 _has_position_reached_max_size(QDisk *self, gint64 position)
@@ -349,15 +448,15 @@ qdisk_started(QDisk *self)
 }
 
 static inline gboolean
-_does_backlog_head_precede_write_head(QDisk *self)
+_does_backlog_head_precede_write_head(QDisk *self, gint64 write_head)
 {
-  return self->hdr->backlog_head <= self->hdr->write_head;
+  return self->hdr->backlog_head <= write_head;
 }
 
 static inline gboolean
-_is_write_head_less_than_max_size(QDisk *self)
+_is_write_head_less_than_max_size(QDisk *self, gint64 write_head)
 {
-  return self->hdr->write_head < self->hdr->capacity_bytes;
+  return write_head < self->hdr->capacity_bytes;
 }
 
 static inline gboolean
@@ -367,10 +466,10 @@ _is_able_to_reset_write_head_to_beginning_of_qdisk(QDisk *self)
 }
 
 static inline gboolean
-_is_free_space_between_write_head_and_backlog_head(QDisk *self, gint msg_len)
+_is_free_space_between_write_head_and_backlog_head(QDisk *self, gint64 write_head, gint msg_len)
 {
   /* this forces 1 byte of empty space between backlog and write */
-  return self->hdr->write_head + msg_len < self->hdr->backlog_head;
+  return write_head + msg_len < self->hdr->backlog_head;
 }
 
 static inline gboolean
@@ -386,15 +485,15 @@ qdisk_is_file_empty(QDisk *self)
   return self->hdr->length == 0 && self->hdr->backlog_len == 0;
 }
 
-gboolean
-qdisk_is_space_avail(QDisk *self, gint at_least)
+static gboolean
+_is_space_avail_at(QDisk *self, gint64 write_head, gint at_least)
 {
-  if (_does_backlog_head_precede_write_head(self))
+  if (_does_backlog_head_precede_write_head(self, write_head))
     {
       /* no exact size-check is needed in this case, because writing after
        * capacity_bytes is allowed when the last message does not fit in
        */
-      if (_is_write_head_less_than_max_size(self))
+      if (_is_write_head_less_than_max_size(self, write_head))
         return TRUE;
 
       /* exact size-check is needed as we have unread/unacked data after the write head
@@ -404,7 +503,13 @@ qdisk_is_space_avail(QDisk *self, gint at_least)
              && _is_free_space_at_the_beginning_of_qdisk(self, at_least);
     }
 
-  return _is_free_space_between_write_head_and_backlog_head(self, at_least);
+  return _is_free_space_between_write_head_and_backlog_head(self, write_head, at_least);
+}
+
+gboolean
+qdisk_is_space_avail(QDisk *self, gint at_least)
+{
+  return _is_space_avail_at(self, self->hdr->write_head, at_least);
 }
 
 static inline gboolean
@@ -434,6 +539,7 @@ _maybe_truncate_file(QDisk *self, gint64 expected_size)
 
   msg_debug("Truncating queue file", evt_tag_str("filename", self->filename), evt_tag_long("new size", expected_size));
 
+  _invalidate_read_ahead(self);
   if (ftruncate(self->fd, (off_t) expected_size) == 0)
     {
       self->cached_file_size = expected_size;
@@ -687,34 +793,26 @@ qdisk_get_next_tail_position(QDisk *self)
   return self->hdr->write_head;
 }
 
-gboolean
-qdisk_push_tail(QDisk *self, GString *record)
+/* Calculates where the write head ends up after a record of record_len
+ * bytes was written at position, see _commit_record() for the details.
+ */
+static inline gint64
+_get_write_head_after_record(QDisk *self, gint64 position, gsize record_len)
 {
-  if (!qdisk_started(self))
-    return FALSE;
+  gint64 write_head = position + record_len;
 
-  if (_could_not_wrap_write_head_last_push_but_now_can(self))
-    {
-      /*
-       * We can safely move the write_head to the beginning, but still
-       * not sure, if this message will have space. We move the write_head
-       * then check the available space compared to the new position.
-       */
-      self->hdr->write_head = QDISK_RESERVED_SPACE;
-    }
-
-  if (!qdisk_is_space_avail(self, record->len))
-    return FALSE;
-
-  if (!pwrite_strict(self->fd, record->str, record->len, self->hdr->write_head))
-    {
-      msg_error("Error writing disk-queue file",
-                evt_tag_error("error"));
-      return FALSE;
-    }
+  if (write_head > MAX(self->hdr->backlog_head, self->hdr->read_head)
+      && _has_position_reached_max_size(self, write_head)
+      && _is_able_to_reset_write_head_to_beginning_of_qdisk(self))
+    return QDISK_RESERVED_SPACE;
 
-  self->hdr->write_head = self->hdr->write_head + record->len;
+  return write_head;
+}
 
+static void
+_commit_record(QDisk *self, gsize record_len, gboolean last_in_run)
+{
+  self->hdr->write_head = self->hdr->write_head + record_len;
 
   /* NOTE: we only wrap around if the read head is before the write,
    * otherwise we'd truncate the data the read head is still processing, e.g.
@@ -743,7 +841,9 @@ qdisk_push_tail(QDisk *self, GString *record)
     {
       if (self->cached_file_size > self->hdr->write_head)
         {
-          _maybe_truncate_file(self, self->hdr->write_head);
+          /* the rest of the run is already written after this record */
+          if (last_in_run)
+            _maybe_truncate_file(self, self->hdr->write_head);
         }
       else
         {
@@ -765,13 +865,113 @@ qdisk_push_tail(QDisk *self, GString *record)
         }
     }
   self->hdr->length++;
-  return TRUE;
+}
+
+/* Writes the longest prefix of records that fits in the file and that can
+ * be laid out contiguously (e.g. there's no wrap-around in between) with a
+ * single pwritev() call.  The header is only updated once the data is
+ * written, so a crash in between can't leave garbage behind the write head.
+ *
+ * Returns the number of records written.
+ */
+static gint
+_write_contiguous_records(QDisk *self, GString **records, gint num_records, gint64 *positions)
+{
+  struct iovec iov[QDISK_MAX_WRITE_BATCH_SIZE];
+  gint64 write_head = self->hdr->write_head;
+  gsize total_len = 0;
+  gint count = 0;
+
+  num_records = MIN(num_records, QDISK_MAX_WRITE_BATCH_SIZE);
+  while (count < num_records)
+    {
+      GString *record = records[count];
+
+      if (!_is_space_avail_at(self, write_head, record->len))
+        break;
+
+      iov[count].iov_base = record->str;
+      iov[count].iov_len = record->len;
+      total_len += record->len;
+      count++;
+
+      gint64 next_write_head = _get_write_head_after_record(self, write_head, record->len);
+      if (next_write_head != write_head + (gint64) record->len)
+        break;
+      write_head = next_write_head;
+    }
+
+  if (count == 0)
+    return 0;
+
+  gint64 run_start = self->hdr->write_head;
+  if (!pwritev_strict(self->fd, iov, count, total_len, run_start))
+    {
+      msg_error("Error writing disk-queue file",
+                evt_tag_error("error"));
+      return 0;
+    }
+  _invalidate_read_ahead_if_overlaps(self, run_start, total_len);
+
+  for (gint i = 0; i < count; i++)
+    {
+      if (positions)
+        positions[i] = self->hdr->write_head;
+      _commit_record(self, iov[i].iov_len, i == count - 1);
+    }
+
+  return count;
+}
+
+/* Appends the records to the end of the queue, coalescing them into as few
+ * write system calls as possible.  Records are pushed in order, the first
+ * one that doesn't fit stops the batch.
+ *
+ * If positions is not NULL, the file offset of each successfully pushed
+ * record is stored there.
+ *
+ * Returns the number of records pushed.
+ */
+gint
+qdisk_push_tail_batch(QDisk *self, GString **records, gint num_records, gint64 *positions)
+{
+  if (!qdisk_started(self))
+    return 0;
+
+  gint pushed = 0;
+  while (pushed < num_records)
+    {
+      if (_could_not_wrap_write_head_last_push_but_now_can(self))
+        {
+          /*
+           * We can safely move the write_head to the beginning, but still
+           * not sure, if this message will have space. We move the write_head
+           * then check the available space compared to the new position.
+           */
+          self->hdr->write_head = QDISK_RESERVED_SPACE;
+        }
+
+      gint written = _write_contiguous_records(self, &records[pushed], num_records - pushed,
+                                               positions ? &positions[pushed] : NULL);
+      if (written == 0)
+        break;
+
+      pushed += written;
+    }
+
+  return pushed;
+}
+
+gboolean
+qdisk_push_tail(QDisk *self, GString *record)
+{
+  return qdisk_push_tail_batch(self, &record, 1, NULL) == 1;
 }
 
 static inline gssize
 _read_record_length_from_disk(QDisk *self, gint64 position, guint32 *record_length)
 {
-  gssize bytes_read = pread(self->fd, (gchar *)record_length, sizeof(guint32), position);
+  gssize bytes_read = _pread_cached(self, (gchar *)record_length, sizeof(guint32), position);
 
   *record_length = GUINT32_FROM_BE(*record_length);
 
@@ -835,7 +1035,7 @@ _read_record_from_disk(QDisk *self, GString *record, guint32 record_length)
 {
   g_string_set_size(record, record_length);
 
-  gssize bytes_read = pread(self->fd, record->str, record_length, self->hdr->read_head + sizeof(record_length));
+  gssize bytes_read = _pread_cached(self, record->str, record_length, self->hdr->read_head + sizeof(record_length));
   if (bytes_read != record_length)
     {
       msg_error("Error reading disk-queue file",
@@ -1358,6 +1558,7 @@ _close_file(QDisk *self)
     }
 
   self->cached_file_size = 0;
+  _invalidate_read_ahead(self);
 }
 
 static void
@@ -1839,6 +2040,7 @@ void
 qdisk_free(QDisk *self)
 {
   self->options = NULL;
+  g_free(self->read_ahead.buffer);
   g_free(self->filename);
   g_free(self);
 }
@@ -61,6 +61,7 @@ gint64 qdisk_get_max_useful_space(QDisk *self);
 gint64 qdisk_get_empty_space(QDisk *self);
 gint64 qdisk_get_used_useful_space(QDisk *self);
 gboolean qdisk_push_tail(QDisk *self, GString *record);
+gint qdisk_push_tail_batch(QDisk *self, GString **records, gint num_records, gint64 *positions);
 gboolean qdisk_pop_head(QDisk *self, GString *record);
 gboolean qdisk_peek_head(QDisk *self, GString *record);
 gboolean qdisk_remove_head(QDisk *self);
@@ -540,6 +540,52 @@ qdisk_get_next_filename(const gchar *dir, gboolean reliable)
   return NULL;
 }
 
+ParameterizedTestParameters(diskq, testcase_write_batches)
+{
+  static restart_test_parameters test_cases[] =
+  {
+    {"test-diskq-write-batch.qf", FALSE},
+    {"test-diskq-write-batch.rqf", TRUE},
+  };
+
+  return cr_make_param_array(restart_test_parameters, test_cases, sizeof(test_cases) / sizeof(test_cases[0]));
+}
+
+ParameterizedTest(restart_test_parameters *test_case, diskq, testcase_write_batches)
+{
+  DiskQueueOptions options = {0};
+
+  main_loop_worker_allocate_thread_space(FEEDERS);
+  main_loop_worker_finalize_thread_space();
+
+  _construct_options(&options, 10000000, 100000, test_case->reliable);
+  options.write_batch_size = 100;
+
+  unlink(test_case->filename);
+  LogQueue *q = queue_new(test_case->reliable, &options, test_case->filename, NULL);
+  log_queue_disk_start(q);
+
+  fed_messages = 0;
+  acked_messages = 0;
+
+  /* the feeder invokes the batch callbacks in every 256 messages, so
+   * batches are flushed both when they get full and when the callback runs */
+  GThread *thread_feed = g_thread_new(NULL, threaded_feed, q);
+  g_thread_join(thread_feed);
+
+  cr_assert_eq(acked_messages, MESSAGES_PER_FEEDER);
+  cr_assert_eq(log_queue_get_length(q), MESSAGES_PER_FEEDER);
+
+  send_some_messages(q, MESSAGES_PER_FEEDER, TRUE);
+  cr_assert_eq(log_queue_get_length(q), 0);
+
+  gboolean persistent;
+  log_queue_disk_stop(q, &persistent);
+  log_queue_unref(q);
+  unlink(test_case->filename);
+  disk_queue_options_destroy(&options);
+}
+
 Test(diskq, test_no_next_filename_in_acquire)
 {
   const gchar *queue_persist_name = "test_no_next_filename_in_acquire";
@@ -377,6 +377,165 @@ Test(qdisk, prealloc)
   cleanup_qdisk(filename, qdisk);
 }
 
+static gint
+push_dummy_records(QDisk *qdisk, const guint *record_sizes, gint num_records, gint64 *positions)
+{
+  GString **records = g_new(GString *, num_records);
+  for (gint i = 0; i < num_records; i++)
+    {
+      GError *error = NULL;
+      records[i] = g_string_new(NULL);
+      cr_assert(qdisk_serialize(records[i], generate_dummy_payload, GUINT_TO_POINTER(record_sizes[i]), &error));
+    }
+
+  gint pushed = qdisk_push_tail_batch(qdisk, records, num_records, positions);
+
+  for (gint i = 0; i < num_records; i++)
+    g_string_free(records[i], TRUE);
+  g_free(records);
+
+  return pushed;
+}
+
+Test(qdisk, push_tail_batch)
+{
+  const gchar *filename = "test_qdisk_push_tail_batch.rqf";
+  QDisk *qdisk = create_qdisk(TDISKQ_RELIABLE, filename, MiB(1));
+  qdisk_start(qdisk, NULL, NULL, NULL);
+
+  guint record_sizes[] = { 16, 128, 1024, 3, 4096 };
+  gint num_records = G_N_ELEMENTS(record_sizes);
+  gint64 positions[G_N_ELEMENTS(record_sizes)];
+
+  cr_assert_eq(push_dummy_records(qdisk, record_sizes, num_records, positions), num_records);
+  cr_assert_eq(qdisk_get_length(qdisk), num_records);
+
+  gint64 expected_position = QDISK_RESERVED_SPACE;
+  for (gint i = 0; i < num_records; i++)
+    {
+      cr_assert_eq(positions[i], expected_position);
+      expected_position += FRAME_LENGTH + record_sizes[i];
+    }
+  cr_assert_eq(qdisk_get_writer_head(qdisk), expected_position);
+
+  GString *popped_data = g_string_new(NULL);
+  for (gint i = 0; i < num_records; i++)
+    {
+      cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+      assert_dummy_record(popped_data, record_sizes[i]);
+    }
+  g_string_free(popped_data, TRUE);
+
+  qdisk_stop(qdisk, NULL, NULL, NULL);
+  cleanup_qdisk(filename, qdisk);
+}
+
+Test(qdisk, push_tail_batch_stops_at_the_first_record_that_does_not_fit)
+{
+  const gchar *filename = "test_qdisk_push_tail_batch_full.rqf";
+  QDisk *qdisk = create_qdisk(TDISKQ_RELIABLE, filename, MiB(1));
+  qdisk_start(qdisk, NULL, NULL, NULL);
+
+  /* the 4th record is allowed to go beyond capacity_bytes, the 5th one is not */
+  guint record_sizes[] = { 300 * 1024, 300 * 1024, 300 * 1024, 300 * 1024, 16 };
+
+  cr_assert_eq(push_dummy_records(qdisk, record_sizes, G_N_ELEMENTS(record_sizes), NULL), 4);
+  cr_assert_eq(qdisk_get_length(qdisk), 4);
+  cr_assert_not(push_dummy_record(qdisk, 16));
+
+  qdisk_stop(qdisk, NULL, NULL, NULL);
+  cleanup_qdisk(filename, qdisk);
+}
+
+Test(qdisk, push_tail_batch_wraps_around)
+{
+  const gchar *filename = "test_qdisk_push_tail_batch_wrap.rqf";
+  QDisk *qdisk = create_qdisk(TDISKQ_RELIABLE, filename, MiB(1));
+  qdisk_start(qdisk, NULL, NULL, NULL);
+
+  GString *popped_data = g_string_new(NULL);
+  guint large_record_sizes[] = { 300 * 1024, 300 * 1024, 300 * 1024 };
+  cr_assert_eq(push_dummy_records(qdisk, large_record_sizes, G_N_ELEMENTS(large_record_sizes), NULL), 3);
+  cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+  cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+
+  /* the second record goes beyond capacity_bytes, the third one is written to the beginning of the file */
+  guint record_sizes[] = { 100 * 1024, 100 * 1024, 100 * 1024 };
+  gint64 positions[G_N_ELEMENTS(record_sizes)];
+  cr_assert_eq(push_dummy_records(qdisk, record_sizes, G_N_ELEMENTS(record_sizes), positions), 3);
+  cr_assert_eq(positions[1], positions[0] + FRAME_LENGTH + record_sizes[0]);
+  cr_assert_eq(positions[2], QDISK_RESERVED_SPACE);
+  cr_assert_eq(qdisk_get_length(qdisk), 4);
+
+  cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+  assert_dummy_record(popped_data, large_record_sizes[2]);
+  for (gint i = 0; i < G_N_ELEMENTS(record_sizes); i++)
+    {
+      cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+      assert_dummy_record(popped_data, record_sizes[i]);
+    }
+  g_string_free(popped_data, TRUE);
+
+  qdisk_stop(qdisk, NULL, NULL, NULL);
+  cleanup_qdisk(filename, qdisk);
+}
+
+Test(qdisk, read_ahead)
+{
+  const gchar *filename = "test_qdisk_read_ahead.rqf";
+
+  DiskQueueOptions *opts = construct_diskq_options(TDISKQ_RELIABLE, MiB(4));
+  disk_queue_options_set_read_ahead_bytes(opts, 64 * 1024);
+  QDisk *qdisk = qdisk_new(opts, "TEST", filename);
+  qdisk_start(qdisk, NULL, NULL, NULL);
+
+  /* records spanning the boundary of the read-ahead window, and records larger than the window */
+  GString *popped_data = g_string_new(NULL);
+  for (guint i = 1; i <= 1000; i++)
+    cr_assert(push_dummy_record(qdisk, i % 100 == 0 ? 100 * 1024 : i));
+
+  for (guint i = 1; i <= 1000; i++)
+    {
+      cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+      assert_dummy_record(popped_data, i % 100 == 0 ? 100 * 1024 : i);
+    }
+
+  qdisk_stop(qdisk, NULL, NULL, NULL);
+  g_string_free(popped_data, TRUE);
+  cleanup_qdisk(filename, qdisk);
+}
+
+Test(qdisk, read_ahead_is_invalidated_by_overlapping_writes)
+{
+  const gchar *filename = "test_qdisk_read_ahead_invalidation.rqf";
+
+  DiskQueueOptions *opts = construct_diskq_options(TDISKQ_RELIABLE, MiB(1));
+  disk_queue_options_set_read_ahead_bytes(opts, 64 * 1024);
+  disk_queue_options_set_truncate_size_ratio(opts, 1);
+  QDisk *qdisk = qdisk_new(opts, "TEST", filename);
+  qdisk_start(qdisk, NULL, NULL, NULL);
+
+  GString *popped_data = g_string_new(NULL);
+  cr_assert(push_dummy_record(qdisk, 128));
+
+  /* the read-ahead window now covers the first record */
+  cr_assert(qdisk_pop_head(qdisk, popped_data));
+  cr_assert(qdisk_ack_backlog(qdisk));
+
+  /* the next record overwrites the first one, as the file is not truncated */
+  qdisk_reset_file_if_empty(qdisk);
+  cr_assert_eq(qdisk_get_writer_head(qdisk), QDISK_RESERVED_SPACE);
+  cr_assert_gt(qdisk_get_file_size(qdisk), QDISK_RESERVED_SPACE);
+  cr_assert(push_dummy_record(qdisk, 64));
+
+  cr_assert(reliable_pop_record_without_backlog(qdisk, popped_data));
+  assert_dummy_record(popped_data, 64);
+
+  qdisk_stop(qdisk, NULL, NULL, NULL);
+  g_string_free(popped_data, TRUE);
+  cleanup_qdisk(filename, qdisk);
+}
+
 static gboolean
 _serialize_len_of_zeroes(SerializeArchive *sa, gpointer user_data)
 {
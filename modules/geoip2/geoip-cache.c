@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "geoip-cache.h"
+#include "mainloop-worker.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+
+typedef struct _GeoIPCacheEntry
+{
+  GeoIPCacheKey key;
+  gpointer value;
+  GList lru_link;
+} GeoIPCacheEntry;
+
+typedef struct _GeoIPCacheSlot
+{
+  GHashTable *entries;
+  /* most recently used first */
+  GQueue lru;
+} GeoIPCacheSlot;
+
+struct _GeoIPCache
+{
+  gsize max_entries;
+  GDestroyNotify value_free;
+  gchar *database;
+  gchar *user;
+  StatsCounterItem *hits;
+  StatsCounterItem *misses;
+  gint num_slots;
+  GeoIPCacheSlot *slots[];
+};
+
+gboolean
+geoip_cache_key_from_string(GeoIPCacheKey *key, const gchar *ip)
+{
+  memset(key, 0, sizeof(*key));
+  if (inet_pton(AF_INET, ip, key->address) == 1)
+    {
+      key->length = sizeof(struct in_addr);
+      return TRUE;
+    }
+  if (inet_pton(AF_INET6, ip, key->address) == 1)
+    {
+      key->length = sizeof(struct in6_addr);
+      return TRUE;
+    }
+  return FALSE;
+}
+
+socklen_t
+geoip_cache_key_to_sockaddr(const GeoIPCacheKey *key, struct sockaddr_storage *sa)
+{
+  memset(sa, 0, sizeof(*sa));
+  if (key->length == sizeof(struct in_addr))
+    {
+      struct sockaddr_in *sin = (struct sockaddr_in *) sa;
+
+      sin->sin_family = AF_INET;
+      memcpy(&sin->sin_addr, key->address, sizeof(sin->sin_addr));
+      return sizeof(*sin);
+    }
+
+  struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) sa;
+
+  sin6->sin6_family = AF_INET6;
+  memcpy(&sin6->sin6_addr, key->address, sizeof(sin6->sin6_addr));
+  return sizeof(*sin6);
+}
+
+static guint
+_key_hash(gconstpointer k)
+{
+  const GeoIPCacheKey *key = (const GeoIPCacheKey *) k;
+  guint hash = 5381;
+
+  for (gint i = 0; i < key->length; i++)
+    hash = ((hash << 5) + hash) + key->address[i];
+  return hash;
+}
+
+static gboolean
+_key_equal(gconstpointer a, gconstpointer b)
+{
+  const GeoIPCacheKey *k1 = (const GeoIPCacheKey *) a;
+  const GeoIPCacheKey *k2 = (const GeoIPCacheKey *) b;
+
+  return k1->length == k2->length && memcmp(k1->address, k2->address, k1->length) == 0;
+}
+
+static void
+_entry_free(GeoIPCache *self, GeoIPCacheEntry *entry)
+{
+  self->value_free(entry->value);
+  g_free(entry);
+}
+
+static GeoIPCacheSlot *
+_slot_new(void)
+{
+  GeoIPCacheSlot *slot = g_new0(GeoIPCacheSlot, 1);
+
+  slot->entries = g_hash_table_new(_key_hash, _key_equal);
+  g_queue_init(&slot->lru);
+  return slot;
+}
+
+static void
+_slot_free(GeoIPCache *self, GeoIPCacheSlot *slot)
+{
+  GList *link;
+
+  while ((link = g_queue_pop_head_link(&slot->lru)))
+    _entry_free(self, link->data);
+  g_hash_table_unref(slot->entries);
+  g_free(slot);
+}
+
+static GeoIPCacheSlot *
+_get_slot(GeoIPCache *self)
+{
+  gint thread_index = main_loop_worker_get_thread_index();
+
+  if (thread_index < 0 || thread_index >= self->num_slots)
+    return NULL;
+
+  /* only ever touched by the thread owning the index */
+  if (!self->slots[thread_index])
+    self->slots[thread_index] = _slot_new();
+  return self->slots[thread_index];
+}
+
+gpointer
+geoip_cache_lookup(GeoIPCache *self, const GeoIPCacheKey *key)
+{
+  GeoIPCacheSlot *slot = _get_slot(self);
+
+  if (!slot)
+    return NULL;
+
+  GeoIPCacheEntry *entry = g_hash_table_lookup(slot->entries, key);
+  if (!entry)
+    {
+      stats_counter_inc(self->misses);
+      return NULL;
+    }
+
+  stats_counter_inc(self->hits);
+  g_queue_unlink(&slot->lru, &entry->lru_link);
+  g_queue_push_head_link(&slot->lru, &entry->lru_link);
+  return entry->value;
+}
+
+static GeoIPCacheEntry *
+_evict_least_recently_used(GeoIPCache *self, GeoIPCacheSlot *slot)
+{
+  GList *link = g_queue_pop_tail_link(&slot->lru);
+  GeoIPCacheEntry *entry = link->data;
+
+  g_hash_table_remove(slot->entries, &entry->key);
+  self->value_free(entry->value);
+  return entry;
+}
+
+gboolean
+geoip_cache_store(GeoIPCache *self, const GeoIPCacheKey *key, gpointer value)
+{
+  GeoIPCacheSlot *slot = _get_slot(self);
+
+  if (!slot)
+    return FALSE;
+
+  GeoIPCacheEntry *entry = g_hash_table_lookup(slot->entries, key);
+  if (entry)
+    {
+      self->value_free(entry->value);
+      entry->value = value;
+      g_queue_unlink(&slot->lru, &entry->lru_link);
+      g_queue_push_head_link(&slot->lru, &entry->lru_link);
+      return TRUE;
+    }
+
+  if (g_queue_get_length(&slot->lru) >= self->max_entries)
+    entry = _evict_least_recently_used(self, slot);
+  else
+    entry = g_new0(GeoIPCacheEntry, 1);
+
+  entry->key = *key;
+  entry->value = value;
+  entry->lru_link.data = entry;
+  g_hash_table_insert(slot->entries, &entry->key, entry);
+  g_queue_push_head_link(&slot->lru, &entry->lru_link);
+  return TRUE;
+}
+
+static void
+_set_stats_key(GeoIPCache *self, StatsClusterKey *sc_key, StatsClusterLabel *labels, const gchar *name)
+{
+  labels[0] = stats_cluster_label("database", self->database);
+  labels[1] = stats_cluster_label("user", self->user);
+  stats_cluster_single_key_set(sc_key, name, labels, 2);
+}
+
+static void
+_register_stats(GeoIPCache *self)
+{
+  StatsClusterKey sc_key;
+  StatsClusterLabel labels[2];
+
+  stats_lock();
+  _set_stats_key(self, &sc_key, labels, "geoip2_cache_hits_total");
+  stats_register_sharded_counter(STATS_LEVEL1, &sc_key, SC_TYPE_SINGLE_VALUE, &self->hits);
+  _set_stats_key(self, &sc_key, labels, "geoip2_cache_misses_total");
+  stats_register_sharded_counter(STATS_LEVEL1, &sc_key, SC_TYPE_SINGLE_VALUE, &self->misses);
+  stats_unlock();
+}
+
+static void
+_unregister_stats(GeoIPCache *self)
+{
+  StatsClusterKey sc_key;
+  StatsClusterLabel labels[2];
+
+  stats_lock();
+  _set_stats_key(self, &sc_key, labels, "geoip2_cache_hits_total");
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->hits);
+  _set_stats_key(self, &sc_key, labels, "geoip2_cache_misses_total");
+  stats_unregister_counter(&sc_key, SC_TYPE_SINGLE_VALUE, &self->misses);
+  stats_unlock();
+}
+
+GeoIPCache *
+geoip_cache_new(gsize max_entries, GDestroyNotify value_free, const gchar *database, const gchar *user)
+{
+  gint num_slots = max_entries > 0 ? main_loop_worker_get_max_number_of_threads() : 0;
+  GeoIPCache *self = g_malloc0(sizeof(GeoIPCache) + num_slots * sizeof(GeoIPCacheSlot *));
+
+  self->max_entries = max_entries;
+  self->value_free = value_free;
+  self->database = g_strdup(database);
+  self->user = g_strdup(user);
+  self->num_slots = num_slots;
+
+  if (num_slots > 0)
+    _register_stats(self);
+  return self;
+}
+
+void
+geoip_cache_free(GeoIPCache *self)
+{
+  if (self->num_slots > 0)
+    _unregister_stats(self);
+
+  for (gint i = 0; i < self->num_slots; i++)
+    {
+      if (self->slots[i])
+        _slot_free(self, self->slots[i]);
+    }
+  g_free(self->database);
+  g_free(self->user);
+  g_free(self);
+}
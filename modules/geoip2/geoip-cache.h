@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#ifndef GEOIP_CACHE_H_INCLUDED
+#define GEOIP_CACHE_H_INCLUDED
+
+#include "syslog-ng.h"
+
+#include <sys/socket.h>
+
+#define GEOIP_CACHE_DEFAULT_SIZE 1024
+
+/* the binary form of an IPv4 or IPv6 address */
+typedef struct _GeoIPCacheKey
+{
+  guint8 length;
+  guint8 address[16];
+} GeoIPCacheKey;
+
+gboolean geoip_cache_key_from_string(GeoIPCacheKey *key, const gchar *ip);
+socklen_t geoip_cache_key_to_sockaddr(const GeoIPCacheKey *key, struct sockaddr_storage *sa);
+
+/*
+ * Bounded LRU cache of already extracted lookup results, one per worker
+ * thread, so lookups don't need any locking.  The cache belongs to the
+ * parser or template function that opened the database, so it is
+ * discarded together with the database on reload.
+ *
+ * Threads without a worker thread index don't use the cache at all.
+ */
+typedef struct _GeoIPCache GeoIPCache;
+
+gpointer geoip_cache_lookup(GeoIPCache *self, const GeoIPCacheKey *key);
+
+/* takes ownership of value on success, returns FALSE if the current
+ * thread has no cache, in which case the caller keeps ownership */
+gboolean geoip_cache_store(GeoIPCache *self, const GeoIPCacheKey *key, gpointer value);
+
+GeoIPCache *geoip_cache_new(gsize max_entries, GDestroyNotify value_free,
+                            const gchar *database, const gchar *user);
+void geoip_cache_free(GeoIPCache *self);
+
+#endif
@@ -33,6 +33,7 @@ static CfgLexerKeyword geoip2_parser_keywords[] =
   { "geoip2",         KW_GEOIP2 },
   { "database",       KW_DATABASE },
   { "prefix",         KW_PREFIX },
+  { "cache_size",     KW_CACHE_SIZE },
   { NULL }
 };
 
@@ -22,6 +22,7 @@
 
 #include "geoip-parser.h"
 #include "maxminddb-helper.h"
+#include "geoip-cache.h"
 
 typedef struct _GeoIPParser GeoIPParser;
 
@@ -29,9 +30,11 @@ struct _GeoIPParser
 {
   LogParser super;
   MMDB_s *database;
+  GeoIPCache *cache;
 
   gchar *database_path;
   gchar *prefix;
+  gint cache_size;
 };
 
 void
@@ -52,13 +55,36 @@ geoip_parser_set_database_path(LogParser *s, const gchar *database_path)
   self->database_path = g_strdup(database_path);
 }
 
+void
+geoip_parser_set_cache_size(LogParser *s, gint cache_size)
+{
+  GeoIPParser *self = (GeoIPParser *) s;
+
+  self->cache_size = cache_size;
+}
+
+static MMDB_lookup_result_s
+_mmdb_lookup(GeoIPParser *self, const gchar *input, const GeoIPCacheKey *key, int *_gai_error, int *mmdb_error)
+{
+  if (!key)
+    return MMDB_lookup_string(self->database, input, _gai_error, mmdb_error);
+
+  /* already parsed, no need to go through getaddrinfo() again */
+  struct sockaddr_storage sa;
+
+  geoip_cache_key_to_sockaddr(key, &sa);
+  *_gai_error = 0;
+  return MMDB_lookup_sockaddr(self->database, (struct sockaddr *) &sa, mmdb_error);
+}
+
 static gboolean
-_mmdb_load_entry_data_list(GeoIPParser *self, const gchar *input, MMDB_entry_data_list_s **entry_data_list)
+_mmdb_load_entry_data_list(GeoIPParser *self, const gchar *input, const GeoIPCacheKey *key,
+                           MMDB_entry_data_list_s **entry_data_list)
 {
   int _gai_error, mmdb_error;
-  MMDB_lookup_result_s result =
-    MMDB_lookup_string(self->database, input, &_gai_error, &mmdb_error);
+  MMDB_lookup_result_s result = _mmdb_lookup(self, input, key, &_gai_error, &mmdb_error);
 
+  *entry_data_list = NULL;
   if (!result.found_entry)
     {
       if (_gai_error != 0)
@@ -73,7 +99,8 @@ _mmdb_load_entry_data_list(GeoIPParser *self, const gchar *input, MMDB_entry_dat
                   evt_tag_str("ip", input),
                   log_pipe_location_tag(&self->super.super));
 
-      return FALSE;
+      /* not found is a valid (and cacheable) result */
+      return _gai_error == 0 && mmdb_error == MMDB_SUCCESS;
     }
 
   mmdb_error = MMDB_get_entry_data_list(&result.entry, entry_data_list);
@@ -86,6 +113,30 @@ _mmdb_load_entry_data_list(GeoIPParser *self, const gchar *input, MMDB_entry_dat
   return TRUE;
 }
 
+/* returns NULL on error, an empty array if the address is not in the database */
+static GArray *
+_extract_fields(GeoIPParser *self, const gchar *input, const GeoIPCacheKey *key)
+{
+  MMDB_entry_data_list_s *entry_data_list;
+  if (!_mmdb_load_entry_data_list(self, input, key, &entry_data_list))
+    return NULL;
+
+  GArray *fields = geoip_fields_new();
+  if (!entry_data_list)
+    return fields;
+
+  GArray *path = g_array_new(TRUE, FALSE, sizeof(gchar *));
+  g_array_append_val(path, self->prefix);
+
+  gint status;
+  dump_geodata_into_fields(fields, entry_data_list, path, &status);
+
+  MMDB_free_entry_data_list(entry_data_list);
+  g_array_free(path, TRUE);
+
+  return fields;
+}
+
 static gboolean
 maxminddb_parser_process(LogParser *s, LogMessage **pmsg,
                          const LogPathOptions *path_options,
@@ -98,18 +149,23 @@ maxminddb_parser_process(LogParser *s, LogMessage **pmsg,
             evt_tag_str("prefix", self->prefix),
             evt_tag_msg_reference(*pmsg));
 
-  MMDB_entry_data_list_s *entry_data_list;
-  if (!_mmdb_load_entry_data_list(self, input, &entry_data_list))
-    return TRUE;
+  GeoIPCacheKey key;
+  gboolean has_key = geoip_cache_key_from_string(&key, input);
 
-  GArray *path = g_array_new(TRUE, FALSE, sizeof(gchar *));
-  g_array_append_val(path, self->prefix);
+  GArray *fields = has_key ? geoip_cache_lookup(self->cache, &key) : NULL;
+  if (fields)
+    {
+      geoip_fields_set_into_msg(fields, msg);
+      return TRUE;
+    }
 
-  gint status;
-  dump_geodata_into_msg(msg, entry_data_list, path, &status);
+  fields = _extract_fields(self, input, has_key ? &key : NULL);
+  if (!fields)
+    return TRUE;
 
-  MMDB_free_entry_data_list(entry_data_list);
-  g_array_free(path, TRUE);
+  geoip_fields_set_into_msg(fields, msg);
+  if (!has_key || !geoip_cache_store(self->cache, &key, fields))
+    geoip_fields_free(fields);
 
   return TRUE;
 }
@@ -125,22 +181,35 @@ maxminddb_parser_clone(LogPipe *s)
 
   geoip_parser_set_database_path(&cloned->super, self->database_path);
   geoip_parser_set_prefix(&cloned->super, self->prefix);
+  geoip_parser_set_cache_size(&cloned->super, self->cache_size);
 
   return &cloned->super.super;
 }
 
 static void
-maxminddb_parser_free(LogPipe *s)
+_close_database(GeoIPParser *self)
 {
-  GeoIPParser *self = (GeoIPParser *) s;
-
-  g_free(self->database_path);
-  g_free(self->prefix);
+  if (self->cache)
+    {
+      geoip_cache_free(self->cache);
+      self->cache = NULL;
+    }
   if (self->database)
     {
       MMDB_close(self->database);
       g_free(self->database);
+      self->database = NULL;
     }
+}
+
+static void
+maxminddb_parser_free(LogPipe *s)
+{
+  GeoIPParser *self = (GeoIPParser *) s;
+
+  g_free(self->database_path);
+  g_free(self->prefix);
+  _close_database(self);
 
   log_parser_free_method(s);
 }
@@ -171,6 +240,9 @@ maxminddb_parser_init(LogPipe *s)
   if (!self->database_path)
     return FALSE;
 
+  /* reopening the database invalidates everything cached from the previous one */
+  _close_database(self);
+
   self->database = g_new0(MMDB_s, 1);
   if (!self->database)
     return FALSE;
@@ -178,6 +250,9 @@ maxminddb_parser_init(LogPipe *s)
   if (!mmdb_open_database(self->database_path, self->database))
     return FALSE;
 
+  self->cache = geoip_cache_new(self->cache_size, (GDestroyNotify) geoip_fields_free,
+                                self->database_path, "parser");
+
   remove_trailing_dot(self->prefix);
 
   return log_parser_init_method(s);
@@ -195,6 +270,7 @@ maxminddb_parser_new(GlobalConfig *cfg)
   self->super.process = maxminddb_parser_process;
 
   geoip_parser_set_prefix(&self->super, ".geoip2");
+  self->cache_size = GEOIP_CACHE_DEFAULT_SIZE;
 
   return &self->super;
 }
@@ -25,12 +25,26 @@
 
 #include <syslog-ng.h>
 #include <maxminddb.h>
+#include "logmsg/logmsg.h"
 void append_mmdb_entry_data_to_gstring(GString *target, MMDB_entry_data_s *entry_data);
 gchar *mmdb_default_database(void);
 gboolean mmdb_open_database(const gchar *path, MMDB_s *database);
-MMDB_entry_data_list_s *dump_geodata_into_msg(LogMessage *msg,
-                                              MMDB_entry_data_list_s *entry_data_list,
-                                              GArray *path, gint *status);
+
+/* a name-value pair extracted from the database, ready to be set into a
+ * message */
+typedef struct _GeoIPField
+{
+  NVHandle handle;
+  gchar *value;
+  gssize value_len;
+} GeoIPField;
+
+GArray *geoip_fields_new(void);
+void geoip_fields_free(GArray *fields);
+void geoip_fields_set_into_msg(GArray *fields, LogMessage *msg);
+MMDB_entry_data_list_s *dump_geodata_into_fields(GArray *fields,
+                                                 MMDB_entry_data_list_s *entry_data_list,
+                                                 GArray *path, gint *status);
 
 
 #endif
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+#include "libtest/msg_parse_lib.h"
+
+#include "geoip-cache.h"
+#include "geoip-parser.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "scratch-buffers.h"
+#include "template/templates.h"
+#include "stats/stats.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+
+#include <iv.h>
+
+typedef void (*WorkerFunc)(gpointer user_data);
+
+typedef struct _WorkerArgs
+{
+  WorkerFunc func;
+  gpointer user_data;
+} WorkerArgs;
+
+static gpointer
+_worker_thread(gpointer s)
+{
+  WorkerArgs *args = (WorkerArgs *) s;
+
+  iv_init();
+  main_loop_worker_thread_start(MLW_ASYNC_WORKER);
+  args->func(args->user_data);
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+static void
+_run_in_worker_thread(WorkerFunc func, gpointer user_data)
+{
+  WorkerArgs args = { .func = func, .user_data = user_data };
+
+  g_thread_join(g_thread_new("geoip2-worker", _worker_thread, &args));
+}
+
+static GeoIPCacheKey
+_key(const gchar *ip)
+{
+  GeoIPCacheKey key;
+
+  cr_assert(geoip_cache_key_from_string(&key, ip), "failed to parse address: %s", ip);
+  return key;
+}
+
+static void
+_store_string(GeoIPCache *cache, const gchar *ip, const gchar *value)
+{
+  GeoIPCacheKey key = _key(ip);
+
+  cr_assert(geoip_cache_store(cache, &key, g_strdup(value)));
+}
+
+static void
+_assert_cached(GeoIPCache *cache, const gchar *ip, const gchar *expected)
+{
+  GeoIPCacheKey key = _key(ip);
+  const gchar *value = geoip_cache_lookup(cache, &key);
+
+  if (!expected)
+    {
+      cr_assert_null(value, "unexpected cache entry for %s: %s", ip, value);
+      return;
+    }
+  cr_assert_not_null(value, "expected a cache entry for %s", ip);
+  cr_assert_str_eq(value, expected);
+}
+
+Test(geoip2_cache, test_key_from_string)
+{
+  GeoIPCacheKey key;
+
+  cr_assert(geoip_cache_key_from_string(&key, "2.125.160.216"));
+  cr_assert_eq(key.length, 4);
+  cr_assert(geoip_cache_key_from_string(&key, "2001:218::1"));
+  cr_assert_eq(key.length, 16);
+  cr_assert_not(geoip_cache_key_from_string(&key, "not-an-address"));
+  cr_assert_not(geoip_cache_key_from_string(&key, ""));
+}
+
+static void
+_test_least_recently_used_entry_is_evicted(gpointer user_data)
+{
+  GeoIPCache *cache = geoip_cache_new(2, g_free, "test.mmdb", "test");
+
+  _store_string(cache, "10.0.0.1", "first");
+  _store_string(cache, "::ffff:10.0.0.2", "second");
+  _assert_cached(cache, "10.0.0.1", "first");
+
+  /* 10.0.0.1 was used last, so the second entry is evicted */
+  _store_string(cache, "10.0.0.3", "third");
+  _assert_cached(cache, "::ffff:10.0.0.2", NULL);
+  _assert_cached(cache, "10.0.0.1", "first");
+  _assert_cached(cache, "10.0.0.3", "third");
+
+  _store_string(cache, "10.0.0.3", "replaced");
+  _assert_cached(cache, "10.0.0.3", "replaced");
+  _assert_cached(cache, "10.0.0.1", "first");
+
+  geoip_cache_free(cache);
+}
+
+Test(geoip2_cache, test_least_recently_used_entry_is_evicted)
+{
+  _run_in_worker_thread(_test_least_recently_used_entry_is_evicted, NULL);
+}
+
+Test(geoip2_cache, test_threads_without_index_do_not_cache)
+{
+  GeoIPCache *cache = geoip_cache_new(2, g_free, "test.mmdb", "test");
+  GeoIPCacheKey key = _key("10.0.0.1");
+
+  cr_assert_not(geoip_cache_store(cache, &key, "value"));
+  cr_assert_null(geoip_cache_lookup(cache, &key));
+
+  geoip_cache_free(cache);
+}
+
+static void
+_test_zero_cache_size_disables_caching(gpointer user_data)
+{
+  GeoIPCache *cache = geoip_cache_new(0, g_free, "test.mmdb", "test");
+  GeoIPCacheKey key = _key("10.0.0.1");
+
+  cr_assert_not(geoip_cache_store(cache, &key, "value"));
+  cr_assert_null(geoip_cache_lookup(cache, &key));
+
+  geoip_cache_free(cache);
+}
+
+Test(geoip2_cache, test_zero_cache_size_disables_caching)
+{
+  _run_in_worker_thread(_test_zero_cache_size_disables_caching, NULL);
+}
+
+static void
+_parse_twice(gpointer user_data)
+{
+  LogParser *parser = (LogParser *) user_data;
+
+  for (gint i = 0; i < 2; i++)
+    {
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+      LogMessage *msg = log_msg_new_empty();
+
+      cr_assert(log_parser_process_message(parser, &msg, &path_options));
+      assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.country.iso_code"), "GB");
+      assert_log_message_value(msg, log_msg_get_value_handle(".geoip2.location.latitude"), "51.750000");
+      log_msg_unref(msg);
+      scratch_buffers_explicit_gc();
+    }
+}
+
+Test(geoip2_cache, test_parser_returns_the_same_values_from_the_cache)
+{
+  LogParser *parser = maxminddb_parser_new(configuration);
+  LogTemplate *template = log_template_new(NULL, NULL);
+
+  geoip_parser_set_database_path(parser, TOP_SRCDIR "/modules/geoip2/tests/test.mmdb");
+  cr_assert(log_template_compile(template, "2.125.160.216", NULL));
+  log_parser_set_template(parser, template);
+  cr_assert(log_pipe_init(&parser->super));
+
+  _run_in_worker_thread(_parse_twice, parser);
+
+  log_pipe_deinit(&parser->super);
+  log_pipe_unref(&parser->super);
+}
+
+static void
+_format_twice(gpointer user_data)
+{
+  LogTemplate *template = (LogTemplate *) user_data;
+  LogMessage *msg = log_msg_new_empty();
+  GString *result = g_string_new("");
+  LogTemplateEvalOptions options = DEFAULT_TEMPLATE_EVAL_OPTIONS;
+
+  for (gint i = 0; i < 2; i++)
+    {
+      g_string_truncate(result, 0);
+      log_template_format(template, msg, &options, result);
+      cr_assert_str_eq(result->str, "GB");
+    }
+
+  g_string_free(result, TRUE);
+  log_msg_unref(msg);
+}
+
+static gsize
+_template_function_cache_hits(void)
+{
+  StatsClusterKey sc_key;
+  StatsClusterLabel labels[] =
+  {
+    stats_cluster_label("database", TOP_SRCDIR "/modules/geoip2/tests/test.mmdb"),
+    stats_cluster_label("user", "template-function"),
+  };
+
+  stats_cluster_single_key_set(&sc_key, "geoip2_cache_hits_total", labels, G_N_ELEMENTS(labels));
+
+  stats_lock();
+  StatsCounterItem *hits = stats_get_counter(&sc_key, SC_TYPE_SINGLE_VALUE);
+  stats_unlock();
+
+  cr_assert_not_null(hits, "the cache of the template function was not created");
+  return stats_counter_get(hits);
+}
+
+Test(geoip2_cache, test_template_function_cache_is_sized_after_the_thread_space_is_finalized)
+{
+  LogTemplate *template = log_template_new(configuration, NULL);
+
+  configuration->stats_options.level = STATS_LEVEL1;
+  stats_reinit(&configuration->stats_options);
+  cr_assert(cfg_load_module(configuration, "geoip2-plugin"));
+
+  /* templates are compiled before AH_CONFIG_PRE_INIT decides the number of
+   * worker threads, which is 0 when the configuration is first loaded */
+  main_loop_worker_finalize_thread_space();
+  cr_assert(log_template_compile(template,
+                                 "$(geoip2 --database " TOP_SRCDIR "/modules/geoip2/tests/test.mmdb 2.125.160.216)",
+                                 NULL));
+  main_loop_worker_allocate_thread_space(1);
+  main_loop_worker_finalize_thread_space();
+
+  _run_in_worker_thread(_format_twice, template);
+  cr_assert_eq(_template_function_cache_hits(), 1);
+
+  log_template_unref(template);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+  main_loop_worker_allocate_thread_space(1);
+  main_loop_worker_finalize_thread_space();
+}
+
+static void
+teardown(void)
+{
+  scratch_buffers_explicit_gc();
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(geoip2_cache, .init = setup, .fini = teardown);
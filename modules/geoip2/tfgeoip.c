@@ -29,15 +29,24 @@
 #include "syslog-ng-config.h"
 #include "maxminddb-helper.h"
 #include "geoip-parser.h"
+#include "geoip-cache.h"
 
 typedef struct
 {
   TFSimpleFuncState super;
   MMDB_s  *database;
+  GeoIPCache *cache;
   gchar *database_path;
   gchar **entry_path;
+  gint cache_size;
 } TFMaxMindDBState;
 
+static void
+_free_cached_result(gpointer s)
+{
+  g_string_free((GString *) s, TRUE);
+}
+
 static inline gboolean
 tf_maxminddb_init(TFMaxMindDBState *state)
 {
@@ -53,6 +62,18 @@ tf_maxminddb_init(TFMaxMindDBState *state)
   return TRUE;
 }
 
+/* The number of worker threads is only known after AH_CONFIG_PRE_INIT,
+ * long after the template was compiled, so the cache is created by the
+ * first invocation. */
+static GeoIPCache *
+_get_cache(TFMaxMindDBState *state)
+{
+  if (g_once_init_enter(&state->cache))
+    g_once_init_leave(&state->cache,
+                      geoip_cache_new(state->cache_size, _free_cached_result, state->database_path, "template-function"));
+  return state->cache;
+}
+
 static gboolean
 tf_geoip_maxminddb_prepare(LogTemplateFunction *self, gpointer s, LogTemplate *parent,
                            gint argc, gchar *argv[], GError **error)
@@ -60,11 +81,13 @@ tf_geoip_maxminddb_prepare(LogTemplateFunction *self, gpointer s, LogTemplate *p
   TFMaxMindDBState *state = (TFMaxMindDBState *) s;
   gchar *field = NULL;
   state->database_path = NULL;
+  state->cache_size = GEOIP_CACHE_DEFAULT_SIZE;
 
   GOptionEntry maxminddb_options[] =
   {
     { "database", 'd', 0, G_OPTION_ARG_FILENAME, &state->database_path, "mmdb database location", NULL },
     { "field", 'f', 0, G_OPTION_ARG_STRING, &field, "data path in database. For example: country.iso_code", NULL },
+    { "cache-size", 0, 0, G_OPTION_ARG_INT, &state->cache_size, "number of lookup results cached per thread, 0 disables caching", NULL },
     { NULL }
   };
 
@@ -81,10 +104,10 @@ tf_geoip_maxminddb_prepare(LogTemplateFunction *self, gpointer s, LogTemplate *p
   if (!state->database_path)
     state->database_path = mmdb_default_database();
 
-  if (!state->database_path || argc < 1)
+  if (!state->database_path || argc < 1 || state->cache_size < 0)
     {
       g_set_error(error, LOG_TEMPLATE_ERROR, LOG_TEMPLATE_ERROR_COMPILE,
-                  "geoip2: format must be: $(geoip2 --database <db.mmdb> [ --field path.child ] ${HOST})\n");
+                  "geoip2: format must be: $(geoip2 --database <db.mmdb> [ --field path.child ] [ --cache-size <n> ] ${HOST})\n");
       goto error;
     }
 
@@ -119,17 +142,27 @@ error:
 
 }
 
-static void
-tf_geoip_maxminddb_call(LogTemplateFunction *self, gpointer s, const LogTemplateInvokeArgs *args, GString *result,
-                        LogMessageValueType *type)
+static MMDB_lookup_result_s
+_mmdb_lookup(TFMaxMindDBState *state, const gchar *input, const GeoIPCacheKey *key, int *_gai_error, int *mmdb_error)
 {
-  TFMaxMindDBState *state = (TFMaxMindDBState *) s;
+  if (!key)
+    return MMDB_lookup_string(state->database, input, _gai_error, mmdb_error);
+
+  struct sockaddr_storage sa;
+
+  geoip_cache_key_to_sockaddr(key, &sa);
+  *_gai_error = 0;
+  return MMDB_lookup_sockaddr(state->database, (struct sockaddr *) &sa, mmdb_error);
+}
 
+/* returns FALSE on error, an address that is not in the database yields an
+ * empty result */
+static gboolean
+_lookup_field(TFMaxMindDBState *state, const gchar *input, const GeoIPCacheKey *key, GString *result)
+{
   int _gai_error, mmdb_error;
-  MMDB_lookup_result_s mmdb_result =
-    MMDB_lookup_string(state->database, args->argv[0]->str, &_gai_error, &mmdb_error);
+  MMDB_lookup_result_s mmdb_result = _mmdb_lookup(state, input, key, &_gai_error, &mmdb_error);
 
-  *type = LM_VT_STRING;
   if (!mmdb_result.found_entry)
     {
       goto error;
@@ -145,18 +178,49 @@ tf_geoip_maxminddb_call(LogTemplateFunction *self, gpointer s, const LogTemplate
   if (entry_data.has_data)
     append_mmdb_entry_data_to_gstring(result, &entry_data);
 
-  return;
+  return TRUE;
 
 error:
   if (_gai_error != 0)
     msg_error("$(geoip2): getaddrinfo failed",
-              evt_tag_str("ip", args->argv[0]->str),
+              evt_tag_str("ip", input),
               evt_tag_str("gai_error", gai_strerror(_gai_error)));
 
   if (mmdb_error != MMDB_SUCCESS )
     msg_error("$(geoip2): maxminddb error",
-              evt_tag_str("ip", args->argv[0]->str),
+              evt_tag_str("ip", input),
               evt_tag_str("error", MMDB_strerror(mmdb_error)));
+
+  return _gai_error == 0 && mmdb_error == MMDB_SUCCESS;
+}
+
+static void
+tf_geoip_maxminddb_call(LogTemplateFunction *self, gpointer s, const LogTemplateInvokeArgs *args, GString *result,
+                        LogMessageValueType *type)
+{
+  TFMaxMindDBState *state = (TFMaxMindDBState *) s;
+  const gchar *input = args->argv[0]->str;
+
+  *type = LM_VT_STRING;
+
+  GeoIPCacheKey key;
+  gboolean has_key = geoip_cache_key_from_string(&key, input);
+
+  GeoIPCache *cache = _get_cache(state);
+  GString *cached = has_key ? geoip_cache_lookup(cache, &key) : NULL;
+  if (cached)
+    {
+      g_string_append_len(result, cached->str, cached->len);
+      return;
+    }
+
+  gsize start = result->len;
+  if (!_lookup_field(state, input, has_key ? &key : NULL, result) || !has_key)
+    return;
+
+  GString *value = g_string_new_len(result->str + start, result->len - start);
+  if (!geoip_cache_store(cache, &key, value))
+    g_string_free(value, TRUE);
 }
 
 static void
@@ -164,6 +228,8 @@ tf_geoip_maxminddb_free_state(gpointer s)
 {
   TFMaxMindDBState *state = (TFMaxMindDBState *) s;
 
+  if (state->cache)
+    geoip_cache_free(state->cache);
   g_free(state->database_path);
   g_strfreev(state->entry_path);
   tf_simple_func_free_state(&state->super);
@@ -94,7 +94,7 @@ private:
 
 DestinationDriver::DestinationDriver(BigQueryDestDriver *s)
   : super(s), url("bigquerystorage.googleapis.com"),
-    batch_bytes(10 * 1000 * 1000), keepalive_time(-1), keepalive_timeout(-1), keepalive_max_pings_without_data(-1),
+    batch_bytes(10 * 1000 * 1000), max_in_flight_requests(1), keepalive_time(-1), keepalive_timeout(-1), keepalive_max_pings_without_data(-1),
     compression(false)
 {
   log_template_options_defaults(&this->template_options);
@@ -181,6 +181,12 @@ DestinationDriver::init()
       return false;
     }
 
+  if (!this->row_encoder.compile(this->schema_descriptor))
+    {
+      msg_debug("BigQuery schema contains fields that can not be encoded directly, falling back to protobuf Reflection",
+                log_pipe_location_tag(&this->super->super.super.super.super));
+    }
+
   if (this->get_project().empty() || this->get_dataset().empty() || this->get_table().empty())
     {
       msg_error("Error initializing BigQuery destination, project(), dataset(), and table() are mandatory options",
@@ -404,6 +410,13 @@ bigquery_dd_set_batch_bytes(LogDriver *d, glong b)
   self->cpp->set_batch_bytes((size_t) b);
 }
 
+void
+bigquery_dd_set_max_in_flight_requests(LogDriver *d, gint m)
+{
+  BigQueryDestDriver *self = (BigQueryDestDriver *) d;
+  self->cpp->set_max_in_flight_requests(m);
+}
+
 void
 bigquery_dd_set_compression(LogDriver *d, gboolean b)
 {
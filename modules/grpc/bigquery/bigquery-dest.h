@@ -44,6 +44,7 @@ gboolean bigquery_dd_add_field(LogDriver *d, const gchar *name, const gchar *typ
 void bigquery_dd_set_protobuf_schema(LogDriver *d, const gchar *proto_path, GList *values);
 
 void bigquery_dd_set_batch_bytes(LogDriver *d, glong b);
+void bigquery_dd_set_max_in_flight_requests(LogDriver *d, gint m);
 void bigquery_dd_set_compression(LogDriver *d, gboolean b);
 
 void bigquery_dd_set_keepalive_time(LogDriver *d, gint t);
@@ -33,6 +33,7 @@
 #include "compat/cpp-end.h"
 
 #include "metrics/grpc-metrics.hpp"
+#include "bigquery-row-encoder.hpp"
 
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
@@ -122,6 +123,11 @@ public:
     this->batch_bytes = b;
   }
 
+  void set_max_in_flight_requests(int m)
+  {
+    this->max_in_flight_requests = m;
+  }
+
   void set_compression(bool b)
   {
     this->compression = b;
@@ -193,6 +199,7 @@ private:
   std::string table;
 
   size_t batch_bytes;
+  int max_in_flight_requests;
 
   int keepalive_time;
   int keepalive_timeout;
@@ -218,6 +225,7 @@ private:
   std::unique_ptr<google::protobuf::DynamicMessageFactory> msg_factory;
   const google::protobuf::Descriptor *schema_descriptor = nullptr;
   const google::protobuf::Message *schema_prototype  = nullptr;
+  RowEncoder row_encoder;
 
   std::list<std::pair<std::string, long>> int_extra_channel_args;
   std::list<std::pair<std::string, std::string>> string_extra_channel_args;
@@ -40,6 +40,7 @@ static CfgLexerKeyword bigquery_keywords[] =
   { "schema", KW_SCHEMA },
   { "protobuf_schema", KW_PROTOBUF_SCHEMA },
   { "batch_bytes", KW_BATCH_BYTES },
+  { "max_in_flight_requests", KW_MAX_IN_FLIGHT_REQUESTS },
   { "compression", KW_COMPRESSION },
   { "keep_alive", KW_KEEP_ALIVE },
   { "time", KW_TIME },
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bigquery-row-encoder.hpp"
+
+#include "compat/cpp-start.h"
+#include "logmsg/type-hinting.h"
+#include "compat/cpp-end.h"
+
+#include <algorithm>
+#include <cstring>
+
+using syslogng::grpc::bigquery::RowEncoder;
+using google::protobuf::FieldDescriptor;
+
+enum WireType
+{
+  WIRETYPE_VARINT = 0,
+  WIRETYPE_FIXED64 = 1,
+  WIRETYPE_LENGTH_DELIMITED = 2,
+  WIRETYPE_FIXED32 = 5,
+};
+
+static void
+_append_varint(std::string &row, uint64_t value)
+{
+  char buf[10];
+  std::size_t len = 0;
+
+  while (value >= 0x80)
+    {
+      buf[len++] = (char) ((value & 0x7F) | 0x80);
+      value >>= 7;
+    }
+  buf[len++] = (char) value;
+
+  row.append(buf, len);
+}
+
+static void
+_append_fixed32(std::string &row, uint32_t value)
+{
+  char buf[4];
+
+  for (std::size_t i = 0; i < sizeof(buf); i++)
+    buf[i] = (char) (value >> (8 * i));
+
+  row.append(buf, sizeof(buf));
+}
+
+static void
+_append_fixed64(std::string &row, uint64_t value)
+{
+  char buf[8];
+
+  for (std::size_t i = 0; i < sizeof(buf); i++)
+    buf[i] = (char) (value >> (8 * i));
+
+  row.append(buf, sizeof(buf));
+}
+
+static bool
+_lookup_encoding(const FieldDescriptor *field, RowEncoder::Encoding *encoding, WireType *wire_type)
+{
+  switch (field->type())
+    {
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      *encoding = RowEncoder::Encoding::STRING;
+      *wire_type = WIRETYPE_LENGTH_DELIMITED;
+      return true;
+    case FieldDescriptor::TYPE_INT32:
+      *encoding = RowEncoder::Encoding::INT32;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    case FieldDescriptor::TYPE_INT64:
+      *encoding = RowEncoder::Encoding::INT64;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    case FieldDescriptor::TYPE_UINT32:
+      *encoding = RowEncoder::Encoding::UINT32;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    case FieldDescriptor::TYPE_UINT64:
+      *encoding = RowEncoder::Encoding::UINT64;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    case FieldDescriptor::TYPE_SINT32:
+      *encoding = RowEncoder::Encoding::SINT32;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    case FieldDescriptor::TYPE_SINT64:
+      *encoding = RowEncoder::Encoding::SINT64;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    case FieldDescriptor::TYPE_FIXED32:
+      *encoding = RowEncoder::Encoding::FIXED32;
+      *wire_type = WIRETYPE_FIXED32;
+      return true;
+    case FieldDescriptor::TYPE_FIXED64:
+      *encoding = RowEncoder::Encoding::FIXED64;
+      *wire_type = WIRETYPE_FIXED64;
+      return true;
+    case FieldDescriptor::TYPE_SFIXED32:
+      *encoding = RowEncoder::Encoding::SFIXED32;
+      *wire_type = WIRETYPE_FIXED32;
+      return true;
+    case FieldDescriptor::TYPE_SFIXED64:
+      *encoding = RowEncoder::Encoding::SFIXED64;
+      *wire_type = WIRETYPE_FIXED64;
+      return true;
+    case FieldDescriptor::TYPE_DOUBLE:
+      *encoding = RowEncoder::Encoding::DOUBLE;
+      *wire_type = WIRETYPE_FIXED64;
+      return true;
+    case FieldDescriptor::TYPE_FLOAT:
+      *encoding = RowEncoder::Encoding::FLOAT;
+      *wire_type = WIRETYPE_FIXED32;
+      return true;
+    case FieldDescriptor::TYPE_BOOL:
+      *encoding = RowEncoder::Encoding::BOOL;
+      *wire_type = WIRETYPE_VARINT;
+      return true;
+    default:
+      return false;
+    }
+}
+
+bool
+RowEncoder::compile(const google::protobuf::Descriptor *descriptor)
+{
+  this->reset();
+
+  for (int i = 0; i < descriptor->field_count(); ++i)
+    {
+      const FieldDescriptor *field = descriptor->field(i);
+      FieldPlan field_plan;
+      WireType wire_type;
+
+      /* setting a member of a oneof clears the others, leave that to Reflection */
+      if (field->is_repeated() || field->real_containing_oneof())
+        goto unsupported;
+
+      if (!_lookup_encoding(field, &field_plan.encoding, &wire_type))
+        goto unsupported;
+
+      field_plan.field_desc = field;
+      field_plan.field_index = i;
+      field_plan.has_presence = field->has_presence();
+      field_plan.tag.clear();
+      _append_varint(field_plan.tag, ((uint64_t) field->number() << 3) | wire_type);
+
+      this->plan.push_back(std::move(field_plan));
+    }
+
+  std::sort(this->plan.begin(), this->plan.end(), [](const FieldPlan &a, const FieldPlan &b)
+  {
+    return a.field_desc->number() < b.field_desc->number();
+  });
+
+  this->compiled = true;
+  return true;
+
+unsupported:
+  this->reset();
+  return false;
+}
+
+void
+RowEncoder::reset()
+{
+  this->compiled = false;
+  this->plan.clear();
+}
+
+static bool
+_cast_to_int64(const char *value, gint on_error, int64_t *v)
+{
+  if (!type_cast_to_int64(value, -1, v, NULL))
+    {
+      type_cast_drop_helper(on_error, value, -1, "integer");
+      return false;
+    }
+  return true;
+}
+
+static bool
+_cast_to_double(const char *value, gint on_error, double *v)
+{
+  if (!type_cast_to_double(value, -1, v, NULL))
+    {
+      type_cast_drop_helper(on_error, value, -1, "double");
+      return false;
+    }
+  return true;
+}
+
+/*
+ * The integer conversions follow what the Reflection based serialization
+ * did: int32 fields are sign extended to 64 bits, unsigned fields are
+ * parsed as int64 and truncated.
+ */
+static bool
+_encode_number(const RowEncoder::FieldPlan &field, const char *value, gint on_error, uint64_t *bits)
+{
+  switch (field.encoding)
+    {
+    case RowEncoder::Encoding::INT32:
+    case RowEncoder::Encoding::SINT32:
+    case RowEncoder::Encoding::SFIXED32:
+    {
+      int32_t v;
+      if (!type_cast_to_int32(value, -1, &v, NULL))
+        {
+          type_cast_drop_helper(on_error, value, -1, "integer");
+          return false;
+        }
+
+      if (field.encoding == RowEncoder::Encoding::SINT32)
+        *bits = (uint32_t) (((uint32_t) v << 1) ^ (uint32_t) (v >> 31));
+      else if (field.encoding == RowEncoder::Encoding::SFIXED32)
+        *bits = (uint32_t) v;
+      else
+        *bits = (uint64_t) (int64_t) v;
+      return true;
+    }
+    case RowEncoder::Encoding::INT64:
+    case RowEncoder::Encoding::SINT64:
+    case RowEncoder::Encoding::SFIXED64:
+    {
+      int64_t v;
+      if (!_cast_to_int64(value, on_error, &v))
+        return false;
+
+      if (field.encoding == RowEncoder::Encoding::SINT64)
+        *bits = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+      else
+        *bits = (uint64_t) v;
+      return true;
+    }
+    case RowEncoder::Encoding::UINT32:
+    case RowEncoder::Encoding::FIXED32:
+    {
+      int64_t v;
+      if (!_cast_to_int64(value, on_error, &v))
+        return false;
+
+      *bits = (uint32_t) v;
+      return true;
+    }
+    case RowEncoder::Encoding::UINT64:
+    case RowEncoder::Encoding::FIXED64:
+    {
+      int64_t v;
+      if (!_cast_to_int64(value, on_error, &v))
+        return false;
+
+      *bits = (uint64_t) v;
+      return true;
+    }
+    case RowEncoder::Encoding::DOUBLE:
+    {
+      double v;
+      if (!_cast_to_double(value, on_error, &v))
+        return false;
+
+      std::memcpy(bits, &v, sizeof(v));
+      return true;
+    }
+    case RowEncoder::Encoding::FLOAT:
+    {
+      double v;
+      if (!_cast_to_double(value, on_error, &v))
+        return false;
+
+      float f = (float) v;
+      uint32_t f_bits;
+      std::memcpy(&f_bits, &f, sizeof(f));
+      *bits = f_bits;
+      return true;
+    }
+    case RowEncoder::Encoding::BOOL:
+    {
+      gboolean v;
+      if (!type_cast_to_boolean(value, -1, &v, NULL))
+        {
+          type_cast_drop_helper(on_error, value, -1, "boolean");
+          return false;
+        }
+
+      *bits = v ? 1 : 0;
+      return true;
+    }
+    default:
+      g_assert_not_reached();
+      return false;
+    }
+}
+
+bool
+RowEncoder::encode_field(const FieldPlan &field, const char *value, std::size_t value_len, gint on_error,
+                         std::string &row)
+{
+  if (field.encoding == Encoding::STRING)
+    {
+      if (!field.has_presence && value_len == 0)
+        return true;
+
+      row.append(field.tag);
+      _append_varint(row, value_len);
+      row.append(value, value_len);
+      return true;
+    }
+
+  uint64_t bits;
+  if (!_encode_number(field, value, on_error, &bits))
+    return false;
+
+  /*
+   * Without presence, the default value is not serialized.  Floating point
+   * values are compared bitwise, so -0.0 is still serialized.
+   */
+  if (!field.has_presence && bits == 0)
+    return true;
+
+  row.append(field.tag);
+
+  switch (field.encoding)
+    {
+    case Encoding::FIXED32:
+    case Encoding::SFIXED32:
+    case Encoding::FLOAT:
+      _append_fixed32(row, (uint32_t) bits);
+      break;
+    case Encoding::FIXED64:
+    case Encoding::SFIXED64:
+    case Encoding::DOUBLE:
+      _append_fixed64(row, bits);
+      break;
+    default:
+      _append_varint(row, bits);
+      break;
+    }
+
+  return true;
+}
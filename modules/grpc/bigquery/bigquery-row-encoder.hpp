@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef BIGQUERY_ROW_ENCODER_HPP
+#define BIGQUERY_ROW_ENCODER_HPP
+
+#include "syslog-ng.h"
+
+#include <google/protobuf/descriptor.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace syslogng {
+namespace grpc {
+namespace bigquery {
+
+/*
+ * Encodes BigQuery rows directly into protobuf wire format, without
+ * instantiating a message for every row.
+ *
+ * The plan is compiled once from the schema descriptor: it holds the
+ * fields in field number order (the order in which the protobuf library
+ * serializes them) with their tags already encoded.  The output of
+ * encode_field() is byte-identical to setting the same fields using
+ * Reflection and calling SerializePartialToString() on the message.
+ *
+ * Schemas that can't be represented this way (repeated, message, enum or
+ * oneof fields) fail to compile, in which case the caller should fall back
+ * to Reflection.
+ */
+class RowEncoder final
+{
+public:
+  enum class Encoding
+  {
+    STRING,
+    INT32,
+    INT64,
+    UINT32,
+    UINT64,
+    SINT32,
+    SINT64,
+    FIXED32,
+    FIXED64,
+    SFIXED32,
+    SFIXED64,
+    DOUBLE,
+    FLOAT,
+    BOOL,
+  };
+
+  struct FieldPlan
+  {
+    const google::protobuf::FieldDescriptor *field_desc;
+    /* index of the field in the descriptor, matches the index of the configured value */
+    std::size_t field_index;
+    std::string tag;
+    Encoding encoding;
+    /* fields without presence are not serialized when they hold the default value */
+    bool has_presence;
+  };
+
+  bool compile(const google::protobuf::Descriptor *descriptor);
+  void reset();
+
+  bool is_compiled() const
+  {
+    return this->compiled;
+  }
+
+  const std::vector<FieldPlan> &get_plan() const
+  {
+    return this->plan;
+  }
+
+  /*
+   * Appends the encoded field to @row.  @value must be NUL-terminated, as
+   * the type casting functions depend on it.  Nothing is appended in case
+   * the value can't be converted to the type of the field, and false is
+   * returned.
+   */
+  static bool encode_field(const FieldPlan &field, const char *value, std::size_t value_len, gint on_error,
+                           std::string &row);
+
+private:
+  bool compiled = false;
+  std::vector<FieldPlan> plan;
+};
+
+}
+}
+}
+
+#endif
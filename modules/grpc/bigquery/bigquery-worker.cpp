@@ -45,12 +45,6 @@ using syslogng::grpc::bigquery::DestinationWorker;
 using syslogng::grpc::bigquery::DestinationDriver;
 using google::protobuf::FieldDescriptor;
 
-struct _BigQueryDestWorker
-{
-  LogThreadedDestWorker super;
-  DestinationWorker *cpp;
-};
-
 DestinationWorker::DestinationWorker(BigQueryDestWorker *s) : super(s)
 {
   DestinationDriver *owner = this->get_owner();
@@ -90,6 +84,9 @@ DestinationWorker::connect()
   this->prepare_context(*this->batch_writer_ctx.get());
   this->batch_writer = this->stub->AppendRows(this->batch_writer_ctx.get());
 
+  this->in_flight.clear();
+  this->next_offset = 0;
+  this->committed_offset = 0;
   this->prepare_batch();
 
   msg_debug("Connecting to BigQuery", log_pipe_location_tag((LogPipe *) this->super->super.owner));
@@ -302,14 +299,59 @@ error:
   return false;
 }
 
-LogThreadedResult
-DestinationWorker::insert(LogMessage *msg)
+bool
+DestinationWorker::encode_field(const RowEncoder::FieldPlan &field_plan, LogMessage *msg, std::string &row)
 {
   DestinationDriver *owner = this->get_owner();
-  std::string serialized_row;
-  size_t row_bytes = 0;
+  const Field &field = owner->fields[field_plan.field_index];
+  bool result = true;
 
-  google::cloud::bigquery::storage::v1::ProtoRows *rows = this->current_batch.mutable_proto_rows()->mutable_rows();
+  ScratchBuffersMarker m;
+  GString *buf = scratch_buffers_alloc_and_mark(&m);
+
+  LogMessageValueType type;
+
+  Slice value = this->format_template(field.value, msg, buf, &type);
+
+  if (type == LM_VT_NULL)
+    {
+      if (field.field_desc->is_required())
+        {
+          msg_error("Missing required field", evt_tag_str("field", field.name.c_str()));
+          result = false;
+        }
+    }
+  else
+    {
+      result = RowEncoder::encode_field(field_plan, value.str, value.len, owner->template_options.on_error, row);
+    }
+
+  scratch_buffers_reclaim_marked(m);
+  return result;
+}
+
+bool
+DestinationWorker::encode_row(LogMessage *msg, std::string &row)
+{
+  DestinationDriver *owner = this->get_owner();
+  bool msg_has_field = false;
+
+  for (const auto &field_plan : owner->row_encoder.get_plan())
+    {
+      bool field_inserted = this->encode_field(field_plan, msg, row);
+      msg_has_field |= field_inserted;
+
+      if (!field_inserted && (owner->template_options.on_error & ON_ERROR_DROP_MESSAGE))
+        return false;
+    }
+
+  return msg_has_field;
+}
+
+bool
+DestinationWorker::encode_row_with_reflection(LogMessage *msg, std::string &row)
+{
+  DestinationDriver *owner = this->get_owner();
 
   google::protobuf::Message *message = owner->schema_prototype->New();
   const google::protobuf::Reflection *reflection = message->GetReflection();
@@ -321,15 +363,43 @@ DestinationWorker::insert(LogMessage *msg)
       msg_has_field |= field_inserted;
 
       if (!field_inserted && (owner->template_options.on_error & ON_ERROR_DROP_MESSAGE))
-        goto drop;
+        {
+          msg_has_field = false;
+          break;
+        }
     }
 
-  if (!msg_has_field)
+  if (msg_has_field)
+    message->SerializePartialToString(&row);
+
+  delete message;
+  return msg_has_field;
+}
+
+bool
+DestinationWorker::serialize_row(LogMessage *msg, std::string &row)
+{
+  /* the precompiled plan writes the wire format directly, Reflection is only needed for exotic schemas */
+  if (this->get_owner()->row_encoder.is_compiled())
+    return this->encode_row(msg, row);
+
+  return this->encode_row_with_reflection(msg, row);
+}
+
+LogThreadedResult
+DestinationWorker::insert(LogMessage *msg)
+{
+  DestinationDriver *owner = this->get_owner();
+  std::string serialized_row;
+  size_t row_bytes = 0;
+
+  google::cloud::bigquery::storage::v1::ProtoRows *rows = this->current_batch.mutable_proto_rows()->mutable_rows();
+
+  if (!this->serialize_row(msg, serialized_row))
     goto drop;
 
   this->batch_size++;
 
-  message->SerializePartialToString(&serialized_row);
   row_bytes = serialized_row.size();
   rows->add_serialized_rows(std::move(serialized_row));
 
@@ -338,8 +408,6 @@ DestinationWorker::insert(LogMessage *msg)
 
   msg_trace("Message added to BigQuery batch", log_pipe_location_tag((LogPipe *) this->super->super.owner));
 
-  delete message;
-
   if (this->should_initiate_flush())
     return log_threaded_dest_worker_flush(&this->super->super, LTF_FLUSH_NORMAL);
 
@@ -351,7 +419,6 @@ drop:
       msg_error("Failed to format message for BigQuery, dropping message",
                 log_pipe_location_tag((LogPipe *) this->super->super.owner));
     }
-  delete message;
 
   /* LTR_DROP currently drops the entire batch */
   return LTR_QUEUED;
@@ -382,51 +449,162 @@ _append_rows_response_get_status(const google::cloud::bigquery::storage::v1::App
 }
 
 LogThreadedResult
-DestinationWorker::flush(LogThreadedFlushMode mode)
+DestinationWorker::process_in_flight_response()
 {
-  if (this->batch_size == 0)
-    return LTR_SUCCESS;
-
-  LogThreadedResult result;
+  DestinationDriver *owner = this->get_owner();
+  InFlightBatch batch = this->in_flight.front();
   google::cloud::bigquery::storage::v1::AppendRowsResponse append_rows_response;
 
-  if (!this->batch_writer->Write(current_batch))
-    {
-      msg_error("Error writing BigQuery batch", log_pipe_location_tag((LogPipe *) this->super->super.owner));
-      result = LTR_ERROR;
-      goto exit;
-    }
-
   if (!this->batch_writer->Read(&append_rows_response))
     {
       msg_error("Error reading BigQuery batch response", log_pipe_location_tag((LogPipe *) this->super->super.owner));
-      result = LTR_ERROR;
-      goto exit;
+      return LTR_ERROR;
     }
 
+  /* the response is consumed, the batch is no longer waiting for it, even if it has to be rewound */
+  this->in_flight.pop_front();
+
+  owner->metrics.insert_grpc_request_stats(_append_rows_response_get_status(append_rows_response));
+
   if (append_rows_response.has_error() && append_rows_response.error().code() != ::grpc::StatusCode::ALREADY_EXISTS)
     {
       msg_error("Error in BigQuery batch",
                 evt_tag_str("error", append_rows_response.error().message().c_str()),
                 evt_tag_int("code", append_rows_response.error().code()),
+                evt_tag_long("offset", batch.offset),
                 log_pipe_location_tag((LogPipe *) this->super->super.owner));
 
-      result = LTR_ERROR;
+      if (append_rows_response.row_errors_size() == 0)
+        return LTR_ERROR;
 
-      if (append_rows_response.row_errors_size() != 0)
-        result = handle_row_errors(append_rows_response);
+      this->handle_row_errors(append_rows_response);
+      log_threaded_dest_worker_drop_in_flight_messages(&this->super->super, batch.batch_size);
 
-      goto exit;
+      /* the batches sent after the dropped one point beyond the end of the stream, they have to be resent */
+      if (!this->in_flight.empty())
+        return this->resend_in_flight_batches();
+
+      this->next_offset = this->committed_offset;
+      return LTR_SUCCESS;
+    }
+
+  if (append_rows_response.has_append_result() && append_rows_response.append_result().has_offset() &&
+      append_rows_response.append_result().offset().value() != batch.offset)
+    {
+      msg_error("BigQuery response does not belong to the oldest batch in flight",
+                evt_tag_long("expected_offset", batch.offset),
+                evt_tag_long("offset", append_rows_response.append_result().offset().value()),
+                log_pipe_location_tag((LogPipe *) this->super->super.owner));
+      return LTR_ERROR;
     }
 
-  log_threaded_dest_worker_written_bytes_add(&this->super->super, this->current_batch_bytes);
-  log_threaded_dest_driver_insert_batch_length_stats(this->super->super.owner, this->current_batch_bytes);
+  log_threaded_dest_worker_written_bytes_add(&this->super->super, batch.batch_bytes);
+  log_threaded_dest_driver_insert_batch_length_stats(this->super->super.owner, batch.batch_bytes);
+  log_threaded_dest_worker_ack_in_flight_messages(&this->super->super, batch.batch_size);
+
+  this->committed_offset = batch.offset + batch.rows;
 
   msg_debug("BigQuery batch delivered", log_pipe_location_tag((LogPipe *) this->super->super.owner));
-  result = LTR_SUCCESS;
+  return LTR_SUCCESS;
+}
+
+LogThreadedResult
+DestinationWorker::send_batch()
+{
+  DestinationDriver *owner = this->get_owner();
+
+  while (this->in_flight.size() >= (size_t) owner->max_in_flight_requests)
+    {
+      LogThreadedResult result = this->process_in_flight_response();
+      if (result != LTR_SUCCESS)
+        return result;
+    }
+
+  this->current_batch.mutable_offset()->set_value(this->next_offset);
+
+  if (!this->batch_writer->Write(this->current_batch))
+    {
+      msg_error("Error writing BigQuery batch", log_pipe_location_tag((LogPipe *) this->super->super.owner));
+      return LTR_ERROR;
+    }
+
+  InFlightBatch batch;
+  batch.offset = this->next_offset;
+  batch.rows = this->batch_size;
+  batch.batch_bytes = this->current_batch_bytes;
+  batch.batch_size = log_threaded_dest_worker_set_batch_in_flight(&this->super->super);
+  this->in_flight.push_back(batch);
+
+  this->next_offset += batch.rows;
+  this->prepare_batch();
+  return LTR_SUCCESS;
+}
+
+void
+DestinationWorker::abort_in_flight_batches()
+{
+  google::cloud::bigquery::storage::v1::AppendRowsResponse append_rows_response;
+
+  /* responses of the aborted batches are still on their way, skip them */
+  for (size_t i = 0; i < this->in_flight.size(); i++)
+    {
+      if (!this->batch_writer->Read(&append_rows_response))
+        break;
+    }
+
+  this->in_flight.clear();
+  this->next_offset = this->committed_offset;
+}
+
+/*
+ * Rewinds the batches in flight together with the one being collected, so
+ * that they are sent again from the committed offset.  This is not a
+ * delivery failure, so it does not count as a retry either.
+ */
+LogThreadedResult
+DestinationWorker::resend_in_flight_batches()
+{
+  this->abort_in_flight_batches();
+  log_threaded_dest_worker_reclaim_in_flight_messages(&this->super->super);
+  log_threaded_dest_worker_rewind_messages(&this->super->super, this->super->super.batch_size);
+  this->prepare_batch();
+  return LTR_EXPLICIT_ACK_MGMT;
+}
+
+/*
+ * Batches are written to the AppendRows stream with their offset and are
+ * kept in flight until their response arrives, while the next batch is
+ * being collected.  Responses arrive in the order of the requests, so each
+ * one belongs to the oldest batch in flight.
+ */
+LogThreadedResult
+DestinationWorker::flush(LogThreadedFlushMode mode)
+{
+  DestinationDriver *owner = this->get_owner();
+  LogThreadedResult result;
+
+  if (this->batch_size == 0 && this->in_flight.empty())
+    return LTR_SUCCESS;
+
+  if (this->batch_size > 0)
+    result = this->send_batch();
+  else
+    result = this->process_in_flight_response();
+
+  /* without pipelining, and at shutdown, wait for all the responses */
+  if (owner->max_in_flight_requests == 1 || mode == LTF_FLUSH_EXPEDITE)
+    {
+      while (result == LTR_SUCCESS && !this->in_flight.empty())
+        result = this->process_in_flight_response();
+    }
+
+  if (result == LTR_SUCCESS || result == LTR_EXPLICIT_ACK_MGMT)
+    return LTR_EXPLICIT_ACK_MGMT;
 
-exit:
-  this->get_owner()->metrics.insert_grpc_request_stats(_append_rows_response_get_status(append_rows_response));
+  /* the failed batch can only be rewound together with all batches sent
+   * after it and the one being collected, the result applies to all of them */
+  this->abort_in_flight_batches();
+  log_threaded_dest_worker_reclaim_in_flight_messages(&this->super->super);
   this->prepare_batch();
   return result;
 }
@@ -37,6 +37,8 @@
 #include <string>
 #include <memory>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 
 #include "google/cloud/bigquery/storage/v1/storage.grpc.pb.h"
 
@@ -53,6 +55,15 @@ private:
     std::size_t len;
   };
 
+  struct InFlightBatch
+  {
+    /* number of messages, including the ones that could not be formatted */
+    gint batch_size;
+    std::size_t batch_bytes;
+    int64_t rows;
+    int64_t offset;
+  };
+
 public:
   DestinationWorker(BigQueryDestWorker *s);
   ~DestinationWorker();
@@ -72,11 +83,22 @@ private:
   bool should_initiate_flush();
   bool insert_field(const google::protobuf::Reflection *reflection, const Field &field,
                     LogMessage *msg, google::protobuf::Message *message);
+  bool encode_field(const RowEncoder::FieldPlan &field_plan, LogMessage *msg, std::string &row);
+  bool encode_row(LogMessage *msg, std::string &row);
+  bool encode_row_with_reflection(LogMessage *msg, std::string &row);
+  bool serialize_row(LogMessage *msg, std::string &row);
+  LogThreadedResult send_batch();
+  LogThreadedResult process_in_flight_response();
+  void abort_in_flight_batches();
+  LogThreadedResult resend_in_flight_batches();
   LogThreadedResult handle_row_errors(const google::cloud::bigquery::storage::v1::AppendRowsResponse &response);
   Slice format_template(LogTemplate *tmpl, LogMessage *msg, GString *value, LogMessageValueType *type);
   DestinationDriver *get_owner();
 
 private:
+  /* drives the worker against a fake BigQueryWrite server in the unit tests */
+  friend class DestinationWorkerTest;
+
   BigQueryDestWorker *super;
 
   std::string table;
@@ -94,10 +116,21 @@ private:
   google::cloud::bigquery::storage::v1::AppendRowsRequest current_batch;
   size_t batch_size = 0;
   size_t current_batch_bytes = 0;
+
+  /* batches written to the AppendRows stream, waiting for their response */
+  std::deque<InFlightBatch> in_flight;
+  int64_t next_offset = 0;
+  int64_t committed_offset = 0;
 };
 
 }
 }
 }
 
+struct _BigQueryDestWorker
+{
+  LogThreadedDestWorker super;
+  syslogng::grpc::bigquery::DestinationWorker *cpp;
+};
+
 #endif
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bigquery-row-encoder.hpp"
+
+#include "compat/cpp-start.h"
+#include "logmsg/type-hinting.h"
+#include "on-error.h"
+#include "apphook.h"
+#include "compat/cpp-end.h"
+
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+
+#include <criterion/criterion.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace syslogng::grpc::bigquery;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::FieldDescriptorProto;
+
+struct TestField
+{
+  const char *name;
+  FieldDescriptorProto::Type type;
+  int number;
+};
+
+/* field numbers are deliberately out of order, serialization orders them */
+static const TestField test_fields[] =
+{
+  { "str", FieldDescriptorProto::TYPE_STRING, 7 },
+  { "bytes", FieldDescriptorProto::TYPE_BYTES, 3 },
+  { "i32", FieldDescriptorProto::TYPE_INT32, 1 },
+  { "i64", FieldDescriptorProto::TYPE_INT64, 20 },
+  { "u32", FieldDescriptorProto::TYPE_UINT32, 2 },
+  { "u64", FieldDescriptorProto::TYPE_UINT64, 300 },
+  { "s32", FieldDescriptorProto::TYPE_SINT32, 4 },
+  { "s64", FieldDescriptorProto::TYPE_SINT64, 5 },
+  { "f32", FieldDescriptorProto::TYPE_FIXED32, 6 },
+  { "f64", FieldDescriptorProto::TYPE_FIXED64, 16 },
+  { "sf32", FieldDescriptorProto::TYPE_SFIXED32, 15 },
+  { "sf64", FieldDescriptorProto::TYPE_SFIXED64, 2047 },
+  { "dbl", FieldDescriptorProto::TYPE_DOUBLE, 9 },
+  { "flt", FieldDescriptorProto::TYPE_FLOAT, 8 },
+  { "bool", FieldDescriptorProto::TYPE_BOOL, 10 },
+};
+
+class TestSchema
+{
+public:
+  TestSchema(const char *syntax)
+  {
+    google::protobuf::FileDescriptorProto file_descriptor_proto;
+
+    file_descriptor_proto.set_name("test.proto");
+    file_descriptor_proto.set_syntax(syntax);
+    google::protobuf::DescriptorProto *descriptor_proto = file_descriptor_proto.add_message_type();
+    descriptor_proto->set_name("TestRecord");
+
+    for (const auto &test_field : test_fields)
+      {
+        FieldDescriptorProto *field_desc_proto = descriptor_proto->add_field();
+        field_desc_proto->set_name(test_field.name);
+        field_desc_proto->set_type(test_field.type);
+        field_desc_proto->set_number(test_field.number);
+        field_desc_proto->set_label(FieldDescriptorProto::LABEL_OPTIONAL);
+      }
+
+    this->descriptor = this->pool.BuildFile(file_descriptor_proto)->message_type(0);
+    cr_assert(this->descriptor);
+    this->prototype = this->factory.GetPrototype(this->descriptor);
+  }
+
+  const google::protobuf::Descriptor *descriptor;
+  const google::protobuf::Message *prototype;
+
+private:
+  google::protobuf::DescriptorPool pool;
+  google::protobuf::DynamicMessageFactory factory;
+};
+
+/* mirrors DestinationWorker::insert_field() */
+static void
+_set_with_reflection(google::protobuf::Message *message, const FieldDescriptor *field, const char *value)
+{
+  const google::protobuf::Reflection *reflection = message->GetReflection();
+  gint32 i32;
+  gint64 i64;
+  gdouble d;
+  gboolean b;
+
+  switch (field->cpp_type())
+    {
+    case FieldDescriptor::CppType::CPPTYPE_STRING:
+      reflection->SetString(message, field, value);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_INT32:
+      cr_assert(type_cast_to_int32(value, -1, &i32, NULL));
+      reflection->SetInt32(message, field, i32);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_INT64:
+      cr_assert(type_cast_to_int64(value, -1, &i64, NULL));
+      reflection->SetInt64(message, field, i64);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_UINT32:
+      cr_assert(type_cast_to_int64(value, -1, &i64, NULL));
+      reflection->SetUInt32(message, field, (uint32_t) i64);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_UINT64:
+      cr_assert(type_cast_to_int64(value, -1, &i64, NULL));
+      reflection->SetUInt64(message, field, (uint64_t) i64);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_DOUBLE:
+      cr_assert(type_cast_to_double(value, -1, &d, NULL));
+      reflection->SetDouble(message, field, d);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_FLOAT:
+      cr_assert(type_cast_to_double(value, -1, &d, NULL));
+      reflection->SetFloat(message, field, (float) d);
+      break;
+    case FieldDescriptor::CppType::CPPTYPE_BOOL:
+      cr_assert(type_cast_to_boolean(value, -1, &b, NULL));
+      reflection->SetBool(message, field, b);
+      break;
+    default:
+      cr_assert(false, "unexpected field type");
+    }
+}
+
+static std::string
+_serialize_with_reflection(const TestSchema &schema, const std::vector<const char *> &values)
+{
+  std::unique_ptr<google::protobuf::Message> message{schema.prototype->New()};
+  std::string row;
+
+  for (int i = 0; i < schema.descriptor->field_count(); ++i)
+    {
+      if (values[i])
+        _set_with_reflection(message.get(), schema.descriptor->field(i), values[i]);
+    }
+
+  message->SerializePartialToString(&row);
+  return row;
+}
+
+static std::string
+_serialize_with_encoder(const TestSchema &schema, const std::vector<const char *> &values)
+{
+  RowEncoder encoder;
+  std::string row;
+
+  cr_assert(encoder.compile(schema.descriptor));
+
+  for (const auto &field_plan : encoder.get_plan())
+    {
+      const char *value = values[field_plan.field_index];
+
+      if (value)
+        cr_assert(RowEncoder::encode_field(field_plan, value, strlen(value), 0, row));
+    }
+
+  return row;
+}
+
+static void
+_assert_encoder_matches_reflection(const char *syntax, const std::vector<const char *> &values)
+{
+  TestSchema schema(syntax);
+
+  std::string expected = _serialize_with_reflection(schema, values);
+  std::string actual = _serialize_with_encoder(schema, values);
+
+  cr_assert_eq(actual.size(), expected.size(), "row size mismatch, syntax: %s", syntax);
+  cr_assert(actual == expected, "row content mismatch, syntax: %s", syntax);
+}
+
+static const std::vector<std::vector<const char *>> test_values =
+{
+  { "foo", "bar", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "1.5", "2.5", "true" },
+  { "", "", "0", "0", "0", "0", "0", "0", "0", "0", "0", "0", "0", "0", "false" },
+  {
+    "a longer string that needs more than a single byte of length prefix, a longer string that needs "
+    "more than a single byte of length prefix",
+    "b\xc3\xa1r", "-1", "-2", "-3", "-4", "-5", "-6", "-7", "-8", "-9", "-10", "-1.5", "-2.5", "false"
+  },
+  {
+    "x", "y", "2147483647", "9223372036854775807", "4294967295", "-1", "-2147483648", "-9223372036854775808",
+    "4294967295", "-1", "-2147483648", "-9223372036854775808", "0.25", "3.4e38", "1"
+  },
+  { NULL, "only bytes", NULL, "42", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+  { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+};
+
+Test(bigquery_row_encoder, test_proto2_rows_are_identical_to_reflection)
+{
+  for (const auto &values : test_values)
+    _assert_encoder_matches_reflection("proto2", values);
+}
+
+Test(bigquery_row_encoder, test_proto3_rows_are_identical_to_reflection)
+{
+  for (const auto &values : test_values)
+    _assert_encoder_matches_reflection("proto3", values);
+}
+
+Test(bigquery_row_encoder, test_invalid_values_are_not_encoded)
+{
+  TestSchema schema("proto2");
+  RowEncoder encoder;
+  std::string row;
+
+  cr_assert(encoder.compile(schema.descriptor));
+
+  for (const auto &field_plan : encoder.get_plan())
+    {
+      if (field_plan.encoding == RowEncoder::Encoding::STRING)
+        continue;
+
+      cr_assert_not(RowEncoder::encode_field(field_plan, "not-a-number", 12, ON_ERROR_SILENT, row));
+    }
+
+  cr_assert(row.empty());
+}
+
+Test(bigquery_row_encoder, test_unsupported_schemas_are_not_compiled)
+{
+  google::protobuf::DescriptorPool pool;
+  google::protobuf::FileDescriptorProto file_descriptor_proto;
+  RowEncoder encoder;
+
+  file_descriptor_proto.set_name("test.proto");
+  file_descriptor_proto.set_syntax("proto2");
+  google::protobuf::DescriptorProto *descriptor_proto = file_descriptor_proto.add_message_type();
+  descriptor_proto->set_name("TestRecord");
+
+  FieldDescriptorProto *field_desc_proto = descriptor_proto->add_field();
+  field_desc_proto->set_name("list");
+  field_desc_proto->set_type(FieldDescriptorProto::TYPE_STRING);
+  field_desc_proto->set_number(1);
+  field_desc_proto->set_label(FieldDescriptorProto::LABEL_REPEATED);
+
+  const google::protobuf::Descriptor *descriptor = pool.BuildFile(file_descriptor_proto)->message_type(0);
+
+  cr_assert_not(encoder.compile(descriptor));
+  cr_assert_not(encoder.is_compiled());
+  cr_assert(encoder.get_plan().empty());
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(bigquery_row_encoder, .init = setup, .fini = teardown);
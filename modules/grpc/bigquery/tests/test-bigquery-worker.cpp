@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bigquery-worker.hpp"
+#include "bigquery-dest.hpp"
+
+#include "compat/cpp-start.h"
+#include "logthrdest/logthrdestdrv.h"
+#include "logqueue.h"
+#include "mainloop.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "compat/cpp-end.h"
+
+#include <grpcpp/server.h>
+#include <grpcpp/server_builder.h>
+
+#include <criterion/criterion.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bigquery_v1 = google::cloud::bigquery::storage::v1;
+
+/*
+ * A BigQueryWrite service with a single write stream, appending the rows of
+ * the requests that continue the stream, like the COMMITTED streams of
+ * BigQuery do.
+ */
+class FakeBigQueryWrite final : public bigquery_v1::BigQueryWrite::Service
+{
+public:
+  ::grpc::Status CreateWriteStream(::grpc::ServerContext *context, const bigquery_v1::CreateWriteStreamRequest *request,
+                                   bigquery_v1::WriteStream *response) override
+  {
+    response->set_name(request->parent() + "/streams/test");
+    return ::grpc::Status::OK;
+  }
+
+  ::grpc::Status AppendRows(::grpc::ServerContext *context,
+                            ::grpc::ServerReaderWriter<bigquery_v1::AppendRowsResponse,
+                            bigquery_v1::AppendRowsRequest> *stream) override
+  {
+    bigquery_v1::AppendRowsRequest request;
+
+    while (stream->Read(&request))
+      {
+        bigquery_v1::AppendRowsResponse response;
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        this->process_request(request, response);
+        stream->Write(response);
+      }
+
+    return ::grpc::Status::OK;
+  }
+
+  ::grpc::Status FinalizeWriteStream(::grpc::ServerContext *context,
+                                     const bigquery_v1::FinalizeWriteStreamRequest *request,
+                                     bigquery_v1::FinalizeWriteStreamResponse *response) override
+  {
+    return ::grpc::Status::OK;
+  }
+
+  std::vector<int64_t> get_request_offsets()
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->request_offsets;
+  }
+
+  std::vector<std::string> get_rows()
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->rows;
+  }
+
+public:
+  /* the request at this offset is rejected with a row error */
+  int64_t reject_rows_at_offset = -1;
+
+  /* the rows at this offset are appended, but the response reports an error */
+  int64_t lose_response_at_offset = -1;
+
+private:
+  void append(const bigquery_v1::AppendRowsRequest &request)
+  {
+    /* the schema has a single string field, its value follows the tag and the length */
+    for (const auto &row : request.proto_rows().rows().serialized_rows())
+      this->rows.push_back(row.substr(2));
+  }
+
+  void set_error(bigquery_v1::AppendRowsResponse &response, ::grpc::StatusCode code, const char *message)
+  {
+    response.mutable_error()->set_code(code);
+    response.mutable_error()->set_message(message);
+  }
+
+  void process_request(const bigquery_v1::AppendRowsRequest &request, bigquery_v1::AppendRowsResponse &response)
+  {
+    int64_t offset = request.offset().value();
+    int64_t stream_end = this->rows.size();
+
+    this->request_offsets.push_back(offset);
+
+    if (offset == this->reject_rows_at_offset)
+      {
+        this->reject_rows_at_offset = -1;
+        this->set_error(response, ::grpc::StatusCode::INVALID_ARGUMENT, "rows are invalid");
+
+        bigquery_v1::RowError *row_error = response.add_row_errors();
+        row_error->set_index(0);
+        row_error->set_code(bigquery_v1::RowError::FIELDS_ERROR);
+        row_error->set_message("field is invalid");
+        return;
+      }
+
+    if (offset < stream_end)
+      {
+        this->set_error(response, ::grpc::StatusCode::ALREADY_EXISTS, "rows already exist");
+        return;
+      }
+
+    if (offset > stream_end)
+      {
+        this->set_error(response, ::grpc::StatusCode::OUT_OF_RANGE, "offset is beyond the end of the stream");
+        return;
+      }
+
+    this->append(request);
+
+    if (offset == this->lose_response_at_offset)
+      {
+        this->lose_response_at_offset = -1;
+        this->set_error(response, ::grpc::StatusCode::INTERNAL, "response is lost");
+        return;
+      }
+
+    response.mutable_append_result()->mutable_offset()->set_value(offset);
+  }
+
+private:
+  std::mutex lock;
+  std::vector<int64_t> request_offsets;
+  std::vector<std::string> rows;
+};
+
+namespace syslogng {
+namespace grpc {
+namespace bigquery {
+
+/*
+ * Feeds the worker the way the worker thread of LogThreadedDestDriver
+ * does, but synchronously, so the state of the worker can be checked after
+ * each step.
+ */
+class DestinationWorkerTest
+{
+public:
+  DestinationWorkerTest(LogThreadedDestDriver *owner, std::shared_ptr<::grpc::Channel> channel)
+    : owner(owner), worker(owner->workers[0]), cpp(((BigQueryDestWorker *) owner->workers[0])->cpp)
+  {
+    this->cpp->channel = channel;
+    this->cpp->stub = bigquery_v1::BigQueryWrite::NewStub(channel);
+    cr_assert(this->cpp->connect());
+  }
+
+  ~DestinationWorkerTest()
+  {
+    this->cpp->disconnect();
+  }
+
+  void send_messages(gint n)
+  {
+    LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+    gchar pid[16];
+
+    for (gint i = 0; i < n; i++)
+      {
+        LogMessage *msg = log_msg_new_empty();
+
+        g_snprintf(pid, sizeof(pid), "%d", i);
+        log_msg_set_value(msg, LM_V_PID, pid, -1);
+        log_queue_push_tail(this->worker->queue, msg, &path_options);
+      }
+
+    this->process_queue();
+  }
+
+  gsize get_in_flight_batches()
+  {
+    return this->cpp->in_flight.size();
+  }
+
+  gsize max_in_flight_batches = 0;
+
+private:
+  void process_result(LogThreadedResult result)
+  {
+    cr_assert(result == LTR_QUEUED || result == LTR_EXPLICIT_ACK_MGMT || result == LTR_ERROR,
+              "unexpected result: %s", log_threaded_result_to_str(result));
+
+    /* errors are retried right away, the stream is the same, so the offsets are still valid */
+    if (result == LTR_ERROR)
+      log_threaded_dest_worker_rewind_messages(this->worker, this->worker->batch_size);
+
+    this->max_in_flight_batches = MAX(this->max_in_flight_batches, this->cpp->in_flight.size());
+  }
+
+  void process_queue()
+  {
+    LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+    for (gint i = 0; i < 1000; i++)
+      {
+        LogMessage *msg = log_queue_pop_head(this->worker->queue, &path_options);
+
+        if (!msg)
+          {
+            if (this->worker->batch_size == 0 && this->cpp->in_flight.empty())
+              return;
+
+            this->process_result(this->cpp->flush(LTF_FLUSH_NORMAL));
+            continue;
+          }
+
+        this->worker->batch_size++;
+        this->process_result(this->cpp->insert(msg));
+        if (this->worker->batch_size >= this->owner->batch_lines)
+          this->process_result(this->cpp->flush(LTF_FLUSH_NORMAL));
+
+        log_msg_unref(msg);
+      }
+
+    cr_assert_fail("messages were not delivered");
+  }
+
+private:
+  LogThreadedDestDriver *owner;
+  LogThreadedDestWorker *worker;
+  DestinationWorker *cpp;
+};
+
+}
+}
+}
+
+using syslogng::grpc::bigquery::DestinationWorkerTest;
+
+static MainLoop *main_loop;
+static MainLoopOptions main_loop_options = {0};
+
+static FakeBigQueryWrite *service;
+static std::unique_ptr<::grpc::Server> server;
+static LogDriver *driver;
+
+static void
+_create_driver(gint max_in_flight_requests)
+{
+  GlobalConfig *cfg = main_loop_get_current_config(main_loop);
+  LogTemplate *pid = log_template_new(cfg, NULL);
+
+  cr_assert(log_template_compile(pid, "$PID", NULL));
+
+  driver = bigquery_dd_new(cfg);
+  bigquery_dd_set_project(driver, "project");
+  bigquery_dd_set_dataset(driver, "dataset");
+  bigquery_dd_set_table(driver, "table");
+  cr_assert(bigquery_dd_add_field(driver, "pid", "STRING", pid));
+  bigquery_dd_set_max_in_flight_requests(driver, max_in_flight_requests);
+  log_threaded_dest_driver_set_batch_lines(driver, 2);
+  log_template_unref(pid);
+
+  /* the workers are not started, the testcases drive them */
+  cr_assert(log_pipe_init(&driver->super));
+}
+
+static std::vector<std::string>
+_pids(gint from, gint to)
+{
+  std::vector<std::string> pids;
+
+  for (gint i = from; i < to; i++)
+    pids.push_back(std::to_string(i));
+  return pids;
+}
+
+static LogThreadedDestDriver *
+_owner(void)
+{
+  return (LogThreadedDestDriver *) driver;
+}
+
+Test(bigquery_worker, test_batches_in_flight_are_acked_in_the_order_of_their_offsets)
+{
+  _create_driver(3);
+
+  {
+    DestinationWorkerTest worker(_owner(), server->InProcessChannel(::grpc::ChannelArguments()));
+
+    worker.send_messages(10);
+    cr_assert_eq(worker.max_in_flight_batches, 3);
+    cr_assert_eq(worker.get_in_flight_batches(), 0);
+  }
+
+  cr_assert(service->get_request_offsets() == std::vector<int64_t>({0, 2, 4, 6, 8}));
+  cr_assert(service->get_rows() == _pids(0, 10));
+  cr_assert_eq(stats_counter_get(_owner()->metrics.written_messages), 10);
+  cr_assert_eq(stats_counter_get(_owner()->metrics.dropped_messages), 0);
+}
+
+Test(bigquery_worker, test_batch_with_row_errors_is_dropped_and_the_batches_after_it_are_resent)
+{
+  _create_driver(3);
+  service->reject_rows_at_offset = 2;
+
+  {
+    DestinationWorkerTest worker(_owner(), server->InProcessChannel(::grpc::ChannelArguments()));
+
+    worker.send_messages(10);
+    cr_assert_eq(_owner()->workers[0]->retries_counter, 0,
+                 "resending the batches after a dropped one is not a retry");
+    cr_assert_eq(_owner()->workers[0]->retries_on_error_counter, 0);
+  }
+
+  cr_assert(service->get_request_offsets() == std::vector<int64_t>({0, 2, 4, 6, 2, 4, 6}));
+
+  std::vector<std::string> expected_rows = _pids(0, 2);
+  for (const auto &pid : _pids(4, 10))
+    expected_rows.push_back(pid);
+  cr_assert(service->get_rows() == expected_rows);
+
+  cr_assert_eq(stats_counter_get(_owner()->metrics.written_messages), 8);
+  cr_assert_eq(stats_counter_get(_owner()->metrics.dropped_messages), 2);
+}
+
+Test(bigquery_worker, test_already_existing_rows_are_not_appended_again)
+{
+  _create_driver(1);
+  service->lose_response_at_offset = 2;
+
+  {
+    DestinationWorkerTest worker(_owner(), server->InProcessChannel(::grpc::ChannelArguments()));
+
+    worker.send_messages(6);
+  }
+
+  cr_assert(service->get_request_offsets() == std::vector<int64_t>({0, 2, 2, 4}));
+  cr_assert(service->get_rows() == _pids(0, 6));
+  cr_assert_eq(stats_counter_get(_owner()->metrics.written_messages), 6);
+  cr_assert_eq(stats_counter_get(_owner()->metrics.dropped_messages), 0);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+  cfg_set_current_version(main_loop_get_current_config(main_loop));
+
+  service = new FakeBigQueryWrite();
+
+  ::grpc::ServerBuilder builder;
+  builder.RegisterService(service);
+  server = builder.BuildAndStart();
+  cr_assert(server);
+}
+
+static void
+teardown(void)
+{
+  log_pipe_deinit(&driver->super);
+  log_pipe_unref(&driver->super);
+  driver = NULL;
+
+  server->Shutdown();
+  server.reset();
+  delete service;
+
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(bigquery_worker, .init = setup, .fini = teardown);
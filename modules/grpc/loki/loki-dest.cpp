@@ -66,23 +66,9 @@ DestinationDriver::add_label(std::string name, LogTemplate *value)
 }
 
 bool
-DestinationDriver::init()
+DestinationDriver::init_worker_partition_key()
 {
   GlobalConfig *cfg = log_pipe_get_config(&this->super->super.super.super.super);
-
-  if (!credentials_builder.validate())
-    {
-      return false;
-    }
-
-  if (!this->message)
-    {
-      this->message = log_template_new(cfg, NULL);
-      log_template_compile(this->message, DEFAULT_MESSAGE_TEMPLATE, NULL);
-    }
-
-  log_template_options_init(&this->template_options, cfg);
-
   LogTemplate *worker_partition_key = log_template_new(cfg, NULL);
 
   std::stringstream template_str;
@@ -109,6 +95,35 @@ DestinationDriver::init()
   else
     log_threaded_dest_driver_set_worker_partition_key_ref(&this->super->super.super.super, worker_partition_key);
 
+  return true;
+}
+
+bool
+DestinationDriver::init()
+{
+  GlobalConfig *cfg = log_pipe_get_config(&this->super->super.super.super.super);
+
+  if (!credentials_builder.validate())
+    {
+      return false;
+    }
+
+  if (!this->message)
+    {
+      this->message = log_template_new(cfg, NULL);
+      log_template_compile(this->message, DEFAULT_MESSAGE_TEMPLATE, NULL);
+    }
+
+  log_template_options_init(&this->template_options, cfg);
+
+  /*
+   * The entries of a stream are always sent by the same worker, so they
+   * stay in order.  With a single worker, there is no need to render the
+   * labels for the partition key as well.
+   */
+  if (this->super->super.num_workers > 1 && !this->init_worker_partition_key())
+    return false;
+
   if (!log_threaded_dest_driver_init_method(&this->super->super.super.super.super))
     return false;
 
@@ -311,7 +326,5 @@ loki_dd_new(GlobalConfig *cfg)
 
   self->super.worker.construct = loki_dw_new;
 
-  self->super.flush_on_key_change = TRUE;
-
   return &self->super.super.super;
 }
@@ -156,6 +156,7 @@ public:
 
 private:
   friend class DestinationWorker;
+  bool init_worker_partition_key();
 
 private:
   LokiDestDriver *super;
@@ -36,7 +36,7 @@
 #include "push.grpc.pb.h"
 
 #include <string>
-#include <sstream>
+#include <cstring>
 #include <chrono>
 #include <sys/time.h>
 
@@ -49,13 +49,7 @@ using syslogng::grpc::loki::DestinationWorker;
 using syslogng::grpc::loki::DestinationDriver;
 using google::protobuf::FieldDescriptor;
 
-struct _LokiDestWorker
-{
-  LogThreadedDestWorker super;
-  DestinationWorker *cpp;
-};
-
-DestinationWorker::DestinationWorker(LokiDestWorker *s) : super(s)
+DestinationWorker::DestinationWorker(LokiDestWorker *s) : super(s), batch_id(1)
 {
 }
 
@@ -149,45 +143,107 @@ DestinationWorker::disconnect()
 void
 DestinationWorker::prepare_batch()
 {
-  this->current_batch = logproto::PushRequest{};
-  this->current_batch.add_streams();
+  /* Clear() keeps the allocated streams and entries, they are reused by the next batch */
+  this->current_batch.Clear();
+  this->batch_id++;
+
+  /* label sets are kept across batches, unless there are too many of them */
+  if (this->label_sets.size() > MAX_CACHED_LABEL_SETS)
+    this->label_sets.clear();
 }
 
+/*
+ * The label values are rendered once per message, each of them prefixed by
+ * its length, so that the concatenation identifies the label set
+ * unambiguously.
+ */
 void
-DestinationWorker::set_labels(LogMessage *msg)
+DestinationWorker::render_label_values(LogMessage *msg)
 {
   DestinationDriver *owner = this->get_owner();
-  logproto::StreamAdapter *stream = this->current_batch.mutable_streams(0);
 
   LogTemplateEvalOptions options = {&owner->template_options, LTZ_SEND, this->super->super.seq_num, NULL, LM_VT_STRING};
 
   ScratchBuffersMarker m;
   GString *buf = scratch_buffers_alloc_and_mark(&m);
-  GString *sanitized_value = scratch_buffers_alloc();
 
-  std::stringstream formatted_labels;
-  bool comma_needed = false;
-  formatted_labels << "{";
+  this->label_values.clear();
   for (const auto &label : owner->labels)
     {
-      if (comma_needed)
-        formatted_labels << ", ";
-
       log_template_format(label.value, msg, &options, buf);
 
-      g_string_truncate(sanitized_value, 0);
-      append_unsafe_utf8_as_escaped_binary(sanitized_value, buf->str, -1, "\"");
+      guint32 len = buf->len;
+      this->label_values.append((const gchar *) &len, sizeof(len));
+      this->label_values.append(buf->str, buf->len);
+    }
+
+  scratch_buffers_reclaim_marked(m);
+}
+
+void
+DestinationWorker::format_labels(const std::string &values, std::string &formatted_labels)
+{
+  DestinationDriver *owner = this->get_owner();
+
+  ScratchBuffersMarker m;
+  GString *buf = scratch_buffers_alloc_and_mark(&m);
+
+  gsize pos = 0;
+  bool comma_needed = false;
+  g_string_append_c(buf, '{');
+  for (const auto &label : owner->labels)
+    {
+      guint32 len;
+      memcpy(&len, values.data() + pos, sizeof(len));
+      pos += sizeof(len);
+
+      if (comma_needed)
+        g_string_append(buf, ", ");
 
-      formatted_labels << label.name << "=\"" << sanitized_value->str << "\"";
+      g_string_append_len(buf, label.name.c_str(), label.name.length());
+      g_string_append(buf, "=\"");
+      append_unsafe_utf8_as_escaped_binary(buf, values.data() + pos, len, "\"");
+      g_string_append_c(buf, '"');
+      pos += len;
 
       comma_needed = true;
     }
-  formatted_labels << "}";
-  stream->set_labels(formatted_labels.str());
+  g_string_append_c(buf, '}');
 
+  formatted_labels.assign(buf->str, buf->len);
   scratch_buffers_reclaim_marked(m);
 }
 
+/*
+ * Messages are grouped into streams by their label set, so a batch can
+ * contain messages with different labels.  Label sets are cached by their
+ * rendered values together with their escaped, formatted form, and the
+ * index of their stream in the current batch.
+ */
+logproto::StreamAdapter *
+DestinationWorker::lookup_stream(LogMessage *msg)
+{
+  this->render_label_values(msg);
+
+  auto it = this->label_sets.find(this->label_values);
+  if (it == this->label_sets.end())
+    {
+      it = this->label_sets.emplace(this->label_values, LabelSet{}).first;
+      this->format_labels(it->first, it->second.formatted_labels);
+    }
+
+  LabelSet &label_set = it->second;
+  if (label_set.batch_id == this->batch_id)
+    return this->current_batch.mutable_streams(label_set.stream_index);
+
+  label_set.batch_id = this->batch_id;
+  label_set.stream_index = this->current_batch.streams_size();
+
+  logproto::StreamAdapter *stream = this->current_batch.add_streams();
+  stream->set_labels(label_set.formatted_labels);
+  return stream;
+}
+
 void
 DestinationWorker::set_timestamp(logproto::EntryAdapter *entry, LogMessage *msg)
 {
@@ -208,11 +264,7 @@ LogThreadedResult
 DestinationWorker::insert(LogMessage *msg)
 {
   DestinationDriver *owner = this->get_owner();
-  logproto::StreamAdapter *stream = this->current_batch.mutable_streams(0);
-
-  if (stream->entries_size() == 0)
-    this->set_labels(msg);
-
+  logproto::StreamAdapter *stream = this->lookup_stream(msg);
   logproto::EntryAdapter *entry = stream->add_entries();
 
   this->set_timestamp(entry, msg);
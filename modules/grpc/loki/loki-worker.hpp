@@ -34,6 +34,7 @@
 
 #include <string>
 #include <memory>
+#include <unordered_map>
 
 #include "push.grpc.pb.h"
 
@@ -55,8 +56,20 @@ public:
   LogThreadedResult flush(LogThreadedFlushMode mode);
 
 private:
+  struct LabelSet
+  {
+    std::string formatted_labels;
+    /* the stream of this label set in current_batch, if batch_id matches */
+    guint64 batch_id = 0;
+    int stream_index = 0;
+  };
+
+  static const gsize MAX_CACHED_LABEL_SETS = 1024;
+
   void prepare_batch();
-  void set_labels(LogMessage *msg);
+  void render_label_values(LogMessage *msg);
+  void format_labels(const std::string &values, std::string &formatted_labels);
+  logproto::StreamAdapter *lookup_stream(LogMessage *msg);
   void set_timestamp(logproto::EntryAdapter *entry, LogMessage *msg);
   DestinationDriver *get_owner();
 
@@ -68,10 +81,24 @@ private:
   std::shared_ptr<::grpc::Channel> channel;
   std::unique_ptr<logproto::Pusher::Stub> stub;
   logproto::PushRequest current_batch;
+  guint64 batch_id;
+
+  /* rendered label values -> label set, kept across batches */
+  std::string label_values;
+  std::unordered_map<std::string, LabelSet> label_sets;
+
+  /* inspects the batches built by the worker in the unit tests */
+  friend class DestinationWorkerTest;
 };
 
 }
 }
 }
 
+struct _LokiDestWorker
+{
+  LogThreadedDestWorker super;
+  syslogng::grpc::loki::DestinationWorker *cpp;
+};
+
 #endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "loki-worker.hpp"
+#include "loki-dest.hpp"
+
+#include "compat/cpp-start.h"
+#include "logthrdest/logthrdestdrv.h"
+#include "mainloop.h"
+#include "apphook.h"
+#include "compat/cpp-end.h"
+
+#include <criterion/criterion.h>
+
+#include <string>
+#include <vector>
+
+namespace syslogng {
+namespace grpc {
+namespace loki {
+
+/*
+ * Feeds messages directly to the worker and inspects the batch it builds,
+ * the batches are never sent.
+ */
+class DestinationWorkerTest
+{
+public:
+  DestinationWorkerTest(LogThreadedDestDriver *owner)
+    : worker(owner->workers[0]), cpp(((LokiDestWorker *) owner->workers[0])->cpp)
+  {
+    this->cpp->prepare_batch();
+  }
+
+  void insert(const gchar *program, const gchar *host, const gchar *message)
+  {
+    LogMessage *msg = log_msg_new_empty();
+
+    log_msg_set_value(msg, LM_V_PROGRAM, program, -1);
+    log_msg_set_value(msg, LM_V_HOST, host, -1);
+    log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+
+    this->worker->batch_size++;
+    cr_assert_eq(this->cpp->insert(msg), LTR_QUEUED);
+    log_msg_unref(msg);
+  }
+
+  /* what flush() does with the batch after sending it */
+  void finish_batch()
+  {
+    this->worker->batch_size = 0;
+    this->cpp->prepare_batch();
+  }
+
+  void assert_stream(int index, const std::string &labels, const std::vector<std::string> &lines)
+  {
+    const logproto::StreamAdapter &stream = this->cpp->current_batch.streams(index);
+
+    cr_assert_eq(stream.labels(), labels, "stream #%d has unexpected labels: %s", index, stream.labels().c_str());
+    cr_assert_eq(stream.entries_size(), (int) lines.size(), "stream #%d has %d entries", index, stream.entries_size());
+    for (int i = 0; i < stream.entries_size(); i++)
+      cr_assert_eq(stream.entries(i).line(), lines[i], "entry #%d of stream #%d: %s", i, index,
+                   stream.entries(i).line().c_str());
+  }
+
+  int get_num_streams()
+  {
+    return this->cpp->current_batch.streams_size();
+  }
+
+  gsize get_num_cached_label_sets()
+  {
+    return this->cpp->label_sets.size();
+  }
+
+private:
+  LogThreadedDestWorker *worker;
+  DestinationWorker *cpp;
+};
+
+}
+}
+}
+
+using syslogng::grpc::loki::DestinationWorkerTest;
+
+static MainLoop *main_loop;
+static MainLoopOptions main_loop_options = {0};
+static LogDriver *driver;
+
+static LogTemplate *
+_compile_template(const gchar *template_str)
+{
+  LogTemplate *t = log_template_new(main_loop_get_current_config(main_loop), NULL);
+
+  cr_assert(log_template_compile(t, template_str, NULL));
+  return t;
+}
+
+static void
+_create_driver(void)
+{
+  driver = loki_dd_new(main_loop_get_current_config(main_loop));
+
+  LogTemplate *app = _compile_template("$PROGRAM");
+  LogTemplate *host = _compile_template("$HOST");
+  loki_dd_add_label(driver, "app", app);
+  loki_dd_add_label(driver, "host", host);
+  log_template_unref(app);
+  log_template_unref(host);
+
+  loki_dd_set_message_template_ref(driver, _compile_template("$MESSAGE"));
+
+  /* the workers are not started, the testcases drive them */
+  cr_assert(log_pipe_init(&driver->super));
+}
+
+Test(loki_worker, test_mixed_labels_are_batched_into_one_stream_per_label_set)
+{
+  _create_driver();
+  cr_assert_null(((LogThreadedDestDriver *) driver)->worker_partition_key,
+                 "a single worker does not need a partition key");
+
+  DestinationWorkerTest worker((LogThreadedDestDriver *) driver);
+
+  worker.insert("foo", "host1", "m1");
+  worker.insert("bar", "host1", "m2");
+  worker.insert("foo", "host1", "m3");
+  worker.insert("foo", "host2", "m4");
+  worker.insert("bar", "host1", "m5");
+  worker.insert("q\"uote", "host1", "m6");
+
+  cr_assert_eq(worker.get_num_streams(), 4);
+  worker.assert_stream(0, "{app=\"foo\", host=\"host1\"}", {"m1", "m3"});
+  worker.assert_stream(1, "{app=\"bar\", host=\"host1\"}", {"m2", "m5"});
+  worker.assert_stream(2, "{app=\"foo\", host=\"host2\"}", {"m4"});
+  worker.assert_stream(3, "{app=\"q\\\"uote\", host=\"host1\"}", {"m6"});
+
+  /* the label sets are kept for the next batch, their streams are not */
+  worker.finish_batch();
+  cr_assert_eq(worker.get_num_cached_label_sets(), 4);
+
+  worker.insert("foo", "host2", "m7");
+  worker.insert("baz", "host1", "m8");
+  worker.insert("foo", "host2", "m9");
+
+  cr_assert_eq(worker.get_num_streams(), 2);
+  worker.assert_stream(0, "{app=\"foo\", host=\"host2\"}", {"m7", "m9"});
+  worker.assert_stream(1, "{app=\"baz\", host=\"host1\"}", {"m8"});
+  cr_assert_eq(worker.get_num_cached_label_sets(), 5);
+}
+
+Test(loki_worker, test_label_values_are_not_mixed_up_across_labels)
+{
+  _create_driver();
+
+  DestinationWorkerTest worker((LogThreadedDestDriver *) driver);
+
+  /* the concatenation of the values is the same */
+  worker.insert("ab", "c", "m1");
+  worker.insert("a", "bc", "m2");
+
+  cr_assert_eq(worker.get_num_streams(), 2);
+  worker.assert_stream(0, "{app=\"ab\", host=\"c\"}", {"m1"});
+  worker.assert_stream(1, "{app=\"a\", host=\"bc\"}", {"m2"});
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+  cfg_set_current_version(main_loop_get_current_config(main_loop));
+}
+
+static void
+teardown(void)
+{
+  log_pipe_deinit(&driver->super);
+  log_pipe_unref(&driver->super);
+  driver = NULL;
+
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(loki_worker, .init = setup, .fini = teardown);
@@ -226,14 +226,15 @@ public:
     if (filterx_object_is_type(object, &FILTERX_TYPE_NAME(json_object)) ||
         filterx_object_is_type(object, &FILTERX_TYPE_NAME(json_array)))
       {
-        str = filterx_json_to_json_literal(object);
-        if (!str)
+        GString *json_literal = scratch_buffers_alloc();
+        if (!filterx_json_to_json_literal(object, json_literal))
           {
             msg_error("protobuf-field: json marshal error",
                       evt_tag_str("field", reflectors.fieldDescriptor->name().c_str()));
             return false;
           }
-        len = strlen(str);
+        str = json_literal->str;
+        len = json_literal->len;
         goto success;
       }
 
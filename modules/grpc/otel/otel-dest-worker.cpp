@@ -30,6 +30,7 @@
 #include <google/protobuf/util/message_differencer.h>
 
 #include "otel-dest-worker.hpp"
+#include "otel-logmsg-handles.hpp"
 
 #define get_DestWorker(s) (((OtelDestWorker *) s)->cpp)
 
@@ -110,9 +111,52 @@ DestWorker::get_metadata_for_current_msg(LogMessage *msg)
     }
 }
 
+static bool
+_append_raw_metadata_field(LogMessage *msg, NVHandle handle, LogMessageValueType expected_type, std::string &key)
+{
+  gssize len;
+  LogMessageValueType type;
+  const gchar *value = log_msg_get_value_with_type(msg, handle, &len, &type);
+
+  if (type != expected_type)
+    return false;
+
+  /* length-prefixed, so that the boundaries of the fields are unambiguous */
+  guint32 field_len = len;
+  key.append((const char *) &field_len, sizeof(field_len));
+  key.append(value, len);
+  return true;
+}
+
+bool
+DestWorker::get_raw_metadata_key(LogMessage *msg, std::string &key)
+{
+  key.resize(0);
+  return _append_raw_metadata_field(msg, logmsg_handle::RAW_RESOURCE, LM_VT_PROTOBUF, key) &&
+         _append_raw_metadata_field(msg, logmsg_handle::RAW_RESOURCE_SCHEMA_URL, LM_VT_STRING, key) &&
+         _append_raw_metadata_field(msg, logmsg_handle::RAW_SCOPE, LM_VT_PROTOBUF, key) &&
+         _append_raw_metadata_field(msg, logmsg_handle::RAW_SCOPE_SCHEMA_URL, LM_VT_STRING, key);
+}
+
+void
+DestWorker::clear_raw_metadata_cache()
+{
+  scope_logs_by_raw_metadata.clear();
+  scope_metrics_by_raw_metadata.clear();
+  scope_spans_by_raw_metadata.clear();
+}
+
 ScopeLogs *
 DestWorker::lookup_scope_logs(LogMessage *msg)
 {
+  bool has_raw_metadata = get_raw_metadata_key(msg, raw_metadata_key);
+  if (has_raw_metadata)
+    {
+      auto cached = scope_logs_by_raw_metadata.find(raw_metadata_key);
+      if (cached != scope_logs_by_raw_metadata.end())
+        return cached->second;
+    }
+
   get_metadata_for_current_msg(msg);
 
   ResourceLogs *resource_logs = nullptr;
@@ -151,6 +195,9 @@ DestWorker::lookup_scope_logs(LogMessage *msg)
       scope_logs->set_schema_url(current_msg_metadata.scope_schema_url);
     }
 
+  if (has_raw_metadata)
+    scope_logs_by_raw_metadata.emplace(raw_metadata_key, scope_logs);
+
   return scope_logs;
 }
 
@@ -189,6 +236,14 @@ DestWorker::lookup_fallback_scope_logs(LogMessage *msg)
 ScopeMetrics *
 DestWorker::lookup_scope_metrics(LogMessage *msg)
 {
+  bool has_raw_metadata = get_raw_metadata_key(msg, raw_metadata_key);
+  if (has_raw_metadata)
+    {
+      auto cached = scope_metrics_by_raw_metadata.find(raw_metadata_key);
+      if (cached != scope_metrics_by_raw_metadata.end())
+        return cached->second;
+    }
+
   get_metadata_for_current_msg(msg);
 
   ResourceMetrics *resource_metrics = nullptr;
@@ -227,12 +282,23 @@ DestWorker::lookup_scope_metrics(LogMessage *msg)
       scope_metrics->set_schema_url(current_msg_metadata.scope_schema_url);
     }
 
+  if (has_raw_metadata)
+    scope_metrics_by_raw_metadata.emplace(raw_metadata_key, scope_metrics);
+
   return scope_metrics;
 }
 
 ScopeSpans *
 DestWorker::lookup_scope_spans(LogMessage *msg)
 {
+  bool has_raw_metadata = get_raw_metadata_key(msg, raw_metadata_key);
+  if (has_raw_metadata)
+    {
+      auto cached = scope_spans_by_raw_metadata.find(raw_metadata_key);
+      if (cached != scope_spans_by_raw_metadata.end())
+        return cached->second;
+    }
+
   get_metadata_for_current_msg(msg);
 
   ResourceSpans *resource_spans = nullptr;
@@ -271,6 +337,9 @@ DestWorker::lookup_scope_spans(LogMessage *msg)
       scope_spans->set_schema_url(current_msg_metadata.scope_schema_url);
     }
 
+  if (has_raw_metadata)
+    scope_spans_by_raw_metadata.emplace(raw_metadata_key, scope_spans);
+
   return scope_spans;
 }
 
@@ -536,6 +605,7 @@ exit:
   metrics_service_request.Clear();
   trace_service_request.Clear();
   fallback_msg_scope_logs = nullptr;
+  clear_raw_metadata_cache();
 
   logs_current_batch_bytes = metrics_current_batch_bytes = spans_current_batch_bytes = 0;
 
@@ -37,6 +37,8 @@
 #include "otel-dest.hpp"
 #include "otel-protobuf-formatter.hpp"
 
+#include <unordered_map>
+
 typedef struct OtelDestWorker_ OtelDestWorker;
 
 namespace syslogng {
@@ -75,6 +77,8 @@ protected:
 
   void clear_current_msg_metadata();
   void get_metadata_for_current_msg(LogMessage *msg);
+  bool get_raw_metadata_key(LogMessage *msg, std::string &key);
+  void clear_raw_metadata_cache();
 
   virtual ScopeLogs *lookup_scope_logs(LogMessage *msg);
   virtual ScopeLogs *lookup_fallback_scope_logs(LogMessage *msg);
@@ -122,6 +126,17 @@ protected:
   } current_msg_metadata;
 
   ScopeLogs *fallback_msg_scope_logs = nullptr;
+
+  /*
+   * Messages coming from the OTel source carry their resource and scope in
+   * serialized form.  Identical serialized metadata always maps to the same
+   * ScopeLogs/ScopeMetrics/ScopeSpans of the current batch, so these can be
+   * found without parsing and comparing the resource and scope again.
+   */
+  std::string raw_metadata_key;
+  std::unordered_map<std::string, ScopeLogs *> scope_logs_by_raw_metadata;
+  std::unordered_map<std::string, ScopeMetrics *> scope_metrics_by_raw_metadata;
+  std::unordered_map<std::string, ScopeSpans *> scope_spans_by_raw_metadata;
 };
 
 }
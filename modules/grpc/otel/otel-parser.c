@@ -53,6 +53,7 @@ static CfgLexerKeyword otel_keywords[] =
   { "compression",               KW_COMPRESSION },
   { "batch_bytes",               KW_BATCH_BYTES },
   { "concurrent_requests",       KW_CONCURRENT_REQUESTS },
+  { "handler_threads",           KW_HANDLER_THREADS },
   { "channel_args",              KW_CHANNEL_ARGS },
   { "headers",                   KW_HEADERS },
   { "set_hostname",              KW_SET_HOSTNAME },
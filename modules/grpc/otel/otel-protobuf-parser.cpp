@@ -1113,32 +1113,62 @@ _unset_raw_fields(LogMessage *msg)
   log_msg_unset_value(msg, logmsg_handle::RAW_SPAN);
 }
 
+syslogng::grpc::otel::RawMetadata::RawMetadata(const ::grpc::string &peer)
+  : saddr(_extract_saddr(peer))
+{
+}
+
+syslogng::grpc::otel::RawMetadata::~RawMetadata()
+{
+  g_sockaddr_unref(saddr);
+}
+
 void
-syslogng::grpc::otel::ProtobufParser::store_raw_metadata(LogMessage *msg, const ::grpc::string &peer,
-                                                         const Resource &resource,
-                                                         const std::string &resource_schema_url,
-                                                         const InstrumentationScope &scope,
-                                                         const std::string &scope_schema_url)
+syslogng::grpc::otel::RawMetadata::set_resource(const Resource &value, const std::string &schema_url)
+{
+  value.SerializePartialToString(&resource);
+  resource_schema_url = schema_url;
+}
+
+void
+syslogng::grpc::otel::RawMetadata::set_scope(const InstrumentationScope &value, const std::string &schema_url)
 {
-  std::string serialized;
+  value.SerializePartialToString(&scope);
+  scope_schema_url = schema_url;
+}
 
-  msg->saddr = _extract_saddr(peer);
+void
+syslogng::grpc::otel::RawMetadata::store(LogMessage *msg) const
+{
+  msg->saddr = g_sockaddr_ref(saddr);
 
   /* .otel_raw.resource */
-  resource.SerializePartialToString(&serialized);
-  _set_value(msg, logmsg_handle::RAW_RESOURCE, serialized, LM_VT_PROTOBUF);
+  _set_value(msg, logmsg_handle::RAW_RESOURCE, resource, LM_VT_PROTOBUF);
 
   /* .otel_raw.resource_schema_url */
   _set_value(msg, logmsg_handle::RAW_RESOURCE_SCHEMA_URL, resource_schema_url, LM_VT_STRING);
 
   /* .otel_raw.scope */
-  scope.SerializePartialToString(&serialized);
-  _set_value(msg, logmsg_handle::RAW_SCOPE, serialized, LM_VT_PROTOBUF);
+  _set_value(msg, logmsg_handle::RAW_SCOPE, scope, LM_VT_PROTOBUF);
 
   /* .otel_raw.scope_schema_url */
   _set_value(msg, logmsg_handle::RAW_SCOPE_SCHEMA_URL, scope_schema_url, LM_VT_STRING);
 }
 
+void
+syslogng::grpc::otel::ProtobufParser::store_raw_metadata(LogMessage *msg, const ::grpc::string &peer,
+                                                         const Resource &resource,
+                                                         const std::string &resource_schema_url,
+                                                         const InstrumentationScope &scope,
+                                                         const std::string &scope_schema_url)
+{
+  RawMetadata raw_metadata(peer);
+
+  raw_metadata.set_resource(resource, resource_schema_url);
+  raw_metadata.set_scope(scope, scope_schema_url);
+  raw_metadata.store(msg);
+}
+
 void
 syslogng::grpc::otel::ProtobufParser::store_raw(LogMessage *msg, const LogRecord &log_record)
 {
@@ -48,6 +48,31 @@ using opentelemetry::proto::logs::v1::LogRecord;
 using opentelemetry::proto::metrics::v1::Metric;
 using opentelemetry::proto::trace::v1::Span;
 
+/*
+ * The Resource and InstrumentationScope are shared by all the records below
+ * them in a request.  RawMetadata serializes them only once, and stores the
+ * same buffers into every LogMessage created from those records.
+ */
+class RawMetadata
+{
+public:
+  RawMetadata(const ::grpc::string &peer);
+  RawMetadata(const RawMetadata &) = delete;
+  RawMetadata &operator=(const RawMetadata &) = delete;
+  ~RawMetadata();
+
+  void set_resource(const Resource &resource, const std::string &schema_url);
+  void set_scope(const InstrumentationScope &scope, const std::string &schema_url);
+  void store(LogMessage *msg) const;
+
+private:
+  GSockAddr *saddr;
+  std::string resource;
+  std::string resource_schema_url;
+  std::string scope;
+  std::string scope_schema_url;
+};
+
 class ProtobufParser
 {
 public:
@@ -53,7 +53,9 @@ using opentelemetry::proto::metrics::v1::Metric;
 class AsyncServiceCallInterface
 {
 public:
+  virtual ~AsyncServiceCallInterface() = default;
   virtual void Proceed(bool ok) = 0;
+  virtual void Process() = 0;
 };
 
 template <class S, class Req, class Res>
@@ -61,6 +63,7 @@ class AsyncServiceCall final : public AsyncServiceCallInterface
 {
 public:
   void Proceed(bool ok) override;
+  void Process() override;
 
 public:
   AsyncServiceCall(SourceWorker &worker_, S *service_, ::grpc::ServerCompletionQueue *cq_)
@@ -83,12 +86,9 @@ private:
   CallStatus status;
 };
 
-}
-}
-}
-
-template <> void
-syslogng::grpc::otel::TraceServiceCall::Proceed(bool ok)
+template <class S, class Req, class Res>
+void
+AsyncServiceCall<S, Req, Res>::Proceed(bool ok)
 {
   if (status == FINISH || !ok)
     {
@@ -96,23 +96,44 @@ syslogng::grpc::otel::TraceServiceCall::Proceed(bool ok)
       return;
     }
 
+  if (worker.driver.handler_threads)
+    {
+      worker.hand_off(this);
+      return;
+    }
+
+  Process();
+}
+
+}
+}
+}
+
+template <> void
+syslogng::grpc::otel::TraceServiceCall::Process()
+{
   if (!worker.super->super.under_termination)
     new TraceServiceCall(worker, service, cq);
 
   ::grpc::Status response_status = ::grpc::Status::OK;
 
   int msgs_in_fetch_round = 0;
+  RawMetadata raw_metadata(ctx.peer());
 
   for (const ResourceSpans &resource_spans : request.resource_spans())
     {
       const Resource &resource = resource_spans.resource();
       const std::string &resource_spans_schema_url = resource_spans.schema_url();
 
+      raw_metadata.set_resource(resource, resource_spans_schema_url);
+
       for (const ScopeSpans &scope_spans : resource_spans.scope_spans())
         {
           const InstrumentationScope &scope = scope_spans.scope();
           const std::string &scope_spans_schema_url = scope_spans.schema_url();
 
+          raw_metadata.set_scope(scope, scope_spans_schema_url);
+
           for (const Span &span : scope_spans.spans())
             {
               if (worker.super->super.under_termination)
@@ -122,8 +143,7 @@ syslogng::grpc::otel::TraceServiceCall::Proceed(bool ok)
                 }
 
               LogMessage *msg = log_msg_new_empty();
-              ProtobufParser::store_raw_metadata(msg, ctx.peer(), resource, resource_spans_schema_url, scope,
-                                                 scope_spans_schema_url);
+              raw_metadata.store(msg);
               ProtobufParser::store_raw(msg, span);
               worker.post(msg);
 
@@ -145,31 +165,33 @@ syslogng::grpc::otel::TraceServiceCall::Proceed(bool ok)
 }
 
 template <> void
-syslogng::grpc::otel::LogsServiceCall::Proceed(bool ok)
+syslogng::grpc::otel::LogsServiceCall::Process()
 {
-  if (status == FINISH || !ok)
-    {
-      delete this;
-      return;
-    }
-
   if (!worker.super->super.under_termination)
     new LogsServiceCall(worker, service, cq);
 
   ::grpc::Status response_status = ::grpc::Status::OK;
 
   int msgs_in_fetch_round = 0;
+  RawMetadata raw_metadata(ctx.peer());
 
   for (const ResourceLogs &resource_logs : request.resource_logs())
     {
       const Resource &resource = resource_logs.resource();
       const std::string &resource_logs_schema_url = resource_logs.schema_url();
 
+      raw_metadata.set_resource(resource, resource_logs_schema_url);
+
       for (const ScopeLogs &scope_logs : resource_logs.scope_logs())
         {
           const InstrumentationScope &scope = scope_logs.scope();
           const std::string &scope_logs_schema_url = scope_logs.schema_url();
 
+          bool is_syslog_ng = ProtobufParser::is_syslog_ng_log_record(resource, resource_logs_schema_url, scope,
+                                                                      scope_logs_schema_url);
+          if (!is_syslog_ng)
+            raw_metadata.set_scope(scope, scope_logs_schema_url);
+
           for (const LogRecord &log_record : scope_logs.log_records())
             {
               if (worker.super->super.under_termination)
@@ -179,15 +201,13 @@ syslogng::grpc::otel::LogsServiceCall::Proceed(bool ok)
                 }
 
               LogMessage *msg = log_msg_new_empty();
-              if (ProtobufParser::is_syslog_ng_log_record(resource, resource_logs_schema_url, scope,
-                                                          scope_logs_schema_url))
+              if (is_syslog_ng)
                 {
                   ProtobufParser::store_syslog_ng(msg, log_record);
                 }
               else
                 {
-                  ProtobufParser::store_raw_metadata(msg, ctx.peer(), resource, resource_logs_schema_url, scope,
-                                                     scope_logs_schema_url);
+                  raw_metadata.store(msg);
                   ProtobufParser::store_raw(msg, log_record);
                 }
               worker.post(msg);
@@ -210,31 +230,30 @@ syslogng::grpc::otel::LogsServiceCall::Proceed(bool ok)
 }
 
 template <> void
-syslogng::grpc::otel::MetricsServiceCall::Proceed(bool ok)
+syslogng::grpc::otel::MetricsServiceCall::Process()
 {
-  if (status == FINISH || !ok)
-    {
-      delete this;
-      return;
-    }
-
   if (!worker.super->super.under_termination)
     new MetricsServiceCall(worker, service, cq);
 
   ::grpc::Status response_status = ::grpc::Status::OK;
 
   int msgs_in_fetch_round = 0;
+  RawMetadata raw_metadata(ctx.peer());
 
   for (const ResourceMetrics &resource_metrics : request.resource_metrics())
     {
       const Resource &resource = resource_metrics.resource();
       const std::string &resource_metrics_schema_url = resource_metrics.schema_url();
 
+      raw_metadata.set_resource(resource, resource_metrics_schema_url);
+
       for (const ScopeMetrics &scope_metrics : resource_metrics.scope_metrics())
         {
           const InstrumentationScope &scope = scope_metrics.scope();
           const std::string &scope_metrics_schema_url = scope_metrics.schema_url();
 
+          raw_metadata.set_scope(scope, scope_metrics_schema_url);
+
           for (const Metric &metric : scope_metrics.metrics())
             {
               if (worker.super->super.under_termination)
@@ -244,8 +263,7 @@ syslogng::grpc::otel::MetricsServiceCall::Proceed(bool ok)
                 }
 
               LogMessage *msg = log_msg_new_empty();
-              ProtobufParser::store_raw_metadata(msg, ctx.peer(), resource, resource_metrics_schema_url, scope,
-                                                 scope_metrics_schema_url);
+              raw_metadata.store(msg);
               ProtobufParser::store_raw(msg, metric);
               worker.post(msg);
 
@@ -29,6 +29,7 @@
 #include "compat/cpp-end.h"
 
 #include <string>
+#include <thread>
 
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/server_builder.h>
@@ -165,6 +166,80 @@ SourceWorker::SourceWorker(OtelSourceWorker *s, SourceDriver &d)
   driver.cqs.pop_front();
 }
 
+void
+syslogng::grpc::otel::SourceWorker::poll_cq()
+{
+  void *tag;
+  bool ok;
+  while (cq->Next(&tag, &ok))
+    {
+      static_cast<AsyncServiceCallInterface *>(tag)->Proceed(ok);
+    }
+}
+
+void
+syslogng::grpc::otel::SourceWorker::hand_off(AsyncServiceCallInterface *call)
+{
+  std::lock_guard<std::mutex> guard(handler.lock);
+
+  handler.calls.push_back(call);
+  handler.cond.notify_one();
+}
+
+/*
+ * With handler-threads(yes), the CQ is polled on a separate thread, which
+ * only accepts new requests and completes finished ones.  Received requests
+ * are handed over to this (the worker) thread, which parses them and posts
+ * the messages, blocking on the window if needed.  The request is finished
+ * only after all of its messages were posted.
+ *
+ * A replacement call is only requested once a received request is picked
+ * up for processing, so the number of requests waiting here is bounded by
+ * concurrent-requests() for each service.  Requests that are still waiting
+ * when the CQ is drained are dropped, as they can not be finished on a CQ
+ * that was shut down.
+ */
+void
+syslogng::grpc::otel::SourceWorker::run_handler()
+{
+  std::thread cq_thread([this]()
+  {
+    poll_cq();
+
+    std::lock_guard<std::mutex> guard(handler.lock);
+    handler.cq_drained = true;
+    handler.cond.notify_one();
+  });
+
+  while (true)
+    {
+      AsyncServiceCallInterface *call;
+
+      {
+        std::unique_lock<std::mutex> guard(handler.lock);
+        handler.cond.wait(guard, [this]()
+        {
+          return !handler.calls.empty() || handler.cq_drained;
+        });
+
+        if (handler.cq_drained)
+          break;
+
+        call = handler.calls.front();
+        handler.calls.pop_front();
+      }
+
+      call->Process();
+    }
+
+  cq_thread.join();
+
+  /* the CQ is shut down, the requests still waiting here can not be finished anymore */
+  for (AsyncServiceCallInterface *call : handler.calls)
+    delete call;
+  handler.calls.clear();
+}
+
 void
 syslogng::grpc::otel::SourceWorker::run()
 {
@@ -180,12 +255,10 @@ syslogng::grpc::otel::SourceWorker::run()
       new MetricsServiceCall(*this, driver.metrics_service.get(), cq.get());
     }
 
-  void *tag;
-  bool ok;
-  while (cq->Next(&tag, &ok))
-    {
-      static_cast<AsyncServiceCallInterface *>(tag)->Proceed(ok);
-    }
+  if (driver.handler_threads)
+    run_handler();
+  else
+    poll_cq();
 }
 
 void
@@ -221,6 +294,12 @@ otel_sd_set_concurrent_requests(LogDriver *s, gint concurrent_requests)
   get_SourceDriver(s)->concurrent_requests = concurrent_requests;
 }
 
+void
+otel_sd_set_handler_threads(LogDriver *s, gboolean handler_threads)
+{
+  get_SourceDriver(s)->handler_threads = handler_threads;
+}
+
 void
 otel_sd_add_int_channel_arg(LogDriver *s, const gchar *name, gint64 value)
 {
@@ -37,6 +37,7 @@ LogDriver *otel_sd_new(GlobalConfig *cfg);
 void otel_sd_set_port(LogDriver *s, guint64 port);
 void otel_sd_set_fetch_limit(LogDriver *s, gint fetch_limit);
 void otel_sd_set_concurrent_requests(LogDriver *s, gint concurrent_requests);
+void otel_sd_set_handler_threads(LogDriver *s, gboolean handler_threads);
 void otel_sd_add_int_channel_arg(LogDriver *s, const gchar *name, gint64 value);
 void otel_sd_add_string_channel_arg(LogDriver *s, const gchar *name, const gchar *value);
 
@@ -35,12 +35,16 @@
 #include <grpcpp/server.h>
 
 #include <list>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 namespace syslogng {
 namespace grpc {
 namespace otel {
 
 class SourceWorker;
+class AsyncServiceCallInterface;
 
 class SourceDriver
 {
@@ -68,6 +72,7 @@ public:
   guint64 port = 4317;
   int fetch_limit = -1;
   int concurrent_requests = 2;
+  bool handler_threads = false;
   syslogng::grpc::ServerCredentialsBuilder credentials_builder;
   std::list<std::pair<std::string, long>> int_extra_channel_args;
   std::list<std::pair<std::string, std::string>> string_extra_channel_args;
@@ -89,6 +94,9 @@ public:
 
 private:
   void post(LogMessage *msg);
+  void poll_cq();
+  void run_handler();
+  void hand_off(AsyncServiceCallInterface *call);
 
 private:
   friend TraceServiceCall;
@@ -99,6 +107,15 @@ private:
   OtelSourceWorker *super;
   SourceDriver &driver;
   std::unique_ptr<::grpc::ServerCompletionQueue> cq;
+
+  /* requests received on the CQ, waiting to be processed by the handler thread */
+  struct
+  {
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<AsyncServiceCallInterface *> calls;
+    bool cq_drained = false;
+  } handler;
 };
 
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "otel-dest-worker.hpp"
+#include "otel-protobuf-parser.hpp"
+#include "otel-logmsg-handles.hpp"
+
+#include "compat/cpp-start.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "compat/cpp-end.h"
+
+#include <criterion/criterion.h>
+
+using namespace syslogng::grpc::otel;
+using namespace opentelemetry::proto::resource::v1;
+using namespace opentelemetry::proto::common::v1;
+using namespace opentelemetry::proto::logs::v1;
+
+static GlobalConfig *cfg;
+
+class TestDestWorker : public DestWorker
+{
+public:
+  TestDestWorker(OtelDestWorker *s) : DestWorker(s) {}
+
+  using DestWorker::lookup_scope_logs;
+  using DestWorker::logs_service_request;
+};
+
+static LogMessage *
+_create_log_msg(RawMetadata &raw_metadata, const gchar *body)
+{
+  LogMessage *msg = log_msg_new_empty();
+
+  raw_metadata.store(msg);
+  log_msg_set_value_by_name_with_type(msg, ".otel.log.body", body, -1, LM_VT_STRING);
+  return msg;
+}
+
+Test(otel_dest_worker, scope_logs_are_reused_for_repeated_raw_metadata)
+{
+  LogDriver *driver = otel_dd_new(cfg);
+  otel_dd_set_url(driver, "localhost:4317");
+
+  OtelDestWorker *worker = g_new0(OtelDestWorker, 1);
+  worker->super.owner = (LogThreadedDestDriver *) driver;
+  TestDestWorker *dw = new TestDestWorker(worker);
+
+  RawMetadata raw_metadata("ipv4:127.0.0.5:36372");
+
+  Resource resource;
+  KeyValue *attr = resource.add_attributes();
+  attr->set_key("service.name");
+  attr->mutable_value()->set_string_value("my_service");
+  raw_metadata.set_resource(resource, "my_resource_schema_url");
+
+  InstrumentationScope first_scope;
+  first_scope.set_name("first_scope");
+  InstrumentationScope second_scope;
+  second_scope.set_name("second_scope");
+
+  raw_metadata.set_scope(first_scope, "my_scope_schema_url");
+  LogMessage *first_msg = _create_log_msg(raw_metadata, "first");
+  LogMessage *repeated_msg = _create_log_msg(raw_metadata, "repeated");
+
+  raw_metadata.set_scope(second_scope, "");
+  LogMessage *second_msg = _create_log_msg(raw_metadata, "second");
+
+  raw_metadata.set_scope(first_scope, "my_scope_schema_url");
+  LogMessage *another_repeated_msg = _create_log_msg(raw_metadata, "another repeated");
+
+  ScopeLogs *first_scope_logs = dw->lookup_scope_logs(first_msg);
+  first_scope_logs->add_log_records();
+  ScopeLogs *second_scope_logs = dw->lookup_scope_logs(second_msg);
+  second_scope_logs->add_log_records();
+
+  cr_assert_neq(first_scope_logs, second_scope_logs);
+  cr_assert_eq(dw->lookup_scope_logs(repeated_msg), first_scope_logs);
+  cr_assert_eq(dw->lookup_scope_logs(another_repeated_msg), first_scope_logs);
+  cr_assert_eq(dw->lookup_scope_logs(second_msg), second_scope_logs);
+
+  const auto &request = dw->logs_service_request;
+  cr_assert_eq(request.resource_logs_size(), 1);
+
+  const ResourceLogs &resource_logs = request.resource_logs(0);
+  cr_assert_str_eq(resource_logs.schema_url().c_str(), "my_resource_schema_url");
+  cr_assert_eq(resource_logs.resource().attributes_size(), 1);
+  cr_assert_str_eq(resource_logs.resource().attributes(0).key().c_str(), "service.name");
+  cr_assert_str_eq(resource_logs.resource().attributes(0).value().string_value().c_str(), "my_service");
+
+  cr_assert_eq(resource_logs.scope_logs_size(), 2);
+  cr_assert_eq(&resource_logs.scope_logs(0), first_scope_logs);
+  cr_assert_str_eq(resource_logs.scope_logs(0).scope().name().c_str(), "first_scope");
+  cr_assert_str_eq(resource_logs.scope_logs(0).schema_url().c_str(), "my_scope_schema_url");
+  cr_assert_eq(&resource_logs.scope_logs(1), second_scope_logs);
+  cr_assert_str_eq(resource_logs.scope_logs(1).scope().name().c_str(), "second_scope");
+  cr_assert_str_eq(resource_logs.scope_logs(1).schema_url().c_str(), "");
+
+  log_msg_unref(first_msg);
+  log_msg_unref(repeated_msg);
+  log_msg_unref(second_msg);
+  log_msg_unref(another_repeated_msg);
+
+  delete dw;
+  g_free(worker);
+  log_pipe_unref(&driver->super);
+}
+
+static void
+_setup(void)
+{
+  app_startup();
+  otel_logmsg_handles_global_init();
+  cfg = cfg_new_snippet();
+}
+
+static void
+_teardown(void)
+{
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(otel_dest_worker, .init = _setup, .fini = _teardown);
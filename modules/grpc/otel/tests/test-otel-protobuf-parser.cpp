@@ -186,6 +186,58 @@ Test(otel_protobuf_parser, metadata)
   log_msg_unref(msg);
 }
 
+Test(otel_protobuf_parser, raw_metadata_shared_by_records)
+{
+  RawMetadata raw_metadata("ipv4:127.0.0.5:36372");
+
+  Resource resource;
+  KeyValue *string_attr = resource.add_attributes();
+  string_attr->set_key("string_key");
+  string_attr->mutable_value()->set_string_value("string_attribute");
+  raw_metadata.set_resource(resource, "my_resource_schema_url");
+
+  InstrumentationScope first_scope;
+  first_scope.set_name("first_scope");
+  raw_metadata.set_scope(first_scope, "my_scope_schema_url");
+
+  LogMessage *first_msg = log_msg_new_empty();
+  raw_metadata.store(first_msg);
+  LogMessage *second_msg = log_msg_new_empty();
+  raw_metadata.store(second_msg);
+
+  InstrumentationScope other_scope;
+  other_scope.set_name("other_scope");
+  raw_metadata.set_scope(other_scope, "");
+
+  LogMessage *other_msg = log_msg_new_empty();
+  raw_metadata.store(other_msg);
+
+  std::string serialized_resource = resource.SerializePartialAsString();
+  std::string serialized_first_scope = first_scope.SerializePartialAsString();
+  std::string serialized_other_scope = other_scope.SerializePartialAsString();
+
+  LogMessage *msgs[] = { first_msg, second_msg, other_msg };
+  for (LogMessage *msg : msgs)
+    {
+      cr_assert(msg->saddr != NULL);
+      _assert_log_msg_value(msg, ".otel_raw.resource", serialized_resource.c_str(), serialized_resource.length(),
+                            LM_VT_PROTOBUF);
+      _assert_log_msg_value(msg, ".otel_raw.resource_schema_url", "my_resource_schema_url", -1, LM_VT_STRING);
+    }
+
+  _assert_log_msg_value(first_msg, ".otel_raw.scope", serialized_first_scope.c_str(),
+                        serialized_first_scope.length(), LM_VT_PROTOBUF);
+  _assert_log_msg_value(second_msg, ".otel_raw.scope", serialized_first_scope.c_str(),
+                        serialized_first_scope.length(), LM_VT_PROTOBUF);
+  _assert_log_msg_value(second_msg, ".otel_raw.scope_schema_url", "my_scope_schema_url", -1, LM_VT_STRING);
+  _assert_log_msg_value(other_msg, ".otel_raw.scope", serialized_other_scope.c_str(),
+                        serialized_other_scope.length(), LM_VT_PROTOBUF);
+  _assert_log_msg_value(other_msg, ".otel_raw.scope_schema_url", "", -1, LM_VT_STRING);
+
+  for (LogMessage *msg : msgs)
+    log_msg_unref(msg);
+}
+
 Test(otel_protobuf_parser, log_record)
 {
   LogMessage *msg = _create_dummy_log_msg();
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "opentelemetry/proto/collector/logs/v1/logs_service.grpc.pb.h"
+
+#include "otel-source.h"
+#include "otel-logmsg-handles.hpp"
+
+#include "compat/cpp-start.h"
+#include "logthrsource/logthrsourcedrv.h"
+#include "mainloop.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "compat/cpp-end.h"
+
+#include <grpcpp/create_channel.h>
+#include <grpcpp/security/credentials.h>
+
+#include <criterion/criterion.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using opentelemetry::proto::collector::logs::v1::LogsService;
+using opentelemetry::proto::collector::logs::v1::ExportLogsServiceRequest;
+using opentelemetry::proto::collector::logs::v1::ExportLogsServiceResponse;
+
+#define MAX_SPIN_ITERATIONS 10000
+
+static MainLoop *main_loop;
+static MainLoopOptions main_loop_options = {0};
+static GlobalConfig *cfg;
+
+static void
+_sleep_msec(long msec)
+{
+  struct timespec sleep_time = { msec / 1000, (msec % 1000) * 1000000 };
+  nanosleep(&sleep_time, NULL);
+}
+
+typedef struct _CapturePipe
+{
+  LogPipe super;
+  GMutex lock;
+  GPtrArray *messages;
+  gboolean ack;
+} CapturePipe;
+
+static void
+_capture_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  CapturePipe *self = (CapturePipe *) s;
+
+  g_mutex_lock(&self->lock);
+  g_ptr_array_add(self->messages, msg);
+  gboolean ack = self->ack;
+  g_mutex_unlock(&self->lock);
+
+  if (ack)
+    log_msg_ack(msg, path_options, AT_PROCESSED);
+}
+
+static guint
+_capture_pipe_count(CapturePipe *self)
+{
+  g_mutex_lock(&self->lock);
+  guint count = self->messages->len;
+  g_mutex_unlock(&self->lock);
+  return count;
+}
+
+static void
+_capture_pipe_ack_all(CapturePipe *self)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  g_mutex_lock(&self->lock);
+  self->ack = TRUE;
+  for (guint i = 0; i < self->messages->len; i++)
+    log_msg_ack((LogMessage *) g_ptr_array_index(self->messages, i), &path_options, AT_PROCESSED);
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+_capture_pipe_free(LogPipe *s)
+{
+  CapturePipe *self = (CapturePipe *) s;
+
+  g_ptr_array_free(self->messages, TRUE);
+  g_mutex_clear(&self->lock);
+  log_pipe_free_method(s);
+}
+
+static CapturePipe *
+_capture_pipe_new(gboolean ack)
+{
+  CapturePipe *self = g_new0(CapturePipe, 1);
+
+  log_pipe_init_instance(&self->super, cfg);
+  self->super.queue = _capture_pipe_queue;
+  self->super.free_fn = _capture_pipe_free;
+  self->messages = g_ptr_array_new_with_free_func((GDestroyNotify) log_msg_unref);
+  self->ack = ack;
+  g_mutex_init(&self->lock);
+  cr_assert(log_pipe_init(&self->super));
+  return self;
+}
+
+static void
+_wait_for_captured_messages(CapturePipe *capture, guint expected)
+{
+  guint count = _capture_pipe_count(capture);
+
+  for (gint c = 0; count != expected && c < MAX_SPIN_ITERATIONS; c++)
+    {
+      _sleep_msec(1);
+      count = _capture_pipe_count(capture);
+    }
+  cr_assert_eq(count, expected, "expected %u messages, got %u", expected, count);
+}
+
+static guint16
+_find_free_port(void)
+{
+  struct sockaddr_in addr = {};
+  socklen_t addr_len = sizeof(addr);
+  gint fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  cr_assert(fd >= 0);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  cr_assert(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+  cr_assert(getsockname(fd, (struct sockaddr *) &addr, &addr_len) == 0);
+  close(fd);
+
+  return ntohs(addr.sin_port);
+}
+
+static LogDriver *
+_start_source(guint16 port, CapturePipe *capture, gint init_window_size)
+{
+  LogDriver *d = otel_sd_new(cfg);
+
+  otel_sd_set_port(d, port);
+  otel_sd_set_handler_threads(d, TRUE);
+  log_threaded_source_driver_get_source_options(d)->init_window_size = init_window_size;
+  log_pipe_append(&d->super, &capture->super);
+
+  cr_assert(log_pipe_init(&d->super));
+  cr_assert(log_pipe_post_config_init(&d->super));
+  return d;
+}
+
+static void
+_stop_source(LogDriver *d)
+{
+  main_loop_sync_worker_startup_and_teardown();
+  log_pipe_deinit(&d->super);
+  log_pipe_unref(&d->super);
+}
+
+static ::grpc::Status
+_export_logs(guint16 port, gint num_log_records)
+{
+  auto channel = ::grpc::CreateChannel("127.0.0.1:" + std::to_string(port), ::grpc::InsecureChannelCredentials());
+  auto stub = LogsService::NewStub(channel);
+
+  ExportLogsServiceRequest request;
+  auto *log_records = request.add_resource_logs()->add_scope_logs()->mutable_log_records();
+  for (gint i = 0; i < num_log_records; i++)
+    log_records->Add()->mutable_body()->set_string_value(std::to_string(i));
+
+  ::grpc::ClientContext ctx;
+  ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
+  ctx.set_wait_for_ready(true);
+
+  ExportLogsServiceResponse response;
+  return stub->Export(&ctx, request, &response);
+}
+
+Test(otel_source, test_handler_thread_processes_the_requests_received_on_the_cq)
+{
+  guint16 port = _find_free_port();
+  CapturePipe *capture = _capture_pipe_new(TRUE);
+  LogDriver *d = _start_source(port, capture, 100);
+
+  for (gint i = 0; i < 10; i++)
+    {
+      ::grpc::Status status = _export_logs(port, 3);
+      cr_assert(status.ok(), "Export() failed: %s", status.error_message().c_str());
+    }
+
+  _wait_for_captured_messages(capture, 30);
+
+  _stop_source(d);
+  log_pipe_deinit(&capture->super);
+  log_pipe_unref(&capture->super);
+}
+
+Test(otel_source, test_handler_thread_blocks_on_the_window_while_requests_are_still_received)
+{
+  guint16 port = _find_free_port();
+  CapturePipe *capture = _capture_pipe_new(FALSE);
+  LogDriver *d = _start_source(port, capture, 4);
+
+  std::vector<::grpc::Status> statuses(3);
+  std::vector<std::thread> clients;
+  for (gsize i = 0; i < statuses.size(); i++)
+    clients.emplace_back([port, i, &statuses]()
+    {
+      statuses[i] = _export_logs(port, 3);
+    });
+
+  /* nothing is acked, the handler stops once the window is used up */
+  _wait_for_captured_messages(capture, 4);
+  _sleep_msec(100);
+  cr_assert_eq(_capture_pipe_count(capture), 4);
+
+  _capture_pipe_ack_all(capture);
+  _wait_for_captured_messages(capture, 9);
+
+  for (auto &client : clients)
+    client.join();
+  for (auto &status : statuses)
+    cr_assert(status.ok(), "Export() failed: %s", status.error_message().c_str());
+
+  _stop_source(d);
+  log_pipe_deinit(&capture->super);
+  log_pipe_unref(&capture->super);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  otel_logmsg_handles_global_init();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+  cfg = main_loop_get_current_config(main_loop);
+  cfg_set_current_version(cfg);
+  main_loop_worker_allocate_thread_space(2);
+  main_loop_worker_finalize_thread_space();
+}
+
+static void
+teardown(void)
+{
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(otel_source, .init = setup, .fini = teardown);
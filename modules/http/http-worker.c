@@ -32,6 +32,10 @@
 
 #define HTTP_HEADER_FORMAT_ERROR http_header_format_error_quark()
 
+/* upper limit of a single wait for in-flight requests, new messages are
+ * not processed by the worker while waiting */
+#define HTTP_IN_FLIGHT_POLL_TIMEOUT_MSEC 100
+
 static GQuark http_header_format_error_quark(void)
 {
   return g_quark_from_static_string("http_header_format_error_quark");
@@ -103,80 +107,80 @@ _curl_write_function(char *ptr, size_t size, size_t nmemb, void *userdata)
  * request specific options will be set separately
  */
 static void
-_setup_static_options_in_curl(HTTPDestinationWorker *self)
+_setup_static_options_in_curl(HTTPDestinationWorker *self, CURL *curl)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
-  curl_easy_reset(self->curl);
+  curl_easy_reset(curl);
 
-  curl_easy_setopt(self->curl, CURLOPT_WRITEFUNCTION, _curl_write_function);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _curl_write_function);
 
-  curl_easy_setopt(self->curl, CURLOPT_URL, owner->url);
+  curl_easy_setopt(curl, CURLOPT_URL, owner->url);
 
   if (owner->user)
-    curl_easy_setopt(self->curl, CURLOPT_USERNAME, owner->user);
+    curl_easy_setopt(curl, CURLOPT_USERNAME, owner->user);
 
   if (owner->password)
-    curl_easy_setopt(self->curl, CURLOPT_PASSWORD, owner->password);
+    curl_easy_setopt(curl, CURLOPT_PASSWORD, owner->password);
 
   if (owner->user_agent)
-    curl_easy_setopt(self->curl, CURLOPT_USERAGENT, owner->user_agent);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, owner->user_agent);
 
   if (owner->ca_dir)
-    curl_easy_setopt(self->curl, CURLOPT_CAPATH, owner->ca_dir);
+    curl_easy_setopt(curl, CURLOPT_CAPATH, owner->ca_dir);
 
   if (owner->ca_file)
-    curl_easy_setopt(self->curl, CURLOPT_CAINFO, owner->ca_file);
+    curl_easy_setopt(curl, CURLOPT_CAINFO, owner->ca_file);
 
   if (owner->cert_file)
-    curl_easy_setopt(self->curl, CURLOPT_SSLCERT, owner->cert_file);
+    curl_easy_setopt(curl, CURLOPT_SSLCERT, owner->cert_file);
 
   if (owner->key_file)
-    curl_easy_setopt(self->curl, CURLOPT_SSLKEY, owner->key_file);
+    curl_easy_setopt(curl, CURLOPT_SSLKEY, owner->key_file);
 
   if (owner->ciphers)
-    curl_easy_setopt(self->curl, CURLOPT_SSL_CIPHER_LIST, owner->ciphers);
+    curl_easy_setopt(curl, CURLOPT_SSL_CIPHER_LIST, owner->ciphers);
 
 #if SYSLOG_NG_HAVE_DECL_CURLOPT_TLS13_CIPHERS
   if (owner->tls13_ciphers)
-    curl_easy_setopt(self->curl, CURLOPT_TLS13_CIPHERS, owner->tls13_ciphers);
+    curl_easy_setopt(curl, CURLOPT_TLS13_CIPHERS, owner->tls13_ciphers);
 #endif
 
 #if SYSLOG_NG_HAVE_DECL_CURLOPT_SSL_VERIFYSTATUS
   if (owner->ocsp_stapling_verify)
-    curl_easy_setopt(self->curl, CURLOPT_SSL_VERIFYSTATUS, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYSTATUS, 1L);
 #endif
 
   if (owner->proxy)
-    curl_easy_setopt(self->curl, CURLOPT_PROXY, owner->proxy);
+    curl_easy_setopt(curl, CURLOPT_PROXY, owner->proxy);
 
-  curl_easy_setopt(self->curl, CURLOPT_SSLVERSION, owner->ssl_version);
-  curl_easy_setopt(self->curl, CURLOPT_SSL_VERIFYHOST, owner->peer_verify ? 2L : 0L);
-  curl_easy_setopt(self->curl, CURLOPT_SSL_VERIFYPEER, owner->peer_verify ? 1L : 0L);
+  curl_easy_setopt(curl, CURLOPT_SSLVERSION, owner->ssl_version);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, owner->peer_verify ? 2L : 0L);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, owner->peer_verify ? 1L : 0L);
 
-  curl_easy_setopt(self->curl, CURLOPT_DEBUGFUNCTION, _curl_debug_function);
-  curl_easy_setopt(self->curl, CURLOPT_DEBUGDATA, self);
-  curl_easy_setopt(self->curl, CURLOPT_VERBOSE, 1L);
+  curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, _curl_debug_function);
+  curl_easy_setopt(curl, CURLOPT_DEBUGDATA, self);
+  curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
   if (owner->accept_redirects)
     {
-      curl_easy_setopt(self->curl, CURLOPT_FOLLOWLOCATION, 1);
-      curl_easy_setopt(self->curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
+      curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+      curl_easy_setopt(curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL);
 #if SYSLOG_NG_HAVE_DECL_CURLOPT_REDIR_PROTOCOLS_STR
-      curl_easy_setopt(self->curl, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
+      curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
 #else
-      curl_easy_setopt(self->curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+      curl_easy_setopt(curl, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
 #endif
-      curl_easy_setopt(self->curl, CURLOPT_MAXREDIRS, 3);
+      curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3);
     }
-  curl_easy_setopt(self->curl, CURLOPT_TIMEOUT, owner->timeout);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, owner->timeout);
 
   if (owner->method_type == METHOD_TYPE_PUT)
-    curl_easy_setopt(self->curl, CURLOPT_CUSTOMREQUEST, "PUT");
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
 
-  curl_easy_setopt(self->curl, CURLOPT_ACCEPT_ENCODING, owner->accept_encoding->str);
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, owner->accept_encoding->str);
 
-  curl_easy_setopt(self->curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 }
 
 
@@ -446,20 +450,21 @@ _finish_request_body(HTTPDestinationWorker *self)
 }
 
 static void
-_debug_response_info(HTTPDestinationWorker *self, const gchar *url, glong http_code)
+_debug_response_info(HTTPDestinationWorker *self, CURL *curl, const gchar *url, glong http_code,
+                     gsize body_size, gint batch_size)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
 
   gdouble total_time = 0;
   glong redirect_count = 0;
 
-  curl_easy_getinfo(self->curl, CURLINFO_TOTAL_TIME, &total_time);
-  curl_easy_getinfo(self->curl, CURLINFO_REDIRECT_COUNT, &redirect_count);
+  curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total_time);
+  curl_easy_getinfo(curl, CURLINFO_REDIRECT_COUNT, &redirect_count);
   msg_debug("http: HTTP response received",
             evt_tag_str("url", url),
             evt_tag_int("status_code", http_code),
-            evt_tag_int("body_size", self->request_body->len),
-            evt_tag_int("batch_size", self->super.batch_size),
+            evt_tag_int("body_size", body_size),
+            evt_tag_int("batch_size", batch_size),
             evt_tag_int("redirected", redirect_count != 0),
             evt_tag_printf("total_time", "%.3f", total_time),
             evt_tag_int("worker_index", self->super.worker_index),
@@ -520,43 +525,56 @@ _custom_map_http_result(HTTPDestinationWorker *self, const gchar *url, HttpRespo
   return LTR_MAX;
 }
 
-static gboolean
-_curl_perform_request(HTTPDestinationWorker *self, const gchar *url)
+static void
+_curl_setup_request_body(HTTPDestinationWorker *self, CURL *curl, GString *request_body,
+                         GString *request_body_compressed, List *request_headers)
 {
-  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
-
-  msg_trace("http: Sending HTTP request",
-            evt_tag_str("url", url));
-
-  curl_easy_setopt(self->curl, CURLOPT_URL, url);
   if (self->compressor)
     {
-      if (compressor_compress(self->compressor, self->request_body_compressed, self->request_body) &&
-          self->request_body_compressed->len < self->request_body->len)
+      if (compressor_compress(self->compressor, request_body_compressed, request_body) &&
+          request_body_compressed->len < request_body->len)
         {
-          curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, self->request_body_compressed->str);
-          curl_easy_setopt(self->curl, CURLOPT_POSTFIELDSIZE, self->request_body_compressed->len);
-          _add_header(self->request_headers, "Content-Encoding", compressor_get_encoding_name(self->compressor));
+          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body_compressed->str);
+          curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, request_body_compressed->len);
+          _add_header(request_headers, "Content-Encoding", compressor_get_encoding_name(self->compressor));
         }
       else
         {
           msg_debug("http: error compressing data payload, sending uncompressed data instead");
-          curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, self->request_body->str);
+          curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body->str);
         }
     }
   else
-    curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, self->request_body->str);
-  curl_easy_setopt(self->curl, CURLOPT_HTTPHEADER, http_curl_header_list_as_slist(self->request_headers));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body->str);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, http_curl_header_list_as_slist(request_headers));
+}
+
+static void
+_report_request_error(HTTPDestinationWorker *self, const gchar *url, CURLcode ret)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  msg_error("http: error sending HTTP request",
+            evt_tag_str("url", url),
+            evt_tag_str("error", curl_easy_strerror(ret)),
+            evt_tag_int("worker_index", self->super.worker_index),
+            evt_tag_str("driver", owner->super.super.super.id),
+            log_pipe_location_tag(&owner->super.super.super.super));
+}
+
+static gboolean
+_curl_perform_request(HTTPDestinationWorker *self, const gchar *url)
+{
+  msg_trace("http: Sending HTTP request",
+            evt_tag_str("url", url));
+
+  curl_easy_setopt(self->curl, CURLOPT_URL, url);
+  _curl_setup_request_body(self, self->curl, self->request_body, self->request_body_compressed, self->request_headers);
 
   CURLcode ret = curl_easy_perform(self->curl);
   if (ret != CURLE_OK)
     {
-      msg_error("http: error sending HTTP request",
-                evt_tag_str("url", url),
-                evt_tag_str("error", curl_easy_strerror(ret)),
-                evt_tag_int("worker_index", self->super.worker_index),
-                evt_tag_str("driver", owner->super.super.super.id),
-                log_pipe_location_tag(&owner->super.super.super.super));
+      _report_request_error(self, url, ret);
       return FALSE;
     }
 
@@ -564,10 +582,10 @@ _curl_perform_request(HTTPDestinationWorker *self, const gchar *url)
 }
 
 static gboolean
-_curl_get_status_code(HTTPDestinationWorker *self, const gchar *url, glong *http_code)
+_curl_get_status_code(HTTPDestinationWorker *self, CURL *curl, const gchar *url, glong *http_code)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
-  CURLcode ret = curl_easy_getinfo(self->curl, CURLINFO_RESPONSE_CODE, http_code);
+  CURLcode ret = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, http_code);
 
   if (ret != CURLE_OK)
     {
@@ -642,20 +660,16 @@ _update_status_code_metrics(HTTPDestinationWorker *self, const gchar *url, glong
 }
 
 static LogThreadedResult
-_flush_on_target(HTTPDestinationWorker *self, const gchar *url)
+_process_response(HTTPDestinationWorker *self, CURL *curl, const gchar *url, gsize body_size, gint batch_size)
 {
   HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
-
-  if (!_curl_perform_request(self, url))
-    return LTR_NOT_CONNECTED;
-
   glong http_code = 0;
 
-  if (!_curl_get_status_code(self, url, &http_code))
+  if (!_curl_get_status_code(self, curl, url, &http_code))
     return LTR_NOT_CONNECTED;
 
   if (debug_flag)
-    _debug_response_info(self, url, http_code);
+    _debug_response_info(self, curl, url, http_code, body_size, batch_size);
 
   _update_status_code_metrics(self, url, http_code);
 
@@ -677,6 +691,15 @@ _flush_on_target(HTTPDestinationWorker *self, const gchar *url)
   return _map_http_status_code(self, url, http_code);
 }
 
+static LogThreadedResult
+_flush_on_target(HTTPDestinationWorker *self, const gchar *url)
+{
+  if (!_curl_perform_request(self, url))
+    return LTR_NOT_CONNECTED;
+
+  return _process_response(self, self->curl, url, self->request_body->len, self->super.batch_size);
+}
+
 static gboolean
 _format_request_headers_error_is_critical(GError *error)
 {
@@ -800,6 +823,356 @@ _flush(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
   return retval;
 }
 
+/*
+ * In-flight requests
+ *
+ * If max-in-flight-requests() is larger than 1, flush() sends the batch
+ * using the curl multi interface and returns without waiting for the
+ * response.  Requests are kept in a ring buffer in the order they were
+ * sent, and are completed in that order, as the backlog of our queue can
+ * only be acknowledged from its head.
+ *
+ * If a request fails (after trying the alternative targets of the load
+ * balancer), all requests that are still in flight are aborted and their
+ * messages are rewound together with the failed batch, as the queue is
+ * unable to rewind messages from the middle of its backlog.
+ */
+
+static inline HTTPInFlightRequest *
+_get_in_flight_request(HTTPDestinationWorker *self, gint index)
+{
+  return &self->in_flight.requests[(self->in_flight.head + index) % self->in_flight.max];
+}
+
+static gboolean
+_in_flight_request_init(HTTPDestinationWorker *self, HTTPInFlightRequest *request)
+{
+  if (!(request->curl = curl_easy_init()))
+    return FALSE;
+
+  _setup_static_options_in_curl(self, request->curl);
+  curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request);
+
+  request->request_body = g_string_sized_new(32768);
+  if (self->compressor)
+    request->request_body_compressed = g_string_sized_new(32768);
+  request->request_headers = http_curl_header_list_new();
+  request->url = g_string_new(NULL);
+  return TRUE;
+}
+
+static void
+_in_flight_request_reset(HTTPInFlightRequest *request)
+{
+  list_remove_all(request->request_headers);
+  g_string_truncate(request->request_body, 0);
+  if (request->msg_for_templated_url)
+    log_msg_unref(request->msg_for_templated_url);
+  request->msg_for_templated_url = NULL;
+  request->target = NULL;
+  request->batch_size = 0;
+  request->completed = FALSE;
+}
+
+static void
+_in_flight_request_deinit(HTTPInFlightRequest *request)
+{
+  if (!request->curl)
+    return;
+
+  _in_flight_request_reset(request);
+  g_string_free(request->request_body, TRUE);
+  if (request->request_body_compressed)
+    g_string_free(request->request_body_compressed, TRUE);
+  list_free(request->request_headers);
+  g_string_free(request->url, TRUE);
+  curl_easy_cleanup(request->curl);
+}
+
+static void
+_start_in_flight_request(HTTPDestinationWorker *self, HTTPInFlightRequest *request)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  if (http_lb_target_is_url_templated(request->target))
+    http_lb_target_format_templated_url(request->target, request->msg_for_templated_url,
+                                        &owner->template_options, request->url);
+  else
+    g_string_assign(request->url, http_lb_target_get_literal_url(request->target));
+
+  msg_trace("http: Sending HTTP request",
+            evt_tag_str("url", request->url->str),
+            evt_tag_int("in_flight_requests", self->in_flight.len));
+
+  curl_easy_setopt(request->curl, CURLOPT_URL, request->url->str);
+  curl_multi_add_handle(self->in_flight.multi, request->curl);
+}
+
+static void
+_retry_or_complete_in_flight_request(HTTPDestinationWorker *self, HTTPInFlightRequest *request,
+                                     LogThreadedResult result)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  if (result == LTR_SUCCESS)
+    {
+      http_load_balancer_set_target_successful(owner->load_balancer, request->target);
+    }
+  else
+    {
+      http_load_balancer_set_target_failed(owner->load_balancer, request->target);
+
+      HTTPLoadBalancerTarget *alt_target = http_load_balancer_choose_target(owner->load_balancer, &self->lbc);
+      if (request->retry_attempts > 0 && alt_target != request->target)
+        {
+          msg_debug("http: Target server down, trying an alternative server",
+                    evt_tag_str("url", request->url->str),
+                    evt_tag_int("worker_index", self->super.worker_index),
+                    evt_tag_str("driver", owner->super.super.super.id),
+                    log_pipe_location_tag(&owner->super.super.super.super));
+
+          request->retry_attempts--;
+          request->target = alt_target;
+          _start_in_flight_request(self, request);
+          return;
+        }
+    }
+
+  request->result = result;
+  request->completed = TRUE;
+}
+
+static void
+_collect_completed_in_flight_requests(HTTPDestinationWorker *self)
+{
+  CURLMsg *msg;
+  gint msgs_left;
+
+  while ((msg = curl_multi_info_read(self->in_flight.multi, &msgs_left)))
+    {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      gchar *private_data = NULL;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private_data);
+      HTTPInFlightRequest *request = (HTTPInFlightRequest *) private_data;
+
+      /* msg is invalidated by removing the handle */
+      CURLcode ret = msg->data.result;
+      curl_multi_remove_handle(self->in_flight.multi, request->curl);
+
+      LogThreadedResult result = LTR_NOT_CONNECTED;
+      if (ret != CURLE_OK)
+        _report_request_error(self, request->url->str, ret);
+      else
+        result = _process_response(self, request->curl, request->url->str, request->request_body->len,
+                                   request->batch_size);
+
+      _retry_or_complete_in_flight_request(self, request, result);
+    }
+}
+
+static LogThreadedResult
+_finish_completed_in_flight_requests(HTTPDestinationWorker *self)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  while (self->in_flight.len > 0)
+    {
+      HTTPInFlightRequest *request = _get_in_flight_request(self, 0);
+
+      if (!request->completed)
+        break;
+
+      if (request->result == LTR_SUCCESS)
+        {
+          gsize msg_length = request->request_body->len;
+          log_threaded_dest_worker_written_bytes_add(&self->super, msg_length);
+          log_threaded_dest_driver_insert_batch_length_stats(self->super.owner, msg_length);
+          log_threaded_dest_worker_ack_in_flight_messages(&self->super, request->batch_size);
+        }
+      else if (request->result == LTR_DROP)
+        {
+          msg_error("Message(s) dropped while sending message to destination",
+                    evt_tag_str("driver", owner->super.super.super.id),
+                    evt_tag_int("worker_index", self->super.worker_index),
+                    evt_tag_int("batch_size", request->batch_size));
+          log_threaded_dest_worker_drop_in_flight_messages(&self->super, request->batch_size);
+        }
+      else
+        {
+          return request->result;
+        }
+
+      _in_flight_request_reset(request);
+      self->in_flight.head = (self->in_flight.head + 1) % self->in_flight.max;
+      self->in_flight.len--;
+    }
+
+  return LTR_SUCCESS;
+}
+
+static LogThreadedResult
+_poll_in_flight_requests(HTTPDestinationWorker *self, gint timeout_msec)
+{
+  gint running_handles;
+
+  if (timeout_msec > 0)
+    curl_multi_wait(self->in_flight.multi, NULL, 0, timeout_msec, NULL);
+
+  CURLMcode ret = curl_multi_perform(self->in_flight.multi, &running_handles);
+  if (ret != CURLM_OK)
+    {
+      msg_error("http: error driving in-flight HTTP requests",
+                evt_tag_str("error", curl_multi_strerror(ret)),
+                evt_tag_int("worker_index", self->super.worker_index),
+                evt_tag_str("driver", self->super.owner->super.super.id));
+      return LTR_NOT_CONNECTED;
+    }
+
+  _collect_completed_in_flight_requests(self);
+  return _finish_completed_in_flight_requests(self);
+}
+
+static void
+_abort_in_flight_requests(HTTPDestinationWorker *self)
+{
+  for (gint i = 0; i < self->in_flight.len; i++)
+    {
+      HTTPInFlightRequest *request = _get_in_flight_request(self, i);
+
+      if (!request->completed)
+        curl_multi_remove_handle(self->in_flight.multi, request->curl);
+      _in_flight_request_reset(request);
+    }
+  self->in_flight.head = 0;
+  self->in_flight.len = 0;
+}
+
+static LogThreadedResult
+_send_batch_in_flight(HTTPDestinationWorker *self)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+  GError *error = NULL;
+
+  _finish_request_body(self);
+
+  if (!_try_format_request_headers(self, &error))
+    {
+      if (!_format_request_headers_catch_error(&error))
+        return LTR_NOT_CONNECTED;
+    }
+
+  LogThreadedResult result = _poll_in_flight_requests(self, 0);
+  while (result == LTR_SUCCESS && self->in_flight.len == self->in_flight.max)
+    result = _poll_in_flight_requests(self, HTTP_IN_FLIGHT_POLL_TIMEOUT_MSEC);
+
+  if (result != LTR_SUCCESS)
+    return result;
+
+  HTTPInFlightRequest *request = _get_in_flight_request(self, self->in_flight.len);
+  self->in_flight.len++;
+
+  /* hand over the request, the buffers of the free request are reused to
+   * collect the next batch */
+  GString *request_body = request->request_body;
+  request->request_body = self->request_body;
+  self->request_body = request_body;
+
+  List *request_headers = request->request_headers;
+  request->request_headers = self->request_headers;
+  self->request_headers = request_headers;
+
+  request->msg_for_templated_url = self->msg_for_templated_url;
+  self->msg_for_templated_url = NULL;
+
+  request->batch_size = log_threaded_dest_worker_set_batch_in_flight(&self->super);
+  request->retry_attempts = owner->load_balancer->num_targets - 1;
+  request->target = http_load_balancer_choose_target(owner->load_balancer, &self->lbc);
+
+  _curl_setup_request_body(self, request->curl, request->request_body, request->request_body_compressed,
+                           request->request_headers);
+  _start_in_flight_request(self, request);
+
+  _reinit_request_headers(self);
+  _reinit_request_body(self);
+
+  return _poll_in_flight_requests(self, 0);
+}
+
+static LogThreadedResult
+_flush_in_flight(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
+{
+  HTTPDestinationWorker *self = (HTTPDestinationWorker *) s;
+  LogThreadedResult result;
+
+  if (self->super.batch_size == 0 && self->in_flight.len == 0)
+    return LTR_SUCCESS;
+
+  if (mode == LTF_FLUSH_EXPEDITE)
+    result = LTR_EXPLICIT_ACK_MGMT;
+  else if (self->super.batch_size > 0)
+    result = _send_batch_in_flight(self);
+  else
+    result = _poll_in_flight_requests(self, HTTP_IN_FLIGHT_POLL_TIMEOUT_MSEC);
+
+  if (result == LTR_SUCCESS)
+    return LTR_EXPLICIT_ACK_MGMT;
+
+  /* the failed batch can only be rewound together with all batches sent
+   * after it and the one being collected, the result applies to all of them */
+  _abort_in_flight_requests(self);
+  log_threaded_dest_worker_reclaim_in_flight_messages(&self->super);
+
+  /* an expedited flush (at reload) is not a failure, the messages are put
+   * back to the queue without counting a retry */
+  if (mode == LTF_FLUSH_EXPEDITE)
+    log_threaded_dest_worker_rewind_messages(&self->super, self->super.batch_size);
+
+  _reinit_request_headers(self);
+  _reinit_request_body(self);
+  if (self->msg_for_templated_url)
+    log_msg_unref(self->msg_for_templated_url);
+  self->msg_for_templated_url = NULL;
+
+  return result;
+}
+
+static gboolean
+_in_flight_requests_init(HTTPDestinationWorker *self)
+{
+  HTTPDestinationDriver *owner = (HTTPDestinationDriver *) self->super.owner;
+
+  if (!(self->in_flight.multi = curl_multi_init()))
+    return FALSE;
+
+  self->in_flight.max = owner->max_in_flight_requests;
+  self->in_flight.requests = g_new0(HTTPInFlightRequest, self->in_flight.max);
+  for (gint i = 0; i < self->in_flight.max; i++)
+    {
+      if (!_in_flight_request_init(self, &self->in_flight.requests[i]))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+static void
+_in_flight_requests_deinit(HTTPDestinationWorker *self)
+{
+  if (!self->in_flight.multi)
+    return;
+
+  if (self->in_flight.requests)
+    _abort_in_flight_requests(self);
+  curl_multi_cleanup(self->in_flight.multi);
+  self->in_flight.multi = NULL;
+
+  for (gint i = 0; self->in_flight.requests && i < self->in_flight.max; i++)
+    _in_flight_request_deinit(&self->in_flight.requests[i]);
+  g_free(self->in_flight.requests);
+  self->in_flight.requests = NULL;
+}
+
 static gboolean
 _should_initiate_flush(HTTPDestinationWorker *self)
 {
@@ -872,9 +1245,18 @@ _init(LogThreadedDestWorker *s)
                 log_pipe_location_tag(&owner->super.super.super.super));
       return FALSE;
     }
-  _setup_static_options_in_curl(self);
+  _setup_static_options_in_curl(self, self->curl);
   _reinit_request_headers(self);
   _reinit_request_body(self);
+
+  if (owner->max_in_flight_requests > 1 && !_in_flight_requests_init(self))
+    {
+      msg_error("http: cannot initialize libcurl for in-flight requests",
+                evt_tag_int("worker_index", self->super.worker_index),
+                evt_tag_str("driver", owner->super.super.super.id),
+                log_pipe_location_tag(&owner->super.super.super.super));
+      return FALSE;
+    }
   return log_threaded_dest_worker_init_method(s);
 }
 
@@ -892,6 +1274,7 @@ _deinit(LogThreadedDestWorker *s)
 
   if (self->compressor)
     compressor_free(self->compressor);
+  _in_flight_requests_deinit(self);
   list_free(self->request_headers);
   curl_easy_cleanup(self->curl);
   log_threaded_dest_worker_deinit_method(s);
@@ -919,6 +1302,9 @@ http_dw_new(LogThreadedDestDriver *o, gint worker_index)
   self->super.flush = _flush;
   self->super.free_fn = http_dw_free;
 
+  if (owner->max_in_flight_requests > 1)
+    self->super.flush = _flush_in_flight;
+
   if (owner->super.batch_lines > 0 || owner->batch_bytes > 0)
     self->super.insert = _insert_batched;
   else
@@ -31,6 +31,22 @@
 #include "compression.h"
 #include "metrics/dyn-metrics-store.h"
 
+/* a batch sent using the curl multi interface, waiting for its response */
+typedef struct _HTTPInFlightRequest
+{
+  CURL *curl;
+  GString *request_body;
+  GString *request_body_compressed;
+  List *request_headers;
+  LogMessage *msg_for_templated_url;
+  HTTPLoadBalancerTarget *target;
+  GString *url;
+  gint batch_size;
+  gint retry_attempts;
+  gboolean completed;
+  LogThreadedResult result;
+} HTTPInFlightRequest;
+
 typedef struct _HTTPDestinationWorker
 {
   LogThreadedDestWorker super;
@@ -43,6 +59,17 @@ typedef struct _HTTPDestinationWorker
   GString *url_buffer;
   LogMessage *msg_for_templated_url;
 
+  /* used if max-in-flight-requests() is larger than 1, requests form a
+   * ring buffer in the order they were sent */
+  struct
+  {
+    CURLM *multi;
+    HTTPInFlightRequest *requests;
+    gint max;
+    gint head;
+    gint len;
+  } in_flight;
+
   struct
   {
     DynMetricsStore *cache;
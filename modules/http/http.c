@@ -357,6 +357,14 @@ http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes)
   self->batch_bytes = batch_bytes;
 }
 
+void
+http_dd_set_max_in_flight_requests(LogDriver *d, gint max_in_flight_requests)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  self->max_in_flight_requests = max_in_flight_requests;
+}
+
 void
 http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix)
 {
@@ -519,6 +527,7 @@ http_dd_new(GlobalConfig *cfg)
   /* disable batching even if the global batch_lines is specified */
   self->super.batch_lines = 0;
   self->batch_bytes = 0;
+  self->max_in_flight_requests = 1;
   self->body_prefix = g_string_new("");
   self->body_suffix = g_string_new("");
   self->delimiter = g_string_new("\n");
@@ -64,6 +64,7 @@ typedef struct
   short int method_type;
   glong timeout;
   glong batch_bytes;
+  gint max_in_flight_requests;
   LogTemplate *body_template;
   LogTemplateOptions template_options;
   HttpResponseHandlers *response_handlers;
@@ -93,6 +94,7 @@ void http_dd_set_peer_verify(LogDriver *d, gboolean verify);
 gboolean http_dd_set_ocsp_stapling_verify(LogDriver *d, gboolean verify);
 void http_dd_set_timeout(LogDriver *d, glong timeout);
 void http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes);
+void http_dd_set_max_in_flight_requests(LogDriver *d, gint max_in_flight_requests);
 void http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix);
 void http_dd_set_body_suffix(LogDriver *d, const gchar *body_suffix);
 void http_dd_set_delimiter(LogDriver *d, const gchar *delimiter);
@@ -247,3 +247,22 @@ Test(http, set_urls_safe_or_unsafe_template)
   log_pipe_unref(&driver->super.super.super.super);
 }
 #endif
+
+Test(http, max_in_flight_requests)
+{
+  HTTPDestinationDriver *driver = (HTTPDestinationDriver *) http_dd_new(configuration);
+  cr_assert_eq(driver->max_in_flight_requests, 1);
+
+  /* by default every batch is sent and waited for one-by-one */
+  HTTPDestinationWorker *blocking_worker = (HTTPDestinationWorker *) http_dw_new(&driver->super, 0);
+  cr_assert_null(blocking_worker->in_flight.requests);
+
+  http_dd_set_max_in_flight_requests(&driver->super.super.super, 4);
+  HTTPDestinationWorker *in_flight_worker = (HTTPDestinationWorker *) http_dw_new(&driver->super, 1);
+  cr_assert(in_flight_worker->super.flush != blocking_worker->super.flush,
+            "batches have to be sent using the curl multi interface if max-in-flight-requests() is larger than 1");
+
+  log_threaded_dest_worker_free(&in_flight_worker->super);
+  log_threaded_dest_worker_free(&blocking_worker->super);
+  log_pipe_unref((LogPipe *)driver);
+}
@@ -123,8 +123,6 @@ _load_json_file(const gchar *filepath, GError **error)
   FilterXObject *result = NULL;
   if (object && (result = filterx_json_new_from_object(object)))
     filterx_object_make_readonly(result);
-  else
-    json_object_put(object);
 
   json_tokener_free(tokener);
   fclose(file);
@@ -149,52 +147,6 @@ _free(FilterXExpr *s)
   filterx_function_free_method(&self->super);
 }
 
-static void _deep_freeze(FilterXFuntionCacheJsonFile *self, FilterXObject *object);
-
-static void
-_deep_freeze_dict(FilterXFuntionCacheJsonFile *self, FilterXObject *object)
-{
-  struct json_object_iter itr;
-  json_object_object_foreachC(filterx_json_object_get_value(object), itr)
-  {
-    struct json_object *elem_jso = itr.val;
-    FilterXObject *elem_object = filterx_json_convert_json_to_object(self->cached_json, NULL, elem_jso);
-    _deep_freeze(self, elem_object);
-    filterx_json_associate_cached_object(elem_jso, elem_object);
-  }
-}
-
-static void
-_deep_freeze_list(FilterXFuntionCacheJsonFile *self, FilterXObject *object)
-{
-  struct json_object *jso = filterx_json_array_get_value(object);
-  guint64 len = json_object_array_length(jso);
-
-  for (guint64 i = 0; i < len; i++)
-    {
-      struct json_object *elem_jso = json_object_array_get_idx(jso, i);
-      FilterXObject *elem_object = filterx_json_convert_json_to_object(self->cached_json, NULL, elem_jso);
-      _deep_freeze(self, elem_object);
-      filterx_json_associate_cached_object(elem_jso, elem_object);
-    }
-}
-
-static void
-_deep_freeze(FilterXFuntionCacheJsonFile *self, FilterXObject *object)
-{
-  if (!object)
-    return;
-
-  if (filterx_object_freeze(object))
-    g_ptr_array_add(self->frozen_objects, object);
-
-  if (filterx_object_is_type(object, &FILTERX_TYPE_NAME(json_object)))
-    _deep_freeze_dict(self, object);
-
-  if (filterx_object_is_type(object, &FILTERX_TYPE_NAME(json_array)))
-    _deep_freeze_list(self, object);
-}
-
 FilterXFunction *
 filterx_function_cache_json_file_new(const gchar *function_name, FilterXFunctionArgs *args, GError **error)
 {
@@ -217,7 +169,7 @@ filterx_function_cache_json_file_new(const gchar *function_name, FilterXFunction
   if (!filterx_function_args_check(args, error))
     goto error;
 
-  _deep_freeze(self, self->cached_json);
+  filterx_json_deep_freeze(self->cached_json, self->frozen_objects);
 
   filterx_function_args_free(args);
   return &self->super;
@@ -241,7 +241,25 @@ _format_and_append_value(FilterXObject *value, GString *result)
   struct json_object *js;
   if (filterx_object_extract_json_array(value, &js) ||
       filterx_object_extract_json_object(value, &js))
-    return _format_and_append_json(js, result);
+    {
+      gboolean success = _format_and_append_json(js, result);
+      json_object_put(js);
+      return success;
+    }
+
+  /* numbers parsed from JSON, json-c formats them using their original text */
+  if (filterx_object_is_type(value, &FILTERX_TYPE_NAME(json_double)) ||
+      filterx_object_is_type(value, &FILTERX_TYPE_NAME(json_uint64)))
+    {
+      FilterXObject *assoc_object = NULL;
+      if (!filterx_object_map_to_json(value, &js, &assoc_object))
+        return FALSE;
+      filterx_object_unref(assoc_object);
+
+      gboolean success = _format_and_append_json(js, result);
+      json_object_put(js);
+      return success;
+    }
 
   if (filterx_object_extract_null(value))
     return _format_and_append_null(result);
@@ -109,6 +109,13 @@ Test(filterx_format_json, test_filterx_format_json)
   /* json_array */
   _assert_filterx_format_json_and_unref(filterx_json_array_new_from_repr("[\"foo\", 42]", -1), "[\"foo\",42]");
 
+  /* numbers parsed from JSON keep their original text */
+  _assert_filterx_format_json_and_unref(filterx_json_object_new_from_repr("{\"a\":1.50,\"b\":1e3,\"c\":18446744073709551615}",
+                                        -1),
+                                        "{\"a\":1.50,\"b\":1e3,\"c\":18446744073709551615}");
+  _assert_filterx_format_json_and_unref(filterx_json_array_new_from_repr("[1.50,1e3,18446744073709551615]", -1),
+                                        "[1.50,1e3,18446744073709551615]");
+
   /* message_value */
   _assert_filterx_format_json_and_unref(filterx_message_value_new("T", -1, LM_VT_BOOLEAN), "true");
   _assert_filterx_format_json_and_unref(filterx_message_value_new("F", -1, LM_VT_BOOLEAN), "false");
@@ -143,6 +150,18 @@ Test(filterx_format_json, test_filterx_format_json)
   cr_assert(filterx_object_set_subscript(dict, bar, &fx_1337));
   _assert_filterx_format_json_and_unref(dict, "{\"foo\":42,\"bar\":1337}");
 
+  /* members taken out of a parsed JSON */
+  FilterXObject *parsed = filterx_json_array_new_from_repr("[1.50,1e3,18446744073709551615]", -1);
+  FilterXObject *parsed_list = filterx_test_list_new();
+  for (guint64 i = 0; i < 3; i++)
+    {
+      FilterXObject *elem = filterx_list_get_subscript(parsed, i);
+      cr_assert(filterx_list_append(parsed_list, &elem));
+      filterx_object_unref(elem);
+    }
+  filterx_object_unref(parsed);
+  _assert_filterx_format_json_and_unref(parsed_list, "[1.50,1e3,18446744073709551615]");
+
   /* list */
   FilterXObject *list = filterx_test_list_new();
   cr_assert(filterx_list_append(list, &foo));
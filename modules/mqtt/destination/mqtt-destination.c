@@ -42,6 +42,9 @@
 
 #define DEFAULT_MESSAGE_TEMPLATE "$ISODATE $HOST $MSGHDR$MSG"
 
+/* the in-flight limit of a non-reliable Paho client, unless set in the connect options */
+#define MQTT_CLIENT_DEFAULT_MAX_INFLIGHT_MESSAGES 10
+
 /*
  * Configuration
  */
@@ -73,9 +76,25 @@ mqtt_dd_set_message_template_ref(LogDriver *d, LogTemplate *message)
   self->message = message;
 }
 
+void
+mqtt_dd_set_max_in_flight_messages(LogDriver *d, gint max_in_flight_messages)
+{
+  MQTTDestinationDriver *self = (MQTTDestinationDriver *)d;
+
+  self->max_in_flight_messages = max_in_flight_messages;
+}
+
 /*
  * Utilities
  */
+
+/* QoS 0 publishes complete immediately, there is nothing to wait for */
+gboolean
+mqtt_dd_is_publishing_asynchronously(MQTTDestinationDriver *self)
+{
+  return self->max_in_flight_messages > 1 && mqtt_client_options_get_qos(&self->options) > 0;
+}
+
 static const gchar *
 _format_stats_key(LogThreadedDestDriver *d, StatsClusterKeyBuilder *kb)
 {
@@ -126,6 +145,7 @@ _set_default_value(MQTTDestinationDriver *self, GlobalConfig *cfg)
   log_template_compile(self->message, DEFAULT_MESSAGE_TEMPLATE, NULL);
 
   log_template_options_defaults(&self->template_options);
+  self->max_in_flight_messages = 1;
 }
 
 static gboolean
@@ -171,7 +191,31 @@ _init(LogPipe *d)
       return FALSE;
     }
 
-  if (self->super.batch_lines != -1 || self->super.batch_timeout != -1)
+  if (mqtt_dd_is_publishing_asynchronously(self))
+    {
+      /* batch-lines() is set from max-in-flight-messages(), which is also the case when we are reinitialized */
+      if (self->super.batch_lines != -1 && self->super.batch_lines != self->max_in_flight_messages)
+        {
+          msg_error("The mqtt destination collects its in-flight messages as a batch, please use max-in-flight-messages() instead of batch-lines()",
+                    evt_tag_str("driver", self->super.super.super.id),
+                    log_pipe_location_tag(&self->super.super.super.super));
+          return FALSE;
+        }
+
+#if !SYSLOG_NG_HAVE_PAHO_MAX_INFLIGHT_MESSAGES
+      if (self->max_in_flight_messages > MQTT_CLIENT_DEFAULT_MAX_INFLIGHT_MESSAGES)
+        {
+          msg_error("The current libpaho-mqtt version does not support setting its limit of in-flight messages, "
+                    "please use a lower max-in-flight-messages() or update to at least libpaho-mqtt 1.3.0",
+                    evt_tag_int("max_in_flight_messages", self->max_in_flight_messages),
+                    evt_tag_int("limit", MQTT_CLIENT_DEFAULT_MAX_INFLIGHT_MESSAGES),
+                    evt_tag_str("driver", self->super.super.super.id),
+                    log_pipe_location_tag(&self->super.super.super.super));
+          return FALSE;
+        }
+#endif
+    }
+  else if (self->super.batch_lines != -1 || self->super.batch_timeout != -1)
     {
       msg_error("The mqtt destination does not support the batching of messages, so none of the batching related parameters can be set (batch-timeout, batch-lines)",
                 evt_tag_str("driver", self->super.super.super.id),
@@ -189,6 +233,10 @@ _init(LogPipe *d)
 
   log_template_options_init(&self->template_options, cfg);
 
+  /* the in-flight messages are collected as a batch, which is completed in flush() */
+  if (mqtt_dd_is_publishing_asynchronously(self))
+    log_threaded_dest_driver_set_batch_lines(d, self->max_in_flight_messages);
+
   if (_topic_name_is_a_template(self) && self->fallback_topic == NULL)
     {
       msg_error("mqtt: the fallback_topic() argument is required if topic is templated for mqtt destinations",
@@ -145,34 +145,39 @@ mqtt_dest_worker_resolve_template_topic_name(MQTTDestinationWorker *self, LogMes
 }
 
 static LogThreadedResult
-_mqtt_send(LogThreadedDestWorker *s, gchar *msg, const gchar *topic)
+_mqtt_publish(LogThreadedDestWorker *s, gchar *msg, const gchar *topic, MQTTClient_deliveryToken *token)
 {
   MQTTDestinationWorker *self = (MQTTDestinationWorker *)s;
   MQTTDestinationDriver *owner = (MQTTDestinationDriver *) s->owner;
 
   MQTTClient_message pubmsg = MQTTClient_message_initializer;
-  MQTTClient_deliveryToken token;
   gint rc;
-  LogThreadedResult result = LTR_SUCCESS;
 
   pubmsg.payload = msg;
   pubmsg.payloadlen = (int)strlen(msg);
   pubmsg.qos = mqtt_client_options_get_qos(&owner->options);
   pubmsg.retained = 0;
 
-  rc = MQTTClient_publishMessage(self->client, topic, &pubmsg, &token);
+  rc = MQTTClient_publishMessage(self->client, topic, &pubmsg, token);
   msg_debug("Outgoing message to MQTT destination", evt_tag_str("topic", topic),
             evt_tag_str("message", msg), log_pipe_location_tag(&owner->super.super.super.super));
 
-  result = _publish_result_evaluation (&self->super, rc);
+  return _publish_result_evaluation (&self->super, rc);
+}
 
-  if (result != LTR_SUCCESS)
-    return result;
+static LogThreadedResult
+_mqtt_wait_for_completion(LogThreadedDestWorker *s, MQTTClient_deliveryToken token)
+{
+  MQTTDestinationWorker *self = (MQTTDestinationWorker *)s;
 
-  rc = MQTTClient_waitForCompletion(self->client, token, PUBLISH_TIMEOUT);
-  result = _wait_result_evaluation(&self->super, rc);
+  gint rc = MQTTClient_waitForCompletion(self->client, token, PUBLISH_TIMEOUT);
+  return _wait_result_evaluation(&self->super, rc);
+}
 
-  return result;
+static void
+_forget_in_flight_messages(MQTTDestinationWorker *self)
+{
+  g_array_set_size(self->in_flight_tokens, 0);
 }
 
 static void
@@ -186,17 +191,43 @@ _format_message(LogThreadedDestWorker *s, LogMessage *msg)
   log_template_format(owner->message, msg, &options, self->string_to_write);
 }
 
+/*
+ * With max-in-flight-messages() > 1 (and QoS 1 or 2), insert() only
+ * publishes the message and remembers its delivery token, the messages
+ * are collected in a batch of max-in-flight-messages() size.  flush() waits
+ * for the completion of the batch in publishing order, so a round-trip is
+ * paid per batch instead of per message.
+ */
 static LogThreadedResult
 _insert(LogThreadedDestWorker *s, LogMessage *msg)
 {
   MQTTDestinationWorker *self = (MQTTDestinationWorker *)s;
+  MQTTDestinationDriver *owner = (MQTTDestinationDriver *) s->owner;
+  MQTTClient_deliveryToken token;
   LogThreadedResult result = LTR_SUCCESS;
 
   _format_message(s, msg);
 
-  result = _mqtt_send(s, self->string_to_write->str, mqtt_dest_worker_resolve_template_topic_name(self, msg));
+  result = _mqtt_publish(s, self->string_to_write->str, mqtt_dest_worker_resolve_template_topic_name(self, msg),
+                         &token);
 
-  return result;
+  if (!mqtt_dd_is_publishing_asynchronously(owner))
+    {
+      if (result != LTR_SUCCESS)
+        return result;
+
+      return _mqtt_wait_for_completion(s, token);
+    }
+
+  if (result != LTR_SUCCESS)
+    {
+      /* the whole batch is going to be rewound or dropped */
+      _forget_in_flight_messages(self);
+      return result;
+    }
+
+  g_array_append_val(self->in_flight_tokens, token);
+  return LTR_QUEUED;
   /*
    * LTR_DROP,
    * LTR_ERROR,
@@ -207,6 +238,29 @@ _insert(LogThreadedDestWorker *s, LogMessage *msg)
   */
 }
 
+static LogThreadedResult
+_flush(LogThreadedDestWorker *s, LogThreadedFlushMode mode)
+{
+  MQTTDestinationWorker *self = (MQTTDestinationWorker *)s;
+  LogThreadedResult result = LTR_SUCCESS;
+  guint completed;
+
+  for (completed = 0; completed < self->in_flight_tokens->len; completed++)
+    {
+      result = _mqtt_wait_for_completion(s, g_array_index(self->in_flight_tokens, MQTTClient_deliveryToken, completed));
+      if (result != LTR_SUCCESS)
+        break;
+    }
+
+  /* the backlog can only be acknowledged from its head: the messages
+   * following the first failure are retried, even if they were delivered */
+  if (result != LTR_SUCCESS && completed > 0)
+    log_threaded_dest_worker_ack_messages(s, completed);
+
+  _forget_in_flight_messages(self);
+  return result;
+}
+
 static gboolean
 _connect(LogThreadedDestWorker *s)
 {
@@ -219,6 +273,17 @@ _connect(LogThreadedDestWorker *s)
   MQTTClient_SSLOptions ssl_opts;
   mqtt_client_options_to_mqtt_client_connection_option(&owner->options, &conn_opts, &ssl_opts);
 
+  /* a reliable client would block publishing until the previous message is completed */
+  if (mqtt_dd_is_publishing_asynchronously(owner))
+    {
+      conn_opts.reliable = 0;
+#if SYSLOG_NG_HAVE_PAHO_MAX_INFLIGHT_MESSAGES
+      /* otherwise publishing fails with MQTTCLIENT_MAX_MESSAGES_INFLIGHT above the default limit of the client */
+      if (conn_opts.struct_version >= 6)
+        conn_opts.maxInflightMessages = owner->max_in_flight_messages;
+#endif
+    }
+
   if ((rc = MQTTClient_connect(self->client, &conn_opts)) != MQTTCLIENT_SUCCESS)
     {
       msg_error("Error connecting mqtt client",
@@ -237,6 +302,7 @@ _disconnect(LogThreadedDestWorker *s)
   MQTTDestinationWorker *self = (MQTTDestinationWorker *)s;
 
   MQTTClient_disconnect(self->client, MQTT_DISCONNECT_TIMEOUT);
+  _forget_in_flight_messages(self);
 }
 
 static gboolean
@@ -288,6 +354,7 @@ _free(LogThreadedDestWorker *s)
 
   g_string_free(self->string_to_write, TRUE);
   g_string_free(self->topic_name_buffer, TRUE);
+  g_array_free(self->in_flight_tokens, TRUE);
 
   log_threaded_dest_worker_free_method(s);
 }
@@ -300,11 +367,13 @@ mqtt_dw_new(LogThreadedDestDriver *o, gint worker_index)
 
   self->string_to_write = g_string_new("");
   self->topic_name_buffer = g_string_new("");
+  self->in_flight_tokens = g_array_new(FALSE, FALSE, sizeof(MQTTClient_deliveryToken));
 
   log_threaded_dest_worker_init_instance(&self->super, o, worker_index);
   self->super.init = _init;
   self->super.deinit = _deinit;
   self->super.insert = _insert;
+  self->super.flush = _flush;
   self->super.free_fn = _free;
   self->super.connect = _connect;
   self->super.disconnect = _disconnect;
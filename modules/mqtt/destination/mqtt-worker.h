@@ -39,6 +39,9 @@ typedef struct _MQTTDestinationWorker
   GString *string_to_write;
   GString *topic_name_buffer;
 
+  /* tokens of the messages published in the current batch, in publishing order */
+  GArray *in_flight_tokens;
+
   struct iv_timer yield_timer;
 } MQTTDestinationWorker;
 
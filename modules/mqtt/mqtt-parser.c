@@ -35,6 +35,7 @@ static CfgLexerKeyword mqtt_keywords[] =
   { "address", KW_ADDRESS },
   { "topic", KW_TOPIC },
   { "fallback_topic", KW_FALLBACK_TOPIC },
+  { "max_in_flight_messages", KW_MAX_IN_FLIGHT_MESSAGES },
   { "keepalive", KW_KEEPALIVE },
   { "qos", KW_QOS },
   { "client_id", KW_CLIENT_ID },
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/config_parse_lib.h"
+#include "libtest/grab-logging.h"
+
+#include "mqtt-destination.h"
+#include "cfg.h"
+#include "cfg-grammar.h"
+#include "apphook.h"
+#include "plugin.h"
+
+static MQTTDestinationDriver *
+_parse_mqtt_destination(const gchar *options)
+{
+  MQTTDestinationDriver *dd = NULL;
+  gchar *raw_config = g_strdup_printf("mqtt(topic(\"test/topic\") %s);", options);
+
+  gboolean result = parse_config(raw_config, LL_CONTEXT_DESTINATION, NULL, (gpointer *) &dd);
+  g_free(raw_config);
+
+  return result ? dd : NULL;
+}
+
+Test(mqtt_destination, test_max_in_flight_messages_defaults_to_one)
+{
+  MQTTDestinationDriver *dd = _parse_mqtt_destination("qos(1)");
+
+  cr_assert_not_null(dd);
+  cr_assert_eq(dd->max_in_flight_messages, 1);
+  cr_assert_not(mqtt_dd_is_publishing_asynchronously(dd));
+
+  log_pipe_unref(&dd->super.super.super.super);
+}
+
+Test(mqtt_destination, test_max_in_flight_messages_is_parsed)
+{
+  MQTTDestinationDriver *dd = _parse_mqtt_destination("qos(1) max-in-flight-messages(16)");
+
+  cr_assert_not_null(dd);
+  cr_assert_eq(dd->max_in_flight_messages, 16);
+  cr_assert(mqtt_dd_is_publishing_asynchronously(dd));
+
+  log_pipe_unref(&dd->super.super.super.super);
+}
+
+Test(mqtt_destination, test_max_in_flight_messages_has_to_be_positive)
+{
+  cr_assert_null(_parse_mqtt_destination("max-in-flight-messages(0)"));
+  cr_assert_null(_parse_mqtt_destination("max-in-flight-messages(-1)"));
+}
+
+Test(mqtt_destination, test_max_in_flight_messages_is_ignored_with_qos_0)
+{
+  MQTTDestinationDriver *dd = _parse_mqtt_destination("qos(0) max-in-flight-messages(16)");
+
+  cr_assert_not_null(dd);
+  cr_assert_not(mqtt_dd_is_publishing_asynchronously(dd));
+
+  log_pipe_unref(&dd->super.super.super.super);
+}
+
+Test(mqtt_destination, test_batch_lines_conflicting_with_max_in_flight_messages_is_rejected)
+{
+  MQTTDestinationDriver *dd = _parse_mqtt_destination("qos(1) max-in-flight-messages(16)");
+
+  cr_assert_not_null(dd);
+  log_threaded_dest_driver_set_batch_lines(&dd->super.super.super, 100);
+
+  start_grabbing_messages();
+  cr_assert_not(log_pipe_init(&dd->super.super.super.super));
+  assert_grabbed_log_contains("please use max-in-flight-messages() instead of batch-lines()");
+  stop_grabbing_messages();
+
+  log_pipe_unref(&dd->super.super.super.super);
+}
+
+Test(mqtt_destination, test_batch_lines_is_rejected_without_max_in_flight_messages)
+{
+  MQTTDestinationDriver *dd = _parse_mqtt_destination("qos(1)");
+
+  cr_assert_not_null(dd);
+  log_threaded_dest_driver_set_batch_lines(&dd->super.super.super, 100);
+
+  start_grabbing_messages();
+  cr_assert_not(log_pipe_init(&dd->super.super.super.super));
+  assert_grabbed_log_contains("does not support the batching of messages");
+  stop_grabbing_messages();
+
+  log_pipe_unref(&dd->super.super.super.super);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  configuration = cfg_new_snippet();
+  cr_assert(cfg_load_module(configuration, "mqtt"));
+}
+
+static void
+teardown(void)
+{
+  cfg_free(configuration);
+  app_shutdown();
+}
+
+TestSuite(mqtt_destination, .init = setup, .fini = teardown);
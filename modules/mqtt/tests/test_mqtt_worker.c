@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "libtest/cr_template.h"
+#include "libtest/grab-logging.h"
+
+#include "mqtt-destination.h"
+#include "logthrdest/logthrdestdrv.h"
+#include "mainloop.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+
+#include <MQTTClient.h>
+
+/*
+ * The Paho client functions used by the mqtt() destination are replaced
+ * by the mock below, it completes (or fails) the delivery tokens without
+ * a broker, and records the order in which they were published and
+ * waited for.  Like the Paho client, it refuses to publish above its
+ * in-flight limit.
+ */
+
+#define MAX_SPIN_ITERATIONS 10000
+#define PAHO_DEFAULT_MAX_INFLIGHT_MESSAGES 10
+
+typedef struct _MockWait
+{
+  MQTTClient_deliveryToken token;
+  gint published;
+} MockWait;
+
+static struct
+{
+  GMutex lock;
+  GPtrArray *payloads;
+  GArray *waits;
+  MQTTClient_deliveryToken last_token;
+  MQTTClient_deliveryToken fail_token;
+  gint connect_reliable;
+  gint max_inflight_messages;
+  gint in_flight;
+} mock;
+
+int
+MQTTClient_create(MQTTClient *handle, const char *serverURI, const char *clientId,
+                  int persistence_type, void *persistence_context)
+{
+  *handle = &mock;
+  return MQTTCLIENT_SUCCESS;
+}
+
+void
+MQTTClient_destroy(MQTTClient *handle)
+{
+  *handle = NULL;
+}
+
+int
+MQTTClient_connect(MQTTClient handle, MQTTClient_connectOptions *options)
+{
+  g_mutex_lock(&mock.lock);
+  mock.connect_reliable = options->reliable;
+  mock.max_inflight_messages = options->reliable ? 1 : PAHO_DEFAULT_MAX_INFLIGHT_MESSAGES;
+#if SYSLOG_NG_HAVE_PAHO_MAX_INFLIGHT_MESSAGES
+  if (options->struct_version >= 6 && options->maxInflightMessages > 0)
+    mock.max_inflight_messages = options->maxInflightMessages;
+#endif
+  mock.in_flight = 0;
+  g_mutex_unlock(&mock.lock);
+  return MQTTCLIENT_SUCCESS;
+}
+
+int
+MQTTClient_disconnect(MQTTClient handle, int timeout)
+{
+  return MQTTCLIENT_SUCCESS;
+}
+
+void
+MQTTClient_yield(void)
+{
+}
+
+const char *
+MQTTClient_strerror(int code)
+{
+  return "mocked error";
+}
+
+int
+MQTTClient_publishMessage(MQTTClient handle, const char *topicName, MQTTClient_message *msg,
+                          MQTTClient_deliveryToken *dt)
+{
+  g_mutex_lock(&mock.lock);
+  if (mock.in_flight >= mock.max_inflight_messages)
+    {
+      g_mutex_unlock(&mock.lock);
+      return MQTTCLIENT_MAX_MESSAGES_INFLIGHT;
+    }
+  g_ptr_array_add(mock.payloads, g_strndup(msg->payload, msg->payloadlen));
+  *dt = ++mock.last_token;
+  mock.in_flight++;
+  g_mutex_unlock(&mock.lock);
+  return MQTTCLIENT_SUCCESS;
+}
+
+int
+MQTTClient_waitForCompletion(MQTTClient handle, MQTTClient_deliveryToken dt, unsigned long timeout)
+{
+  MockWait wait = { .token = dt };
+
+  g_mutex_lock(&mock.lock);
+  wait.published = mock.payloads->len;
+  g_array_append_val(mock.waits, wait);
+  if (mock.in_flight > 0)
+    mock.in_flight--;
+  gboolean fail = dt == mock.fail_token;
+  g_mutex_unlock(&mock.lock);
+
+  return fail ? MQTTCLIENT_FAILURE : MQTTCLIENT_SUCCESS;
+}
+
+static MainLoop *main_loop;
+static MainLoopOptions main_loop_options = {0};
+static MQTTDestinationDriver *dd;
+
+static void
+_sleep_msec(long msec)
+{
+  struct timespec sleep_time = { msec / 1000, (msec % 1000) * 1000000 };
+  nanosleep(&sleep_time, NULL);
+}
+
+static void
+_spin_for_counter_value(StatsCounterItem *counter, gssize expected_value)
+{
+  gssize value = stats_counter_get(counter);
+
+  for (gint c = 0; value != expected_value && c < MAX_SPIN_ITERATIONS; c++)
+    {
+      _sleep_msec(1);
+      value = stats_counter_get(counter);
+    }
+  cr_assert_eq(value, expected_value,
+               "counter did not reach the expected value, expected_value=%" G_GSSIZE_FORMAT
+               ", value=%" G_GSSIZE_FORMAT, expected_value, value);
+}
+
+static LogTemplate *
+_compile_template(const gchar *template)
+{
+  LogTemplate *t = log_template_new(main_loop_get_current_config(main_loop), NULL);
+
+  cr_assert(log_template_compile(t, template, NULL));
+  return t;
+}
+
+static void
+_create_driver(gint max_in_flight_messages)
+{
+  LogDriver *d = mqtt_dd_new(main_loop_get_current_config(main_loop));
+
+  mqtt_dd_set_topic_template(d, _compile_template("test/topic"));
+  mqtt_dd_set_message_template_ref(d, _compile_template("$PID"));
+  mqtt_dd_set_max_in_flight_messages(d, max_in_flight_messages);
+  mqtt_client_options_set_qos(mqtt_dd_get_options(d), 1);
+  log_threaded_dest_driver_set_time_reopen(d, 0);
+
+  dd = (MQTTDestinationDriver *) d;
+  cr_assert(log_pipe_init(&dd->super.super.super.super));
+}
+
+/* the worker is started only after the messages are queued, so the batches are always full */
+static void
+_start_worker(void)
+{
+  cr_assert(log_pipe_post_config_init(&dd->super.super.super.super));
+}
+
+static void
+_destroy_driver(void)
+{
+  main_loop_sync_worker_startup_and_teardown();
+  log_pipe_deinit(&dd->super.super.super.super);
+  log_pipe_unref(&dd->super.super.super.super);
+  dd = NULL;
+}
+
+static void
+_send_messages(gint n)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+  gchar pid[16];
+
+  for (gint i = 0; i < n; i++)
+    {
+      LogMessage *msg = create_sample_message();
+
+      g_snprintf(pid, sizeof(pid), "%d", i);
+      log_msg_set_value(msg, LM_V_PID, pid, -1);
+      log_pipe_queue(&dd->super.super.super.super, msg, &path_options);
+    }
+}
+
+static void
+_assert_published_payloads(const gchar *expected[], guint len)
+{
+  cr_assert_eq(mock.payloads->len, len, "expected %u published messages, got %u", len, mock.payloads->len);
+  for (guint i = 0; i < len; i++)
+    cr_assert_str_eq(g_ptr_array_index(mock.payloads, i), expected[i], "mismatch at publish #%u", i);
+}
+
+static void
+_assert_waits(const MockWait expected[], guint len)
+{
+  cr_assert_eq(mock.waits->len, len, "expected %u waits, got %u", len, mock.waits->len);
+  for (guint i = 0; i < len; i++)
+    {
+      MockWait *wait = &g_array_index(mock.waits, MockWait, i);
+
+      cr_assert_eq(wait->token, expected[i].token, "mismatch at wait #%u", i);
+      cr_assert_eq(wait->published, expected[i].published, "token %d was waited for too early", wait->token);
+    }
+}
+
+Test(mqtt_worker, test_in_flight_messages_are_completed_in_publishing_order)
+{
+  _create_driver(4);
+  _send_messages(10);
+  _start_worker();
+
+  _spin_for_counter_value(dd->super.metrics.written_messages, 10);
+  cr_assert_eq(dd->super.batch_lines, 4);
+  cr_assert_eq(mock.connect_reliable, 0);
+
+  const gchar *expected_payloads[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+  _assert_published_payloads(expected_payloads, G_N_ELEMENTS(expected_payloads));
+
+  /* every batch is published before its first token is waited for */
+  const MockWait expected_waits[] =
+  {
+    { 1, 4 }, { 2, 4 }, { 3, 4 }, { 4, 4 },
+    { 5, 8 }, { 6, 8 }, { 7, 8 }, { 8, 8 },
+    { 9, 10 }, { 10, 10 },
+  };
+  _assert_waits(expected_waits, G_N_ELEMENTS(expected_waits));
+
+  _destroy_driver();
+}
+
+Test(mqtt_worker, test_messages_completed_before_a_failure_are_acked_and_the_rest_is_published_again)
+{
+  _create_driver(4);
+  mock.fail_token = 3;
+  _send_messages(10);
+  start_grabbing_messages();
+  _start_worker();
+
+  _spin_for_counter_value(dd->super.metrics.written_messages, 10);
+  cr_assert_eq(stats_counter_get(dd->super.metrics.dropped_messages), 0);
+  cr_assert_eq(stats_counter_get(dd->super.worker.instance.queue->metrics.shared.memory_usage), 0);
+  assert_grabbed_log_contains("Error occurred while");
+  stop_grabbing_messages();
+
+  /* "0" and "1" were completed before the failing token, only "2" and "3" are published again */
+  const gchar *expected_payloads[] = { "0", "1", "2", "3", "2", "3", "4", "5", "6", "7", "8", "9" };
+  _assert_published_payloads(expected_payloads, G_N_ELEMENTS(expected_payloads));
+
+  /* the token following the failure is not waited for */
+  const MockWait expected_waits[] =
+  {
+    { 1, 4 }, { 2, 4 }, { 3, 4 },
+    { 5, 8 }, { 6, 8 }, { 7, 8 }, { 8, 8 },
+    { 9, 12 }, { 10, 12 }, { 11, 12 }, { 12, 12 },
+  };
+  _assert_waits(expected_waits, G_N_ELEMENTS(expected_waits));
+
+  _destroy_driver();
+}
+
+#if SYSLOG_NG_HAVE_PAHO_MAX_INFLIGHT_MESSAGES
+
+Test(mqtt_worker, test_in_flight_messages_above_the_default_limit_of_the_client)
+{
+  _create_driver(16);
+  _send_messages(32);
+  _start_worker();
+
+  _spin_for_counter_value(dd->super.metrics.written_messages, 32);
+  cr_assert_eq(mock.max_inflight_messages, 16);
+
+  /* nothing is published again, both batches are published as a whole before waiting */
+  cr_assert_eq(mock.payloads->len, 32);
+  cr_assert_eq(mock.waits->len, 32);
+  cr_assert_eq(g_array_index(mock.waits, MockWait, 0).published, 16);
+  cr_assert_eq(g_array_index(mock.waits, MockWait, 16).published, 32);
+
+  _destroy_driver();
+}
+
+#else
+
+Test(mqtt_worker, test_in_flight_messages_above_the_default_limit_of_the_client_are_rejected)
+{
+  LogDriver *d = mqtt_dd_new(main_loop_get_current_config(main_loop));
+
+  mqtt_dd_set_topic_template(d, _compile_template("test/topic"));
+  mqtt_dd_set_max_in_flight_messages(d, PAHO_DEFAULT_MAX_INFLIGHT_MESSAGES + 1);
+  mqtt_client_options_set_qos(mqtt_dd_get_options(d), 1);
+
+  cr_assert_not(log_pipe_init(&d->super));
+  log_pipe_unref(&d->super);
+}
+
+#endif
+
+Test(mqtt_worker, test_messages_are_completed_one_by_one_without_max_in_flight_messages)
+{
+  _create_driver(1);
+  _send_messages(3);
+  _start_worker();
+
+  _spin_for_counter_value(dd->super.metrics.written_messages, 3);
+  cr_assert_eq(mock.connect_reliable, 1);
+
+  const MockWait expected_waits[] = { { 1, 1 }, { 2, 2 }, { 3, 3 } };
+  _assert_waits(expected_waits, G_N_ELEMENTS(expected_waits));
+
+  _destroy_driver();
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+  cfg_set_current_version(main_loop_get_current_config(main_loop));
+  main_loop_worker_allocate_thread_space(2);
+  main_loop_worker_finalize_thread_space();
+
+  g_mutex_init(&mock.lock);
+  mock.payloads = g_ptr_array_new_with_free_func(g_free);
+  mock.waits = g_array_new(FALSE, FALSE, sizeof(MockWait));
+  mock.last_token = 0;
+  mock.fail_token = -1;
+  mock.connect_reliable = -1;
+  mock.max_inflight_messages = 0;
+  mock.in_flight = 0;
+}
+
+static void
+teardown(void)
+{
+  g_ptr_array_free(mock.payloads, TRUE);
+  g_array_free(mock.waits, TRUE);
+  g_mutex_clear(&mock.lock);
+
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(mqtt_worker, .init = setup, .fini = teardown);
@@ -104,5 +104,15 @@ class LogDestination(LogDestination):
 
         Returns:
             int: one value from the LogDestinationResult enum
+
+        Batching:
+            Instead of send(), a destination may implement a
+            send_batch(self, msgs) method, which is not defined here as its
+            presence enables batching.  In that case syslog-ng collects up
+            to batch-lines() messages and passes them as a list to a single
+            send_batch() call.  It returns either one LogDestinationResult
+            value that applies to the whole batch, or a list with one value
+            for each message.  Messages following the first failure in the
+            list are retried together with it.
         """
         raise NotImplementedError
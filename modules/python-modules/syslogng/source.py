@@ -263,6 +263,14 @@ class LogFetcher(LogFetcher):
                 status code and a message instance.  Possible status codes
                 are defined as members in the LogFetcher class or as values
                 in the LogFetchrResult enum.
+
+        Batching:
+            A fetcher may implement a fetch_batch(self, max_messages)
+            method instead, which is not defined here as its presence
+            replaces fetch().  It returns a (LogFetcherResult,
+            [LogMessage, ...]) tuple of at most max_messages messages, the
+            messages are posted one by one before fetch_batch() is called
+            again.
         """
         raise NotImplementedError
 
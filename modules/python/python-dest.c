@@ -37,6 +37,12 @@
 #include "messages.h"
 #include "python-persist.h"
 
+typedef struct
+{
+  LogMessage *msg;
+  gint32 seq_num;
+} PythonDestBatchItem;
+
 typedef struct
 {
   LogThreadedDestDriver super;
@@ -46,6 +52,9 @@ typedef struct
   LogTemplateOptions template_options;
   ValuePairs *vp;
 
+  /* messages collected for send_batch(), owned by the worker thread */
+  GArray *batch;
+
   struct
   {
     PyObject *class;
@@ -53,6 +62,7 @@ typedef struct
     PyObject *is_opened;
     PyObject *open;
     PyObject *send;
+    PyObject *send_batch;
     PyObject *flush;
     PyObject *generate_persist_name;
     GPtrArray *_refs_to_clean;
@@ -271,6 +281,77 @@ _py_invoke_send(PythonDestDriver *self, PyObject *dict)
   return result;
 }
 
+static LogThreadedResult
+_py_batch_result_from_pyobject(PyObject *obj)
+{
+  LogThreadedResult result = pyobject_to_worker_insert_result(obj);
+
+  /* these would leave messages in the batch that we no longer track */
+  if (result == LTR_QUEUED || result == LTR_EXPLICIT_ACK_MGMT)
+    {
+      msg_error("python-dest: send_batch() returned a result that is not valid for a batch, please use SUCCESS, DROP, "
+                "ERROR, NOT_CONNECTED or RETRY. Retrying message later",
+                evt_tag_int("result", result));
+      return LTR_ERROR;
+    }
+  return result;
+}
+
+/* send_batch() either returns a single result that applies to the whole
+ * batch or a sequence with one result for each message */
+static gboolean
+_py_parse_batch_results(PythonDestDriver *self, PyObject *ret, LogThreadedResult *results, gsize num_results)
+{
+  if (PyBool_Check(ret) || PyLong_Check(ret))
+    {
+      LogThreadedResult result = _py_batch_result_from_pyobject(ret);
+
+      for (gsize i = 0; i < num_results; i++)
+        results[i] = result;
+      return TRUE;
+    }
+
+  PyObject *seq = PySequence_Fast(ret, "send_batch() must return a LogDestinationResult or a list of them");
+  if (!seq)
+    {
+      PyErr_Clear();
+      goto error;
+    }
+
+  if ((gsize) PySequence_Fast_GET_SIZE(seq) != num_results)
+    {
+      Py_DECREF(seq);
+      goto error;
+    }
+
+  for (gsize i = 0; i < num_results; i++)
+    results[i] = _py_batch_result_from_pyobject(PySequence_Fast_GET_ITEM(seq, i));
+
+  Py_DECREF(seq);
+  return TRUE;
+
+error:
+  msg_error("python-dest: send_batch() must return a LogDestinationResult or a list with one for each message. "
+            "Retrying batch later",
+            evt_tag_str("driver", self->super.super.super.id),
+            evt_tag_str("class", self->binding.class),
+            evt_tag_int("batch_size", num_results));
+  return FALSE;
+}
+
+static void
+_py_invoke_send_batch(PythonDestDriver *self, PyObject *py_batch, LogThreadedResult *results, gsize num_results)
+{
+  PyObject *ret = _py_invoke_function(self->py.send_batch, py_batch, self->binding.class, self->super.super.super.id);
+
+  if (!ret || !_py_parse_batch_results(self, ret, results, num_results))
+    {
+      for (gsize i = 0; i < num_results; i++)
+        results[i] = LTR_ERROR;
+    }
+  Py_XDECREF(ret);
+}
+
 static gboolean
 _py_invoke_init(PythonDestDriver *self)
 {
@@ -392,6 +473,7 @@ _py_init_bindings(PythonDestDriver *self)
   self->py.open = _py_get_attr_or_null(self->py.instance, "open");
   self->py.flush = _py_get_attr_or_null(self->py.instance, "flush");
   self->py.send = _py_get_attr_or_null(self->py.instance, "send");
+  self->py.send_batch = _py_get_attr_or_null(self->py.instance, "send_batch");
   self->py.generate_persist_name = _py_get_attr_or_null(self->py.instance, "generate_persist_name");
   if (!self->py.send)
     {
@@ -411,6 +493,7 @@ _py_init_bindings(PythonDestDriver *self)
   g_ptr_array_add(self->py._refs_to_clean, self->py.open);
   g_ptr_array_add(self->py._refs_to_clean, self->py.flush);
   g_ptr_array_add(self->py._refs_to_clean, self->py.send);
+  g_ptr_array_add(self->py._refs_to_clean, self->py.send_batch);
   g_ptr_array_add(self->py._refs_to_clean, self->py.generate_persist_name);
 
   return TRUE;
@@ -445,7 +528,7 @@ _py_init_object(PythonDestDriver *self)
 }
 
 static gboolean
-_py_construct_message(PythonDestDriver *self, LogMessage *msg, PyObject **msg_object)
+_py_construct_message(PythonDestDriver *self, LogMessage *msg, gint32 seq_num, PyObject **msg_object)
 {
   GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super.super);
   gboolean success;
@@ -453,7 +536,7 @@ _py_construct_message(PythonDestDriver *self, LogMessage *msg, PyObject **msg_ob
 
   if (self->vp)
     {
-      LogTemplateEvalOptions options = {&self->template_options, LTZ_LOCAL, self->super.worker.instance.seq_num, NULL, LM_VT_STRING};
+      LogTemplateEvalOptions options = {&self->template_options, LTZ_LOCAL, seq_num, NULL, LM_VT_STRING};
       success = py_value_pairs_apply(self->vp, &options, msg, msg_object);
       if (!success && (self->template_options.on_error & ON_ERROR_DROP_MESSAGE))
         return FALSE;
@@ -487,6 +570,132 @@ py_log_destination_stats_written_bytes_add(PyObject *s, PyObject *args)
 }
 
 
+/*
+ * Batching via send_batch()
+ *
+ * If the Python class implements send_batch(), insert() only collects the
+ * messages (without touching the GIL) and flush() converts the whole batch
+ * to Python objects and delivers them using a single send_batch() call,
+ * under a single GIL acquisition.
+ *
+ * Per-message results are applied in order: leading successful and
+ * dropped messages are acknowledged, the first failure applies to the
+ * rest of the batch, which is then retried as usual.
+ */
+static void
+_batch_item_clear(PythonDestBatchItem *item)
+{
+  log_msg_unref(item->msg);
+}
+
+static void
+_batch_clear(PythonDestDriver *self)
+{
+  g_array_set_size(self->batch, 0);
+}
+
+static LogThreadedResult
+_batch_add(PythonDestDriver *self, LogMessage *msg)
+{
+  PythonDestBatchItem item = { log_msg_ref(msg), self->super.worker.instance.seq_num };
+
+  g_array_append_val(self->batch, item);
+  return LTR_QUEUED;
+}
+
+static void
+_batch_settle_run(PythonDestDriver *self, LogThreadedResult result, gint run_length)
+{
+  if (run_length == 0)
+    return;
+
+  if (result == LTR_SUCCESS)
+    log_threaded_dest_worker_ack_messages(&self->super.worker.instance, run_length);
+  else
+    log_threaded_dest_worker_drop_messages(&self->super.worker.instance, run_length);
+}
+
+/* acknowledges the successful/dropped messages at the head of the batch,
+ * returns the result that applies to the remaining ones */
+static LogThreadedResult
+_batch_apply_results(PythonDestDriver *self, LogThreadedResult *results, gsize num_results)
+{
+  LogThreadedResult run_result = LTR_SUCCESS;
+  gint run_length = 0;
+
+  for (gsize i = 0; i < num_results; i++)
+    {
+      if (results[i] != LTR_SUCCESS && results[i] != LTR_DROP)
+        {
+          _batch_settle_run(self, run_result, run_length);
+          return results[i];
+        }
+
+      if (results[i] != run_result)
+        {
+          _batch_settle_run(self, run_result, run_length);
+          run_result = results[i];
+          run_length = 0;
+        }
+      run_length++;
+    }
+
+  _batch_settle_run(self, run_result, run_length);
+  return LTR_SUCCESS;
+}
+
+static LogThreadedResult
+_py_send_batch(PythonDestDriver *self)
+{
+  gsize num_messages = self->batch->len;
+  LogThreadedResult *results = g_new(LogThreadedResult, num_messages);
+  gsize *py_batch_indices = g_new(gsize, num_messages);
+  gsize py_batch_size = 0;
+  PyObject *py_batch;
+  LogThreadedResult result;
+
+  if (self->py.is_opened && !_py_invoke_is_opened(self) && !_py_invoke_open(self))
+    {
+      result = LTR_NOT_CONNECTED;
+      goto exit;
+    }
+
+  py_batch = PyList_New(0);
+  for (gsize i = 0; i < num_messages; i++)
+    {
+      PythonDestBatchItem *item = &g_array_index(self->batch, PythonDestBatchItem, i);
+      PyObject *msg_object;
+
+      if (!_py_construct_message(self, item->msg, item->seq_num, &msg_object))
+        {
+          results[i] = LTR_DROP;
+          continue;
+        }
+
+      PyList_Append(py_batch, msg_object);
+      Py_DECREF(msg_object);
+      py_batch_indices[py_batch_size++] = i;
+    }
+
+  if (py_batch_size > 0)
+    {
+      LogThreadedResult *py_results = g_new(LogThreadedResult, py_batch_size);
+
+      _py_invoke_send_batch(self, py_batch, py_results, py_batch_size);
+      for (gsize i = 0; i < py_batch_size; i++)
+        results[py_batch_indices[i]] = py_results[i];
+      g_free(py_results);
+    }
+  Py_DECREF(py_batch);
+
+  result = _batch_apply_results(self, results, num_messages);
+
+exit:
+  g_free(py_batch_indices);
+  g_free(results);
+  return result;
+}
+
 static LogThreadedResult
 python_dd_insert(LogThreadedDestDriver *d, LogMessage *msg)
 {
@@ -495,6 +704,9 @@ python_dd_insert(LogThreadedDestDriver *d, LogMessage *msg)
   PyObject *msg_object;
   PyGILState_STATE gstate;
 
+  if (self->py.send_batch)
+    return _batch_add(self, msg);
+
   gstate = PyGILState_Ensure();
   if (self->py.is_opened && !_py_invoke_is_opened(self))
     {
@@ -505,7 +717,7 @@ python_dd_insert(LogThreadedDestDriver *d, LogMessage *msg)
         }
     }
 
-  if (!_py_construct_message(self, msg, &msg_object))
+  if (!_py_construct_message(self, msg, self->super.worker.instance.seq_num, &msg_object))
     goto exit;
 
   result =_py_invoke_send(self, msg_object);
@@ -534,9 +746,17 @@ python_dd_flush(LogThreadedDestDriver *s)
   PythonDestDriver *self = (PythonDestDriver *)s;
   PyGILState_STATE gstate;
 
+  LogThreadedResult result = LTR_SUCCESS;
+
   gstate = PyGILState_Ensure();
-  LogThreadedResult result = _py_invoke_flush(self);
+  if (self->batch->len > 0)
+    result = _py_send_batch(self);
+  if (result == LTR_SUCCESS)
+    result = _py_invoke_flush(self);
   PyGILState_Release(gstate);
+
+  /* the messages that were not acknowledged are rewound/dropped by our caller */
+  _batch_clear(self);
   return result;
 };
 
@@ -639,6 +859,7 @@ python_dd_free(LogPipe *d)
   PyGILState_Release(gstate);
 
   value_pairs_unref(self->vp);
+  g_array_free(self->batch, TRUE);
 
   python_binding_clear(&self->binding);
   log_threaded_dest_driver_free(d);
@@ -651,6 +872,8 @@ python_dd_new(GlobalConfig *cfg)
 
   log_threaded_dest_driver_init_instance(&self->super, cfg);
   log_template_options_defaults(&self->template_options);
+  self->batch = g_array_new(FALSE, FALSE, sizeof(PythonDestBatchItem));
+  g_array_set_clear_func(self->batch, (GDestroyNotify) _batch_item_clear);
 
   self->super.super.super.super.init = python_dd_init;
   self->super.super.super.super.deinit = python_dd_deinit;
@@ -35,16 +35,26 @@
 
 #include <structmember.h>
 
+typedef struct _PythonFetcherPrefetchedMessage
+{
+  LogMessage *msg;
+  PyObject *bookmark_data;
+} PythonFetcherPrefetchedMessage;
+
 typedef struct _PythonFetcherDriver
 {
   LogThreadedFetcherDriver super;
   PythonBinding binding;
 
+  /* messages returned by fetch_batch() that were not posted yet */
+  GQueue *prefetched;
+
   struct
   {
     PyObject *class;
     PyObject *instance;
     PyObject *fetch_method;
+    PyObject *fetch_batch_method;
     PyObject *open_method;
     PyObject *close_method;
     PyObject *request_exit_method;
@@ -178,7 +188,7 @@ _py_fetcher_get_ack_tracker(PythonFetcherDriver *self)
 }
 
 static gboolean
-_py_fetcher_fill_bookmark(PythonFetcherDriver *self, PyLogMessage *pymsg)
+_py_fetcher_fill_bookmark(PythonFetcherDriver *self, PyObject *bookmark_data)
 {
   if (!self->py.ack_tracker_factory)
     {
@@ -196,7 +206,7 @@ _py_fetcher_fill_bookmark(PythonFetcherDriver *self, PyLogMessage *pymsg)
   bookmark = ack_tracker_request_bookmark(ack_tracker);
   Py_END_ALLOW_THREADS
 
-  PyBookmark *py_bookmark = py_bookmark_new(pymsg->bookmark_data, self->py.ack_tracker_factory->ack_callback);
+  PyBookmark *py_bookmark = py_bookmark_new(bookmark_data, self->py.ack_tracker_factory->ack_callback);
   py_bookmark_fill(bookmark, py_bookmark);
   Py_XDECREF(py_bookmark);
 
@@ -227,7 +237,7 @@ _py_invoke_fetch(PythonFetcherDriver *self, LogMessage **msg)
 
       if (pymsg->bookmark_data && pymsg->bookmark_data != Py_None)
         {
-          if (!_py_fetcher_fill_bookmark(self, pymsg))
+          if (!_py_fetcher_fill_bookmark(self, pymsg->bookmark_data))
             {
               Py_XDECREF(ret);
               return THREADED_FETCH_ERROR;
@@ -253,6 +263,152 @@ error:
   return THREADED_FETCH_ERROR;
 }
 
+/*
+ * Batched fetching via fetch_batch()
+ *
+ * fetch_batch(max_messages) returns a (FetchResult, [LogMessage, ...])
+ * tuple.  The messages are queued up and returned one by one by subsequent
+ * fetch() calls, which only need the GIL if the message carries bookmark
+ * data: bookmarks have to be requested right before the message is posted.
+ *
+ * max_messages is the free space in the flow-control window, so whatever
+ * is still queued when the fetcher thread stops can be posted right away,
+ * see python_fetcher_thread_deinit().
+ */
+static void
+_prefetched_message_free(PythonFetcherPrefetchedMessage *self)
+{
+  log_msg_unref(self->msg);
+  Py_XDECREF(self->bookmark_data);
+  g_free(self);
+}
+
+static void
+_py_fetcher_push_prefetched(PythonFetcherDriver *self, PyLogMessage *pymsg)
+{
+  PythonFetcherPrefetchedMessage *prefetched = g_new0(PythonFetcherPrefetchedMessage, 1);
+
+  prefetched->msg = log_msg_ref(pymsg->msg);
+  if (pymsg->bookmark_data && pymsg->bookmark_data != Py_None)
+    {
+      Py_INCREF(pymsg->bookmark_data);
+      prefetched->bookmark_data = pymsg->bookmark_data;
+    }
+  g_queue_push_tail(self->prefetched, prefetched);
+}
+
+/* NOTE: needs the GIL if the message at the head of the queue has bookmark data */
+static ThreadedFetchResult
+_py_fetcher_pop_prefetched(PythonFetcherDriver *self, LogMessage **msg)
+{
+  PythonFetcherPrefetchedMessage *prefetched = g_queue_pop_head(self->prefetched);
+
+  if (prefetched->bookmark_data && !_py_fetcher_fill_bookmark(self, prefetched->bookmark_data))
+    {
+      _prefetched_message_free(prefetched);
+      return THREADED_FETCH_ERROR;
+    }
+
+  *msg = log_msg_ref(prefetched->msg);
+  _prefetched_message_free(prefetched);
+  return THREADED_FETCH_SUCCESS;
+}
+
+static gboolean
+_py_fetcher_has_prefetched_bookmark(PythonFetcherDriver *self)
+{
+  PythonFetcherPrefetchedMessage *prefetched = g_queue_peek_head(self->prefetched);
+
+  return prefetched->bookmark_data != NULL;
+}
+
+static void
+_py_fetcher_clear_prefetched(PythonFetcherDriver *self)
+{
+  PythonFetcherPrefetchedMessage *prefetched;
+
+  while ((prefetched = g_queue_pop_head(self->prefetched)))
+    _prefetched_message_free(prefetched);
+}
+
+static gboolean
+_py_queue_fetched_batch(PythonFetcherDriver *self, PyObject *py_batch)
+{
+  PyObject *seq = PySequence_Fast(py_batch, "fetch_batch() must return a list of LogMessage instances");
+  if (!seq)
+    return FALSE;
+
+  Py_ssize_t batch_size = PySequence_Fast_GET_SIZE(seq);
+  for (Py_ssize_t i = 0; i < batch_size; i++)
+    {
+      if (!py_is_log_message(PySequence_Fast_GET_ITEM(seq, i)))
+        {
+          Py_DECREF(seq);
+          return FALSE;
+        }
+    }
+
+  for (Py_ssize_t i = 0; i < batch_size; i++)
+    _py_fetcher_push_prefetched(self, (PyLogMessage *) PySequence_Fast_GET_ITEM(seq, i));
+
+  Py_DECREF(seq);
+  return TRUE;
+}
+
+static gsize
+_py_fetcher_get_free_window(PythonFetcherDriver *self)
+{
+  LogThreadedSourceWorker *worker = self->super.super.workers[0];
+
+  return window_size_counter_get(&worker->super.window_size, NULL);
+}
+
+static ThreadedFetchResult
+_py_invoke_fetch_batch(PythonFetcherDriver *self, LogMessage **msg)
+{
+  PyObject *max_messages = PyLong_FromSize_t(_py_fetcher_get_free_window(self));
+  PyObject *ret = _py_invoke_function(self->py.fetch_batch_method, max_messages, self->binding.class,
+                                      self->super.super.super.super.id);
+  Py_DECREF(max_messages);
+
+  if (!ret || !PyTuple_Check(ret) || PyTuple_Size(ret) > 2)
+    goto error;
+
+  PyObject *result = PyTuple_GetItem(ret, 0);
+  if (!result || !PyLong_Check(result))
+    goto error;
+
+  ThreadedFetchResult fetch_result;
+  if (!_ulong_to_fetch_result(PyLong_AsUnsignedLong(result), &fetch_result))
+    goto error;
+
+  if (fetch_result == THREADED_FETCH_SUCCESS)
+    {
+      PyObject *py_batch = PyTuple_GetItem(ret, 1);
+      if (!py_batch || !_py_queue_fetched_batch(self, py_batch))
+        goto error;
+
+      if (g_queue_is_empty(self->prefetched))
+        fetch_result = THREADED_FETCH_NO_DATA;
+      else
+        fetch_result = _py_fetcher_pop_prefetched(self, msg);
+    }
+
+  Py_XDECREF(ret);
+  PyErr_Clear();
+  return fetch_result;
+
+error:
+  msg_error("python-fetcher: Error in Python fetcher, fetch_batch() must return a tuple (FetchResult, [LogMessage, ...])",
+            evt_tag_str("driver", self->super.super.super.super.id),
+            evt_tag_str("class", self->binding.class));
+
+  Py_XDECREF(ret);
+  PyErr_Clear();
+
+  return THREADED_FETCH_ERROR;
+}
+
 static gboolean
 _py_is_log_fetcher(PyObject *obj)
 {
@@ -269,6 +425,7 @@ _py_free_bindings(PythonFetcherDriver *self)
   Py_CLEAR(self->py.class);
   Py_CLEAR(self->py.instance);
   Py_CLEAR(self->py.fetch_method);
+  Py_CLEAR(self->py.fetch_batch_method);
   Py_CLEAR(self->py.open_method);
   Py_CLEAR(self->py.close_method);
   Py_CLEAR(self->py.request_exit_method);
@@ -357,6 +514,7 @@ _py_init_methods(PythonFetcherDriver *self)
   if (!_py_lookup_fetch_method(self))
     return FALSE;
 
+  self->py.fetch_batch_method = _py_get_attr_or_null(self->py.instance, "fetch_batch");
   self->py.request_exit_method = _py_get_attr_or_null(self->py.instance, "request_exit");
   self->py.open_method = _py_get_attr_or_null(self->py.instance, "open");
   self->py.close_method = _py_get_attr_or_null(self->py.instance, "close");
@@ -575,10 +733,28 @@ python_fetcher_fetch(LogThreadedFetcherDriver *s)
   PythonFetcherDriver *self = (PythonFetcherDriver *) s;
   LogThreadedFetchResult fetch_result;
 
+  if (!g_queue_is_empty(self->prefetched) && !_py_fetcher_has_prefetched_bookmark(self))
+    {
+      LogMessage *msg = NULL;
+      ThreadedFetchResult result = _py_fetcher_pop_prefetched(self, &msg);
+
+      return (LogThreadedFetchResult)
+      {
+        result, msg
+      };
+    }
+
   PyGILState_STATE gstate = PyGILState_Ensure();
   {
     LogMessage *msg = NULL;
-    ThreadedFetchResult result = _py_invoke_fetch(self, &msg);
+    ThreadedFetchResult result;
+
+    if (!g_queue_is_empty(self->prefetched))
+      result = _py_fetcher_pop_prefetched(self, &msg);
+    else if (self->py.fetch_batch_method)
+      result = _py_invoke_fetch_batch(self, &msg);
+    else
+      result = _py_invoke_fetch(self, &msg);
 
     fetch_result = (LogThreadedFetchResult)
     {
@@ -590,6 +766,42 @@ python_fetcher_fetch(LogThreadedFetcherDriver *s)
   return fetch_result;
 }
 
+/* NOTE: runs in the fetcher thread after it stopped fetching, the pipeline
+ * is still running at this point */
+static void
+python_fetcher_thread_deinit(LogThreadedFetcherDriver *s)
+{
+  PythonFetcherDriver *self = (PythonFetcherDriver *) s;
+  LogThreadedSourceWorker *worker = self->super.super.workers[0];
+
+  while (!g_queue_is_empty(self->prefetched) && log_threaded_source_worker_free_to_send(worker))
+    {
+      LogMessage *msg = NULL;
+      ThreadedFetchResult result;
+
+      if (_py_fetcher_has_prefetched_bookmark(self))
+        {
+          PyGILState_STATE gstate = PyGILState_Ensure();
+          result = _py_fetcher_pop_prefetched(self, &msg);
+          PyGILState_Release(gstate);
+        }
+      else
+        {
+          result = _py_fetcher_pop_prefetched(self, &msg);
+        }
+
+      if (result == THREADED_FETCH_SUCCESS)
+        log_threaded_source_worker_post(worker, msg);
+    }
+
+  if (!g_queue_is_empty(self->prefetched))
+    msg_error("python-fetcher: fetch_batch() returned more messages than max_messages, "
+              "dropping the ones that did not fit into the flow-control window",
+              evt_tag_str("driver", self->super.super.super.super.id),
+              evt_tag_str("class", self->binding.class),
+              evt_tag_int("dropped", g_queue_get_length(self->prefetched)));
+}
+
 static const gchar *
 python_fetcher_format_persist_name(const LogPipe *s)
 {
@@ -653,8 +865,10 @@ python_fetcher_free(LogPipe *s)
   PythonFetcherDriver *self = (PythonFetcherDriver *) s;
 
   PyGILState_STATE gstate = PyGILState_Ensure();
+  _py_fetcher_clear_prefetched(self);
   _py_free_bindings(self);
   PyGILState_Release(gstate);
+  g_queue_free(self->prefetched);
 
   python_binding_clear(&self->binding);
   log_threaded_fetcher_driver_free_method(s);
@@ -666,9 +880,11 @@ python_fetcher_new(GlobalConfig *cfg)
   PythonFetcherDriver *self = g_new0(PythonFetcherDriver, 1);
 
   log_threaded_fetcher_driver_init_instance(&self->super, cfg);
+  self->prefetched = g_queue_new();
   self->super.super.super.super.super.init = python_fetcher_init;
   self->super.super.super.super.super.deinit = python_fetcher_deinit;
   self->super.super.super.super.super.free_fn = python_fetcher_free;
+  self->super.thread_deinit = python_fetcher_thread_deinit;
   self->super.super.super.super.super.generate_persist_name = python_fetcher_format_persist_name;
 
   self->super.super.format_stats_key = python_fetcher_format_stats_key;
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ */
+
+/* this has to come first for modules which include the Python.h header */
+#include "python-module.h"
+
+#include <criterion/criterion.h>
+
+#include "python-helpers.h"
+#include "python-dest.h"
+#include "python-fetcher.h"
+#include "python-main.h"
+#include "python-startup.h"
+#include "python-global.h"
+#include "logthrdest/logthrdestdrv.h"
+#include "logthrsource/logthrsourcedrv.h"
+#include "mainloop-worker.h"
+#include "mainloop.h"
+#include "apphook.h"
+
+#define MAX_SPIN_ITERATIONS 10000
+
+static MainLoop *main_loop;
+static MainLoopOptions main_loop_options = {0};
+static GlobalConfig *cfg;
+
+CFG_LTYPE yyltype;
+
+static void
+_load_code(const gchar *code)
+{
+  PyGILState_STATE gstate;
+  gstate = PyGILState_Ensure();
+  cr_assert(python_evaluate_global_code(cfg, code, &yyltype));
+  PyGILState_Release(gstate);
+}
+
+static void
+_sleep_msec(long msec)
+{
+  struct timespec sleep_time = { msec / 1000, (msec % 1000) * 1000000 };
+  nanosleep(&sleep_time, NULL);
+}
+
+static void
+_spin_for_counter_value(StatsCounterItem *counter, gssize expected_value)
+{
+  gssize value = stats_counter_get(counter);
+
+  for (gint c = 0; value != expected_value && c < MAX_SPIN_ITERATIONS; c++)
+    {
+      _sleep_msec(1);
+      value = stats_counter_get(counter);
+    }
+  cr_assert_eq(value, expected_value,
+               "counter did not reach the expected value, expected_value=%" G_GSSIZE_FORMAT
+               ", value=%" G_GSSIZE_FORMAT, expected_value, value);
+}
+
+/*
+ * python destinations
+ */
+
+static LogThreadedDestDriver *
+_create_dest(const gchar *class, gint batch_lines)
+{
+  LogDriver *d = python_dd_new(cfg);
+  LogThreadedDestDriver *dd = (LogThreadedDestDriver *) d;
+
+  python_binding_set_class(python_dd_get_binding(d), (gchar *) class);
+  log_threaded_dest_driver_set_batch_lines(d, batch_lines);
+  dd->worker.instance.time_reopen = 0;
+
+  cr_assert(log_pipe_init(&d->super));
+  return dd;
+}
+
+static void
+_start_dest(LogThreadedDestDriver *dd)
+{
+  cr_assert(log_pipe_post_config_init(&dd->super.super.super));
+}
+
+static void
+_destroy_dest(LogThreadedDestDriver *dd)
+{
+  main_loop_sync_worker_startup_and_teardown();
+  log_pipe_deinit(&dd->super.super.super);
+  log_pipe_unref(&dd->super.super.super);
+}
+
+static void
+_send_messages(LogThreadedDestDriver *dd, gint num_messages)
+{
+  for (gint i = 0; i < num_messages; i++)
+    {
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT_NOACK;
+      LogMessage *msg = log_msg_new_empty();
+      gchar value[16];
+
+      g_snprintf(value, sizeof(value), "%d", i);
+      log_msg_set_value(msg, LM_V_MESSAGE, value, -1);
+      log_pipe_queue(&dd->super.super.super, msg, &path_options);
+    }
+}
+
+const gchar *batch_dest_code = "\n\
+from _syslogng import LogDestination, LogDestinationResult\n\
+batches = []\n\
+class BatchDest(LogDestination):\n\
+    def send(self, msg):\n\
+        raise Exception('send() should not be called when send_batch() is implemented')\n\
+    def send_batch(self, msgs):\n\
+        batches.append([int(msg['MESSAGE']) for msg in msgs])\n\
+        return LogDestinationResult.SUCCESS";
+
+Test(python_batch, test_send_batch_acks_whole_batches)
+{
+  _load_code(batch_dest_code);
+
+  LogThreadedDestDriver *dd = _create_dest("BatchDest", 5);
+  _start_dest(dd);
+  _send_messages(dd, 12);
+  _spin_for_counter_value(dd->metrics.written_messages, 12);
+  cr_assert_eq(stats_counter_get(dd->metrics.dropped_messages), 0);
+  _destroy_dest(dd);
+
+  _load_code("assert sum(batches, []) == list(range(12)), batches");
+  _load_code("assert max(len(batch) for batch in batches) <= 5, batches");
+}
+
+/* message #1 is dropped, message #2 fails once, messages after the failure
+ * are resent together with it */
+const gchar *partial_failure_dest_code = "\n\
+from _syslogng import LogDestination, LogDestinationResult\n\
+batches = []\n\
+class PartialFailureDest(LogDestination):\n\
+    def send_batch(self, msgs):\n\
+        ids = [int(msg['MESSAGE']) for msg in msgs]\n\
+        results = []\n\
+        for i in ids:\n\
+            if i == 1:\n\
+                results.append(LogDestinationResult.DROP)\n\
+            elif i == 2 and 2 not in sum(batches, []):\n\
+                results.append(LogDestinationResult.ERROR)\n\
+            else:\n\
+                results.append(LogDestinationResult.SUCCESS)\n\
+        batches.append(ids)\n\
+        return results";
+
+Test(python_batch, test_send_batch_partial_failure_retries_the_rest_of_the_batch)
+{
+  _load_code(partial_failure_dest_code);
+
+  LogThreadedDestDriver *dd = _create_dest("PartialFailureDest", 5);
+
+  /* queued before the worker starts, so they end up in a single batch */
+  _send_messages(dd, 5);
+  _start_dest(dd);
+  _spin_for_counter_value(dd->metrics.written_messages, 4);
+  cr_assert_eq(stats_counter_get(dd->metrics.dropped_messages), 1);
+  _destroy_dest(dd);
+
+  _load_code("assert batches == [[0, 1, 2, 3, 4], [2, 3, 4]], batches");
+}
+
+const gchar *single_dest_code = "\n\
+from _syslogng import LogDestination\n\
+sent = []\n\
+class SingleDest(LogDestination):\n\
+    def send(self, msg):\n\
+        sent.append(int(msg['MESSAGE']))\n\
+        return True";
+
+Test(python_batch, test_destination_without_send_batch_sends_messages_one_by_one)
+{
+  _load_code(single_dest_code);
+
+  LogThreadedDestDriver *dd = _create_dest("SingleDest", 5);
+  _start_dest(dd);
+  _send_messages(dd, 12);
+  _spin_for_counter_value(dd->metrics.written_messages, 12);
+  _destroy_dest(dd);
+
+  _load_code("assert sent == list(range(12)), sent");
+}
+
+/*
+ * python fetchers
+ */
+
+typedef struct _CapturePipe
+{
+  LogPipe super;
+  GMutex lock;
+  GPtrArray *messages;
+  gboolean ack;
+} CapturePipe;
+
+static void
+_capture_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  CapturePipe *self = (CapturePipe *) s;
+
+  g_mutex_lock(&self->lock);
+  g_ptr_array_add(self->messages, msg);
+  gboolean ack = self->ack;
+  g_mutex_unlock(&self->lock);
+
+  if (ack)
+    log_msg_ack(msg, path_options, AT_PROCESSED);
+}
+
+static guint
+_capture_pipe_count(CapturePipe *self)
+{
+  g_mutex_lock(&self->lock);
+  guint count = self->messages->len;
+  g_mutex_unlock(&self->lock);
+  return count;
+}
+
+static void
+_capture_pipe_ack_all(CapturePipe *self)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  path_options.ack_needed = TRUE;
+  g_mutex_lock(&self->lock);
+  self->ack = TRUE;
+  for (guint i = 0; i < self->messages->len; i++)
+    log_msg_ack(g_ptr_array_index(self->messages, i), &path_options, AT_PROCESSED);
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+_capture_pipe_free(LogPipe *s)
+{
+  CapturePipe *self = (CapturePipe *) s;
+
+  g_ptr_array_free(self->messages, TRUE);
+  g_mutex_clear(&self->lock);
+  log_pipe_free_method(s);
+}
+
+static CapturePipe *
+_capture_pipe_new(void)
+{
+  CapturePipe *self = g_new0(CapturePipe, 1);
+
+  log_pipe_init_instance(&self->super, cfg);
+  self->super.queue = _capture_pipe_queue;
+  self->super.free_fn = _capture_pipe_free;
+  self->messages = g_ptr_array_new_with_free_func((GDestroyNotify) log_msg_unref);
+  g_mutex_init(&self->lock);
+  cr_assert(log_pipe_init(&self->super));
+  return self;
+}
+
+static void
+_wait_for_captured_messages(CapturePipe *capture, guint expected)
+{
+  guint count = _capture_pipe_count(capture);
+
+  for (gint c = 0; count != expected && c < MAX_SPIN_ITERATIONS; c++)
+    {
+      _sleep_msec(1);
+      count = _capture_pipe_count(capture);
+    }
+  cr_assert_eq(count, expected, "expected %u messages, got %u", expected, count);
+}
+
+static void
+_assert_captured_messages_in_order(CapturePipe *capture)
+{
+  for (guint i = 0; i < capture->messages->len; i++)
+    {
+      gchar expected[16];
+
+      g_snprintf(expected, sizeof(expected), "%u", i);
+      cr_assert_str_eq(log_msg_get_value(g_ptr_array_index(capture->messages, i), LM_V_MESSAGE, NULL), expected);
+    }
+}
+
+const gchar *batch_fetcher_code = "\n\
+from _syslogng import LogFetcher, LogFetcherResult, LogMessage\n\
+max_messages_seen = []\n\
+next_id = 0\n\
+class BatchFetcher(LogFetcher):\n\
+    def fetch(self):\n\
+        raise Exception('fetch() should not be called when fetch_batch() is implemented')\n\
+    def fetch_batch(self, max_messages):\n\
+        global next_id\n\
+        max_messages_seen.append(max_messages)\n\
+        n = min(3, max_messages, 10 - next_id)\n\
+        if n == 0:\n\
+            return LogFetcherResult.NO_DATA, []\n\
+        batch = [LogMessage(str(i)) for i in range(next_id, next_id + n)]\n\
+        next_id += n\n\
+        return LogFetcherResult.SUCCESS, batch";
+
+Test(python_batch, test_fetch_batch_is_limited_by_the_flow_control_window)
+{
+  _load_code(batch_fetcher_code);
+
+  LogDriver *d = python_fetcher_new(cfg);
+  CapturePipe *capture = _capture_pipe_new();
+
+  python_binding_set_class(python_fetcher_get_binding(d), "BatchFetcher");
+  log_threaded_source_driver_get_source_options(d)->init_window_size = 4;
+  log_pipe_append(&d->super, &capture->super);
+  cr_assert(log_pipe_init(&d->super));
+  cr_assert(log_pipe_post_config_init(&d->super));
+
+  /* nothing is acked, the fetcher stops once the window is used up */
+  _wait_for_captured_messages(capture, 4);
+  _sleep_msec(100);
+  cr_assert_eq(_capture_pipe_count(capture), 4);
+  _load_code("assert max_messages_seen == [4, 1], max_messages_seen");
+
+  _capture_pipe_ack_all(capture);
+  _wait_for_captured_messages(capture, 10);
+
+  main_loop_sync_worker_startup_and_teardown();
+  log_pipe_deinit(&d->super);
+  log_pipe_unref(&d->super);
+
+  _assert_captured_messages_in_order(capture);
+  _load_code("assert all(0 < m <= 4 for m in max_messages_seen), max_messages_seen");
+
+  log_pipe_deinit(&capture->super);
+  log_pipe_unref(&capture->super);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+
+  main_loop = main_loop_get_instance();
+  main_loop_init(main_loop, &main_loop_options);
+  cfg = main_loop_get_current_config(main_loop);
+  cfg_set_current_version(cfg);
+  main_loop_worker_allocate_thread_space(2);
+  main_loop_worker_finalize_thread_space();
+
+  _py_init_interpreter(FALSE);
+}
+
+static void
+teardown(void)
+{
+  main_loop_deinit(main_loop);
+  app_shutdown();
+}
+
+TestSuite(python_batch, .init = setup, .fini = teardown);
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "syslog-format-scan.h"
+
+#include <string.h>
+
+/*
+ * Delimiter scanning used by the syslog parser to find the end of header
+ * fields (spaces, brackets, quotes, etc).
+ *
+ * The vectorized implementations process the input in 16 (SSE4.2) or 32
+ * (AVX2) byte blocks and only ever load full blocks, the remaining tail is
+ * handled by the scalar implementation.  The implementation is selected at
+ * runtime, based on the features of the CPU we are running on, as we are
+ * compiled for the baseline of the architecture.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SYSLOG_FORMAT_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+typedef gsize (*SyslogFormatScanFunc)(const guchar *data, gsize len, const SyslogFormatScanSet *set);
+
+static inline gboolean
+_is_stop_char(guchar c, const SyslogFormatScanSet *set)
+{
+  /* delims are padded to SYSLOG_FORMAT_SCAN_MAX_DELIMS by syslog_format_scan_set_init() */
+  return c == set->delims[0] || c == set->delims[1] || c == set->delims[2] || c == set->delims[3] ||
+         (set->stop_at_non_ascii && c >= 0x80);
+}
+
+static gsize
+_scan_scalar(const guchar *data, gsize len, const SyslogFormatScanSet *set)
+{
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    {
+      if (_is_stop_char(data[i], set))
+        break;
+    }
+  return i;
+}
+
+#if SYSLOG_FORMAT_SCAN_X86
+
+__attribute__((target("sse4.2")))
+static gsize
+_scan_sse42(const guchar *data, gsize len, const SyslogFormatScanSet *set)
+{
+  guint32 packed_delims;
+  gsize i = 0;
+
+  memcpy(&packed_delims, set->delims, sizeof(packed_delims));
+  __m128i delims = _mm_cvtsi32_si128(packed_delims);
+
+  for (; i + 16 <= len; i += 16)
+    {
+      __m128i block = _mm_loadu_si128((const __m128i *) (data + i));
+      gint pos = _mm_cmpestri(delims, set->num_delims, block, 16,
+                              _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+
+      if (set->stop_at_non_ascii)
+        {
+          guint32 non_ascii = _mm_movemask_epi8(block);
+
+          if (non_ascii)
+            pos = MIN(pos, __builtin_ctz(non_ascii));
+        }
+
+      if (pos < 16)
+        return i + pos;
+    }
+  return i + _scan_scalar(data + i, len - i, set);
+}
+
+__attribute__((target("avx2")))
+static gsize
+_scan_avx2(const guchar *data, gsize len, const SyslogFormatScanSet *set)
+{
+  __m256i delim0 = _mm256_set1_epi8(set->delims[0]);
+  __m256i delim1 = _mm256_set1_epi8(set->delims[1]);
+  __m256i delim2 = _mm256_set1_epi8(set->delims[2]);
+  __m256i delim3 = _mm256_set1_epi8(set->delims[3]);
+  gsize i = 0;
+
+  for (; i + 32 <= len; i += 32)
+    {
+      __m256i block = _mm256_loadu_si256((const __m256i *) (data + i));
+      __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, delim0),
+                                                     _mm256_cmpeq_epi8(block, delim1)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(block, delim2),
+                                                     _mm256_cmpeq_epi8(block, delim3)));
+      guint32 mask = (guint32) _mm256_movemask_epi8(hits);
+
+      /* the sign bit of each byte is set for non-ASCII characters */
+      if (set->stop_at_non_ascii)
+        mask |= (guint32) _mm256_movemask_epi8(block);
+
+      if (mask)
+        return i + __builtin_ctz(mask);
+    }
+  return i + _scan_sse42(data + i, len - i, set);
+}
+
+#endif
+
+static SyslogFormatScanImpl scan_impl = SYSLOG_FORMAT_SCAN_SCALAR;
+static SyslogFormatScanFunc scan_func = _scan_scalar;
+
+void
+syslog_format_scan_set_init(SyslogFormatScanSet *self, const gchar *delims, gboolean stop_at_non_ascii)
+{
+  gint len = strlen(delims);
+
+  g_assert(len > 0 && len <= SYSLOG_FORMAT_SCAN_MAX_DELIMS);
+
+  for (gint i = 0; i < SYSLOG_FORMAT_SCAN_MAX_DELIMS; i++)
+    self->delims[i] = i < len ? delims[i] : delims[0];
+  self->num_delims = len;
+  self->stop_at_non_ascii = stop_at_non_ascii;
+}
+
+gsize
+syslog_format_scan(const guchar *data, gsize len, const SyslogFormatScanSet *set)
+{
+  return scan_func(data, len, set);
+}
+
+static gboolean
+_is_impl_supported(SyslogFormatScanImpl impl)
+{
+  switch (impl)
+    {
+    case SYSLOG_FORMAT_SCAN_SCALAR:
+      return TRUE;
+#if SYSLOG_FORMAT_SCAN_X86
+    case SYSLOG_FORMAT_SCAN_SSE42:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2");
+    case SYSLOG_FORMAT_SCAN_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+#endif
+    default:
+      return FALSE;
+    }
+}
+
+gboolean
+syslog_format_scan_select_impl(SyslogFormatScanImpl impl)
+{
+  if (!_is_impl_supported(impl))
+    return FALSE;
+
+  switch (impl)
+    {
+#if SYSLOG_FORMAT_SCAN_X86
+    case SYSLOG_FORMAT_SCAN_SSE42:
+      scan_func = _scan_sse42;
+      break;
+    case SYSLOG_FORMAT_SCAN_AVX2:
+      scan_func = _scan_avx2;
+      break;
+#endif
+    default:
+      scan_func = _scan_scalar;
+      break;
+    }
+  scan_impl = impl;
+  return TRUE;
+}
+
+SyslogFormatScanImpl
+syslog_format_scan_get_impl(void)
+{
+  return scan_impl;
+}
+
+void
+syslog_format_scan_init(void)
+{
+  if (syslog_format_scan_select_impl(SYSLOG_FORMAT_SCAN_AVX2))
+    return;
+  if (syslog_format_scan_select_impl(SYSLOG_FORMAT_SCAN_SSE42))
+    return;
+  syslog_format_scan_select_impl(SYSLOG_FORMAT_SCAN_SCALAR);
+}
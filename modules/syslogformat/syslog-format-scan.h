@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef SYSLOG_FORMAT_SCAN_H_INCLUDED
+#define SYSLOG_FORMAT_SCAN_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/* maximum number of delimiters accepted by syslog_format_scan() */
+#define SYSLOG_FORMAT_SCAN_MAX_DELIMS 4
+
+typedef enum
+{
+  SYSLOG_FORMAT_SCAN_SCALAR,
+  SYSLOG_FORMAT_SCAN_SSE42,
+  SYSLOG_FORMAT_SCAN_AVX2,
+} SyslogFormatScanImpl;
+
+/*
+ * A delimiter set, as used by syslog_format_scan(). Initialize it once
+ * using syslog_format_scan_set_init(), as the vectorized implementations
+ * use the expanded representation.
+ */
+typedef struct _SyslogFormatScanSet
+{
+  guchar delims[SYSLOG_FORMAT_SCAN_MAX_DELIMS];
+  gint num_delims;
+  gboolean stop_at_non_ascii;
+} SyslogFormatScanSet;
+
+void syslog_format_scan_set_init(SyslogFormatScanSet *self, const gchar *delims, gboolean stop_at_non_ascii);
+
+/*
+ * Returns the offset of the first character in @data that is either one
+ * of the delimiters in @set or a non-ASCII character if requested, @len if
+ * none is found.
+ */
+gsize syslog_format_scan(const guchar *data, gsize len, const SyslogFormatScanSet *set);
+
+gboolean syslog_format_scan_select_impl(SyslogFormatScanImpl impl);
+SyslogFormatScanImpl syslog_format_scan_get_impl(void);
+void syslog_format_scan_init(void);
+
+#endif
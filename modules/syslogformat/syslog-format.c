@@ -22,6 +22,7 @@
  */
 
 #include "syslog-format.h"
+#include "syslog-format-scan.h"
 #include "timeutils/scan-timestamp.h"
 #include "timeutils/conv.h"
 #include "logmsg/logmsg.h"
@@ -51,6 +52,35 @@ static struct
   NVHandle cisco_seqid;
 } handles;
 
+static struct
+{
+  SyslogFormatScanSet program_name_end;
+  SyslogFormatScanSet pid_end;
+  SyslogFormatScanSet hostname_end;
+  SyslogFormatScanSet sd_name_end;
+  SyslogFormatScanSet sd_quoted_value_special;
+  SyslogFormatScanSet sd_unquoted_value_end;
+} scan_sets;
+
+static void
+_init_scan_sets(void)
+{
+  syslog_format_scan_set_init(&scan_sets.program_name_end, " [:", FALSE);
+  syslog_format_scan_set_init(&scan_sets.pid_end, " ]:", FALSE);
+  syslog_format_scan_set_init(&scan_sets.hostname_end, " [:", FALSE);
+  /* SD-NAME is printable US-ASCII, except '=', SP, ']' and '"' */
+  syslog_format_scan_set_init(&scan_sets.sd_name_end, " ]=\"", TRUE);
+  syslog_format_scan_set_init(&scan_sets.sd_quoted_value_special, "\"\\]", FALSE);
+  syslog_format_scan_set_init(&scan_sets.sd_unquoted_value_end, " ]", FALSE);
+}
+
+static inline void
+_skip_scanned(const guchar **data, gint *left, gsize scanned)
+{
+  (*data) += scanned;
+  (*left) -= scanned;
+}
+
 static inline gboolean
 _skip_char(const guchar **data, gint *left)
 {
@@ -336,18 +366,12 @@ _syslog_format_parse_legacy_program_name(LogMessage *msg, const guchar **data, g
   src = *data;
   left = *length;
   prog_start = src;
-  while (left && *src != ' ' && *src != '[' && *src != ':')
-    {
-      _skip_char(&src, &left);
-    }
+  _skip_scanned(&src, &left, syslog_format_scan(src, left, &scan_sets.program_name_end));
   log_msg_set_value(msg, LM_V_PROGRAM, (gchar *) prog_start, src - prog_start);
   if (left > 0 && *src == '[')
     {
       const guchar *pid_start = src + 1;
-      while (left && *src != ' ' && *src != ']' && *src != ':')
-        {
-          _skip_char(&src, &left);
-        }
+      _skip_scanned(&src, &left, syslog_format_scan(src, left, &scan_sets.pid_end));
       if (left)
         {
           log_msg_set_value(msg, LM_V_PID, (gchar *) pid_start, src - pid_start);
@@ -406,6 +430,19 @@ _is_invalid_hostname_char(guchar c)
   return invalid_chars[c / 8] & (1 << (c % 8));
 }
 
+static gsize
+_find_invalid_hostname_char(const guchar *data, gsize len)
+{
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    {
+      if (_is_invalid_hostname_char(data[i]))
+        break;
+    }
+  return i;
+}
+
 typedef struct _IPv6Heuristics
 {
   gint8 current_segment;
@@ -469,21 +506,35 @@ _syslog_format_parse_hostname(LogMessage *msg, const guchar **data, gint *length
   oldsrc = src;
   oldleft = left;
 
-  while (left && *src != ' ' && *src != '[' && dst < sizeof(hostname_buf) - 1)
+  gsize max_len = MIN((gsize) left, sizeof(hostname_buf) - 1);
+  gsize span = syslog_format_scan(src, max_len, &scan_sets.hostname_end);
+  if (span == max_len || src[span] != ':')
     {
-      ipv6_heuristics_feed_gchar(&ipv6_heuristics, *src);
-
-      if (*src == ':' && ipv6_heuristics.heuristic_failed)
+      /* no colon in the hostname, the IPv6 heuristics has nothing to decide */
+      if (G_UNLIKELY(flags & LP_CHECK_HOSTNAME))
+        span = _find_invalid_hostname_char(src, span);
+      memcpy(hostname_buf, src, span);
+      dst = span;
+      _skip_scanned(&src, &left, span);
+    }
+  else
+    {
+      while (left && *src != ' ' && *src != '[' && dst < sizeof(hostname_buf) - 1)
         {
-          break;
-        }
+          ipv6_heuristics_feed_gchar(&ipv6_heuristics, *src);
 
-      if (G_UNLIKELY((flags & LP_CHECK_HOSTNAME) && _is_invalid_hostname_char(*src)))
-        {
-          break;
+          if (*src == ':' && ipv6_heuristics.heuristic_failed)
+            {
+              break;
+            }
+
+          if (G_UNLIKELY((flags & LP_CHECK_HOSTNAME) && _is_invalid_hostname_char(*src)))
+            {
+              break;
+            }
+          hostname_buf[dst++] = *src;
+          _skip_char(&src, &left);
         }
-      hostname_buf[dst++] = *src;
-      _skip_char(&src, &left);
     }
   hostname_buf[dst] = 0;
 
@@ -563,7 +614,7 @@ _syslog_format_parse_sd(LogMessage *msg, const guchar **data, gint *length, cons
   g_assert(options->sdata_prefix_len < SD_NAME_SIZE);
 
   guint open_sd = 0;
-  gint left = *length, pos;
+  gint left = *length, pos, max_pos;
 
   if (left && src[0] == '-')
     {
@@ -579,27 +630,19 @@ _syslog_format_parse_sd(LogMessage *msg, const guchar **data, gint *length, cons
           if (!left || !isascii(*src) || *src == '=' || *src == ' ' || *src == ']' || *src == '"')
             goto error;
           /* read sd_id */
-          pos = 0;
-          while (left && *src != ' ' && *src != ']')
+          max_pos = sizeof(sd_id_name) - 1 - options->sdata_prefix_len;
+          pos = syslog_format_scan(src, left, &scan_sets.sd_name_end);
+          if (pos > max_pos)
             {
-              if (pos < sizeof(sd_id_name) - 1 - options->sdata_prefix_len)
-                {
-                  if (isascii(*src) && *src != '=' && *src != ' ' && *src != ']' && *src != '"')
-                    {
-                      sd_id_name[pos] = *src;
-                      pos++;
-                    }
-                  else
-                    {
-                      goto error;
-                    }
-                }
-              else
-                {
-                  goto error;
-                }
-              _skip_char(&src, &left);
+              _skip_scanned(&src, &left, max_pos);
+              goto error;
             }
+          memcpy(sd_id_name, src, pos);
+          _skip_scanned(&src, &left, pos);
+
+          /* stopped at '=', '"' or a non-ASCII character */
+          if (left && *src != ' ' && *src != ']')
+            goto error;
 
           if (pos == 0)
             goto error;
@@ -636,25 +679,19 @@ _syslog_format_parse_sd(LogMessage *msg, const guchar **data, gint *length, cons
                 goto error;
 
               /* read sd-param */
-              pos = 0;
-              while (left && *src != '=')
+              max_pos = sizeof(sd_param_name) - 1 - sd_id_len;
+              pos = syslog_format_scan(src, left, &scan_sets.sd_name_end);
+              if (pos > max_pos)
                 {
-                  if (pos < sizeof(sd_param_name) - 1 - sd_id_len)
-                    {
-                      if (isascii(*src) && *src != '=' && *src != ' ' && *src != ']' && *src != '"')
-                        {
-                          sd_param_name[pos] = *src;
-                          pos++;
-                        }
-                      else
-                        goto error;
-                    }
-                  else
-                    {
-                      goto error;
-                    }
-                  _skip_char(&src, &left);
+                  _skip_scanned(&src, &left, max_pos);
+                  goto error;
                 }
+              memcpy(sd_param_name, src, pos);
+              _skip_scanned(&src, &left, pos);
+
+              /* stopped at SP, ']', '"' or a non-ASCII character */
+              if (left && *src != '=')
+                goto error;
               sd_param_name[pos] = 0;
               gsize sd_param_name_len = g_strlcpy(&sd_value_name[options->sdata_prefix_len + 1 + sd_id_len],
                                                   sd_param_name,
@@ -679,6 +716,20 @@ _syslog_format_parse_sd(LogMessage *msg, const guchar **data, gint *length, cons
 
                   while (left && (*src != '"' || quote))
                     {
+                      if (!quote)
+                        {
+                          /* copy the run of characters that need no special treatment at once */
+                          gint run = syslog_format_scan(src, left, &scan_sets.sd_quoted_value_special);
+                          if (run > 0)
+                            {
+                              gint copy_len = MIN(run, (gint) sizeof(sd_param_value) - 1 - pos);
+                              memcpy(&sd_param_value[pos], src, copy_len);
+                              pos += copy_len;
+                              _skip_scanned(&src, &left, run);
+                              continue;
+                            }
+                        }
+
                       if (!quote && *src == '\\')
                         {
                           quote = TRUE;
@@ -714,17 +765,11 @@ _syslog_format_parse_sd(LogMessage *msg, const guchar **data, gint *length, cons
                 }
               else if (left)
                 {
-                  pos = 0;
+                  gint run = syslog_format_scan(src, left, &scan_sets.sd_unquoted_value_end);
 
-                  while (left && (*src != ' ' && *src != ']'))
-                    {
-                      if (pos < sizeof(sd_param_value) - 1)
-                        {
-                          sd_param_value[pos] = *src;
-                          pos++;
-                        }
-                      _skip_char(&src, &left);
-                    }
+                  pos = MIN(run, (gint) sizeof(sd_param_value) - 1);
+                  memcpy(sd_param_value, src, pos);
+                  _skip_scanned(&src, &left, run);
                   sd_param_value[pos] = 0;
                   sd_param_value_len = pos;
 
@@ -1183,4 +1228,6 @@ syslog_format_init(void)
     }
 
   _init_parse_hostname_invalid_chars();
+  _init_scan_sets();
+  syslog_format_scan_init();
 }
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include <criterion/criterion.h>
+
+#include "apphook.h"
+#include "cfg.h"
+#include "syslog-format.h"
+#include "syslog-format-scan.h"
+#include "logmsg/logmsg.h"
+#include "msg-format.h"
+#include "scratch-buffers.h"
+
+#include <string.h>
+
+GlobalConfig *cfg;
+MsgFormatOptions parse_options;
+
+static const SyslogFormatScanImpl all_impls[] =
+{
+  SYSLOG_FORMAT_SCAN_SCALAR,
+  SYSLOG_FORMAT_SCAN_SSE42,
+  SYSLOG_FORMAT_SCAN_AVX2,
+};
+
+static void
+setup(void)
+{
+  app_startup();
+  syslog_format_init();
+
+  cfg = cfg_new_snippet();
+  msg_format_options_defaults(&parse_options);
+  msg_format_options_init(&parse_options, cfg);
+}
+
+static void
+teardown(void)
+{
+  syslog_format_scan_init();
+  msg_format_options_destroy(&parse_options);
+  scratch_buffers_explicit_gc();
+  app_shutdown();
+  cfg_free(cfg);
+}
+
+TestSuite(syslog_format_scan, .init = setup, .fini = teardown);
+
+static void
+_fill_random_input(guchar *buf, gsize len, GRand *rand)
+{
+  const gchar interesting_chars[] = " []=\"\\:\x80\xff";
+
+  for (gsize i = 0; i < len; i++)
+    {
+      if (g_rand_int_range(rand, 0, 8) == 0)
+        buf[i] = interesting_chars[g_rand_int_range(rand, 0, sizeof(interesting_chars) - 1)];
+      else
+        buf[i] = 'a' + g_rand_int_range(rand, 0, 26);
+    }
+}
+
+Test(syslog_format_scan, test_vectorized_implementations_match_scalar)
+{
+  const gchar *delim_sets[] = { " ", " [:", " ]=\"", "\"\\]", "]" };
+  guchar buf[300];
+  GRand *rand = g_rand_new_with_seed(42);
+
+  for (gint iteration = 0; iteration < 10000; iteration++)
+    {
+      gsize len = g_rand_int_range(rand, 0, sizeof(buf));
+      _fill_random_input(buf, len, rand);
+
+      for (gint set_ndx = 0; set_ndx < G_N_ELEMENTS(delim_sets); set_ndx++)
+        {
+          for (gint non_ascii = 0; non_ascii < 2; non_ascii++)
+            {
+              SyslogFormatScanSet set;
+              syslog_format_scan_set_init(&set, delim_sets[set_ndx], non_ascii);
+
+              cr_assert(syslog_format_scan_select_impl(SYSLOG_FORMAT_SCAN_SCALAR));
+              gsize expected = syslog_format_scan(buf, len, &set);
+
+              for (gint i = 0; i < G_N_ELEMENTS(all_impls); i++)
+                {
+                  if (!syslog_format_scan_select_impl(all_impls[i]))
+                    continue;
+
+                  cr_assert_eq(syslog_format_scan(buf, len, &set), expected,
+                               "scan result mismatch, impl=%d, delims=[%s], non_ascii=%d, len=%" G_GSIZE_FORMAT,
+                               all_impls[i], delim_sets[set_ndx], non_ascii, len);
+                }
+            }
+        }
+    }
+  g_rand_free(rand);
+}
+
+static GString *
+_parse_and_dump(const gchar *data, guint32 flags)
+{
+  GString *result = g_string_new("");
+  LogMessage *msg = log_msg_new_empty();
+  gsize problem_position = 0;
+  NVHandle handles[] = { LM_V_HOST, LM_V_PROGRAM, LM_V_PID, LM_V_MSGID, LM_V_MESSAGE, LM_V_LEGACY_MSGHDR };
+
+  parse_options.flags = flags;
+  gboolean success = syslog_format_handler(&parse_options, msg, (const guchar *) data, strlen(data), &problem_position);
+
+  g_string_append_printf(result, "success=%d problem_position=%" G_GSIZE_FORMAT " flags=%x",
+                         success, problem_position, msg->flags);
+  for (gint i = 0; i < G_N_ELEMENTS(handles); i++)
+    {
+      gssize len;
+      const gchar *value = log_msg_get_value(msg, handles[i], &len);
+      g_string_append_printf(result, " %s=%.*s", log_msg_get_value_name(handles[i], NULL), (gint) len, value);
+    }
+  g_string_append(result, " SDATA=");
+  log_msg_append_format_sdata(msg, result, 0);
+
+  log_msg_unref(msg);
+  return result;
+}
+
+Test(syslog_format_scan, test_parsing_results_are_identical_with_all_implementations)
+{
+  const gchar *messages[] =
+  {
+    "<15>Jan  1 01:00:00 bzorp openvpn[2499]: PTHREAD support initialized",
+    "<15>Jan  1 01:00:00 bzorp openvpn[2499] PTHREAD support initialized",
+    "<15>Jan  1 01:00:00 bzorp openvpn: PTHREAD support initialized",
+    "<15>Jan  1 01:00:00 fe80::20c:29ff:fe1b:8e7c openvpn[2499]: message",
+    "<15>Jan  1 01:00:00 host:with:colons program: message",
+    "<15>Jan  1 01:00:00 bzorp some-very-long-program-name-that-spans-more-than-thirty-two-bytes[12345678901234567890]: msg",
+    "<15>Jan  1 01:00:00 host_with_invalid*chars program: message",
+    "<15>Message forwarded from bzorp: openvpn[2499]: message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine.example.com evntslog - ID47 [exampleSDID@0 iut=\"3\" eventSource=\"Application\" eventID=\"1011\"][examplePriority@0 class=\"high\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [a b=\"escaped \\\" quote and \\] bracket and \\\\ backslash and \\x invalid\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [Originator@6876 sub=Vimsvc.ha-eventmgr opID=esxui-13c6-6b16 sid=5214bde6 user=root] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [an-sd-id-that-is-longer-than-thirty-two-characters-for-sure x=\"y\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [foo= bar=\"baz\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [foo bar\"=\"baz\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [foo b\xc3\xa1r=\"baz\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [foo bar=\"unterminated ] value\"] message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 [foo bar=\"baz\" message",
+    "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - ID47 - message",
+  };
+  guint32 flag_sets[] =
+  {
+    LP_EXPECT_HOSTNAME | LP_STORE_LEGACY_MSGHDR,
+    LP_EXPECT_HOSTNAME | LP_CHECK_HOSTNAME,
+    LP_SYSLOG_PROTOCOL,
+  };
+
+  for (gint msg_ndx = 0; msg_ndx < G_N_ELEMENTS(messages); msg_ndx++)
+    {
+      for (gint flags_ndx = 0; flags_ndx < G_N_ELEMENTS(flag_sets); flags_ndx++)
+        {
+          cr_assert(syslog_format_scan_select_impl(SYSLOG_FORMAT_SCAN_SCALAR));
+          GString *expected = _parse_and_dump(messages[msg_ndx], flag_sets[flags_ndx]);
+
+          for (gint i = 0; i < G_N_ELEMENTS(all_impls); i++)
+            {
+              if (!syslog_format_scan_select_impl(all_impls[i]))
+                continue;
+
+              GString *actual = _parse_and_dump(messages[msg_ndx], flag_sets[flags_ndx]);
+              cr_assert_str_eq(actual->str, expected->str, "parsing result mismatch, impl=%d, msg=%s",
+                               all_impls[i], messages[msg_ndx]);
+              g_string_free(actual, TRUE);
+            }
+          g_string_free(expected, TRUE);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bench.h"
+#include "cfg.h"
+#include "cfg-lexer.h"
+#include "filterx/filterx-parser.h"
+#include "filterx/filterx-eval.h"
+
+#include <stdio.h>
+
+typedef struct _FilterXBenchState
+{
+  FilterXExpr *block;
+  LogMessage *msg;
+} FilterXBenchState;
+
+static gpointer
+_filterx_setup(const gchar *code)
+{
+  FilterXExpr *block = NULL;
+
+  CfgLexer *lexer = cfg_lexer_new_buffer(configuration, code, strlen(code));
+  if (!cfg_run_parser(configuration, lexer, &filterx_parser, (gpointer *) &block, NULL))
+    {
+      fprintf(stderr, "bench: error compiling filterx block: %s\n", code);
+      return NULL;
+    }
+
+  FilterXBenchState *state = g_new0(FilterXBenchState, 1);
+  state->block = block;
+  state->msg = bench_construct_sample_message();
+  return state;
+}
+
+static gpointer
+_filterx_setup_compare(const BenchOptions *options)
+{
+  return _filterx_setup("{ $PROGRAM == \"bench\"; $HOST == \"bench-host\"; }");
+}
+
+static gpointer
+_filterx_setup_assign(const BenchOptions *options)
+{
+  return _filterx_setup("{ $bench_out = $PROGRAM + \": \" + $MSG; $bench_host = $HOST; }");
+}
+
+static void
+_filterx_teardown(gpointer s)
+{
+  FilterXBenchState *state = (FilterXBenchState *) s;
+
+  filterx_expr_unref(state->block);
+  log_msg_unref(state->msg);
+  g_free(state);
+}
+
+/* one operation: evaluating the block in a new evaluation context, as a filterx pipe would */
+static guint64
+_filterx_eval(gpointer s, guint64 iterations)
+{
+  FilterXBenchState *state = (FilterXBenchState *) s;
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      FilterXEvalContext eval_context;
+
+      filterx_eval_init_context(&eval_context, NULL);
+      filterx_eval_exec(&eval_context, state->block, state->msg);
+      filterx_eval_deinit_context(&eval_context);
+    }
+  return iterations;
+}
+
+BenchCase bench_filterx_cases[] =
+{
+  { "filterx/compare", _filterx_setup_compare, _filterx_eval, _filterx_teardown },
+  { "filterx/assign", _filterx_setup_assign, _filterx_eval, _filterx_teardown },
+  { NULL }
+};
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bench.h"
+#include "logmsg/logmsg-serialize.h"
+#include "serialize.h"
+
+#define NVTABLE_BENCH_NUM_VALUES 8
+
+static volatile gsize sink;
+
+/* syslog-format */
+
+static guint64
+_parse_rfc3164(gpointer state, guint64 iterations)
+{
+  gsize length = strlen(BENCH_SAMPLE_RFC3164);
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      LogMessage *msg = log_msg_new_empty();
+      msg_format_parse_into(&bench_parse_options, msg, (const guchar *) BENCH_SAMPLE_RFC3164, length);
+      log_msg_unref(msg);
+    }
+  return iterations;
+}
+
+static guint64
+_parse_rfc5424(gpointer state, guint64 iterations)
+{
+  gsize length = strlen(BENCH_SAMPLE_RFC5424);
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      LogMessage *msg = log_msg_new_empty();
+      msg_format_parse_into(&bench_parse_options_rfc5424, msg, (const guchar *) BENCH_SAMPLE_RFC5424, length);
+      log_msg_unref(msg);
+    }
+  return iterations;
+}
+
+/* nvtable */
+
+typedef struct _NVTableBenchState
+{
+  NVHandle handles[NVTABLE_BENCH_NUM_VALUES];
+  LogMessage *msg;
+} NVTableBenchState;
+
+static gpointer
+_nvtable_setup(const BenchOptions *options)
+{
+  NVTableBenchState *state = g_new0(NVTableBenchState, 1);
+
+  state->msg = log_msg_new_empty();
+  for (gint i = 0; i < NVTABLE_BENCH_NUM_VALUES; i++)
+    {
+      gchar name[32];
+
+      g_snprintf(name, sizeof(name), "bench.value%d", i);
+      state->handles[i] = log_msg_get_value_handle(name);
+      log_msg_set_value(state->msg, state->handles[i], "value", -1);
+    }
+  return state;
+}
+
+static void
+_nvtable_teardown(gpointer s)
+{
+  NVTableBenchState *state = (NVTableBenchState *) s;
+
+  log_msg_unref(state->msg);
+  g_free(state);
+}
+
+/* one operation: setting all the values in a new message */
+static guint64
+_nvtable_set(gpointer s, guint64 iterations)
+{
+  NVTableBenchState *state = (NVTableBenchState *) s;
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      LogMessage *msg = log_msg_new_empty();
+      for (gint j = 0; j < NVTABLE_BENCH_NUM_VALUES; j++)
+        log_msg_set_value(msg, state->handles[j], "a somewhat longer value", -1);
+      log_msg_unref(msg);
+    }
+  return iterations;
+}
+
+/* one operation: looking up all the values */
+static guint64
+_nvtable_get(gpointer s, guint64 iterations)
+{
+  NVTableBenchState *state = (NVTableBenchState *) s;
+  gsize total = 0;
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      for (gint j = 0; j < NVTABLE_BENCH_NUM_VALUES; j++)
+        {
+          gssize len;
+
+          log_msg_get_value(state->msg, state->handles[j], &len);
+          total += len;
+        }
+    }
+  sink = total;
+  return iterations;
+}
+
+/* serialization */
+
+typedef struct _SerializeBenchState
+{
+  LogMessage *msg;
+  GString *serialized;
+} SerializeBenchState;
+
+static gpointer
+_serialize_setup(const BenchOptions *options)
+{
+  SerializeBenchState *state = g_new0(SerializeBenchState, 1);
+
+  state->msg = bench_construct_sample_message();
+  state->serialized = g_string_sized_new(4096);
+
+  SerializeArchive *sa = serialize_string_archive_new(state->serialized);
+  gboolean success = log_msg_serialize(state->msg, sa, 0);
+  serialize_archive_free(sa);
+
+  if (!success)
+    {
+      log_msg_unref(state->msg);
+      g_string_free(state->serialized, TRUE);
+      g_free(state);
+      return NULL;
+    }
+  return state;
+}
+
+static void
+_serialize_teardown(gpointer s)
+{
+  SerializeBenchState *state = (SerializeBenchState *) s;
+
+  log_msg_unref(state->msg);
+  g_string_free(state->serialized, TRUE);
+  g_free(state);
+}
+
+static guint64
+_serialize(gpointer s, guint64 iterations)
+{
+  SerializeBenchState *state = (SerializeBenchState *) s;
+  GString *buffer = g_string_sized_new(4096);
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      g_string_truncate(buffer, 0);
+
+      SerializeArchive *sa = serialize_string_archive_new(buffer);
+      log_msg_serialize(state->msg, sa, 0);
+      serialize_archive_free(sa);
+    }
+  g_string_free(buffer, TRUE);
+  return iterations;
+}
+
+static guint64
+_deserialize(gpointer s, guint64 iterations)
+{
+  SerializeBenchState *state = (SerializeBenchState *) s;
+
+  for (guint64 i = 0; i < iterations; i++)
+    {
+      LogMessage *msg = log_msg_new_empty();
+
+      SerializeArchive *sa = serialize_buffer_archive_new(state->serialized->str, state->serialized->len);
+      log_msg_deserialize(msg, sa);
+      serialize_archive_free(sa);
+      log_msg_unref(msg);
+    }
+  return iterations;
+}
+
+BenchCase bench_logmsg_cases[] =
+{
+  { "syslog-format/rfc3164", NULL, _parse_rfc3164, NULL },
+  { "syslog-format/rfc5424", NULL, _parse_rfc5424, NULL },
+  { "nvtable/set", _nvtable_setup, _nvtable_set, _nvtable_teardown },
+  { "nvtable/get", _nvtable_setup, _nvtable_get, _nvtable_teardown },
+  { "logmsg/serialize", _serialize_setup, _serialize, _serialize_teardown },
+  { "logmsg/deserialize", _serialize_setup, _deserialize, _serialize_teardown },
+  { NULL }
+};
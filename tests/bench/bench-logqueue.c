@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bench.h"
+#include "logqueue-fifo.h"
+#include "mainloop-worker.h"
+#include "stats/stats.h"
+
+#include <iv.h>
+
+/* the consumer acknowledges the backlog in batches, like a destination would */
+#define LOGQUEUE_BENCH_ACK_BATCH 100
+
+typedef struct _LogQueueBenchState
+{
+  gint producers;
+} LogQueueBenchState;
+
+typedef struct _LogQueueBenchRun
+{
+  LogQueue *queue;
+  guint64 messages_per_producer;
+} LogQueueBenchRun;
+
+static gpointer
+_setup_multiple_producers(const BenchOptions *options)
+{
+  LogQueueBenchState *state = g_new0(LogQueueBenchState, 1);
+
+  state->producers = options->threads;
+  return state;
+}
+
+static gpointer
+_setup_single_producer(const BenchOptions *options)
+{
+  LogQueueBenchState *state = g_new0(LogQueueBenchState, 1);
+
+  state->producers = 1;
+  return state;
+}
+
+static void
+_teardown(gpointer s)
+{
+  g_free(s);
+}
+
+static gpointer
+_producer_thread(gpointer s)
+{
+  LogQueueBenchRun *run = (LogQueueBenchRun *) s;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  iv_init();
+  main_loop_worker_thread_start(MLW_ASYNC_WORKER);
+
+  LogMessage *tmpl = log_msg_new_empty();
+  for (guint64 i = 0; i < run->messages_per_producer; i++)
+    {
+      LogMessage *msg = log_msg_clone_cow(tmpl, &path_options);
+      log_msg_add_ack(msg, &path_options);
+
+      log_queue_push_tail(run->queue, msg, &path_options);
+
+      if ((i & 0xFF) == 0)
+        main_loop_worker_invoke_batch_callbacks();
+    }
+  main_loop_worker_invoke_batch_callbacks();
+  log_msg_unref(tmpl);
+
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+/* one operation: a message pushed by one of the producers and popped/acked by the consumer */
+static guint64
+_push_pop(gpointer s, guint64 iterations)
+{
+  LogQueueBenchState *state = (LogQueueBenchState *) s;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  guint64 total = iterations * state->producers;
+  LogQueueBenchRun run =
+  {
+    .queue = log_queue_fifo_new((gint) MIN(total, G_MAXINT), NULL, STATS_LEVEL0, NULL, NULL),
+    .messages_per_producer = iterations,
+  };
+
+  GThread **producers = g_new0(GThread *, state->producers);
+  for (gint i = 0; i < state->producers; i++)
+    producers[i] = g_thread_new("bench-producer", _producer_thread, &run);
+
+  guint64 received = 0;
+  gint unacked = 0;
+  while (received < total)
+    {
+      LogMessage *msg = log_queue_pop_head(run.queue, &path_options);
+
+      if (!msg)
+        {
+          if (unacked)
+            {
+              log_queue_ack_backlog(run.queue, unacked);
+              unacked = 0;
+            }
+          g_thread_yield();
+          continue;
+        }
+
+      log_msg_unref(msg);
+      received++;
+
+      if (++unacked == LOGQUEUE_BENCH_ACK_BATCH)
+        {
+          log_queue_ack_backlog(run.queue, unacked);
+          unacked = 0;
+        }
+    }
+  if (unacked)
+    log_queue_ack_backlog(run.queue, unacked);
+
+  for (gint i = 0; i < state->producers; i++)
+    g_thread_join(producers[i]);
+  g_free(producers);
+
+  log_queue_unref(run.queue);
+  return total;
+}
+
+BenchCase bench_logqueue_cases[] =
+{
+  { "logqueue-fifo/push-pop-single-producer", _setup_single_producer, _push_pop, _teardown },
+  { "logqueue-fifo/push-pop", _setup_multiple_producers, _push_pop, _teardown },
+  { NULL }
+};
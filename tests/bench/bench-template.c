@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bench.h"
+#include "template/templates.h"
+#include "cfg.h"
+
+#include <stdio.h>
+
+typedef struct _TemplateBenchState
+{
+  LogTemplate *template;
+  LogMessage *msg;
+  GString *result;
+} TemplateBenchState;
+
+static TemplateBenchState *
+_template_setup(const gchar *template_str)
+{
+  TemplateBenchState *state = g_new0(TemplateBenchState, 1);
+  GError *error = NULL;
+
+  state->template = log_template_new(configuration, NULL);
+  if (!log_template_compile(state->template, template_str, &error))
+    {
+      fprintf(stderr, "bench: error compiling template: %s\n", error->message);
+      g_clear_error(&error);
+      log_template_unref(state->template);
+      g_free(state);
+      return NULL;
+    }
+
+  state->msg = bench_construct_sample_message();
+  state->result = g_string_sized_new(256);
+  return state;
+}
+
+static gpointer
+_template_setup_literal(const BenchOptions *options)
+{
+  return _template_setup("literal text without macros\n");
+}
+
+static gpointer
+_template_setup_rfc3164(const BenchOptions *options)
+{
+  return _template_setup("<$PRI>$DATE $HOST $MSGHDR$MSG\n");
+}
+
+static gpointer
+_template_setup_iso_date(const BenchOptions *options)
+{
+  return _template_setup("$ISODATE $HOST $PROGRAM[$PID]: $MSG\n");
+}
+
+/* literal + $VALUE pairs, without macros or functions: $HOST and $MSG
+ * would be resolved as macros, so only plain name-value pairs are used */
+static gpointer
+_template_setup_text_and_value(const BenchOptions *options)
+{
+  TemplateBenchState *state = _template_setup("program=$PROGRAM pid=$PID user=${.custom.user} "
+                                              "action=${.custom.action}\n");
+
+  if (!state)
+    return NULL;
+
+  log_msg_set_value_by_name(state->msg, ".custom.user", "bench", -1);
+  log_msg_set_value_by_name(state->msg, ".custom.action", "login", -1);
+  return state;
+}
+
+static void
+_template_teardown(gpointer s)
+{
+  TemplateBenchState *state = (TemplateBenchState *) s;
+
+  log_template_unref(state->template);
+  log_msg_unref(state->msg);
+  g_string_free(state->result, TRUE);
+  g_free(state);
+}
+
+static guint64
+_template_format(gpointer s, guint64 iterations)
+{
+  TemplateBenchState *state = (TemplateBenchState *) s;
+  LogTemplateEvalOptions options = DEFAULT_TEMPLATE_EVAL_OPTIONS;
+
+  for (guint64 i = 0; i < iterations; i++)
+    log_template_format(state->template, state->msg, &options, state->result);
+  return iterations;
+}
+
+BenchCase bench_template_cases[] =
+{
+  { "template/literal", _template_setup_literal, _template_format, _template_teardown },
+  { "template/rfc3164", _template_setup_rfc3164, _template_format, _template_teardown },
+  { "template/iso-date", _template_setup_iso_date, _template_format, _template_teardown },
+  { "template/text-and-value", _template_setup_text_and_value, _template_format, _template_teardown },
+  { NULL }
+};
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "bench.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "mainloop-worker.h"
+#include "atomic-gssize.h"
+#include "libtest/msg_parse_lib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+MsgFormatOptions bench_parse_options;
+MsgFormatOptions bench_parse_options_rfc5424;
+
+static gint threads = 4;
+static gint repeat = 5;
+static gint min_time_msec = 200;
+static gchar *filter = NULL;
+static gchar *output = NULL;
+
+static GOptionEntry bench_options[] =
+{
+  { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter, "Run only the cases matching this glob pattern", "<pattern>" },
+  { "threads", 't', 0, G_OPTION_ARG_INT, &threads, "Number of producer threads in multi-threaded cases", "<n>" },
+  { "repeat", 'r', 0, G_OPTION_ARG_INT, &repeat, "Number of measurements per case, the median is reported", "<n>" },
+  { "min-time", 'm', 0, G_OPTION_ARG_INT, &min_time_msec, "Minimum duration of a single measurement", "<msec>" },
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the results to this file instead of stdout", "<file>" },
+  { NULL }
+};
+
+/*
+ * Allocation counting
+ *
+ * The allocator entry points are interposed in the benchmark executable,
+ * so every malloc()/calloc()/realloc()/posix_memalign() call of the
+ * process is counted, including the ones done by glib and libsyslog-ng.
+ * This relies on the glibc internal entry points, elsewhere (and under
+ * sanitizers, which interpose these functions themselves) allocations are
+ * not reported.
+ */
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define BENCH_COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static atomic_gssize allocations;
+
+void *
+malloc(size_t size)
+{
+  atomic_gssize_inc(&allocations);
+  return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  atomic_gssize_inc(&allocations);
+  return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  atomic_gssize_inc(&allocations);
+  return __libc_realloc(ptr, size);
+}
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+  atomic_gssize_inc(&allocations);
+  *memptr = __libc_memalign(alignment, size);
+  return *memptr ? 0 : ENOMEM;
+}
+
+static inline gssize
+_get_allocations(void)
+{
+  return atomic_gssize_get(&allocations);
+}
+
+#else
+
+static inline gssize
+_get_allocations(void)
+{
+  return 0;
+}
+
+#endif
+
+LogMessage *
+bench_construct_sample_message(void)
+{
+  LogMessage *msg = log_msg_new_empty();
+
+  msg_format_parse_into(&bench_parse_options, msg, (const guchar *) BENCH_SAMPLE_RFC3164,
+                        strlen(BENCH_SAMPLE_RFC3164));
+  return msg;
+}
+
+typedef struct _BenchMeasurement
+{
+  guint64 ops;
+  gdouble elapsed;
+  gssize allocations;
+} BenchMeasurement;
+
+static void
+_measure(const BenchCase *bench_case, gpointer state, guint64 iterations, BenchMeasurement *measurement)
+{
+  struct timespec start, end;
+
+  gssize allocations_before = _get_allocations();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  measurement->ops = bench_case->run(state, iterations);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  measurement->allocations = _get_allocations() - allocations_before;
+  measurement->elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/* find the number of iterations that takes at least min-time */
+static guint64
+_calibrate(const BenchCase *bench_case, gpointer state)
+{
+  gdouble min_time = min_time_msec / 1000.0;
+  guint64 iterations = 1;
+  BenchMeasurement measurement;
+
+  while (TRUE)
+    {
+      _measure(bench_case, state, iterations, &measurement);
+      if (measurement.elapsed >= min_time / 10 || iterations >= G_MAXUINT32)
+        break;
+      iterations *= 2;
+    }
+
+  if (measurement.elapsed <= 0)
+    return iterations;
+  return MAX(1, (guint64) (iterations * (min_time / measurement.elapsed)));
+}
+
+static gint
+_compare_doubles(gconstpointer a, gconstpointer b)
+{
+  gdouble x = *(const gdouble *) a;
+  gdouble y = *(const gdouble *) b;
+
+  return (x > y) - (x < y);
+}
+
+static void
+_append_double(GString *json, const gchar *format, gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_string_append(json, g_ascii_formatd(buf, sizeof(buf), format, value));
+}
+
+static gboolean
+_run_case(const BenchCase *bench_case, const BenchOptions *options, GString *json)
+{
+  gpointer state = NULL;
+
+  if (bench_case->setup && !(state = bench_case->setup(options)))
+    {
+      fprintf(stderr, "bench: error setting up case %s, skipping\n", bench_case->name);
+      return FALSE;
+    }
+
+  guint64 iterations = _calibrate(bench_case, state);
+
+  gdouble *ns_per_op = g_new0(gdouble, repeat);
+  guint64 total_ops = 0;
+  gssize total_allocations = 0;
+  for (gint i = 0; i < repeat; i++)
+    {
+      BenchMeasurement measurement;
+
+      _measure(bench_case, state, iterations, &measurement);
+      ns_per_op[i] = measurement.ops ? measurement.elapsed * 1e9 / measurement.ops : 0;
+      total_ops += measurement.ops;
+      total_allocations += measurement.allocations;
+    }
+  qsort(ns_per_op, repeat, sizeof(ns_per_op[0]), _compare_doubles);
+
+  if (bench_case->teardown)
+    bench_case->teardown(state);
+
+  g_string_append_printf(json, "    {\"name\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT ", ",
+                         bench_case->name, iterations);
+  g_string_append(json, "\"ns_per_op\": ");
+  _append_double(json, "%.1f", ns_per_op[repeat / 2]);
+  g_string_append(json, ", \"ns_per_op_min\": ");
+  _append_double(json, "%.1f", ns_per_op[0]);
+  g_string_append(json, ", \"allocs_per_op\": ");
+#ifdef BENCH_COUNT_ALLOCATIONS
+  _append_double(json, "%.2f", total_ops ? (gdouble) total_allocations / total_ops : 0);
+#else
+  g_string_append(json, "null");
+#endif
+  g_string_append(json, "}");
+
+  fprintf(stderr, "bench: %-40s %12.1f ns/op\n", bench_case->name, ns_per_op[repeat / 2]);
+  g_free(ns_per_op);
+  return TRUE;
+}
+
+static void
+_run_cases(const BenchCase *cases, const BenchOptions *options, GString *json, gboolean *first)
+{
+  for (const BenchCase *bench_case = cases; bench_case->name; bench_case++)
+    {
+      if (filter && !g_pattern_match_simple(filter, bench_case->name))
+        continue;
+
+      gsize len = json->len;
+      if (!*first)
+        g_string_append(json, ",\n");
+
+      if (_run_case(bench_case, options, json))
+        *first = FALSE;
+      else
+        g_string_truncate(json, len);
+    }
+}
+
+static void
+_setup(void)
+{
+  app_startup();
+
+  init_parse_options_and_load_syslogformat(&bench_parse_options);
+  msg_format_options_defaults(&bench_parse_options_rfc5424);
+  msg_format_options_init(&bench_parse_options_rfc5424, configuration);
+  bench_parse_options_rfc5424.flags |= LP_SYSLOG_PROTOCOL;
+
+  configuration->stats_options.level = 1;
+  cfg_init(configuration);
+
+  /* producer threads of the logqueue cases register as worker threads */
+  main_loop_worker_allocate_thread_space(threads);
+  main_loop_worker_finalize_thread_space();
+}
+
+static void
+_teardown(void)
+{
+  msg_format_options_destroy(&bench_parse_options_rfc5424);
+  msg_format_options_destroy(&bench_parse_options);
+  deinit_syslogformat_module();
+  app_shutdown();
+}
+
+int
+main(int argc, char *argv[])
+{
+  GError *error = NULL;
+  GOptionContext *ctx = g_option_context_new("- syslog-ng microbenchmarks");
+
+  g_option_context_add_main_entries(ctx, bench_options, NULL);
+  if (!g_option_context_parse(ctx, &argc, &argv, &error))
+    {
+      fprintf(stderr, "bench: %s\n", error->message);
+      g_clear_error(&error);
+      g_option_context_free(ctx);
+      return 1;
+    }
+  g_option_context_free(ctx);
+
+  if (threads < 1 || repeat < 1 || min_time_msec < 1)
+    {
+      fprintf(stderr, "bench: --threads, --repeat and --min-time must be positive\n");
+      return 1;
+    }
+
+  _setup();
+
+  BenchOptions options = { .threads = threads };
+  GString *json = g_string_new("{\n");
+  gboolean first = TRUE;
+
+  g_string_append_printf(json, "  \"version\": \"%s\",\n", SYSLOG_NG_VERSION);
+  g_string_append_printf(json, "  \"threads\": %d,\n", threads);
+  g_string_append(json, "  \"benchmarks\": [\n");
+
+  _run_cases(bench_logmsg_cases, &options, json, &first);
+  _run_cases(bench_template_cases, &options, json, &first);
+  _run_cases(bench_filterx_cases, &options, json, &first);
+  _run_cases(bench_logqueue_cases, &options, json, &first);
+
+  g_string_append(json, "\n  ]\n}\n");
+
+  _teardown();
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out)
+    {
+      fprintf(stderr, "bench: error opening output file %s: %s\n", output, g_strerror(errno));
+      g_string_free(json, TRUE);
+      return 1;
+    }
+  fputs(json->str, out);
+  if (out != stdout)
+    fclose(out);
+
+  g_string_free(json, TRUE);
+  return 0;
+}
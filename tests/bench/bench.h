@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Axoflow
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "logmsg/logmsg.h"
+#include "msg-format.h"
+
+typedef struct _BenchOptions
+{
+  /* number of producer threads for multi-threaded cases */
+  gint threads;
+} BenchOptions;
+
+/*
+ * A benchmark case.  setup() prepares everything that should not be
+ * measured, run() is timed and has to perform @iterations rounds of the
+ * measured operation.  It returns the number of operations it performed,
+ * which may differ from @iterations (e.g. in multi-threaded cases).
+ */
+typedef struct _BenchCase
+{
+  const gchar *name;
+  gpointer (*setup)(const BenchOptions *options);
+  guint64 (*run)(gpointer state, guint64 iterations);
+  void (*teardown)(gpointer state);
+} BenchCase;
+
+#define BENCH_SAMPLE_RFC3164 \
+  "<34>Oct 11 22:14:15 bench-host bench[1234]: 'su root' failed for lonvick on /dev/pts/8"
+#define BENCH_SAMPLE_RFC5424 \
+  "<165>1 2003-10-11T22:14:15.003Z bench-host evntslog 1234 ID47 " \
+  "[exampleSDID@32473 iut=\"3\" eventSource=\"Application\" eventID=\"1011\"] " \
+  "An application event log entry"
+
+extern MsgFormatOptions bench_parse_options;
+extern MsgFormatOptions bench_parse_options_rfc5424;
+
+LogMessage *bench_construct_sample_message(void);
+
+extern BenchCase bench_logmsg_cases[];
+extern BenchCase bench_template_cases[];
+extern BenchCase bench_filterx_cases[];
+extern BenchCase bench_logqueue_cases[];
+
+#endif